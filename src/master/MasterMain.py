@@ -318,11 +318,15 @@ class CmdGui:
                 status_str += "  Axes confidence: [{:.1f}%, {:.1f}%, {:.1f}%]\n".format(
                     status_dict['localization_confidence_x']*100,status_dict['localization_confidence_y']*100,status_dict['localization_confidence_a']*100)
                 status_str += "Localization position uncertainty: {:.2f}\n".format(status_dict['last_position_uncertainty'])
-                status_str += "Controller timing: {} ms\n".format(status_dict['controller_loop_ms'])
-                status_str += "Position timing:   {} ms\n".format(status_dict['position_loop_ms'])
-                status_str += "Camera timing:   {} ms\n".format(status_dict['cam_loop_ms'])
+                status_str += "Controller timing: {:.1f} ms (p99 {:.1f} ms, max {:.1f} ms)\n".format(
+                    status_dict['controller_loop_ms'], status_dict['controller_loop_p99_ms'], status_dict['controller_loop_max_ms'])
+                status_str += "Position timing:   {:.1f} ms\n".format(status_dict['position_loop_ms'])
+                status_str += "Camera timing:   {:.1f} ms\n".format(status_dict['cam_loop_ms'])
+                status_str += "Camera latency: Side {} ms | Rear {} ms\n".format(status_dict['cam_side_latency_ms'], status_dict['cam_rear_latency_ms'])
+                status_str += "Camera dropped frames: Side {} | Rear {}\n".format(status_dict['cam_side_dropped_frames'], status_dict['cam_rear_dropped_frames'])
                 status_str += "Current action:   {}\n".format(status_dict['current_action'].split('.')[-1])
-                status_str += "Motion in progress: {}\n".format(status_dict["in_progress"])
+                status_str += "Motion in progress: {} (base {}, tray {})\n".format(status_dict["in_progress"],
+                    status_dict.get("base_in_progress", "?"), status_dict.get("tray_in_progress", "?"))
                 status_str += "Has error: {}\n".format(status_dict["error_status"])
                 status_str += "Counter:   {}\n".format(status_dict['counter'])
 
@@ -12,6 +12,7 @@ PORT = 8123
 NET_TIMEOUT = 0.1 # seconds
 START_CHAR = "<"
 END_CHAR = ">"
+ROBOT_BUFFER_SIZE = 2048 # bytes, BUFFER_SIZE in the robot's SocketMultiThreadWrapper.h
 
 class TcpClient:
 
@@ -186,6 +187,16 @@ class ClientBase:
             return None
         return resp['data']
 
+    def request_perf(self):
+        """ Request robot loop timing (count, mean, p50, p99, max in microseconds for each stage) """
+        msg = {'type' : 'perf'}
+        self.client.send(json.dumps(msg))
+        resp = self.wait_for_server_response(expected_msg_type='perf')
+        if not resp:
+            logging.warning("Did not recieve perf response")
+            return None
+        return resp['data']
+
     def estop(self):
         """ Tell client to estop """
         msg = {'type': 'estop'}
@@ -235,6 +246,11 @@ class RobotClient(ClientBase):
         msg = {'type': 'move_const_vel', 'data': {'vx': vx, 'vy': vy, 'va': va, 't': t}}
         self.send_msg_and_wait_for_ack(msg)
 
+    def jog(self, vx, vy, va):
+        """ Stream a velocity setpoint to the robot. It ramps down to a stop unless the next one comes within its deadman timeout"""
+        msg = {'type': 'jog', 'data': {'vx': vx, 'vy': vy, 'va': va}}
+        self.send_msg_and_wait_for_ack(msg)
+
     def place(self):
         """ Tell robot to place pallet """
         msg = {'type': 'place'}
@@ -285,6 +301,28 @@ class RobotClient(ClientBase):
         msg = {'type': 'stop_cameras'}
         self.send_msg_and_wait_for_ack(msg)
 
+    def sequence(self, steps):
+        """ Tell robot to run a list of commands on its own. Each step is a message like the single commands
+        use, e.g. {'type': 'move', 'data': {...}}, with optional 'timeout' (s), 'condition' ('localized' or
+        'vision') and 'with_previous' (start alongside the previous step if its lane is free) fields.
+        The whole message has to fit in the robot's socket buffer (ROBOT_BUFFER_SIZE, roughly 30 move steps).
+        The robot drops anything bigger without replying, so a sequence that is too long raises ValueError instead"""
+        msg = {'type': 'sequence', 'data': {'steps': steps}}
+        msg_size = len(json.dumps(msg,separators=(',',':')).encode()) + len(START_CHAR) + len(END_CHAR)
+        if msg_size >= ROBOT_BUFFER_SIZE:
+            raise ValueError("Sequence message is {} bytes but the robot can only take {}, split it up".format(msg_size, ROBOT_BUFFER_SIZE - 1))
+        self.send_msg_and_wait_for_ack(msg)
+
+    def abort_sequence(self):
+        """ Tell robot to drop the steps of the current sequence that haven't started yet"""
+        msg = {'type': 'abort_sequence'}
+        self.send_msg_and_wait_for_ack(msg)
+
+    def speed_override(self, speed):
+        """ Tell robot to run the current and following moves this many times faster than planned, e.g. 0.5 for half speed"""
+        msg = {'type': 'speed_override', 'data': {'speed': speed}}
+        self.send_msg_and_wait_for_ack(msg)
+
 class BaseStationClient(ClientBase):
     
     def __init__(self, cfg):
@@ -330,6 +368,9 @@ class MockRobotClient:
 
     def request_status(self):
         return {"in_progress": False, "pos_x": 1, "pos_y": 2, "pos_a": 0}
+
+    def request_perf(self):
+        return {}
     
     def clear_error(self):
         pass
@@ -337,6 +378,15 @@ class MockRobotClient:
     def wait_for_localization(self):
         pass
 
+    def sequence(self, steps):
+        pass
+
+    def abort_sequence(self):
+        pass
+
+    def speed_override(self, speed):
+        pass
+
     def toggle_distance(self):
         pass
 
@@ -0,0 +1,79 @@
+import argparse
+import json
+import pickle
+
+from Utils import ActionTypes
+
+
+def _move(msg_type):
+    return lambda action: {'type': msg_type, 'data': {'x': action.x, 'y': action.y, 'a': action.a}}
+
+def _simple(msg_type):
+    return lambda action: {'type': msg_type}
+
+# Same messages RobotClient sends for each action. WAIT is handled by master, so it gets its own
+# message type that only the plan executor understands.
+ACTION_MESSAGES = {
+    ActionTypes.MOVE_COARSE: _move('move'),
+    ActionTypes.MOVE_REL: _move('move_rel'),
+    ActionTypes.MOVE_REL_SLOW: _move('move_rel_slow'),
+    ActionTypes.MOVE_FINE: _move('move_fine'),
+    ActionTypes.MOVE_FINE_STOP_VISION: _move('move_fine_stop_vision'),
+    ActionTypes.MOVE_WITH_VISION: _move('move_vision'),
+    ActionTypes.SET_POSE: _move('set_pose'),
+    ActionTypes.MOVE_CONST_VEL: lambda action: {'type': 'move_const_vel', 'data': {'vx': action.vx, 'vy': action.vy, 'va': action.va, 't': action.t}},
+    ActionTypes.WAIT: lambda action: {'type': 'wait', 'data': {'t': action.time}},
+    ActionTypes.LOAD: _simple('load'),
+    ActionTypes.PLACE: _simple('place'),
+    ActionTypes.TRAY_INIT: _simple('init'),
+    ActionTypes.LOAD_COMPLETE: _simple('lc'),
+    ActionTypes.WAIT_FOR_LOCALIZATION: _simple('wait_for_loc'),
+    ActionTypes.CLEAR_ERROR: _simple('clear_error'),
+    ActionTypes.TOGGLE_VISION_DEBUG: _simple('toggle_vision_debug'),
+    ActionTypes.START_CAMERAS: _simple('start_cameras'),
+    ActionTypes.STOP_CAMERAS: _simple('stop_cameras'),
+}
+
+
+class PlanUnpickler(pickle.Unpickler):
+    """ Plans are saved from FieldPlanner.py run as a script, so their classes live in __main__ """
+    def find_class(self, module, name):
+        if module == '__main__':
+            import FieldPlanner
+            return getattr(FieldPlanner, name)
+        return super().find_class(module, name)
+
+
+def load_plan(path):
+    with open(path, 'rb') as f:
+        return PlanUnpickler(f).load()
+
+
+def plan_to_commands(plan, robot_id=None):
+    """ Returns the command file lines for every cycle in the plan, optionally only those assigned to robot_id """
+    lines = []
+    for cycle in plan.cycles:
+        if robot_id is not None and cycle.robot_id != robot_id:
+            continue
+        lines.append("# cycle {} ({})".format(cycle.id, cycle.robot_id))
+        for action in cycle.action_sequence:
+            make_msg = ACTION_MESSAGES.get(action.action_type)
+            if make_msg is None:
+                # Network checks, pauses and estops don't take any robot time
+                lines.append("# skipped {} ({})".format(action.action_type.name, action.name))
+                continue
+            lines.append(json.dumps(make_msg(action), separators=(',', ':')))
+    return lines
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="Export a .p plan to a command file for the robot plan executor (src/robot/bench/plan_executor.cpp)")
+    parser.add_argument('plan', help="Pickled plan from FieldPlanner.py")
+    parser.add_argument('output', help="Command file to write")
+    parser.add_argument('--robot', default=None, help="Only export cycles assigned to this robot, e.g. robot1")
+    args = parser.parse_args()
+
+    lines = plan_to_commands(load_plan(args.plan), args.robot)
+    with open(args.output, 'w') as f:
+        f.write("\n".join(lines) + "\n")
+    print("Wrote {} lines to {}".format(len(lines), args.output))
@@ -3,9 +3,8 @@ from scp import SCPClient
 import os
 import matplotlib.pyplot as plt
 import config
-import csv
 import numpy as np
-import datetime
+import telemetry_convert
 
 possible_rows = [
     'time',
@@ -35,47 +34,15 @@ def scp_last_motion_log(ip, remote_path, local_path):
     if not os.path.exists(local_path):
         raise ValueError("SCP image did not complete successfully")
 
-def init_data():
-    data = {name:[] for name in possible_rows}
-    data['title'] = ""
-    data['start_time'] = None
-    return data
-
 def parse_log_file(path):
-
-    data = init_data()
-    with open(local_file) as csvfile:
-        reader = csv.reader(csvfile, delimiter=";")
-        for id,row in enumerate(reader):
-            if id == 0:
-                continue
-            elif id == 1:
-                data['title'] = row[-1].replace('"','')
-            else:
-                parse_row(row, data)
-
+    """ Reads the last motion from a telemetry file into the rows used for plotting """
+    telemetry = telemetry_convert.select_motion(telemetry_convert.read_telemetry(path), -1)
+    data = {name: telemetry[name] for name in possible_rows if name in telemetry}
+    data['time'] = (telemetry['timestamp_us'] - telemetry['timestamp_us'][0]) / 1e6
+    mode = telemetry_convert.LIMITS_MODE_NAMES[telemetry['limits_mode'][0]]
+    data['title'] = "Motion {} ({})".format(telemetry['motion_id'][0], mode)
     return data
 
-def parse_row(row, data):
-    entry_data = row[-1].replace('"','').split(",")
-    entry_name = entry_data[0]
-    entry_values = entry_data[1:]
-    entry_time = datetime.datetime.strptime(row[1], '%H:%M:%S.%f')
-
-    if entry_name == "time":
-        if not data["start_time"]:
-            data["start_time"] = entry_time
-            data["time"].append(0)
-        else:
-            dt = (entry_time - data['start_time'])/ datetime.timedelta(seconds=1)
-            data["time"].append(dt)
-
-    else:
-        for i,axis in enumerate(['x','y','a']):
-            axis_name = entry_name+'_'+axis
-            axis_value = float(entry_values[i])
-            data[axis_name].append(axis_value)
-
 def plot_data(data, rows_to_plot=None):
     if not rows_to_plot:
         rows_to_plot = possible_rows[1:]
@@ -101,12 +68,12 @@ if __name__ == '__main__':
     cfg = config.Config()
 
     GET_FILE = True
-    EXISTING_LOCAL_FILENAME = "WiggleVision.csv"
+    EXISTING_LOCAL_FILENAME = "WiggleVision.bin"
 
     if GET_FILE:
         robot_ip = cfg.ip_map['robot1']
-        remote_file = "/home/pi/DominoRobot/src/robot/log/last_motion_log.csv"
-        local_file = os.path.join(cfg.log_folder, "last_motion_log.csv")
+        remote_file = "/home/pi/DominoRobot/src/robot/log/telemetry.bin"
+        local_file = os.path.join(cfg.log_folder, "telemetry.bin")
         scp_last_motion_log(robot_ip, remote_file, local_file)
     else:
         local_file = os.path.join(cfg.log_folder, EXISTING_LOCAL_FILENAME)
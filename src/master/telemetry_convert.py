@@ -0,0 +1,85 @@
+import argparse
+import csv
+import struct
+import numpy as np
+
+# Must match TelemetryFileHeader in src/robot/src/TelemetryRecorder.h
+HEADER_FORMAT = '<8sIIIIQ512s'
+MAGIC = b'DRTELEM'
+TYPE_MAP = {'u64': '<u8', 'u32': '<u4', 'u16': '<u2', 'f32': '<f4'}
+LIMITS_MODE_NAMES = ['COARSE', 'FINE', 'VISION', 'SLOW']
+
+
+def read_telemetry(path):
+    """ Reads a telemetry ring file and returns a dict of column name -> numpy array, oldest record first """
+    with open(path, 'rb') as f:
+        raw = f.read()
+
+    header_size = struct.calcsize(HEADER_FORMAT)
+    magic, version, file_header_size, record_size, capacity, record_count, schema = \
+        struct.unpack(HEADER_FORMAT, raw[:header_size])
+    if magic.rstrip(b'\0') != MAGIC:
+        raise ValueError("{} is not a telemetry file".format(path))
+
+    fields = []
+    for entry in schema.rstrip(b'\0').decode().split(','):
+        name, type_name = entry.split(':')
+        fields.append((name, TYPE_MAP[type_name]))
+    dtype = np.dtype(fields)
+    if dtype.itemsize > record_size:
+        raise ValueError("Schema does not fit in record size {}".format(record_size))
+    dtype = np.dtype({'names': dtype.names, 'formats': [dtype.fields[n][0] for n in dtype.names],
+                      'offsets': [dtype.fields[n][1] for n in dtype.names], 'itemsize': record_size})
+
+    records = np.frombuffer(raw, dtype=dtype, count=capacity, offset=file_header_size)
+
+    # Unroll the ring so the oldest record comes first
+    num_valid = min(record_count, capacity)
+    start = record_count % capacity if record_count > capacity else 0
+    order = (np.arange(num_valid) + start) % capacity
+    records = records[order]
+
+    return {name: np.array(records[name]) for name in dtype.names}
+
+
+def select_motion(data, motion_id):
+    """ Returns only the records of a single motion. A motion_id of -1 selects the last motion """
+    if motion_id < 0:
+        running = data['motion_id'][data['traj_running'] == 1]
+        if len(running) == 0:
+            raise ValueError("No motion found in telemetry")
+        motion_id = running[-1]
+    mask = (data['motion_id'] == motion_id) & (data['traj_running'] == 1)
+    return {name: values[mask] for name, values in data.items()}
+
+
+def write_csv(data, path):
+    names = list(data.keys())
+    with open(path, 'w', newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(names)
+        for row in zip(*[data[name] for name in names]):
+            writer.writerow(row)
+
+
+def write_columnar(data, path):
+    """ Column per array, loadable with np.load(path) """
+    np.savez_compressed(path, **data)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="Convert robot telemetry ring files to CSV or columnar npz")
+    parser.add_argument('input', help="Telemetry file, e.g. log/telemetry.bin")
+    parser.add_argument('output', help="Output file, .csv or .npz")
+    parser.add_argument('--motion', type=int, default=None, help="Only export this motion id, -1 for the last motion")
+    args = parser.parse_args()
+
+    data = read_telemetry(args.input)
+    if args.motion is not None:
+        data = select_motion(data, args.motion)
+
+    if args.output.endswith('.npz'):
+        write_columnar(data, args.output)
+    else:
+        write_csv(data, args.output)
+    print("Wrote {} records to {}".format(len(data['timestamp_us']), args.output))
@@ -0,0 +1,342 @@
+// Microbenchmarks for the hot paths of the control loop and vision pipeline. Each benchmark is
+// calibrated to a batch size that takes a measurable amount of time, then timed over several
+// batches. Prints a table and optionally writes the results as JSON so runs can be compared.
+//
+// Usage:
+//   micro-bench [-o results.json] [-f name_filter] [-t ms_per_benchmark] [-i camera_image]
+//
+// -f only runs benchmarks whose name contains the filter. -i sets the frame used for the
+// camera pipeline benchmarks, by default the first side image in test/testdata/images.
+
+#include <plog/Log.h>
+#include <plog/Init.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include <plog/Appenders/ColorConsoleAppender.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+#include "constants.h"
+#include "utils.h"
+#include "KalmanFilter.h"
+#include "RobotServer.h"
+#include "SmoothTrajectoryGenerator.h"
+#include "StatusUpdater.h"
+#include "camera_tracker/CameraPipeline.h"
+#include "sockets/SocketMultiThreadWrapperFactory.h"
+#include "sockets/MockSocketMultiThreadWrapper.h"
+
+libconfig::Config cfg = libconfig::Config();
+
+// Number of timed batches per benchmark
+constexpr int num_samples = 15;
+// Largest batch size tried while calibrating
+constexpr long max_batch_size = 1 << 24;
+
+struct BenchResult
+{
+    std::string name;
+    long batch_size;
+    double median_ns;
+    double min_ns;
+    double p90_ns;
+};
+
+// Keeps the compiler from optimizing away a result that is never used
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class BenchRunner
+{
+  public:
+
+    BenchRunner(const std::string& filter, float ms_per_benchmark)
+    : filter_(filter),
+      sample_ns_(ms_per_benchmark * 1e6 / num_samples),
+      results_()
+    {}
+
+    // Times fn, which runs one operation per call. after_batch runs untimed after each batch,
+    // for clean up that would otherwise build up across a batch.
+    void run(const std::string& name, const std::function<void()>& fn, const std::function<void()>& after_batch = [](){})
+    {
+        if(!filter_.empty() && name.find(filter_) == std::string::npos) return;
+
+        // Find a batch size that takes about one sample period
+        long batch_size = 1;
+        while(batch_size < max_batch_size && timeBatch(fn, batch_size) < sample_ns_)
+        {
+            after_batch();
+            batch_size *= 2;
+        }
+        after_batch();
+
+        std::vector<double> ns_per_op;
+        for(int i = 0; i < num_samples; i++)
+        {
+            ns_per_op.push_back(timeBatch(fn, batch_size) / batch_size);
+            after_batch();
+        }
+        std::sort(ns_per_op.begin(), ns_per_op.end());
+        BenchResult result = {name, batch_size, ns_per_op[num_samples / 2], ns_per_op.front(), ns_per_op[num_samples * 9 / 10]};
+        results_.push_back(result);
+        printf("  %-44s %12.1f ns %12.1f ns %12.1f ns %10li\n", name.c_str(), result.median_ns, result.min_ns, result.p90_ns, batch_size);
+    }
+
+    const std::vector<BenchResult>& getResults() const { return results_; };
+
+  private:
+
+    double timeBatch(const std::function<void()>& fn, long batch_size)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for(long i = 0; i < batch_size; i++)
+        {
+            fn();
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string filter_;
+    double sample_ns_;
+    std::vector<BenchResult> results_;
+};
+
+void configure_logger()
+{
+    // Logging would dominate several of the benchmarks, so only show errors
+    static plog::ColorConsoleAppender<plog::TxtFormatter> consoleAppender;
+    plog::init(plog::error, &consoleAppender);
+}
+
+std::string limitsModeName(LIMITS_MODE mode)
+{
+    switch(mode)
+    {
+        case LIMITS_MODE::COARSE: return "coarse";
+        case LIMITS_MODE::FINE: return "fine";
+        case LIMITS_MODE::VISION: return "vision";
+        case LIMITS_MODE::SLOW: return "slow";
+    }
+    return "";
+}
+
+void benchTrajectory(BenchRunner& runner)
+{
+    SolverParameters solver = getSolverParameters();
+    for(LIMITS_MODE mode : {LIMITS_MODE::COARSE, LIMITS_MODE::FINE, LIMITS_MODE::VISION})
+    {
+        for(float dist : {0.05, 0.5, 5.0})
+        {
+            MotionPlanningProblem mpp = buildMotionPlanningProblem({0, 0, 0}, {dist, dist / 2, 0.5}, mode, solver);
+            char name[64];
+            snprintf(name, sizeof(name), "generateTrajectory/%s/%.2fm", limitsModeName(mode).c_str(), dist);
+            runner.run(name, [&]() { doNotOptimize(generateTrajectory(mpp)); });
+        }
+    }
+
+    SmoothTrajectoryGenerator traj_gen;
+    traj_gen.generatePointToPointTrajectory({0, 0, 0}, {3, 1, 1}, LIMITS_MODE::COARSE);
+    float t = 0;
+    runner.run("SmoothTrajectoryGenerator::lookup", [&]()
+    {
+        doNotOptimize(traj_gen.lookup(t));
+        // Walk through every region of the trajectory
+        t += 0.001;
+        if(t > 15) t = 0;
+    });
+}
+
+void benchKalmanFilter(BenchRunner& runner)
+{
+    // Same shape as the localization filter
+    Eigen::MatrixXf I = Eigen::MatrixXf::Identity(3,3);
+    Eigen::MatrixXf Q = 0.01 * I;
+    Eigen::MatrixXf R = 0.1 * I;
+    KalmanFilter kf(I, I, I, Q, R);
+    Eigen::VectorXf u(3);
+    u << 0.01, 0.005, 0.001;
+    Eigen::VectorXf y(3);
+    y << 1.0, 0.5, 0.1;
+
+    runner.run("KalmanFilter::predict", [&]() { kf.predict(u); });
+    runner.run("KalmanFilter::update", [&]() { kf.update(y); });
+    runner.run("KalmanFilter::update/R", [&]() { kf.update(y, R); });
+}
+
+void benchRobotServer(BenchRunner& runner)
+{
+    SocketMultiThreadWrapperFactory::getFactoryInstance()->set_mode(SOCKET_FACTORY_MODE::MOCK);
+    MockSocketMultiThreadWrapper* socket = dynamic_cast<MockSocketMultiThreadWrapper*>(SocketMultiThreadWrapperFactory::getFactoryInstance()->get_socket());
+    StatusUpdater status_updater;
+    RobotServer server(status_updater);
+
+    // One of every message master sends
+    const std::vector<std::pair<std::string, std::string>> messages = {
+        {"move", "{\"type\":\"move\",\"data\":{\"x\":1.23,\"y\":4.56,\"a\":0.78}}"},
+        {"move_rel", "{\"type\":\"move_rel\",\"data\":{\"x\":1.23,\"y\":4.56,\"a\":0.78}}"},
+        {"move_rel_slow", "{\"type\":\"move_rel_slow\",\"data\":{\"x\":1.23,\"y\":4.56,\"a\":0.78}}"},
+        {"move_fine", "{\"type\":\"move_fine\",\"data\":{\"x\":1.23,\"y\":4.56,\"a\":0.78}}"},
+        {"move_fine_stop_vision", "{\"type\":\"move_fine_stop_vision\",\"data\":{\"x\":1.23,\"y\":4.56,\"a\":0.78}}"},
+        {"move_vision", "{\"type\":\"move_vision\",\"data\":{\"x\":0.01,\"y\":0.02,\"a\":0.03}}"},
+        {"move_const_vel", "{\"type\":\"move_const_vel\",\"data\":{\"vx\":0.1,\"vy\":0.2,\"va\":0.3,\"t\":4.0}}"},
+        {"jog", "{\"type\":\"jog\",\"data\":{\"vx\":0.1,\"vy\":0.2,\"va\":0.3}}"},
+        {"place", "{\"type\":\"place\"}"},
+        {"load", "{\"type\":\"load\"}"},
+        {"init", "{\"type\":\"init\"}"},
+        {"p", "{\"type\":\"p\",\"data\":{\"x\":1.23,\"y\":4.56,\"a\":0.78}}"},
+        {"set_pose", "{\"type\":\"set_pose\",\"data\":{\"x\":1.23,\"y\":4.56,\"a\":0.78}}"},
+        {"estop", "{\"type\":\"estop\"}"},
+        {"lc", "{\"type\":\"lc\"}"},
+        {"status", "{\"type\":\"status\"}"},
+        {"perf", "{\"type\":\"perf\"}"},
+        {"check", "{\"type\":\"check\"}"},
+        {"clear_error", "{\"type\":\"clear_error\"}"},
+        {"wait_for_loc", "{\"type\":\"wait_for_loc\"}"},
+        {"toggle_vision_debug", "{\"type\":\"toggle_vision_debug\"}"},
+        {"start_cameras", "{\"type\":\"start_cameras\"}"},
+        {"stop_cameras", "{\"type\":\"stop_cameras\"}"},
+        {"sequence", "{\"type\":\"sequence\",\"data\":{\"steps\":["
+                     "{\"type\":\"move\",\"data\":{\"x\":1.23,\"y\":4.56,\"a\":0.78},\"timeout\":30},"
+                     "{\"type\":\"wait_for_loc\"},"
+                     "{\"type\":\"move_const_vel\",\"data\":{\"vx\":0.1,\"vy\":0.2,\"va\":0.3,\"t\":4.0},\"condition\":\"localized\"},"
+                     "{\"type\":\"place\",\"with_previous\":true}]}}"},
+        {"abort_sequence", "{\"type\":\"abort_sequence\"}"},
+        {"speed_override", "{\"type\":\"speed_override\",\"data\":{\"speed\":0.5}}"},
+    };
+    for(const auto& msg : messages)
+    {
+        runner.run("RobotServer::getCommand/" + msg.first,
+                   [&]() { doNotOptimize(server.getCommand(msg.second)); },
+                   [&]() { socket->purge_data(); });
+    }
+
+    runner.run("StatusUpdater::getStatusJsonString", [&]() { doNotOptimize(status_updater.getStatusJsonString()); });
+}
+
+void benchUtils(BenchRunner& runner)
+{
+    // Typical motor driver velocity reply and marvelmind line
+    const std::string short_str = "0.123,-0.456,0.789";
+    const std::string long_str = "1.234,5.678,-9.012,3.456,7.890,-1.234,5.678,9.012,-3.456,7.890";
+    runner.run("parseCommaDelimitedStringToFloat/3", [&]() { doNotOptimize(parseCommaDelimitedStringToFloat(short_str)); });
+    runner.run("parseCommaDelimitedStringToFloat/10", [&]() { doNotOptimize(parseCommaDelimitedStringToFloat(long_str)); });
+}
+
+std::string findDefaultImage()
+{
+    const std::string dir = "test/testdata/images";
+    std::vector<std::string> images;
+    if(std::filesystem::is_directory(dir))
+    {
+        for(const auto& entry : std::filesystem::directory_iterator(dir))
+        {
+            std::string path = entry.path().string();
+            if(path.find("side") != std::string::npos) images.push_back(path);
+        }
+    }
+    std::sort(images.begin(), images.end());
+    return images.empty() ? "" : images.front();
+}
+
+void benchCameraPipeline(BenchRunner& runner, const std::string& image_path)
+{
+    if(image_path.empty())
+    {
+        PLOGE << "No camera image found, skipping CameraPipeline benchmarks";
+        return;
+    }
+
+    // Process the same frame every loop so disk reads don't show up in the timing
+    cfg.lookup("vision_tracker.debug.use_debug_image") = true;
+    cfg.lookup("vision_tracker.debug.use_replay") = false;
+    cfg.lookup("vision_tracker.debug.save_camera_debug") = false;
+    cfg.lookup("vision_tracker.side.debug_image") = image_path;
+    cfg.lookup("vision_tracker.rear.debug_image") = image_path;
+
+    CameraPipeline side_cam(CAMERA_ID::SIDE, /*start_thread=*/ false);
+    runner.run("CameraPipeline::oneLoop/side", [&]() { side_cam.oneLoop(); });
+    CameraPipeline rear_cam(CAMERA_ID::REAR, /*start_thread=*/ false);
+    runner.run("CameraPipeline::oneLoop/rear", [&]() { rear_cam.oneLoop(); });
+}
+
+bool writeJson(const std::string& path, const std::vector<BenchResult>& results)
+{
+    std::ofstream f(path);
+    if(!f)
+    {
+        PLOGE << "Could not write " << path;
+        return false;
+    }
+
+    const std::time_t datetime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    char datetime_str[50];
+    std::strftime(datetime_str, sizeof(datetime_str), "%Y-%m-%dT%H:%M:%S", std::localtime(&datetime));
+
+    f << "{\n  \"timestamp\": \"" << datetime_str << "\",\n  \"benchmarks\": [\n";
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& r = results[i];
+        char line[256];
+        snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"batch_size\": %li, \"median_ns\": %.2f, \"min_ns\": %.2f, \"p90_ns\": %.2f}%s\n",
+            r.name.c_str(), r.batch_size, r.median_ns, r.min_ns, r.p90_ns, i + 1 < results.size() ? "," : "");
+        f << line;
+    }
+    f << "  ]\n}\n";
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::string json_path;
+    std::string filter;
+    std::string image_path;
+    float ms_per_benchmark = 200;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "-o" && i + 1 < argc) json_path = argv[++i];
+        else if(arg == "-f" && i + 1 < argc) filter = argv[++i];
+        else if(arg == "-t" && i + 1 < argc) ms_per_benchmark = std::stof(argv[++i]);
+        else if(arg == "-i" && i + 1 < argc) image_path = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [-o results.json] [-f name_filter] [-t ms_per_benchmark] [-i camera_image]" << std::endl;
+            return(EXIT_FAILURE);
+        }
+    }
+
+    try
+    {
+        cfg.readFile(CONSTANTS_FILE);
+        configure_logger();
+        if(image_path.empty()) image_path = findDefaultImage();
+
+        BenchRunner runner(filter, ms_per_benchmark);
+        printf("  %-44s %15s %15s %15s %10s\n", "benchmark", "median/op", "min/op", "p90/op", "batch");
+        benchTrajectory(runner);
+        benchKalmanFilter(runner);
+        benchRobotServer(runner);
+        benchUtils(runner);
+        benchCameraPipeline(runner, image_path);
+
+        if(!json_path.empty())
+        {
+            if(!writeJson(json_path, runner.getResults())) return(EXIT_FAILURE);
+            printf("Wrote %i results to %s\n", static_cast<int>(runner.getResults().size()), json_path.c_str());
+        }
+    }
+    catch (const libconfig::SettingNotFoundException &e)
+    {
+        std::cerr << "Configuration error with " << e.getPath() << std::endl;
+        return(EXIT_FAILURE);
+    }
+
+    return(EXIT_SUCCESS);
+}
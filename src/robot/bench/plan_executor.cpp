@@ -0,0 +1,678 @@
+// Faster than real time plan executor. Feeds a recorded command sequence through Robot::runOnce
+// against the simulated plant (see src/sim) on the mock clock and reports how long the robot
+// spends on each command type, planned vs actual trajectory durations and where the time goes.
+// A sweep mode reruns the plan over combinations of motion.* settings to find the fastest
+// configuration that still completes the plan and places within the vision tolerances.
+//
+// Usage:
+//   plan-executor <command_file> [-t timeout_s] [-w master_wait_s] [-l load_time_s] [-v]
+//                 [-s motion.setting=v1,v2,... ]...
+//
+// Command files are written by src/master/plan_export.py from a .p plan. Each line is one json
+// message as RobotClient sends it, plus {"type":"wait","data":{"t":seconds}} for plan waits.
+// Blank lines and lines starting with # are skipped, and "# cycle <id>" starts a new cycle.
+//
+// -t  Sim time a command may run before it counts as timed out (default 120 s)
+// -w  Minimum time per command, modelling how long master waits before checking that an
+//     action is done (robot_next_action_wait_time in src/master/config.py, default 2 s)
+// -l  Time from the tray reaching the load position to the load complete signal (default 5 s)
+// -v  Print every command
+// -s  Sweep a motion.* setting over a list of values. Repeat for more settings, every
+//     combination is run.
+
+#include <plog/Log.h>
+#include <plog/Init.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include <plog/Appenders/ColorConsoleAppender.h>
+#include <ArduinoJson/ArduinoJson.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "constants.h"
+#include "robot.h"
+#include "utils.h"
+#include "SmoothTrajectoryGenerator.h"
+#include "camera_tracker/CameraTrackerFactory.h"
+#include "serial/SerialCommsFactory.h"
+#include "sim/SimRobotPlant.h"
+#include "sockets/SocketMultiThreadWrapperFactory.h"
+#include "sockets/MockSocketMultiThreadWrapper.h"
+
+libconfig::Config cfg = libconfig::Config();
+
+// How often the load complete signal is resent if the tray wasn't ready for it
+constexpr float load_complete_retry_s = 0.1;
+// How many of the slowest commands to list
+constexpr int num_slowest_commands = 5;
+
+struct ExecutorOptions
+{
+    float timeout_s = 120.0;
+    float master_wait_s = 2.0;
+    float load_time_s = 5.0;
+    bool verbose = false;
+};
+
+struct PlanCommand
+{
+    int line;
+    int cycle;
+    std::string type;
+    std::string msg;
+    Point target;               // Move target, relative offset or velocity depending on type
+    float time;                 // Wait or move_const_vel duration
+    bool set_camera_target;     // Move the simulated vision target when this command starts
+    Point camera_target;
+};
+
+struct CommandResult
+{
+    float duration;             // Time until the robot reported the command done
+    float master_wait;          // Extra time spent waiting on master afterwards
+    float planned;              // Trajectory duration from the planner, 0 for non motion commands
+    bool rot_limited;           // Rotation took longer than translation in the planned trajectory
+    bool ok;
+    bool checked;               // Final pose checked against the vision tolerances
+    float trans_err;
+    float angle_err;
+};
+
+struct RunResult
+{
+    std::vector<CommandResult> commands;
+    float total_time = 0;
+    float setup_time = 0;
+    float wall_time = 0;
+    int num_failed = 0;
+    int num_out_of_tolerance = 0;
+    float max_trans_err = 0;
+    float max_angle_err = 0;
+    bool aborted = false;
+
+    bool safe() const { return num_failed == 0 && num_out_of_tolerance == 0 && !aborted; }
+};
+
+struct SweepSetting
+{
+    std::string path;
+    std::vector<float> values;
+};
+
+void configure_logger()
+{
+    // Only show errors, the plan produces plenty of expected warnings
+    static plog::ColorConsoleAppender<plog::TxtFormatter> consoleAppender;
+    plog::init(plog::error, &consoleAppender);
+}
+
+bool isMove(const std::string& type)
+{
+    return type == "move" || type == "move_rel" || type == "move_rel_slow" || type == "move_fine" ||
+           type == "move_fine_stop_vision" || type == "move_vision" || type == "move_const_vel";
+}
+
+bool isAbsoluteMove(const std::string& type)
+{
+    return type == "move" || type == "move_fine" || type == "move_fine_stop_vision";
+}
+
+LIMITS_MODE limitsModeFor(const std::string& type)
+{
+    if(type == "move_vision") return LIMITS_MODE::VISION;
+    if(type == "move_fine" || type == "move_fine_stop_vision") return LIMITS_MODE::FINE;
+    if(type == "move_rel_slow") return LIMITS_MODE::SLOW;
+    return LIMITS_MODE::COARSE;
+}
+
+std::vector<PlanCommand> readPlan(const std::string& path)
+{
+    std::vector<PlanCommand> plan;
+    std::ifstream f(path);
+    if(!f)
+    {
+        PLOGE << "Could not read command file " << path;
+        return plan;
+    }
+
+    std::string line;
+    int line_num = 0;
+    int cycle = 0;
+    while(std::getline(f, line))
+    {
+        line_num++;
+        if(!line.empty() && line.back() == '\r') line.pop_back();
+        if(line.empty()) continue;
+        if(line[0] == '#')
+        {
+            if(line.rfind("# cycle", 0) == 0) cycle++;
+            continue;
+        }
+
+        StaticJsonDocument<256> doc;
+        DeserializationError err = deserializeJson(doc, line);
+        std::string type = doc["type"];
+        if(err || type.empty())
+        {
+            PLOGE << "Skipping bad command on line " << line_num << ": " << line;
+            continue;
+        }
+
+        PlanCommand cmd = {line_num, cycle, type, line, {0,0,0}, 0, false, {0,0,0}};
+        if(cmd.type == "move_const_vel")
+        {
+            cmd.target = {doc["data"]["vx"], doc["data"]["vy"], doc["data"]["va"]};
+            cmd.time = doc["data"]["t"];
+        }
+        else if(cmd.type == "wait")
+        {
+            cmd.time = doc["data"]["t"];
+        }
+        else
+        {
+            cmd.target = {doc["data"]["x"], doc["data"]["y"], doc["data"]["a"]};
+        }
+        plan.push_back(cmd);
+    }
+
+    // The simulated camera only sees one target, so move it to wherever each vision move expects to find it:
+    // where the pose the plan expects the robot to be in before the vision move reads as the vision move's
+    // target. It is moved when the move before the vision move starts, so move_fine_stop_vision can see it.
+    Point expected(cfg.lookup("simulation.start_pose")[0], cfg.lookup("simulation.start_pose")[1], cfg.lookup("simulation.start_pose")[2]);
+    int last_move = -1;
+    for(size_t i = 0; i < plan.size(); i++)
+    {
+        const PlanCommand& cmd = plan[i];
+        if(isAbsoluteMove(cmd.type) || cmd.type == "set_pose")
+        {
+            expected = cmd.target;
+        }
+        else if(cmd.type == "move_rel" || cmd.type == "move_rel_slow")
+        {
+            expected = {expected.x + cos(expected.a) * cmd.target.x - sin(expected.a) * cmd.target.y,
+                        expected.y + sin(expected.a) * cmd.target.x + cos(expected.a) * cmd.target.y,
+                        wrap_angle(expected.a + cmd.target.a)};
+        }
+        else if(cmd.type == "move_const_vel")
+        {
+            expected = {expected.x + cmd.target.x * cmd.time, expected.y + cmd.target.y * cmd.time, wrap_angle(expected.a + cmd.target.a * cmd.time)};
+        }
+        else if(cmd.type == "move_vision")
+        {
+            float ta = wrap_angle(expected.a - cmd.target.a);
+            int idx = last_move >= 0 ? last_move : i;
+            plan[idx].set_camera_target = true;
+            plan[idx].camera_target = {expected.x - cos(ta) * cmd.target.x + sin(ta) * cmd.target.y,
+                                       expected.y - sin(ta) * cmd.target.x - cos(ta) * cmd.target.y,
+                                       ta};
+        }
+        if(isMove(cmd.type)) last_move = i;
+    }
+    return plan;
+}
+
+// True robot pose relative to the simulated vision target, what the camera would read without noise
+Point truePoseFromTarget()
+{
+    SimRobotPlant* plant = SimRobotPlant::getInstance();
+    Point pose = plant->getTruePose();
+    Point target = plant->getCameraTarget();
+    float dx = pose.x - target.x;
+    float dy = pose.y - target.y;
+    float cA = cos(target.a);
+    float sA = sin(target.a);
+    return { cA * dx + sA * dy, -sA * dx + cA * dy, wrap_angle(pose.a - target.a)};
+}
+
+// Duration of the trajectory the controller will plan for this command, and whether rotation is the slower axis
+float plannedDuration(const PlanCommand& cmd, Point start, bool* rot_limited)
+{
+    Point target = cmd.target;
+    if(cmd.type == "move_rel" || cmd.type == "move_rel_slow")
+    {
+        target = {start.x + cos(start.a) * cmd.target.x - sin(start.a) * cmd.target.y,
+                  start.y + sin(start.a) * cmd.target.x + cos(start.a) * cmd.target.y,
+                  start.a + cmd.target.a};
+    }
+    else if(cmd.type == "move_const_vel")
+    {
+        // Holds the velocity for the set time, then takes as long as a stop from that velocity to come to rest
+        MotionPlanningProblem mpp = buildMotionPlanningProblem(start, start, LIMITS_MODE::COARSE, SolverParameters());
+        SCurveParameters trans_params;
+        SCurveParameters rot_params;
+        generateStopSCurve(sqrt(pow(cmd.target.x, 2) + pow(cmd.target.y, 2)), 0, mpp.translationalLimits, &trans_params);
+        generateStopSCurve(fabs(cmd.target.a), 0, mpp.rotationalLimits, &rot_params);
+        *rot_limited = rot_params.switch_points[7].t > trans_params.switch_points[7].t;
+        return cmd.time + std::max(trans_params.switch_points[7].t, rot_params.switch_points[7].t);
+    }
+
+    SolverParameters solver = getSolverParameters();
+    MotionPlanningProblem mpp = buildMotionPlanningProblem(start, target, limitsModeFor(cmd.type), solver);
+
+    // Each axis on its own, then stretch the faster one to match the slower like the planner does
+    Eigen::Vector3f delta = mpp.targetPoint - mpp.initialPoint;
+    SCurveParameters trans_params;
+    SCurveParameters rot_params;
+    bool trans_ok = generateSCurve(delta.head(2).norm(), mpp.translationalLimits, solver, &trans_params);
+    bool rot_ok = generateSCurve(fabs(wrap_angle(delta(2))), mpp.rotationalLimits, solver, &rot_params);
+    if(!trans_ok || !rot_ok) return 0;
+
+    SyncResult sync = synchronizeParameters(&trans_params, &rot_params);
+    *rot_limited = sync.rotation_limited;
+    return std::max(trans_params.switch_points[7].t, rot_params.switch_points[7].t);
+}
+
+class PlanExecutor
+{
+  public:
+
+    PlanExecutor(const ExecutorOptions& options)
+    : options_(options),
+      clock_(dynamic_cast<MockClockWrapper*>(ClockFactory::getFactoryInstance()->get_clock())),
+      socket_(dynamic_cast<MockSocketMultiThreadWrapper*>(SocketMultiThreadWrapperFactory::getFactoryInstance()->get_socket())),
+      step_us_(cfg.lookup("simulation.step_us")),
+      load_pos_steps_(static_cast<int>(static_cast<float>(cfg.lookup("tray.load_pos_revs")) * static_cast<int>(cfg.lookup("tray.steps_per_rev")))),
+      robot_()
+    {}
+
+    RunResult run(const std::vector<PlanCommand>& plan)
+    {
+        RunResult result;
+        // Timer follows the mock clock, so wall time comes straight from the system clock
+        auto wall_start = std::chrono::steady_clock::now();
+        reset();
+
+        // The tray is initialized by hand before a plan starts, so it isn't counted
+        PlanCommand init = {0, 0, "init", "{\"type\":\"init\"}", {0,0,0}, 0, false, {0,0,0}};
+        CommandResult init_result = runCommand(init);
+        result.setup_time = init_result.duration;
+        if(!init_result.ok)
+        {
+            PLOGE << "Tray initialization failed";
+            result.aborted = true;
+        }
+
+        for(const auto& cmd : plan)
+        {
+            if(result.aborted) break;
+            CommandResult r = runCommand(cmd);
+            result.commands.push_back(r);
+            result.total_time += r.duration + r.master_wait;
+            if(!r.ok)
+            {
+                result.num_failed++;
+                // Once the robot is in error it rejects everything else
+                if(robot_->getStatus().error_status)
+                {
+                    PLOGE << "Robot in error after line " << cmd.line << ", stopping plan";
+                    result.aborted = true;
+                }
+            }
+            if(r.checked)
+            {
+                result.max_trans_err = std::max(result.max_trans_err, r.trans_err);
+                result.max_angle_err = std::max(result.max_angle_err, r.angle_err);
+                if(r.trans_err > vision_trans_tol_ || r.angle_err > vision_angle_tol_) result.num_out_of_tolerance++;
+            }
+            if(options_.verbose)
+            {
+                printf("  line %4i %-22s %8.2f s (planned %6.2f s)%s\n", cmd.line, cmd.type.c_str(), r.duration,
+                    r.planned, r.ok ? "" : " FAILED");
+            }
+        }
+        result.wall_time = std::chrono::duration_cast<FpSeconds>(std::chrono::steady_clock::now() - wall_start).count();
+        return result;
+    }
+
+  private:
+
+    void reset()
+    {
+        clock_->set_now();
+        vision_trans_tol_ = cfg.lookup("motion.translation.position_threshold.vision");
+        vision_angle_tol_ = cfg.lookup("motion.rotation.position_threshold.vision");
+
+        SimRobotPlant* plant = SimRobotPlant::getInstance();
+        plant->reset({cfg.lookup("simulation.start_pose")[0], cfg.lookup("simulation.start_pose")[1], cfg.lookup("simulation.start_pose")[2]});
+        plant->setCameraTarget({cfg.lookup("simulation.camera.target")[0], cfg.lookup("simulation.camera.target")[1], cfg.lookup("simulation.camera.target")[2]});
+        CameraTrackerFactory::getFactoryInstance()->get_camera_tracker()->stop();
+        socket_->purge_data();
+
+        // A new robot picks up any changed config values
+        robot_.reset();
+        robot_ = std::make_unique<Robot>();
+    }
+
+    void step()
+    {
+        robot_->runOnce();
+        clock_->advance_us(step_us_);
+    }
+
+    float elapsed(ClockTimePoint start)
+    {
+        return std::chrono::duration_cast<FpSeconds>(clock_->now() - start).count();
+    }
+
+    CommandResult runCommand(const PlanCommand& cmd)
+    {
+        CommandResult result = {0, 0, 0, false, true, false, 0, 0};
+        ClockTimePoint start = clock_->now();
+
+        if(cmd.type == "wait")
+        {
+            while(elapsed(start) < cmd.time) step();
+            result.duration = elapsed(start);
+            return result;
+        }
+
+        if(cmd.set_camera_target) SimRobotPlant::getInstance()->setCameraTarget(cmd.camera_target);
+        if(isMove(cmd.type))
+        {
+            StatusUpdater::Status status = robot_->getStatus();
+            Point start_pose = {status.pos_x, status.pos_y, status.pos_a};
+            if(cmd.type == "move_vision") start_pose = truePoseFromTarget();
+            result.planned = plannedDuration(cmd, start_pose, &result.rot_limited);
+        }
+
+        socket_->add_mock_data("<" + cmd.msg + ">");
+        step();
+        // Other commands can legitimately finish within the first loop, but a move can't
+        if(isMove(cmd.type) && !robot_->getStatus().in_progress)
+        {
+            PLOGE << "Line " << cmd.line << ": robot did not start " << cmd.type;
+            result.ok = false;
+        }
+
+        bool load_ready = false;
+        ClockTimePoint load_ready_time = start;
+        while(robot_->getStatus().in_progress)
+        {
+            if(elapsed(start) > options_.timeout_s)
+            {
+                PLOGE << "Line " << cmd.line << ": " << cmd.type << " timed out";
+                result.ok = false;
+                socket_->add_mock_data("<{\"type\":\"estop\"}>");
+                step();
+                break;
+            }
+
+            // Stand in for the operator signalling load complete once the tray is down
+            if(cmd.type == "load")
+            {
+                SimRobotPlant* plant = SimRobotPlant::getInstance();
+                if(!load_ready && !plant->isLifterMoving() && std::abs(plant->getLifterPosition() - load_pos_steps_) <= 1)
+                {
+                    load_ready = true;
+                    load_ready_time = clock_->now();
+                }
+                if(load_ready && elapsed(load_ready_time) > options_.load_time_s)
+                {
+                    socket_->add_mock_data("<{\"type\":\"lc\"}>");
+                    load_ready_time += std::chrono::duration_cast<ClockTimePoint::duration>(FpSeconds(load_complete_retry_s));
+                }
+            }
+            step();
+        }
+        result.duration = elapsed(start);
+        if(robot_->getStatus().error_status) result.ok = false;
+
+        if(cmd.type == "move_vision")
+        {
+            Point pose = truePoseFromTarget();
+            result.checked = true;
+            result.trans_err = sqrt(pow(pose.x - cmd.target.x, 2) + pow(pose.y - cmd.target.y, 2));
+            result.angle_err = fabs(angle_diff(pose.a, cmd.target.a));
+        }
+
+        // Master only checks for completion after a fixed delay
+        while(elapsed(start) < options_.master_wait_s) step();
+        result.master_wait = elapsed(start) - result.duration;
+        return result;
+    }
+
+    ExecutorOptions options_;
+    MockClockWrapper* clock_;
+    MockSocketMultiThreadWrapper* socket_;
+    int step_us_;
+    int load_pos_steps_;
+    float vision_trans_tol_;
+    float vision_angle_tol_;
+    std::unique_ptr<Robot> robot_;
+};
+
+void printReport(const std::vector<PlanCommand>& plan, const RunResult& result)
+{
+    struct TypeStats
+    {
+        int count = 0;
+        float total = 0;
+        float max = 0;
+        float planned = 0;
+        float master_wait = 0;
+    };
+    std::map<std::string, TypeStats> by_type;
+    std::map<int, float> by_cycle;
+    float move_time = 0;
+    float planned_time = 0;
+    float rot_limited_time = 0;
+    float master_wait = 0;
+    for(size_t i = 0; i < result.commands.size(); i++)
+    {
+        const CommandResult& r = result.commands[i];
+        TypeStats& s = by_type[plan[i].type];
+        s.count++;
+        s.total += r.duration;
+        s.max = std::max(s.max, r.duration);
+        s.planned += r.planned;
+        s.master_wait += r.master_wait;
+        by_cycle[plan[i].cycle] += r.duration + r.master_wait;
+        master_wait += r.master_wait;
+        if(r.planned > 0)
+        {
+            move_time += r.duration;
+            planned_time += r.planned;
+            if(r.rot_limited) rot_limited_time += r.planned;
+        }
+    }
+
+    float total = std::max(result.total_time, 0.001f);
+    printf("Ran %i of %i commands: %.1f s robot time in %.2f s wall time (%.0fx real time)\n",
+        static_cast<int>(result.commands.size()), static_cast<int>(plan.size()), result.total_time, result.wall_time,
+        result.wall_time > 0 ? result.total_time / result.wall_time : 0.0);
+    printf("  %-22s %5s %10s %6s %9s %9s %10s\n", "command", "count", "total", "share", "mean", "max", "planned");
+    for(const auto& it : by_type)
+    {
+        const TypeStats& s = it.second;
+        printf("  %-22s %5i %8.1f s %5.1f%% %7.2f s %7.2f s %8.1f s\n", it.first.c_str(), s.count, s.total,
+            100.0 * s.total / total, s.total / s.count, s.max, s.planned);
+    }
+    printf("  %-22s %5s %8.1f s %5.1f%%\n", "master wait", "", master_wait, 100.0 * master_wait / total);
+
+    if(by_cycle.size() > 1)
+    {
+        float cycle_min = by_cycle.begin()->second;
+        float cycle_max = cycle_min;
+        for(const auto& it : by_cycle)
+        {
+            cycle_min = std::min(cycle_min, it.second);
+            cycle_max = std::max(cycle_max, it.second);
+        }
+        printf("Cycles: %i, mean %.1f s, min %.1f s, max %.1f s\n", static_cast<int>(by_cycle.size()),
+            result.total_time / by_cycle.size(), cycle_min, cycle_max);
+    }
+
+    printf("Bottlenecks:\n");
+    if(move_time > 0)
+    {
+        printf("  Moves: %.1f s, %.1f s (%.0f%%) following trajectories and %.1f s (%.0f%%) settling or stopping\n",
+            move_time, planned_time, 100.0 * planned_time / move_time, move_time - planned_time, 100.0 * (move_time - planned_time) / move_time);
+        printf("  Trajectory time limited by rotation: %.1f s (%.0f%%), by translation: %.1f s (%.0f%%)\n",
+            rot_limited_time, 100.0 * rot_limited_time / std::max(planned_time, 0.001f), planned_time - rot_limited_time,
+            100.0 * (planned_time - rot_limited_time) / std::max(planned_time, 0.001f));
+    }
+    std::vector<size_t> order(result.commands.size());
+    for(size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return result.commands[a].duration > result.commands[b].duration; });
+    for(size_t i = 0; i < order.size() && i < num_slowest_commands; i++)
+    {
+        const CommandResult& r = result.commands[order[i]];
+        printf("  line %4i %-22s %7.2f s", plan[order[i]].line, plan[order[i]].type.c_str(), r.duration);
+        if(r.planned > 0) printf(" (planned %.2f s, %s limited)", r.planned, r.rot_limited ? "rotation" : "translation");
+        printf("\n");
+    }
+
+    printf("Failed commands: %i%s\n", result.num_failed, result.aborted ? ", plan aborted" : "");
+    printf("Vision moves out of tolerance: %i, max final error %.4f m, %.3f deg\n", result.num_out_of_tolerance,
+        result.max_trans_err, result.max_angle_err * 180.0 / M_PI);
+}
+
+bool parseSweepSetting(const std::string& arg, SweepSetting* setting)
+{
+    size_t eq = arg.find('=');
+    if(eq == std::string::npos || arg.rfind("motion.", 0) != 0)
+    {
+        std::cerr << "Sweep settings must look like motion.<setting>=v1,v2,...: " << arg << std::endl;
+        return false;
+    }
+    setting->path = arg.substr(0, eq);
+    if(!cfg.exists(setting->path))
+    {
+        std::cerr << "Unknown setting " << setting->path << std::endl;
+        return false;
+    }
+    setting->values = parseCommaDelimitedStringToFloat(arg.substr(eq + 1));
+    return !setting->values.empty();
+}
+
+void applySetting(const std::string& path, float value)
+{
+    libconfig::Setting& s = cfg.lookup(path);
+    if(s.getType() == libconfig::Setting::TypeInt) s = static_cast<int>(value);
+    else s = value;
+}
+
+void runSweep(PlanExecutor& executor, const std::vector<PlanCommand>& plan, const std::vector<SweepSetting>& sweep)
+{
+    std::vector<size_t> idx(sweep.size(), 0);
+    int best = -1;
+    float best_time = 0;
+    std::vector<float> best_values;
+    int run_num = 0;
+
+    printf("Sweeping %i settings\n", static_cast<int>(sweep.size()));
+    while(true)
+    {
+        std::vector<float> values;
+        for(size_t i = 0; i < sweep.size(); i++)
+        {
+            values.push_back(sweep[i].values[idx[i]]);
+            applySetting(sweep[i].path, values.back());
+        }
+
+        RunResult result = executor.run(plan);
+        printf("  run %3i:", run_num);
+        for(size_t i = 0; i < sweep.size(); i++) printf(" %s=%.3f", sweep[i].path.c_str(), values[i]);
+        printf(" -> %.1f s, %s (failed %i, out of tolerance %i, max err %.4f m)\n", result.total_time,
+            result.safe() ? "safe" : "UNSAFE", result.num_failed, result.num_out_of_tolerance, result.max_trans_err);
+        if(result.safe() && (best < 0 || result.total_time < best_time))
+        {
+            best = run_num;
+            best_time = result.total_time;
+            best_values = values;
+        }
+        run_num++;
+
+        // Next combination
+        size_t i = 0;
+        for(; i < sweep.size(); i++)
+        {
+            if(++idx[i] < sweep[i].values.size()) break;
+            idx[i] = 0;
+        }
+        if(i == sweep.size()) break;
+    }
+
+    if(best < 0)
+    {
+        printf("No configuration completed the plan safely\n");
+        return;
+    }
+    printf("Fastest safe configuration (run %i, %.1f s):\n", best, best_time);
+    for(size_t i = 0; i < sweep.size(); i++) printf("  %s = %.3f;\n", sweep[i].path.c_str(), best_values[i]);
+}
+
+int main(int argc, char** argv)
+{
+    ExecutorOptions options;
+    std::string plan_path;
+    std::vector<std::string> sweep_args;
+    bool bad_args = false;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "-t" && i + 1 < argc) options.timeout_s = std::stof(argv[++i]);
+        else if(arg == "-w" && i + 1 < argc) options.master_wait_s = std::stof(argv[++i]);
+        else if(arg == "-l" && i + 1 < argc) options.load_time_s = std::stof(argv[++i]);
+        else if(arg == "-s" && i + 1 < argc) sweep_args.push_back(argv[++i]);
+        else if(arg == "-v") options.verbose = true;
+        else if(plan_path.empty()) plan_path = arg;
+        else bad_args = true;
+    }
+    if(plan_path.empty() || bad_args)
+    {
+        std::cerr << "Usage: " << argv[0] << " <command_file> [-t timeout_s] [-w master_wait_s] [-l load_time_s] [-v] [-s motion.setting=v1,v2,...]..." << std::endl;
+        return(EXIT_FAILURE);
+    }
+
+    try
+    {
+        cfg.readFile(CONSTANTS_FILE);
+        configure_logger();
+
+        // Run everything against the simulated plant on the mock clock
+        cfg.lookup("simulation.enabled") = true;
+        cfg.lookup("telemetry.enabled") = false;
+        ClockFactory::getFactoryInstance()->set_mode(CLOCK_FACTORY_MODE::MOCK);
+        SerialCommsFactory::getFactoryInstance()->set_mode(SERIAL_FACTORY_MODE::SIM);
+        CameraTrackerFactory::getFactoryInstance()->set_mode(CAMERA_TRACKER_FACTORY_MODE::SIM);
+        SocketMultiThreadWrapperFactory::getFactoryInstance()->set_mode(SOCKET_FACTORY_MODE::MOCK);
+        SocketMultiThreadWrapperFactory::getFactoryInstance()->build_socket();
+
+        std::vector<PlanCommand> plan = readPlan(plan_path);
+        if(plan.empty())
+        {
+            std::cerr << "No commands in " << plan_path << std::endl;
+            return(EXIT_FAILURE);
+        }
+
+        std::vector<SweepSetting> sweep;
+        for(const auto& arg : sweep_args)
+        {
+            SweepSetting setting;
+            if(!parseSweepSetting(arg, &setting)) return(EXIT_FAILURE);
+            sweep.push_back(setting);
+        }
+
+        PlanExecutor executor(options);
+        if(sweep.empty())
+        {
+            RunResult result = executor.run(plan);
+            printf("Plan %s\n", plan_path.c_str());
+            printReport(plan, result);
+            if(!result.safe()) return(EXIT_FAILURE);
+        }
+        else
+        {
+            runSweep(executor, plan, sweep);
+        }
+    }
+    catch (const libconfig::SettingNotFoundException &e)
+    {
+        std::cerr << "Configuration error with " << e.getPath() << std::endl;
+        return(EXIT_FAILURE);
+    }
+
+    return(EXIT_SUCCESS);
+}
@@ -0,0 +1,249 @@
+// Headless replay benchmark for the vision pipeline. Streams recorded frames through
+// CameraPipeline (undistort, threshold, blob detect, cameraToRobot) and the pose fit as
+// fast as possible and reports per-stage latency percentiles, throughput and pose error.
+//
+// Usage:
+//   vision-bench <replay_dir> [-g ground_truth.csv]
+//   vision-bench <side_video> <rear_video> [-g ground_truth.csv]
+//
+// When replaying a directory, frames are picked by camera name (*side*.jpg, *rear*.jpg) and
+// side/rear frames are paired in sorted order. The optional ground truth file has one line
+// per frame pair: frame_index,pose_x,pose_y,pose_a
+
+#include <plog/Log.h> 
+#include <plog/Init.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include <plog/Appenders/ColorConsoleAppender.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+
+#include "constants.h"
+#include "utils.h"
+#include "camera_tracker/CameraPipeline.h"
+#include "camera_tracker/PoseSolver.h"
+
+libconfig::Config cfg = libconfig::Config();
+
+struct PoseError
+{
+    float trans;
+    float angle;
+};
+
+void configure_logger()
+{
+    // Only show warnings so the report isn't buried
+    static plog::ColorConsoleAppender<plog::TxtFormatter> consoleAppender;
+    plog::init(plog::warning, &consoleAppender); 
+}
+
+int percentile(std::vector<int> data, float p)
+{
+    if(data.empty()) return 0;
+    std::sort(data.begin(), data.end());
+    size_t idx = std::min(data.size() - 1, static_cast<size_t>(p * data.size()));
+    return data[idx];
+}
+
+void printStage(const std::string& name, const std::vector<int>& data_us)
+{
+    printf("  %-12s p50: %6i us   p90: %6i us   p99: %6i us   max: %6i us\n", name.c_str(),
+        percentile(data_us, 0.5), percentile(data_us, 0.9), percentile(data_us, 0.99), percentile(data_us, 1.0));
+}
+
+std::map<int, Point> readGroundTruth(const std::string& path)
+{
+    std::map<int, Point> ground_truth;
+    std::ifstream f(path);
+    if(!f)
+    {
+        PLOGE << "Could not read ground truth file " << path;
+        return ground_truth;
+    }
+    std::string line;
+    while(std::getline(f, line))
+    {
+        if(line.empty() || line[0] == '#') continue;
+        std::vector<float> vals = parseCommaDelimitedStringToFloat(line);
+        if(vals.size() != 4) 
+        {
+            PLOGW << "Skipping bad ground truth line: " << line;
+            continue;
+        }
+        ground_truth[static_cast<int>(vals[0])] = {vals[1], vals[2], vals[3]};
+    }
+    return ground_truth;
+}
+
+struct StageTimes
+{
+    std::vector<int> undistort;
+    std::vector<int> threshold;
+    std::vector<int> detect;
+    std::vector<int> transform;
+    std::vector<int> total;
+    int num_detected = 0;
+
+    void add(const CameraPipelineTimings& t, int total_us, bool detected)
+    {
+        undistort.push_back(t.undistort_us);
+        threshold.push_back(t.threshold_us);
+        detect.push_back(t.detect_us);
+        transform.push_back(t.transform_us);
+        total.push_back(total_us);
+        if(detected) num_detected++;
+    }
+};
+
+// Process the next frame from the pipeline. Returns false once the replay is exhausted.
+bool processNext(CameraPipeline& pipeline, StageTimes& times, CameraPipelineOutput& output)
+{
+    if(pipeline.replayFinished()) return false;
+    Timer t;
+    pipeline.oneLoop();
+    int dt = t.dt_us();
+    if(pipeline.replayFinished()) return false;
+    output = pipeline.getData();
+    times.add(output.timings, dt, output.ok);
+    return true;
+}
+
+void printCamera(const std::string& name, const StageTimes& times)
+{
+    int n = times.total.size();
+    printf("%s camera: %i frames, %i detections (%.1f%%)\n", name.c_str(), n, times.num_detected, n ? 100.0 * times.num_detected / n : 0.0);
+    printStage("undistort", times.undistort);
+    printStage("threshold", times.threshold);
+    printStage("detect", times.detect);
+    printStage("transform", times.transform);
+    printStage("total", times.total);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> replay_paths;
+    std::string ground_truth_path;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "-g" && i + 1 < argc) ground_truth_path = argv[++i];
+        else replay_paths.push_back(arg);
+    }
+    if(replay_paths.empty() || replay_paths.size() > 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <replay_dir | side_video rear_video> [-g ground_truth.csv]" << std::endl;
+        return(EXIT_FAILURE);
+    }
+
+    try
+    {
+        cfg.readFile(CONSTANTS_FILE);
+        configure_logger();
+
+        // Point both cameras at the replay source
+        cfg.lookup("vision_tracker.debug.use_debug_image") = false;
+        cfg.lookup("vision_tracker.debug.save_camera_debug") = false;
+        cfg.lookup("vision_tracker.debug.use_replay") = true;
+        cfg.lookup("vision_tracker.side.replay_path") = replay_paths.front();
+        cfg.lookup("vision_tracker.rear.replay_path") = replay_paths.back();
+
+        CameraPipeline side_cam(CAMERA_ID::SIDE, /*start_thread=*/ false);
+        CameraPipeline rear_cam(CAMERA_ID::REAR, /*start_thread=*/ false);
+
+        std::vector<Eigen::Vector2f> targets = {
+            {float(cfg.lookup("vision_tracker.physical.side.target_x")), float(cfg.lookup("vision_tracker.physical.side.target_y"))},
+            {float(cfg.lookup("vision_tracker.physical.rear.target_x")), float(cfg.lookup("vision_tracker.physical.rear.target_y"))}};
+        std::vector<float> weights = {float(cfg.lookup("vision_tracker.pose_fit.side_weight")), 
+                                      float(cfg.lookup("vision_tracker.pose_fit.rear_weight"))};
+        float max_residual = cfg.lookup("vision_tracker.pose_fit.max_residual");
+        std::map<int, Point> ground_truth;
+        if(!ground_truth_path.empty()) ground_truth = readGroundTruth(ground_truth_path);
+
+        StageTimes side_times;
+        StageTimes rear_times;
+        std::vector<int> pose_times;
+        std::vector<PoseError> pose_errors;
+        int num_poses = 0;
+        int num_rejected = 0;
+        int frame_idx = 0;
+
+        Timer total_timer;
+        bool side_ok = true;
+        bool rear_ok = true;
+        while(side_ok || rear_ok)
+        {
+            CameraPipelineOutput side_output;
+            CameraPipelineOutput rear_output;
+            side_ok = processNext(side_cam, side_times, side_output);
+            rear_ok = processNext(rear_cam, rear_times, rear_output);
+
+            if(side_ok && rear_ok && side_output.ok && rear_output.ok)
+            {
+                Timer t;
+                RigidPoseFit fit = fitRigidPose2D({side_output.point, rear_output.point}, targets, weights);
+                pose_times.push_back(t.dt_us());
+                num_poses++;
+                if(!fit.ok || fit.residual > max_residual) num_rejected++;
+
+                auto it = ground_truth.find(frame_idx);
+                if(it != ground_truth.end())
+                {
+                    float dx = fit.pose.x - it->second.x;
+                    float dy = fit.pose.y - it->second.y;
+                    pose_errors.push_back({sqrt(dx*dx + dy*dy), fabs(angle_diff(fit.pose.a, it->second.a))});
+                }
+            }
+            if(side_ok || rear_ok) frame_idx++;
+        }
+        float total_s = total_timer.dt_s();
+        int total_frames = side_times.total.size() + rear_times.total.size();
+
+        // Report
+        printf("Vision replay benchmark\n");
+        printf("Processed %i frames in %.3f s (%.1f frames/sec)\n", total_frames, total_s, total_s > 0 ? total_frames / total_s : 0.0);
+        printCamera("Side", side_times);
+        printCamera("Rear", rear_times);
+        printf("Pose fit: %i poses, %i rejected by residual\n", num_poses, num_rejected);
+        printStage("pose fit", pose_times);
+        if(!pose_errors.empty())
+        {
+            float trans_sum = 0, trans_max = 0, angle_sum = 0, angle_max = 0;
+            for(const auto& e : pose_errors)
+            {
+                trans_sum += e.trans;
+                angle_sum += e.angle;
+                trans_max = std::max(trans_max, e.trans);
+                angle_max = std::max(angle_max, e.angle);
+            }
+            printf("Pose error over %i labelled frames: trans mean %.4f m, max %.4f m | angle mean %.3f deg, max %.3f deg\n",
+                static_cast<int>(pose_errors.size()), trans_sum / pose_errors.size(), trans_max, 
+                angle_sum / pose_errors.size() * 180.0 / M_PI, angle_max * 180.0 / M_PI);
+        }
+        else if(!ground_truth_path.empty())
+        {
+            printf("No labelled frames produced a pose\n");
+        }
+
+        if(total_frames == 0)
+        {
+            std::cerr << "No frames were replayed" << std::endl;
+            return(EXIT_FAILURE);
+        }
+    }
+    catch (const libconfig::SettingNotFoundException &e)
+    {
+        std::cerr << "Configuration error with " << e.getPath() << std::endl;
+        return(EXIT_FAILURE);
+    }
+    catch (const std::runtime_error &e)
+    {
+        // Bad replay paths end up here
+        std::cerr << e.what() << std::endl;
+        return(EXIT_FAILURE);
+    }
+
+    return(EXIT_SUCCESS);
+}
@@ -0,0 +1,298 @@
+#include "AsyncLogAppender.h"
+#include "constants.h"
+
+#include <errno.h>
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Max lines written per sink before moving on to the next one
+constexpr int max_batch_size = 256;
+
+// The ring needs at least 2 slots to tell full and empty apart
+static size_t roundUpToPowerOf2(size_t val)
+{
+    size_t out = 2;
+    while(out < val) out <<= 1;
+    return out;
+}
+
+AsyncLogSink::AsyncLogSink(const std::string& file_path, const std::string& header, size_t max_file_size, int max_files)
+: slots_(),
+  mask_(roundUpToPowerOf2(static_cast<int>(cfg.lookup("logging.queue_size"))) - 1),
+  enqueue_pos_(0),
+  dequeue_pos_(0),
+  dropped_count_(0),
+  reported_dropped_count_(0),
+  file_path_(file_path),
+  header_(header),
+  max_file_size_(max_file_size),
+  max_files_(max_files),
+  file_(NULL),
+  open_failed_(false),
+  file_size_(0),
+  batch_(),
+  needs_sync_(false),
+  fsync_interval_ms_(cfg.lookup("logging.fsync_interval_ms")),
+  last_sync_time_(std::chrono::steady_clock::now())
+{
+    slots_.reset(new Slot[mask_ + 1]);
+    for(size_t i = 0; i <= mask_; i++)
+    {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+        slots_[i].restart = false;
+    }
+    AsyncLogWriter::getInstance().addSink(this);
+}
+
+AsyncLogSink::~AsyncLogSink()
+{
+    AsyncLogWriter::getInstance().removeSink(this);
+    if(file_ && file_ != stdout)
+    {
+        fclose(file_);
+    }
+}
+
+bool AsyncLogSink::push(std::string&& line)
+{
+    return pushEntry(std::move(line), false);
+}
+
+void AsyncLogSink::restart()
+{
+    pushEntry(std::string(), true);
+}
+
+// Bounded multi-producer queue based on http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+bool AsyncLogSink::pushEntry(std::string&& line, bool restart)
+{
+    Slot* slot;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while(true)
+    {
+        slot = &slots_[pos & mask_];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if(diff == 0)
+        {
+            if(enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if(diff < 0)
+        {
+            // Full, drop the record rather than wait for the writer
+            dropped_count_++;
+            return false;
+        }
+        else
+        {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+    slot->line = std::move(line);
+    slot->restart = restart;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogSink::pop(std::string& line, bool& restart)
+{
+    Slot& slot = slots_[dequeue_pos_ & mask_];
+    size_t seq = slot.sequence.load(std::memory_order_acquire);
+    if(seq != dequeue_pos_ + 1)
+    {
+        return false;
+    }
+    line = std::move(slot.line);
+    slot.line.clear();
+    restart = slot.restart;
+    slot.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    dequeue_pos_++;
+    return true;
+}
+
+bool AsyncLogSink::drain()
+{
+    if(!file_)
+    {
+        openFile(/*truncate=*/ false);
+    }
+
+    int count = 0;
+    std::string line;
+    bool restart = false;
+    while(count < max_batch_size && pop(line, restart))
+    {
+        count++;
+        if(restart)
+        {
+            writeBatch();
+            openFile(/*truncate=*/ true);
+            continue;
+        }
+        batch_ += line;
+    }
+
+    int dropped = dropped_count_;
+    if(dropped != reported_dropped_count_)
+    {
+        batch_ += "[AsyncLogSink] " + std::to_string(dropped - reported_dropped_count_) + " log records dropped\n";
+        reported_dropped_count_ = dropped;
+    }
+    writeBatch();
+
+    // Limit how often we force data to the sd card since fsync can take a long time
+    if(needs_sync_ && fsync_interval_ms_ > 0 && file_ != stdout)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if(std::chrono::duration_cast<std::chrono::milliseconds>(now - last_sync_time_).count() >= fsync_interval_ms_)
+        {
+            fsync(fileno(file_));
+            last_sync_time_ = now;
+            needs_sync_ = false;
+        }
+    }
+
+    return count > 0;
+}
+
+void AsyncLogSink::writeBatch()
+{
+    if(batch_.empty() || !file_)
+    {
+        batch_.clear();
+        return;
+    }
+    fwrite(batch_.data(), 1, batch_.size(), file_);
+    fflush(file_);
+    file_size_ += batch_.size();
+    needs_sync_ = true;
+    batch_.clear();
+
+    if(max_file_size_ > 0 && file_size_ > max_file_size_ && file_ != stdout)
+    {
+        rollFiles();
+    }
+}
+
+void AsyncLogSink::openFile(bool truncate)
+{
+    if(file_path_.empty())
+    {
+        file_ = stdout;
+        return;
+    }
+
+    if(file_ && file_ != stdout)
+    {
+        fclose(file_);
+    }
+
+    // Same as plog's file appenders, make the log directory if it isn't there yet
+    std::filesystem::path dir = std::filesystem::path(file_path_).parent_path();
+    std::error_code ec;
+    if(!dir.empty())
+    {
+        std::filesystem::create_directories(dir, ec);
+    }
+
+    file_ = fopen(file_path_.c_str(), truncate ? "w" : "a");
+    if(!file_)
+    {
+        // Keep the log rather than silently dropping every line, and only complain once since this is retried on restart
+        if(!open_failed_)
+        {
+            fprintf(stderr, "[AsyncLogSink] Unable to open %s (%s), logging to stdout instead\n", file_path_.c_str(), strerror(errno));
+            open_failed_ = true;
+        }
+        file_ = stdout;
+        return;
+    }
+    file_size_ = ftell(file_);
+    if(file_size_ == 0 && !header_.empty())
+    {
+        fwrite(header_.data(), 1, header_.size(), file_);
+        file_size_ += header_.size();
+    }
+}
+
+void AsyncLogSink::rollFiles()
+{
+    // Same naming as plog's RollingFileAppender: log.txt -> log.1.txt -> log.2.txt ...
+    size_t dot = file_path_.find_last_of('.');
+    std::string base = dot == std::string::npos ? file_path_ : file_path_.substr(0, dot);
+    std::string ext = dot == std::string::npos ? "" : file_path_.substr(dot);
+
+    fclose(file_);
+    file_ = NULL;
+    if(max_files_ > 1)
+    {
+        std::string last = base + "." + std::to_string(max_files_ - 1) + ext;
+        remove(last.c_str());
+        for(int i = max_files_ - 2; i >= 1; i--)
+        {
+            std::string from = base + "." + std::to_string(i) + ext;
+            std::string to = base + "." + std::to_string(i + 1) + ext;
+            rename(from.c_str(), to.c_str());
+        }
+        std::string first = base + ".1" + ext;
+        rename(file_path_.c_str(), first.c_str());
+    }
+    openFile(/*truncate=*/ true);
+}
+
+
+AsyncLogWriter& AsyncLogWriter::getInstance()
+{
+    static AsyncLogWriter* instance = new AsyncLogWriter();
+    return *instance;
+}
+
+AsyncLogWriter::AsyncLogWriter()
+: sinks_mutex_(),
+  sinks_(),
+  idle_sleep_ms_(cfg.lookup("logging.writer_idle_ms")),
+  thread_(&AsyncLogWriter::threadLoop, this)
+{
+    thread_.detach();
+}
+
+void AsyncLogWriter::addSink(AsyncLogSink* sink)
+{
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    sinks_.push_back(sink);
+}
+
+void AsyncLogWriter::removeSink(AsyncLogSink* sink)
+{
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    while(sink->drain()) {}
+    for(auto it = sinks_.begin(); it != sinks_.end(); it++)
+    {
+        if(*it == sink)
+        {
+            sinks_.erase(it);
+            break;
+        }
+    }
+}
+
+void AsyncLogWriter::threadLoop()
+{
+    while(true)
+    {
+        bool wrote_data = false;
+        {
+            std::lock_guard<std::mutex> lock(sinks_mutex_);
+            for(auto sink : sinks_)
+            {
+                wrote_data |= sink->drain();
+            }
+        }
+        if(!wrote_data)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(idle_sleep_ms_));
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef AsyncLogAppender_h
+#define AsyncLogAppender_h
+
+#include <plog/Log.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Destination for pre-formatted log lines. Producers push into a bounded lock-free
+// multi-producer ring and never block. A shared background writer thread drains the
+// ring in batches and does all file I/O. If the ring is full, the record is dropped
+// and counted, and the writer notes the drop count in the log.
+class AsyncLogSink
+{
+  public:
+    // An empty file_path writes to stdout. max_file_size of 0 disables rolling. The file's directory is created
+    // if it doesn't exist, and if the file still can't be opened the sink falls back to stdout.
+    AsyncLogSink(const std::string& file_path, const std::string& header, size_t max_file_size, int max_files);
+
+    virtual ~AsyncLogSink();
+
+    // Safe to call from any thread, never blocks. Returns false if the record was dropped.
+    bool push(std::string&& line);
+
+    // Asks the writer to truncate the file and start over with a fresh header
+    void restart();
+
+    int getDroppedCount() const { return dropped_count_; }
+
+    // Called from the writer thread only. Returns true if anything was written.
+    bool drain();
+
+  private:
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        std::string line;
+        bool restart;
+    };
+
+    bool pushEntry(std::string&& line, bool restart);
+
+    bool pop(std::string& line, bool& restart);
+
+    void openFile(bool truncate);
+
+    void rollFiles();
+
+    void writeBatch();
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) size_t dequeue_pos_;
+    std::atomic<int> dropped_count_;
+    int reported_dropped_count_;
+
+    std::string file_path_;
+    std::string header_;
+    size_t max_file_size_;
+    int max_files_;
+    FILE* file_;
+    bool open_failed_;             // Already warned that the file couldn't be opened
+    size_t file_size_;
+    std::string batch_;
+    bool needs_sync_;
+    int fsync_interval_ms_;
+    std::chrono::steady_clock::time_point last_sync_time_;
+};
+
+// Owns the single background thread that services every AsyncLogSink. Never destroyed so
+// that sinks held in static storage can still drain through it at exit.
+class AsyncLogWriter
+{
+  public:
+    static AsyncLogWriter& getInstance();
+
+    void addSink(AsyncLogSink* sink);
+
+    // Writes out anything left in the sink before removing it
+    void removeSink(AsyncLogSink* sink);
+
+  private:
+    AsyncLogWriter();
+
+    void threadLoop();
+
+    std::mutex sinks_mutex_;   // Only taken by the writer thread and when adding/removing sinks, never by producers
+    std::vector<AsyncLogSink*> sinks_;
+    int idle_sleep_ms_;
+    std::thread thread_;
+};
+
+// plog appender that formats the record on the calling thread and hands the line to the
+// background writer, so logging from the control loop never waits on disk or console I/O
+template<class Formatter>
+class AsyncAppender : public plog::IAppender, public AsyncLogSink
+{
+  public:
+    AsyncAppender(const char* file_name, size_t max_file_size = 0, int max_files = 0)
+    : AsyncLogSink(file_name, Formatter::header(), max_file_size, max_files)
+    {}
+
+    virtual void write(const plog::Record& record) override
+    {
+        push(Formatter::format(record));
+    }
+};
+
+#endif //AsyncLogAppender_h
@@ -0,0 +1,159 @@
+#include "CommandSequencer.h"
+
+#include <plog/Log.h>
+
+LANE laneForCommand(COMMAND cmd)
+{
+    if(cmd == COMMAND::MOVE || 
+       cmd == COMMAND::MOVE_REL ||
+       cmd == COMMAND::MOVE_FINE ||
+       cmd == COMMAND::MOVE_CONST_VEL ||
+       cmd == COMMAND::JOG ||
+       cmd == COMMAND::MOVE_WITH_VISION || 
+       cmd == COMMAND::MOVE_REL_SLOW || 
+       cmd == COMMAND::MOVE_FINE_STOP_VISION ||
+       cmd == COMMAND::WAIT_FOR_LOCALIZATION)
+    {
+        return LANE::BASE;
+    }
+    else if(cmd == COMMAND::PLACE_TRAY ||
+            cmd == COMMAND::LOAD_TRAY ||
+            cmd == COMMAND::INITIALIZE_TRAY)
+    {
+        return LANE::TRAY;
+    }
+    return LANE::NONE;
+}
+
+CommandSequencer::CommandSequencer(const StateBus& bus, float confidence_threshold)
+: bus_(bus),
+  confidence_threshold_(confidence_threshold),
+  steps_(),
+  next_step_(0),
+  running_(false),
+  step_ready_(false),
+  step_timer_(),
+  base_timeout_(),
+  tray_timeout_()
+{
+}
+
+void CommandSequencer::start(const std::vector<RobotServer::SequenceStep>& steps)
+{
+    steps_ = steps;
+    next_step_ = 0;
+    running_ = !steps_.empty();
+    step_ready_ = false;
+    base_timeout_.timeout_s = 0;
+    tray_timeout_.timeout_s = 0;
+    PLOGI.printf("Starting sequence with %i steps", getNumSteps());
+}
+
+void CommandSequencer::abort()
+{
+    if(running_)
+    {
+        PLOGW.printf("Aborting sequence at step %i of %i", next_step_, getNumSteps());
+    }
+    running_ = false;
+    step_ready_ = false;
+}
+
+bool CommandSequencer::update(bool base_busy, bool tray_busy, std::vector<RobotServer::SequenceStep>* steps_to_start)
+{
+    if(!running_)
+    {
+        return true;
+    }
+
+    if((base_busy && timedOut(base_timeout_)) || (tray_busy && timedOut(tray_timeout_)))
+    {
+        PLOGE.printf("Sequence step timed out while running");
+        abort();
+        return false;
+    }
+
+    while(next_step_ < getNumSteps())
+    {
+        const RobotServer::SequenceStep& step = steps_[next_step_];
+        LANE lane = laneForCommand(step.cmd);
+        bool lane_busy = (lane == LANE::BASE && base_busy) || (lane == LANE::TRAY && tray_busy);
+        bool lanes_free = step.with_previous ? !lane_busy : !base_busy && !tray_busy;
+        if(!lanes_free)
+        {
+            break;
+        }
+
+        if(!step_ready_)
+        {
+            step_ready_ = true;
+            step_timer_.reset();
+        }
+        if(!conditionMet(step.condition))
+        {
+            if(step.timeout_s > 0 && step_timer_.dt_s() > step.timeout_s)
+            {
+                PLOGE.printf("Sequence step %i timed out waiting for its condition", next_step_);
+                abort();
+                return false;
+            }
+            break;
+        }
+
+        // The step keeps whatever time it has left after waiting while it runs
+        if(lane == LANE::BASE)
+        {
+            base_busy = true;
+            base_timeout_ = {step.timeout_s, step_timer_};
+        }
+        else if(lane == LANE::TRAY)
+        {
+            tray_busy = true;
+            tray_timeout_ = {step.timeout_s, step_timer_};
+        }
+        steps_to_start->push_back(step);
+        step_ready_ = false;
+        next_step_++;
+    }
+
+    if(next_step_ == getNumSteps() && !base_busy && !tray_busy)
+    {
+        PLOGI.printf("Sequence complete");
+        running_ = false;
+    }
+    return true;
+}
+
+int CommandSequencer::findNextStep(LANE lane) const
+{
+    if(!running_)
+    {
+        return -1;
+    }
+    for(int i = next_step_; i < getNumSteps(); i++)
+    {
+        if(laneForCommand(steps_[i].cmd) == lane)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool CommandSequencer::conditionMet(SEQUENCE_CONDITION condition) const
+{
+    if(condition == SEQUENCE_CONDITION::LOCALIZED)
+    {
+        return bus_.localization.get().total_confidence >= confidence_threshold_;
+    }
+    else if(condition == SEQUENCE_CONDITION::VISION_OK)
+    {
+        return bus_.camera.get().ok;
+    }
+    return true;
+}
+
+bool CommandSequencer::timedOut(LaneTimeout& lane_timeout) const
+{
+    return lane_timeout.timeout_s > 0 && lane_timeout.timer.dt_s() > lane_timeout.timeout_s;
+}
@@ -0,0 +1,68 @@
+#ifndef CommandSequencer_h
+#define CommandSequencer_h
+
+#include <vector>
+
+#include "constants.h"
+#include "RobotServer.h"
+#include "StateBus.h"
+#include "utils.h"
+
+// Lane a command runs in, LANE::NONE for commands that are handled right away
+LANE laneForCommand(COMMAND cmd);
+
+// Runs a list of commands uploaded by master in one go, so each step can start on the same loop the
+// previous one finishes instead of waiting on a round trip to master. The sequencer only decides when
+// steps should start, the robot still starts them and reports when their lanes are free again.
+class CommandSequencer
+{
+  public:
+
+    CommandSequencer(const StateBus& bus, float confidence_threshold);
+
+    // Starts running the steps from the first one
+    void start(const std::vector<RobotServer::SequenceStep>& steps);
+
+    // Drops any steps that haven't started yet. Steps that are already running are left to finish.
+    void abort();
+
+    bool isRunning() const { return running_; };
+
+    // Index of the next step to start, equal to the number of steps once they have all been started
+    int getCurrentStep() const { return next_step_; };
+
+    int getNumSteps() const { return steps_.size(); };
+
+    // Index of the first step that hasn't started and runs in the given lane, -1 if there is none
+    int findNextStep(LANE lane) const;
+
+    const RobotServer::SequenceStep& getStep(int idx) const { return steps_[idx]; };
+
+    // Called once per loop after lanes have been checked for completion. Adds the steps that should be started
+    // this loop to steps_to_start, in order. Returns false if a step ran out of time, which aborts the sequence.
+    bool update(bool base_busy, bool tray_busy, std::vector<RobotServer::SequenceStep>* steps_to_start);
+
+  private:
+
+    // Time budget of the step running in a lane, counted from when the step became ready
+    struct LaneTimeout
+    {
+        float timeout_s;
+        Timer timer;
+    };
+
+    bool conditionMet(SEQUENCE_CONDITION condition) const;
+    bool timedOut(LaneTimeout& lane_timeout) const;
+
+    const StateBus& bus_;
+    float confidence_threshold_;
+    std::vector<RobotServer::SequenceStep> steps_;
+    int next_step_;
+    bool running_;
+    bool step_ready_;                   // The next step has its lanes free and is waiting on its condition
+    Timer step_timer_;                  // Started when the next step became ready
+    LaneTimeout base_timeout_;
+    LaneTimeout tray_timeout_;
+};
+
+#endif //CommandSequencer_h
@@ -35,7 +35,7 @@ class KalmanFilter
 
     // Get current state estimate
     Eigen::VectorXf state() { return x_hat_; };
-    Eigen::MatrixXf covariance() { return P_; };
+    const Eigen::MatrixXf& covariance() { return P_; };
 
     void update_covariance(Eigen::MatrixXf P) {P_ = P;}
 
@@ -25,6 +25,8 @@ class Localization
 
     LocalizationMetrics getLocalizationMetrics() { return metrics_; };
 
+    Eigen::Vector3f getCovarianceDiagonal() { return kf_.covariance().diagonal(); };
+
     void resetAngleCovariance();
 
   private:
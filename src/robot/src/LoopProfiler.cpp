@@ -0,0 +1,141 @@
+#include "LoopProfiler.h"
+
+#include <ArduinoJson/ArduinoJson.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <plog/Log.h>
+#include "constants.h"
+
+// Names used in the perf message, in LOOP_STAGE order
+const char* stage_names[] = {"socket", "command", "marvelmind", "controller", "serial", "tray", "camera", "loop"};
+static_assert(sizeof(stage_names) / sizeof(stage_names[0]) == static_cast<int>(LOOP_STAGE::NUM_STAGES), "Missing stage name");
+
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(uint32_t us)
+{
+    buckets_[bucketIndex(us)]++;
+    count_++;
+    sum_ += us;
+    if(us > max_) max_ = us;
+}
+
+void LatencyHistogram::reset()
+{
+    buckets_.fill(0);
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+}
+
+float LatencyHistogram::getMean() const
+{
+    if(count_ == 0) return 0;
+    return static_cast<float>(sum_) / count_;
+}
+
+uint32_t LatencyHistogram::getPercentile(float p) const
+{
+    if(count_ == 0) return 0;
+
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * count_)));
+    uint64_t seen = 0;
+    for(int i = 0; i < num_buckets; i++)
+    {
+        seen += buckets_[i];
+        if(seen >= target)
+        {
+            return std::min(bucketUpperBound(i), max_);
+        }
+    }
+    return max_;
+}
+
+
+LoopProfiler* LoopProfiler::instance = NULL;
+
+LoopProfiler* LoopProfiler::getInstance()
+{
+    if(!instance)
+    {
+        instance = new LoopProfiler;
+    }
+    return instance;
+}
+
+LoopProfiler::LoopProfiler()
+: enabled_(cfg.lookup("perf.enabled")),
+  histograms_()
+{
+}
+
+void LoopProfiler::record(LOOP_STAGE stage, uint32_t us)
+{
+    histograms_[static_cast<int>(stage)].record(us);
+}
+
+void LoopProfiler::reset()
+{
+    for(auto& h : histograms_)
+    {
+        h.reset();
+    }
+}
+
+std::string LoopProfiler::getJsonString() const
+{
+    const int num_stages = static_cast<int>(LOOP_STAGE::NUM_STAGES);
+    const size_t capacity = JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(num_stages) + num_stages * JSON_OBJECT_SIZE(5);
+    DynamicJsonDocument root(capacity);
+
+    // Format to match messages sent by server
+    root["type"] = "perf";
+    JsonObject doc = root.createNestedObject("data");
+    for(int i = 0; i < num_stages; i++)
+    {
+        const LatencyHistogram& h = histograms_[i];
+        JsonObject stage = doc.createNestedObject(stage_names[i]);
+        stage["count"] = h.getCount();
+        stage["mean"] = h.getMean();
+        stage["p50"] = h.getPercentile(0.5);
+        stage["p99"] = h.getPercentile(0.99);
+        stage["max"] = h.getMax();
+    }
+
+    std::string msg;
+    serializeJson(root, msg);
+    return msg;
+}
+
+bool LoopProfiler::dump(const std::string& path) const
+{
+    std::ofstream f(path);
+    if(!f)
+    {
+        PLOGW << "Could not write loop timing to " << path;
+        return false;
+    }
+    f << getJsonString() << std::endl;
+    return true;
+}
+
+
+ScopedStageTimer::ScopedStageTimer(LOOP_STAGE stage)
+: stage_(stage),
+  enabled_(LoopProfiler::getInstance()->isEnabled()),
+  start_()
+{
+    if(enabled_) start_ = std::chrono::steady_clock::now();
+}
+
+ScopedStageTimer::~ScopedStageTimer()
+{
+    if(!enabled_) return;
+    auto dt = std::chrono::steady_clock::now() - start_;
+    LoopProfiler::getInstance()->record(stage_, std::chrono::duration_cast<std::chrono::microseconds>(dt).count());
+}
@@ -0,0 +1,114 @@
+#ifndef LoopProfiler_h
+#define LoopProfiler_h
+
+#include <array>
+#include <chrono>
+#include <string>
+
+#include "utils.h"
+
+// Stages of Robot::runOnce that are timed. SERIAL happens inside CONTROLLER, so it is counted in both.
+enum class LOOP_STAGE
+{
+    SOCKET,       // Reading and parsing messages from master
+    COMMAND,      // Starting a new command
+    MARVELMIND,   // Polling the marvelmind and feeding it to localization
+    CONTROLLER,   // RobotController::update
+    SERIAL,       // Sending to and reading from the motor driver
+    TRAY,         // TrayController::update
+    CAMERA,       // Camera tracker update and the vision stop trigger
+    LOOP,         // All of Robot::runOnce
+    NUM_STAGES,
+};
+
+// Latency histogram with HDR style buckets. Values under 32 us get their own bucket, above that each
+// power of two is split into 16 linear buckets, so reported values are within about 6% of the real
+// ones over the whole range. Recording is O(1) and never allocates.
+class LatencyHistogram
+{
+  public:
+
+    using Buckets = LogLinearBuckets<4>;
+    static constexpr int sub_bucket_count = Buckets::sub_bucket_count;
+    static constexpr int num_buckets = Buckets::num_buckets;
+
+    LatencyHistogram();
+
+    void record(uint32_t us);
+
+    void reset();
+
+    uint64_t getCount() const { return count_; };
+
+    uint32_t getMax() const { return max_; };
+
+    float getMean() const;
+
+    // Smallest value that fraction p (0 to 1) of the samples are at or below, reported as the top of its bucket
+    uint32_t getPercentile(float p) const;
+
+    // Helpers for mapping values to buckets, public for testing
+    static int bucketIndex(uint32_t us) { return Buckets::index(us); };
+    static uint32_t bucketUpperBound(int idx) { return Buckets::upperBound(idx); };
+
+  private:
+
+    std::array<uint32_t, num_buckets> buckets_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint32_t max_;
+};
+
+// Per stage latency histograms for the robot loop, read over the network with the perf command
+class LoopProfiler
+{
+  public:
+
+    static LoopProfiler* getInstance();
+
+    void record(LOOP_STAGE stage, uint32_t us);
+
+    const LatencyHistogram& getHistogram(LOOP_STAGE stage) const { return histograms_[static_cast<int>(stage)]; };
+
+    void reset();
+
+    bool isEnabled() const { return enabled_; };
+
+    // Count, mean, p50, p99 and max (us) of every stage, formatted like the messages sent by the server
+    std::string getJsonString() const;
+
+    // Writes getJsonString to a file
+    bool dump(const std::string& path) const;
+
+    // Delete copy and assignment constructors
+    LoopProfiler(LoopProfiler const&) = delete;
+    LoopProfiler& operator= (LoopProfiler const&) = delete;
+
+  private:
+
+    LoopProfiler();
+
+    static LoopProfiler* instance;
+
+    bool enabled_;
+    std::array<LatencyHistogram, static_cast<int>(LOOP_STAGE::NUM_STAGES)> histograms_;
+};
+
+// Records the time between construction and destruction against a loop stage. Uses the steady
+// clock directly rather than ClockFactory since it measures real execution time.
+class ScopedStageTimer
+{
+  public:
+
+    ScopedStageTimer(LOOP_STAGE stage);
+
+    ~ScopedStageTimer();
+
+  private:
+
+    LOOP_STAGE stage_;
+    bool enabled_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif //LoopProfiler_h
@@ -1,13 +1,21 @@
 #include "MarvelmindWrapper.h"
 #include "constants.h"
 #include "plog/Log.h"
+#include "sim/SimRobotPlant.h"
 #include <filesystem>
 
 
 MarvelmindWrapper::MarvelmindWrapper()
 : hedge_(createMarvelmindHedge()),
-  ready_(false)
+  ready_(false),
+  simulated_(cfg.lookup("simulation.enabled"))
 {
+    if(simulated_)
+    {
+        PLOGI << "Using simulated marvelmind";
+        return;
+    }
+
     // I expect to 2 devices connected, but because of the fun of linux and udev rules, I don't know 
     // which of the three possible names the devices could have. I could later change this to first 
     // do an `ls /dev/ | grep marvelmind` and find the right ports, but this should work fine too.
@@ -42,6 +50,11 @@ std::vector<float> MarvelmindWrapper::getPositions()
 {
     PositionValue position_data;
     std::vector<float> output;
+
+    if (simulated_)
+    {
+        return SimRobotPlant::getInstance()->getMarvelmindReading();
+    }
     
     if (!ready_)
     {
@@ -17,6 +17,7 @@ class MarvelmindWrapper
   private:
     MarvelmindHedge* hedge_;
     bool ready_;
+    bool simulated_;      // Readings come from SimRobotPlant instead of the hardware
 
 };
 
@@ -1,14 +1,18 @@
 #include "RobotController.h"
 
+#include <algorithm>
 #include <math.h>
 #include <plog/Log.h>
 #include <Eigen/Dense>
 
 #include "constants.h"
+#include "LoopProfiler.h"
 #include "serial/SerialCommsFactory.h"
 #include "robot_controller_modes/RobotControllerModePosition.h"
+#include "robot_controller_modes/RobotControllerModeTracking.h"
 #include "robot_controller_modes/RobotControllerModeVision.h"
 #include "robot_controller_modes/RobotControllerModeStopFast.h"
+#include "robot_controller_modes/RobotControllerModeVelocity.h"
 
 
 RobotController::RobotController(StatusUpdater& statusUpdater)
@@ -24,142 +28,234 @@ RobotController::RobotController(StatusUpdater& statusUpdater)
   logging_rate_(cfg.lookup("motion.log_frequency")),
   log_this_cycle_(false),
   fake_perfect_motion_(cfg.lookup("motion.fake_perfect_motion")),
+  tracking_mode_(cfg.lookup("motion.tracking_mode")),
   fake_local_cart_vel_(0,0,0),
   max_cart_vel_limit_({cfg.lookup("motion.translation.max_vel.coarse"),
                        cfg.lookup("motion.translation.max_vel.coarse"),
                        cfg.lookup("motion.rotation.max_vel.coarse")}),
-  loop_time_averager_(20)
+  wheel_limits_({cfg.lookup("motion.wheel_limits.dist_from_center"),
+                 cfg.lookup("motion.wheel_limits.max_vel"),
+                 cfg.lookup("motion.wheel_limits.max_acc")}),
+  stop_problem_(buildMotionPlanningProblem({0,0,0}, {0,0,0}, LIMITS_MODE::COARSE, getSolverParameters())),
+  loop_time_averager_(20),
+  telemetry_(),
+  telemetry_loop_timer_(),
+  motion_id_(0),
+  planner_(),
+  move_goal_(),
+  goal_known_(false),
+  speed_override_(1)
 {    
     if(fake_perfect_motion_) PLOGW << "Fake robot motion enabled";
 }
 
 void RobotController::moveToPosition(float x, float y, float a)
 {
-    reset_last_motion_logger();
     limits_mode_ = LIMITS_MODE::COARSE;
     setCartVelLimits(limits_mode_);
     Point goal_pos = Point(x,y,a);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("MoveToPosition: %s",goal_pos.toString().c_str());
+    PLOGI_(MOTION_LOG_ID).printf("MoveToPosition: %s",goal_pos.toString().c_str());
 
-    auto position_mode = std::make_unique<RobotControllerModePosition>(fake_perfect_motion_);
-    bool ok = position_mode->startMove(cartPos_, goal_pos, limits_mode_);
-   
-    if (ok) 
-    { 
-        startTraj(); 
-        controller_mode_ = std::move(position_mode);
-    }
-    else { statusUpdater_.setErrorStatus(); }
+    startPositionMove(goal_pos);
 }
 
 void RobotController::moveToPositionRelative(float dx_local, float dy_local, float da_local)
 {
-    reset_last_motion_logger();
     limits_mode_ = LIMITS_MODE::COARSE;
     setCartVelLimits(limits_mode_);
 
-    float dx_global =  cos(cartPos_.a) * dx_local - sin(cartPos_.a) * dy_local;
-    float dy_global =  sin(cartPos_.a) * dx_local + cos(cartPos_.a) * dy_local;
-    float da_global = da_local;
-    Point goal_pos = Point(cartPos_.x + dx_global, cartPos_.y + dy_global, wrap_angle(cartPos_.a + da_global));
-    PLOGI_(MOTION_CSV_LOG_ID).printf("MoveToPositionRelative: %s",goal_pos.toString().c_str());
+    Point goal_pos = relativeGoal(cartPos_, dx_local, dy_local, da_local);
+    PLOGI_(MOTION_LOG_ID).printf("MoveToPositionRelative: %s",goal_pos.toString().c_str());
 
-    auto position_mode = std::make_unique<RobotControllerModePosition>(fake_perfect_motion_);
-    bool ok = position_mode->startMove(cartPos_, goal_pos, limits_mode_);
-   
-    if (ok) 
-    { 
-        startTraj(); 
-        controller_mode_ = std::move(position_mode);
-    }
-    else { statusUpdater_.setErrorStatus(); }
+    startPositionMove(goal_pos);
 }
 
 void RobotController::moveToPositionRelativeSlow(float dx_local, float dy_local, float da_local)
 {
-    reset_last_motion_logger();
     limits_mode_ = LIMITS_MODE::SLOW;
     setCartVelLimits(limits_mode_);
 
-    float dx_global =  cos(cartPos_.a) * dx_local - sin(cartPos_.a) * dy_local;
-    float dy_global =  sin(cartPos_.a) * dx_local + cos(cartPos_.a) * dy_local;
-    float da_global = da_local;
-    Point goal_pos = Point(cartPos_.x + dx_global, cartPos_.y + dy_global, wrap_angle(cartPos_.a + da_global));
-    PLOGI_(MOTION_CSV_LOG_ID).printf("MoveToPositionRelativeSlow: %s",goal_pos.toString().c_str());
+    Point goal_pos = relativeGoal(cartPos_, dx_local, dy_local, da_local);
+    PLOGI_(MOTION_LOG_ID).printf("MoveToPositionRelativeSlow: %s",goal_pos.toString().c_str());
 
-    auto position_mode = std::make_unique<RobotControllerModePosition>(fake_perfect_motion_);
-    bool ok = position_mode->startMove(cartPos_, goal_pos, limits_mode_);
-   
-    if (ok) 
-    { 
-        startTraj(); 
-        controller_mode_ = std::move(position_mode);
-    }
-    else { statusUpdater_.setErrorStatus(); }
+    startPositionMove(goal_pos);
 }
 
 void RobotController::moveToPositionFine(float x, float y, float a)
 {
-    reset_last_motion_logger();
     limits_mode_ = LIMITS_MODE::FINE;
     setCartVelLimits(limits_mode_);
     Point goal_pos = Point(x,y,a);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("MoveToPositionFine: %s",goal_pos.toString().c_str());
+    PLOGI_(MOTION_LOG_ID).printf("MoveToPositionFine: %s",goal_pos.toString().c_str());
 
-    auto position_mode = std::make_unique<RobotControllerModePosition>(fake_perfect_motion_);
-    bool ok = position_mode->startMove(cartPos_, goal_pos, limits_mode_);
-   
-    if (ok) 
-    { 
-        startTraj(); 
-        controller_mode_ = std::move(position_mode);
-    }
-    else { statusUpdater_.setErrorStatus(); }
+    startPositionMove(goal_pos);
 }
 
 void RobotController::moveConstVel(float vx , float vy, float va, float t)
 {
-    (void) vx;
-    (void) vy;
-    (void) va;
-    (void) t;
-    PLOGE << "Not implimented";
+    Velocity velocity = {vx, vy, va};
+    PLOGI_(MOTION_LOG_ID).printf("MoveConstVel: %s for %.2f s", velocity.toString().c_str(), t);
+    setVelocitySetpoint(velocity, t);
+}
+
+void RobotController::jog(float vx, float vy, float va)
+{
+    Velocity velocity = {vx, vy, va};
+    PLOGD_(MOTION_LOG_ID).printf("Jog: %s", velocity.toString().c_str());
+    setVelocitySetpoint(velocity, cfg.lookup("motion.jog.deadman_timeout"));
+}
+
+void RobotController::setVelocitySetpoint(Velocity velocity, float hold_s)
+{
+    RobotControllerModeVelocity* running_mode = trajRunning_ ? dynamic_cast<RobotControllerModeVelocity*>(controller_mode_.get()) : nullptr;
+    if(running_mode)
+    {
+        running_mode->setSetpoint(velocity, hold_s);
+        return;
+    }
+
+    limits_mode_ = LIMITS_MODE::COARSE;
+    setCartVelLimits(limits_mode_);
+    auto velocity_mode = std::make_unique<RobotControllerModeVelocity>(fake_perfect_motion_);
+    velocity_mode->startMove();
+    velocity_mode->setSetpoint(velocity, hold_s);
+    startTraj();
+    controller_mode_ = std::move(velocity_mode);
+    goal_known_ = false;
 }
 
 void RobotController::moveWithVision(float x, float y, float a)
 {
-    reset_last_motion_logger();
     limits_mode_ = LIMITS_MODE::VISION;
     setCartVelLimits(limits_mode_);
     Point goal = Point(x,y,a);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("MoveWithVision: %s",goal.toString().c_str());
+    PLOGI_(MOTION_LOG_ID).printf("MoveWithVision: %s",goal.toString().c_str());
     auto vision_mode = std::make_unique<RobotControllerModeVision>(fake_perfect_motion_, statusUpdater_);
+    vision_mode->setSpeedOverride(speed_override_);
     bool ok = vision_mode->startMove(goal);
    
     if (ok) 
     { 
         startTraj(); 
         controller_mode_ = std::move(vision_mode);
+        goal_known_ = false;
     }
     else { statusUpdater_.setErrorStatus(); }
 }
 
 void RobotController::stopFast()
 {
-    reset_last_motion_logger();
-    limits_mode_ = LIMITS_MODE::FINE;
-    setCartVelLimits(limits_mode_);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("Stop Fast");
+    // Keeps the velocity limits of the move being stopped, lowering them would cut the velocity before the stop 
+    // profile gets to slow it down
+    PLOGI_(MOTION_LOG_ID).printf("Stop Fast");
 
     auto stop_fast_mode = std::make_unique<RobotControllerModeStopFast>(fake_perfect_motion_);
-    stop_fast_mode->startMove(cartPos_, cartVel_);
-    startTraj(); 
-    controller_mode_ = std::move(stop_fast_mode);
+    bool ok = stop_fast_mode->startMove(cartPos_, cartVel_, getTargetAcceleration());
+    if (ok)
+    {
+        startTraj(); 
+        controller_mode_ = std::move(stop_fast_mode);
+        goal_known_ = false;
+    }
+    else { statusUpdater_.setErrorStatus(); }
+}
+
+void RobotController::setSpeedOverride(float speed_override)
+{
+    float min_override = cfg.lookup("motion.speed_override.min");
+    float max_override = cfg.lookup("motion.speed_override.max");
+    speed_override_ = std::max(min_override, std::min(max_override, speed_override));
+    if(speed_override_ != speed_override)
+    {
+        PLOGW.printf("Speed override %.2f out of range, using %.2f", speed_override, speed_override_);
+    }
+    PLOGI_(MOTION_LOG_ID).printf("Speed override: %.2f", speed_override_);
+
+    if(controller_mode_)
+    {
+        controller_mode_->setSpeedOverride(speed_override_);
+    }
+}
+
+float RobotController::getStoppingDistance()
+{
+    // Planned from the cached problem so checking this every loop while moving doesn't log or read the config
+    Velocity acc = getTargetAcceleration();
+    MotionPlanningProblem mpp = stop_problem_;
+    mpp.initialPoint = {cartPos_.x, cartPos_.y, cartPos_.a};
+    mpp.initialVelocity = {cartVel_.vx, cartVel_.vy, cartVel_.va};
+    mpp.initialAcceleration = {acc.vx, acc.vy, acc.va};
+    Trajectory traj = generateStopTrajectory(mpp);
+    return traj.trans_params.switch_points[7].p;
+}
+
+Velocity RobotController::getTargetAcceleration()
+{
+    if(!trajRunning_ || !controller_mode_)
+    {
+        return {0,0,0};
+    }
+    return controller_mode_->getCurrentTargetAcceleration();
+}
+
+void RobotController::planNextMove(float x, float y, float a, LIMITS_MODE limits_mode)
+{
+    planner_.requestPlan(getExpectedEndPosition(), Point(x,y,a), limits_mode);
+}
+
+void RobotController::planNextMoveRelative(float dx_local, float dy_local, float da_local, LIMITS_MODE limits_mode)
+{
+    Point start = getExpectedEndPosition();
+    planner_.requestPlan(start, relativeGoal(start, dx_local, dy_local, da_local), limits_mode);
+}
+
+Point RobotController::getExpectedEndPosition()
+{
+    return trajRunning_ && goal_known_ ? move_goal_ : cartPos_;
+}
+
+Point RobotController::relativeGoal(Point start, float dx_local, float dy_local, float da_local)
+{
+    float dx_global =  cos(start.a) * dx_local - sin(start.a) * dy_local;
+    float dy_global =  sin(start.a) * dx_local + cos(start.a) * dy_local;
+    float da_global = da_local;
+    return Point(start.x + dx_global, start.y + dy_global, wrap_angle(start.a + da_global));
+}
+
+void RobotController::startPositionMove(Point goal_pos)
+{
+    std::unique_ptr<RobotControllerModePosition> position_mode;
+    if(tracking_mode_) position_mode = std::make_unique<RobotControllerModeTracking>(fake_perfect_motion_);
+    else position_mode = std::make_unique<RobotControllerModePosition>(fake_perfect_motion_);
+    position_mode->setSpeedOverride(speed_override_);
+    bool ok;
+    Trajectory planned_traj;
+    Point planned_goal;
+    if(planner_.takePlan(cartPos_, goal_pos, limits_mode_, &planned_traj, &planned_goal))
+    {
+        PLOGI.printf("Using trajectory planned ahead to %s", planned_goal.toString().c_str());
+        goal_pos = planned_goal;
+        ok = position_mode->startPlannedMove(planned_traj, goal_pos, limits_mode_);
+    }
+    else
+    {
+        ok = position_mode->startMove(cartPos_, goal_pos, limits_mode_);
+    }
+   
+    if (ok) 
+    { 
+        startTraj(); 
+        controller_mode_ = std::move(position_mode);
+        move_goal_ = goal_pos;
+        goal_known_ = true;
+    }
+    else { statusUpdater_.setErrorStatus(); }
 }
 
 
 void RobotController::startTraj()
 {
+    motion_id_++;
     trajRunning_ = true;
     enableAllMotors();
     PLOGI.printf("Starting move");
@@ -171,6 +267,7 @@ void RobotController::estop()
     PLOGD_(MOTION_LOG_ID) << "\n====ESTOP====\n";
     trajRunning_ = false;
     limits_mode_ = LIMITS_MODE::FINE;
+    planner_.clear();
     disableAllMotors();
 }
 
@@ -225,7 +322,46 @@ void RobotController::update()
     statusUpdater_.updateVelocity(cartVel_.vx, cartVel_.vy, cartVel_.va);
     loop_time_averager_.mark_point();
     statusUpdater_.updateControlLoopTime(loop_time_averager_.get_ms());
+    statusUpdater_.updateControlLoopJitter(loop_time_averager_.get_p99_ms(), loop_time_averager_.get_max_ms());
     statusUpdater_.updateLocalizationMetrics(localization_.getLocalizationMetrics());
+
+    recordTelemetry(target_vel);
+}
+
+void RobotController::recordTelemetry(Velocity control_vel)
+{
+    PVTPoint target = controller_mode_ ? controller_mode_->getCurrentTarget() : PVTPoint();
+    Eigen::Vector3f cov = localization_.getCovarianceDiagonal();
+
+    TelemetryRecord record;
+    record.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        ClockFactory::getFactoryInstance()->get_clock()->now().time_since_epoch()).count();
+    record.motion_id = motion_id_;
+    record.limits_mode = static_cast<uint16_t>(limits_mode_);
+    record.traj_running = trajRunning_;
+    record.traj_time = target.time;
+    record.pos[0] = cartPos_.x;
+    record.pos[1] = cartPos_.y;
+    record.pos[2] = cartPos_.a;
+    record.vel[0] = cartVel_.vx;
+    record.vel[1] = cartVel_.vy;
+    record.vel[2] = cartVel_.va;
+    record.target_pos[0] = target.position.x;
+    record.target_pos[1] = target.position.y;
+    record.target_pos[2] = target.position.a;
+    record.target_vel[0] = target.velocity.vx;
+    record.target_vel[1] = target.velocity.vy;
+    record.target_vel[2] = target.velocity.va;
+    record.control_vel[0] = control_vel.vx;
+    record.control_vel[1] = control_vel.vy;
+    record.control_vel[2] = control_vel.va;
+    record.loop_dt = telemetry_loop_timer_.dt_s();
+    record.cov[0] = cov(0);
+    record.cov[1] = cov(1);
+    record.cov[2] = cov(2);
+    telemetry_loop_timer_.reset();
+
+    telemetry_.record(record);
 }
 
 
@@ -303,6 +439,7 @@ bool RobotController::readMsgFromMotorDriver(Velocity* decodedVelocity)
     std::vector<float> tmpVelocity = {0,0,0};
     if (serial_to_motor_driver_->isConnected())
     {
+        ScopedStageTimer t(LOOP_STAGE::SERIAL);
         int count = 0;
         while(msg.empty() && count++ < 10)
         {
@@ -393,6 +530,20 @@ void RobotController::setCartVelCommand(Velocity target_vel)
         local_cart_vel.va = clamped_vel;
     }
 
+    // Translation and rotation share the wheels, so scale the whole command down if any one wheel can't keep up.
+    // Otherwise the motor driver would saturate that wheel alone and the robot would drift off the commanded direction.
+    Eigen::Vector3f wheel_speeds = localVelToWheelSpeeds(local_cart_vel, wheel_limits_.dist_from_center);
+    float max_wheel_speed = wheel_speeds.cwiseAbs().maxCoeff();
+    if(max_wheel_speed > wheel_limits_.max_vel)
+    {
+        float scale = wheel_limits_.max_vel / max_wheel_speed;
+        PLOGW.printf("Attempted to command wheel speed of %.3f m/s, scaling velocity by %.3f", max_wheel_speed, scale);
+        PLOGW_(MOTION_LOG_ID).printf("Attempted to command wheel speed of %.3f m/s, scaling velocity by %.3f", max_wheel_speed, scale);
+        local_cart_vel.vx *= scale;
+        local_cart_vel.vy *= scale;
+        local_cart_vel.va *= scale;
+    }
+
     // Prep velocity data to send to motor driver
     char buff[100];
     sprintf(buff, "base:%.4f,%.4f,%.4f",local_cart_vel.vx, local_cart_vel.vy, local_cart_vel.va);
@@ -409,6 +560,7 @@ void RobotController::setCartVelCommand(Velocity target_vel)
     }
     else if (serial_to_motor_driver_->isConnected())
     {
+        ScopedStageTimer t(LOOP_STAGE::SERIAL);
         serial_to_motor_driver_->send(s);
     }
 }
@@ -6,6 +6,8 @@
 #include "serial/SerialComms.h"
 #include "utils.h"
 #include "Localization.h"
+#include "TelemetryRecorder.h"
+#include "TrajectoryPlanner.h"
 #include "robot_controller_modes/RobotControllerModeBase.h"
 
 class RobotController
@@ -27,13 +29,32 @@ class RobotController
     // Command robot to move to a specific position with high accuracy
     void moveToPositionFine(float x, float y, float a);
 
-    // Command robot to move with a constant velocity for some amount of time
+    // Command robot to move with a constant global velocity for some amount of time, then ramp down to a stop. 
+    // Sending another one before that just changes the velocity.
     void moveConstVel(float vx , float vy, float va, float t);
 
+    // Same as moveConstVel, but for a stream of setpoints. Each one holds for motion.jog.deadman_timeout.
+    void jog(float vx, float vy, float va);
+
     void moveWithVision(float x, float y, float a);
 
+    // Brings the robot to rest as quickly as the jerk and acceleration limits allow
     void stopFast();
 
+    // Plays the running move and all later ones back this many times faster than planned, within the range in
+    // motion.speed_override and the configured motion limits. The running move changes speed smoothly.
+    void setSpeedOverride(float speed_override);
+
+    // Distance the robot would travel before coming to rest if stopFast was called now. Cheap enough to check every loop.
+    float getStoppingDistance();
+
+    // Solves the next point to point move on the planner thread, starting from where the current move will end,
+    // so it can start without planning once it is commanded. The move still has to be commanded as usual.
+    void planNextMove(float x, float y, float a, LIMITS_MODE limits_mode);
+
+    // Same as planNextMove, but relative to where the current move will end
+    void planNextMoveRelative(float dx_local, float dy_local, float da_local, LIMITS_MODE limits_mode);
+
     // Main update loop. Should be called as fast as possible
     void update();
 
@@ -68,11 +89,22 @@ class RobotController
     void computeOdometry();
     // Sets up everything to start the trajectory running
     void startTraj();
+    // Acceleration the current trajectory is commanding, zero if none is running
+    Velocity getTargetAcceleration();
+    // Changes the setpoint of the running velocity move, or starts one
+    void setVelocitySetpoint(Velocity velocity, float hold_s);
+    // Starts a point to point move to goal_pos with the current limits mode, using a planned ahead trajectory if there is one
+    void startPositionMove(Point goal_pos);
+    // Goal of the running point to point move, or the current position if there isn't one
+    Point getExpectedEndPosition();
+    Point relativeGoal(Point start, float dx_local, float dy_local, float da_local);
     // Reads an incoming message from the motor driver and fills the decoded
     // velocity in the pointer, if available. Returns true if velocity is filled, false otherwise
     bool readMsgFromMotorDriver(Velocity* decodedVelocity);
 
     void setCartVelLimits(LIMITS_MODE limits_mode);
+    // Write this tick's state to the telemetry recorder
+    void recordTelemetry(Velocity control_vel);
 
     // Member variables
     StatusUpdater& statusUpdater_;         // Reference to status updater object to input status info about the controller
@@ -87,10 +119,20 @@ class RobotController
     RateController logging_rate_ ;         // Rate limit logging to file
     bool log_this_cycle_;                  // Trigger for logging this cycle
     bool fake_perfect_motion_;             // Flag used for testing to enable perfect motion without clearcore
+    bool tracking_mode_;                   // Follow point to point moves with RobotControllerModeTracking
     Velocity fake_local_cart_vel_;         // Commanded local cartesian velocity used to fake perfect motion
     Velocity max_cart_vel_limit_;          // Maximum velocity allowed, used to limit commanded velocity
+    WheelLimits wheel_limits_;             // Full wheel capacity, used to limit commanded velocity
+    MotionPlanningProblem stop_problem_;   // COARSE stop limits and solver params for getStoppingDistance
 
     TimeRunningAverage loop_time_averager_;        // Handles keeping average of the loop timing
+    TelemetryRecorder telemetry_;          // Records controller state every tick
+    Timer telemetry_loop_timer_;           // Time between recorded ticks
+    uint32_t motion_id_;                   // Incremented for each new move so telemetry can be split by move
+    TrajectoryPlanner planner_;            // Solves the next move while the current one runs
+    Point move_goal_;                      // Goal of the last point to point move
+    bool goal_known_;                      // If the running move is a point to point move ending at move_goal_
+    float speed_override_;                 // Playback speed of trajectories relative to how they were planned
 
     std::unique_ptr<RobotControllerModeBase> controller_mode_;
 
@@ -4,13 +4,38 @@
 #include <plog/Log.h>
 
 #include "sockets/SocketMultiThreadWrapperFactory.h"
+#include "LoopProfiler.h"
 
 #include <iostream>
 
+namespace
+{
+    // Commands that can be part of a sequence, keyed by the same type names as the single commands
+    COMMAND sequenceCommandForType(const std::string& type)
+    {
+        if(type == "move") return COMMAND::MOVE;
+        if(type == "move_rel") return COMMAND::MOVE_REL;
+        if(type == "move_rel_slow") return COMMAND::MOVE_REL_SLOW;
+        if(type == "move_fine") return COMMAND::MOVE_FINE;
+        if(type == "move_fine_stop_vision") return COMMAND::MOVE_FINE_STOP_VISION;
+        if(type == "move_vision") return COMMAND::MOVE_WITH_VISION;
+        if(type == "move_const_vel") return COMMAND::MOVE_CONST_VEL;
+        if(type == "place") return COMMAND::PLACE_TRAY;
+        if(type == "load") return COMMAND::LOAD_TRAY;
+        if(type == "init") return COMMAND::INITIALIZE_TRAY;
+        if(type == "wait_for_loc") return COMMAND::WAIT_FOR_LOCALIZATION;
+        if(type == "start_cameras") return COMMAND::START_CAMERAS;
+        if(type == "stop_cameras") return COMMAND::STOP_CAMERAS;
+        return COMMAND::NONE;
+    }
+}
+
 RobotServer::RobotServer(StatusUpdater& statusUpdater)
 : moveData_(),
   positionData_(),
   velocityData_(),
+  sequenceData_(),
+  speedOverrideData_(1),
   statusUpdater_(statusUpdater),
   recvInProgress_(false),
   recvIdx_(0),
@@ -21,176 +46,232 @@ RobotServer::RobotServer(StatusUpdater& statusUpdater)
 
 COMMAND RobotServer::getCommand(std::string message)
 {
-    COMMAND cmd = COMMAND::NONE;
     StaticJsonDocument<256> doc;
     DeserializationError err = deserializeJson(doc, message);
 
+    // Sequences are the only messages allowed to outgrow the fixed document, so only they pay for a heap allocation
+    if(err == DeserializationError::NoMemory)
+    {
+        DynamicJsonDocument sequence_doc(8 * message.size());
+        if(!deserializeJson(sequence_doc, message))
+        {
+            std::string type = sequence_doc["type"] | "";
+            if(type == "sequence")
+            {
+                return parseCommand(sequence_doc, message);
+            }
+        }
+    }
+
     if(err)
     {
         printIncomingCommand(message);
         PLOGI.printf("Error parsing JSON: ");
         PLOGI.printf(err.c_str());   
         sendErr("bad_json");
+        return COMMAND::NONE;
     }
-    else
+    return parseCommand(doc, message);
+}
+
+COMMAND RobotServer::parseCommand(JsonDocument& doc, const std::string& message)
+{
+    COMMAND cmd = COMMAND::NONE;
+    std::string type = doc["type"];
+    if(type == "move")
     {
-        std::string type = doc["type"];
-        if(type == "move")
-        {
-            cmd = COMMAND::MOVE;
-            moveData_.x = doc["data"]["x"];
-            moveData_.y = doc["data"]["y"];
-            moveData_.a = doc["data"]["a"];
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "move_rel")
-        {
-            cmd = COMMAND::MOVE_REL;
-            moveData_.x = doc["data"]["x"];
-            moveData_.y = doc["data"]["y"];
-            moveData_.a = doc["data"]["a"];
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "move_rel_slow")
-        {
-            cmd = COMMAND::MOVE_REL_SLOW;
-            moveData_.x = doc["data"]["x"];
-            moveData_.y = doc["data"]["y"];
-            moveData_.a = doc["data"]["a"];
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "move_fine")
-        {
-            cmd = COMMAND::MOVE_FINE;
-            moveData_.x = doc["data"]["x"];
-            moveData_.y = doc["data"]["y"];
-            moveData_.a = doc["data"]["a"];
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "move_fine_stop_vision")
-        {
-            cmd = COMMAND::MOVE_FINE_STOP_VISION;
-            moveData_.x = doc["data"]["x"];
-            moveData_.y = doc["data"]["y"];
-            moveData_.a = doc["data"]["a"];
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "move_vision")
-        {
-            cmd = COMMAND::MOVE_WITH_VISION;
-            moveData_.x = doc["data"]["x"];
-            moveData_.y = doc["data"]["y"];
-            moveData_.a = doc["data"]["a"];
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "move_const_vel")
-        {
-            cmd = COMMAND::MOVE_CONST_VEL;
-            velocityData_.vx = doc["data"]["vx"];
-            velocityData_.vy = doc["data"]["vy"];
-            velocityData_.va = doc["data"]["va"];
-            velocityData_.t = doc["data"]["t"];
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "place")
-        {
-            cmd = COMMAND::PLACE_TRAY;
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "load")
-        {
-            cmd = COMMAND::LOAD_TRAY;
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "init")
-        {
-            cmd = COMMAND::INITIALIZE_TRAY;
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "p")
-        {
-            cmd = COMMAND::POSITION;
-            positionData_.x = doc["data"]["x"];
-            positionData_.y = doc["data"]["y"];
-            positionData_.a = doc["data"]["a"];
-            sendAck(type);
-        }
-        else if(type == "set_pose")
-        {
-            cmd = COMMAND::SET_POSE;
-            positionData_.x = doc["data"]["x"];
-            positionData_.y = doc["data"]["y"];
-            positionData_.a = doc["data"]["a"];
-            sendAck(type);
-        }
-        else if(type == "estop")
-        {
-            cmd = COMMAND::ESTOP;
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "lc")
-        {
-            cmd = COMMAND::LOAD_COMPLETE;
-            printIncomingCommand(message);
-            sendAck(type);
-        }
-        else if(type == "status")
-        {
-            sendStatus();
-        }
-        else if (type == "check")
-        {
-            sendAck(type);
-        }
-        else if (type == "clear_error")
-        {
-            statusUpdater_.clearErrorStatus();
-            sendAck(type);
-        }
-        else if (type == "wait_for_loc")
-        {
-            sendAck(type);
-            cmd = COMMAND::WAIT_FOR_LOCALIZATION;
-        }
-        else if (type == "toggle_vision_debug")
-        {
-            sendAck(type);
-            cmd = COMMAND::TOGGLE_VISION_DEBUG;
-        }
-        else if (type == "start_cameras")
-        {
-            sendAck(type);
-            cmd = COMMAND::START_CAMERAS;
-        }
-        else if (type == "stop_cameras")
+        cmd = COMMAND::MOVE;
+        moveData_.x = doc["data"]["x"];
+        moveData_.y = doc["data"]["y"];
+        moveData_.a = doc["data"]["a"];
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "move_rel")
+    {
+        cmd = COMMAND::MOVE_REL;
+        moveData_.x = doc["data"]["x"];
+        moveData_.y = doc["data"]["y"];
+        moveData_.a = doc["data"]["a"];
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "move_rel_slow")
+    {
+        cmd = COMMAND::MOVE_REL_SLOW;
+        moveData_.x = doc["data"]["x"];
+        moveData_.y = doc["data"]["y"];
+        moveData_.a = doc["data"]["a"];
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "move_fine")
+    {
+        cmd = COMMAND::MOVE_FINE;
+        moveData_.x = doc["data"]["x"];
+        moveData_.y = doc["data"]["y"];
+        moveData_.a = doc["data"]["a"];
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "move_fine_stop_vision")
+    {
+        cmd = COMMAND::MOVE_FINE_STOP_VISION;
+        moveData_.x = doc["data"]["x"];
+        moveData_.y = doc["data"]["y"];
+        moveData_.a = doc["data"]["a"];
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "move_vision")
+    {
+        cmd = COMMAND::MOVE_WITH_VISION;
+        moveData_.x = doc["data"]["x"];
+        moveData_.y = doc["data"]["y"];
+        moveData_.a = doc["data"]["a"];
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "move_const_vel")
+    {
+        cmd = COMMAND::MOVE_CONST_VEL;
+        velocityData_.vx = doc["data"]["vx"];
+        velocityData_.vy = doc["data"]["vy"];
+        velocityData_.va = doc["data"]["va"];
+        velocityData_.t = doc["data"]["t"];
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "jog")
+    {
+        cmd = COMMAND::JOG;
+        velocityData_.vx = doc["data"]["vx"];
+        velocityData_.vy = doc["data"]["vy"];
+        velocityData_.va = doc["data"]["va"];
+        velocityData_.t = 0;
+        sendAck(type);
+    }
+    else if(type == "place")
+    {
+        cmd = COMMAND::PLACE_TRAY;
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "load")
+    {
+        cmd = COMMAND::LOAD_TRAY;
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "init")
+    {
+        cmd = COMMAND::INITIALIZE_TRAY;
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "p")
+    {
+        cmd = COMMAND::POSITION;
+        positionData_.x = doc["data"]["x"];
+        positionData_.y = doc["data"]["y"];
+        positionData_.a = doc["data"]["a"];
+        sendAck(type);
+    }
+    else if(type == "set_pose")
+    {
+        cmd = COMMAND::SET_POSE;
+        positionData_.x = doc["data"]["x"];
+        positionData_.y = doc["data"]["y"];
+        positionData_.a = doc["data"]["a"];
+        sendAck(type);
+    }
+    else if(type == "estop")
+    {
+        cmd = COMMAND::ESTOP;
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "lc")
+    {
+        cmd = COMMAND::LOAD_COMPLETE;
+        printIncomingCommand(message);
+        sendAck(type);
+    }
+    else if(type == "status")
+    {
+        sendStatus();
+    }
+    else if(type == "perf")
+    {
+        sendPerf();
+    }
+    else if (type == "check")
+    {
+        sendAck(type);
+    }
+    else if (type == "clear_error")
+    {
+        statusUpdater_.clearErrorStatus();
+        sendAck(type);
+    }
+    else if (type == "wait_for_loc")
+    {
+        sendAck(type);
+        cmd = COMMAND::WAIT_FOR_LOCALIZATION;
+    }
+    else if (type == "toggle_vision_debug")
+    {
+        sendAck(type);
+        cmd = COMMAND::TOGGLE_VISION_DEBUG;
+    }
+    else if (type == "start_cameras")
+    {
+        sendAck(type);
+        cmd = COMMAND::START_CAMERAS;
+    }
+    else if (type == "stop_cameras")
+    {
+        sendAck(type);
+        cmd = COMMAND::STOP_CAMERAS;
+    }
+    else if (type == "sequence")
+    {
+        printIncomingCommand(message);
+        if(parseSequence(doc["data"]["steps"].as<JsonArray>()))
         {
+            cmd = COMMAND::SEQUENCE;
             sendAck(type);
-            cmd = COMMAND::STOP_CAMERAS;
-        }
-        else if(type == "")
-        {
-            printIncomingCommand(message);
-            PLOGI.printf("ERROR: Type field empty or not specified ");
-            sendErr("no_type");
         }
         else
         {
-            printIncomingCommand(message);
-            PLOGI.printf("ERROR: Unkown type field ");
-            sendErr("unkown_type");
+            sendErr("bad_sequence");
         }
     }
+    else if (type == "abort_sequence")
+    {
+        printIncomingCommand(message);
+        sendAck(type);
+        cmd = COMMAND::ABORT_SEQUENCE;
+    }
+    else if (type == "speed_override")
+    {
+        printIncomingCommand(message);
+        speedOverrideData_ = doc["data"]["speed"];
+        sendAck(type);
+        cmd = COMMAND::SET_SPEED_OVERRIDE;
+    }
+    else if(type == "")
+    {
+        printIncomingCommand(message);
+        PLOGI.printf("ERROR: Type field empty or not specified ");
+        sendErr("no_type");
+    }
+    else
+    {
+        printIncomingCommand(message);
+        PLOGI.printf("ERROR: Unkown type field ");
+        sendErr("unkown_type");
+    }
     return cmd;    
 }
 
@@ -209,12 +290,72 @@ RobotServer::VelocityData RobotServer::getVelocityData()
     return velocityData_;
 }
 
+std::vector<RobotServer::SequenceStep> RobotServer::getSequenceData()
+{
+    return sequenceData_;
+}
+
+float RobotServer::getSpeedOverrideData()
+{
+    return speedOverrideData_;
+}
+
+bool RobotServer::parseSequence(JsonArray steps)
+{
+    std::vector<SequenceStep> sequence;
+    for(JsonVariant step_json : steps)
+    {
+        std::string type = step_json["type"] | "";
+        SequenceStep step = {};
+        step.cmd = sequenceCommandForType(type);
+        if(step.cmd == COMMAND::NONE)
+        {
+            PLOGW.printf("Unknown sequence step type: %s", type.c_str());
+            return false;
+        }
+        step.move_data.x = step_json["data"]["x"] | 0.0f;
+        step.move_data.y = step_json["data"]["y"] | 0.0f;
+        step.move_data.a = step_json["data"]["a"] | 0.0f;
+        step.velocity_data.vx = step_json["data"]["vx"] | 0.0f;
+        step.velocity_data.vy = step_json["data"]["vy"] | 0.0f;
+        step.velocity_data.va = step_json["data"]["va"] | 0.0f;
+        step.velocity_data.t = step_json["data"]["t"] | 0.0f;
+        step.timeout_s = step_json["timeout"] | 0.0f;
+        step.with_previous = step_json["with_previous"] | false;
+
+        std::string condition = step_json["condition"] | "none";
+        if(condition == "none") step.condition = SEQUENCE_CONDITION::NONE;
+        else if(condition == "localized") step.condition = SEQUENCE_CONDITION::LOCALIZED;
+        else if(condition == "vision") step.condition = SEQUENCE_CONDITION::VISION_OK;
+        else
+        {
+            PLOGW.printf("Unknown sequence step condition: %s", condition.c_str());
+            return false;
+        }
+        sequence.push_back(step);
+    }
+
+    if(sequence.empty())
+    {
+        PLOGW.printf("Sequence has no steps");
+        return false;
+    }
+    sequenceData_ = sequence;
+    return true;
+}
+
 void RobotServer::sendStatus()
 {
     std::string msg = statusUpdater_.getStatusJsonString();
     sendMsg(msg, false);
 }
 
+void RobotServer::sendPerf()
+{
+    std::string msg = LoopProfiler::getInstance()->getJsonString();
+    sendMsg(msg, false);
+}
+
 COMMAND RobotServer::oneLoop()
 {
     COMMAND cmd = COMMAND::NONE;
@@ -231,8 +372,8 @@ COMMAND RobotServer::oneLoop()
 std::string RobotServer::cleanString(std::string message)
 {
   int idx_start = message.find("{");
-  int idx_end = message.find("}") + 1;
-  int len = idx_end - idx_start + 1;
+  int idx_end = message.rfind("}") + 1;
+  int len = idx_end - idx_start;
   if(idx_start == -1 || idx_end == 0)
   {
       PLOGW.printf("Could not find brackets in message");
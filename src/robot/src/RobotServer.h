@@ -8,7 +8,9 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
+#include <ArduinoJson/ArduinoJson.h>
 #include "constants.h"
 #include "sockets/SocketMultiThreadWrapperBase.h"
 #include "StatusUpdater.h"
@@ -34,6 +36,17 @@ class RobotServer
       float va;
       float t;
     };
+
+    // One command of a sequence the robot runs on its own
+    struct SequenceStep
+    {
+      COMMAND cmd;
+      PositionData move_data;
+      VelocityData velocity_data;
+      SEQUENCE_CONDITION condition;
+      float timeout_s;       // Time allowed to wait for the step and run it, 0 for no limit
+      bool with_previous;    // Start as soon as the step's own lane is free instead of waiting for all lanes
+    };
     
     RobotServer(StatusUpdater& statusUpdater);
 
@@ -45,10 +58,19 @@ class RobotServer
 
     RobotServer::VelocityData getVelocityData();
 
+    std::vector<RobotServer::SequenceStep> getSequenceData();
+
+    float getSpeedOverrideData();
+
+    // Parses a single message and returns the command. Public for benchmarks, otherwise only called from oneLoop
+    COMMAND getCommand(std::string message);
+
   private:
     PositionData moveData_;
     PositionData positionData_;
     VelocityData velocityData_;
+    std::vector<SequenceStep> sequenceData_;
+    float speedOverrideData_;
     StatusUpdater& statusUpdater_;
 
     bool recvInProgress_;
@@ -56,7 +78,6 @@ class RobotServer
     std::string buffer_;
     SocketMultiThreadWrapperBase* socket_;
 
-    COMMAND getCommand(std::string message);
     void sendMsg(std::string msg, bool print_debug=true);
     void sendAck(std::string data);
     void sendErr(std::string data);
@@ -64,6 +85,9 @@ class RobotServer
     std::string cleanString(std::string message);
     void printIncomingCommand(std::string message);
     void sendStatus();
+    void sendPerf();
+    COMMAND parseCommand(JsonDocument& doc, const std::string& message);
+    bool parseSequence(JsonArray steps);
 
 };
 
@@ -1,21 +1,23 @@
 #include "SmoothTrajectoryGenerator.h"
+#include <algorithm>
+#include <limits>
 #include <plog/Log.h>
 #include "constants.h"
 #include "utils.h"
 
 constexpr float d6 = 1/6.0;
+constexpr int num_wheel_demand_samples = 100;
+constexpr float min_initial_state = 1e-4;
+constexpr int num_cruise_vel_bisections = 30;
 
 SmoothTrajectoryGenerator::SmoothTrajectoryGenerator()
-  : currentTrajectory_()
+  : currentTrajectory_(),
+    solver_params_(getSolverParameters())
 {
     currentTrajectory_.complete = false;
-    solver_params_.num_loops = cfg.lookup("trajectory_generation.solver_max_loops"); 
-    solver_params_.beta_decay = cfg.lookup("trajectory_generation.solver_beta_decay");
-    solver_params_.alpha_decay = cfg.lookup("trajectory_generation.solver_alpha_decay");
-    solver_params_.exponent_decay = cfg.lookup("trajectory_generation.solver_exponent_decay");
 }
 
-PVTPoint SmoothTrajectoryGenerator::lookup(float time)
+PVTPoint SmoothTrajectoryGenerator::lookup(float time) const
 {
     std::vector<float> trans_values = lookup_1D(time, currentTrajectory_.trans_params);
     std::vector<float> rot_values = lookup_1D(time, currentTrajectory_.rot_params);    
@@ -23,9 +25,11 @@ PVTPoint SmoothTrajectoryGenerator::lookup(float time)
     // Map translational trajectory into XY space with direction vector
     Eigen::Vector2f trans_pos_delta = trans_values[0] * currentTrajectory_.trans_direction;
     Eigen::Vector2f trans_vel = trans_values[1] * currentTrajectory_.trans_direction;
+    Eigen::Vector2f trans_acc = trans_values[2] * currentTrajectory_.trans_direction;
     // Map rotational trajectory into angular space with direction
     float rot_pos_delta = rot_values[0] * currentTrajectory_.rot_direction;
     float rot_vel = rot_values[1] * currentTrajectory_.rot_direction;
+    float rot_acc = rot_values[2] * currentTrajectory_.rot_direction;
 
     // Build and return pvtpoint
     PVTPoint pvt;
@@ -33,21 +37,31 @@ PVTPoint SmoothTrajectoryGenerator::lookup(float time)
                      currentTrajectory_.initialPoint.y + trans_pos_delta(1),
                      wrap_angle(currentTrajectory_.initialPoint.a + rot_pos_delta) };
     pvt.velocity = {trans_vel(0), trans_vel(1), rot_vel};
+    pvt.acceleration = {trans_acc(0), trans_acc(1), rot_acc};
     pvt.time = time;
     return pvt;
 }
 
+Point SmoothTrajectoryGenerator::getEndPoint() const
+{
+    Eigen::Vector2f trans_delta = currentTrajectory_.trans_params.switch_points[7].p * currentTrajectory_.trans_direction;
+    float rot_delta = currentTrajectory_.rot_params.switch_points[7].p * currentTrajectory_.rot_direction;
+    return {currentTrajectory_.initialPoint.x + trans_delta(0),
+            currentTrajectory_.initialPoint.y + trans_delta(1),
+            wrap_angle(currentTrajectory_.initialPoint.a + rot_delta)};
+}
+
 std::vector<float> lookup_1D(float time, const SCurveParameters& params)
 {
     // Handle time before start of trajectory
     if(time <= params.switch_points[0].t)
     {
-        return {params.switch_points[0].p, params.switch_points[0].v};
+        return {params.switch_points[0].p, params.switch_points[0].v, params.switch_points[0].a};
     }
     // Handle time after the end of the trajectory
     else if (time > params.switch_points[7].t)
     {
-        return {params.switch_points[7].p, params.switch_points[7].v};
+        return {params.switch_points[7].p, params.switch_points[7].v, params.switch_points[7].a};
     }
     // Handle times within the trajectory
     else
@@ -55,22 +69,28 @@ std::vector<float> lookup_1D(float time, const SCurveParameters& params)
         // Look for correct region
         for (int i = 1; i <= 7; i++)
         {
-            // Once region is found, compute position and velocity from previous switch point
+            // Once region is found, compute position, velocity and acceleration from previous switch point
             if(params.switch_points[i-1].t < time && time <= params.switch_points[i].t)
             {
                 float dt = time - params.switch_points[i-1].t;
                 std::vector<float> values = computeKinematicsBasedOnRegion(params, i, dt);
-                return {values[2], values[1]};
+                return {values[2], values[1], values[0]};
             }
         }
     }
 
     PLOGE << "Should not get to this point in lookup";
-    return {0,0};
+    return {0,0,0};
 }
 
 
 bool SmoothTrajectoryGenerator::generatePointToPointTrajectory(Point initialPoint, Point targetPoint, LIMITS_MODE limits_mode)
+{
+    return generatePointToPointTrajectory(initialPoint, {0,0,0}, {0,0,0}, targetPoint, limits_mode);
+}
+
+bool SmoothTrajectoryGenerator::generatePointToPointTrajectory(Point initialPoint, Velocity initialVelocity, Velocity initialAcceleration, 
+                                                               Point targetPoint, LIMITS_MODE limits_mode)
 {    
     // Print to logs
     PLOGI.printf("Generating trajectory");
@@ -79,8 +99,15 @@ bool SmoothTrajectoryGenerator::generatePointToPointTrajectory(Point initialPoin
     PLOGD_(MOTION_LOG_ID).printf("\nGenerating trajectory");
     PLOGD_(MOTION_LOG_ID).printf("Starting point: %s", initialPoint.toString().c_str());
     PLOGD_(MOTION_LOG_ID).printf("Target point: %s", targetPoint.toString().c_str());
+    if(!initialVelocity.nearZero() || !initialAcceleration.nearZero())
+    {
+        PLOGI.printf("Starting velocity: %s, acceleration: %s", initialVelocity.toString().c_str(), initialAcceleration.toString().c_str());
+        PLOGD_(MOTION_LOG_ID).printf("Starting velocity: %s, acceleration: %s", initialVelocity.toString().c_str(), initialAcceleration.toString().c_str());
+    }
 
     MotionPlanningProblem mpp = buildMotionPlanningProblem(initialPoint, targetPoint, limits_mode, solver_params_);
+    mpp.initialVelocity = {initialVelocity.vx, initialVelocity.vy, initialVelocity.va};
+    mpp.initialAcceleration = {initialAcceleration.vx, initialAcceleration.vy, initialAcceleration.va};
     currentTrajectory_ = generateTrajectory(mpp);
 
     PLOGI << currentTrajectory_.toString();
@@ -89,33 +116,12 @@ bool SmoothTrajectoryGenerator::generatePointToPointTrajectory(Point initialPoin
     return currentTrajectory_.complete;
 }
 
-// TODO Implement a more accurate version of this if needed
-// Note that this implimentation is a hack and isn't guaranteed to give an accurate constant velocity - so use with caution.
-bool SmoothTrajectoryGenerator::generateConstVelTrajectory(Point initialPoint, Velocity velocity, float moveTime, LIMITS_MODE limits_mode)
+bool SmoothTrajectoryGenerator::generateStopTrajectory(Point initialPoint, Velocity initialVelocity, Velocity initialAcceleration, LIMITS_MODE limits_mode)
 {
-    // Print to logs
-    PLOGI.printf("Generating constVel (sort of) trajectory");
-    PLOGI.printf("Starting point: %s", initialPoint.toString().c_str());
-    PLOGI.printf("Target velocity: %s", velocity.toString().c_str());
-    PLOGI.printf("Move time: %d", moveTime);
-    PLOGD_(MOTION_LOG_ID).printf("Generating constVel (sort of) trajectory");
-    PLOGD_(MOTION_LOG_ID).printf("Starting point: %s", initialPoint.toString().c_str());
-    PLOGD_(MOTION_LOG_ID).printf("Target velocity: %s", velocity.toString().c_str());
-    PLOGD_(MOTION_LOG_ID).printf("Move time: %d", moveTime);
-
-    // This will undershoot the target velocity because we aren't consider accel/jerk here so the 
-    // solver will not quite reach this velocity - especially if the move time specified is small.
-    Point targetPoint;
-    targetPoint.x = initialPoint.x + velocity.vx * moveTime;
-    targetPoint.y = initialPoint.y + velocity.vy * moveTime;
-    targetPoint.a = initialPoint.a + velocity.va * moveTime;
-
-    MotionPlanningProblem mpp = buildMotionPlanningProblem(initialPoint, targetPoint, limits_mode, solver_params_);
-    currentTrajectory_ = generateTrajectory(mpp);
-
-    PLOGI << currentTrajectory_.toString();
-    PLOGD_(MOTION_LOG_ID) << currentTrajectory_.toString();
-
+    MotionPlanningProblem mpp = buildMotionPlanningProblem(initialPoint, initialPoint, limits_mode, solver_params_);
+    mpp.initialVelocity = {initialVelocity.vx, initialVelocity.vy, initialVelocity.va};
+    mpp.initialAcceleration = {initialAcceleration.vx, initialAcceleration.vy, initialAcceleration.va};
+    currentTrajectory_ = ::generateStopTrajectory(mpp);
     return currentTrajectory_.complete;
 }
 
@@ -123,48 +129,70 @@ MotionPlanningProblem buildMotionPlanningProblem(Point initialPoint, Point targe
 {
     MotionPlanningProblem mpp;
     mpp.initialPoint = {initialPoint.x, initialPoint.y, initialPoint.a};
+    mpp.initialVelocity = Eigen::Vector3f::Zero();
+    mpp.initialAcceleration = Eigen::Vector3f::Zero();
     mpp.targetPoint = {targetPoint.x, targetPoint.y, targetPoint.a};
 
     DynamicLimits translationalLimits;
     DynamicLimits rotationalLimits;
+    getDynamicLimits(limits_mode, &translationalLimits, &rotationalLimits);
+
+    // This scaling makes sure to give some headroom for the controller to go a bit faster than the planned limits 
+    // without actually violating any hard constraints
+    mpp.limitMaxFraction = cfg.lookup("motion.limit_max_fraction");
+    mpp.translationalLimits = translationalLimits * mpp.limitMaxFraction;
+    mpp.rotationalLimits = rotationalLimits * mpp.limitMaxFraction;
+    // Translation and rotation share the same wheels, so the combined motion gets the same headroom against what the wheels can do
+    mpp.wheelLimits = { cfg.lookup("motion.wheel_limits.dist_from_center"),
+                        static_cast<float>(cfg.lookup("motion.wheel_limits.max_vel")) * mpp.limitMaxFraction,
+                        static_cast<float>(cfg.lookup("motion.wheel_limits.max_acc")) * mpp.limitMaxFraction};
+    mpp.solver_params = solver;
+
+    return std::move(mpp);     
+}
+
+SolverParameters getSolverParameters()
+{
+    SolverParameters solver;
+    solver.num_loops = cfg.lookup("trajectory_generation.solver_max_loops");
+    solver.beta_decay = cfg.lookup("trajectory_generation.solver_beta_decay");
+    solver.alpha_decay = cfg.lookup("trajectory_generation.solver_alpha_decay");
+    solver.exponent_decay = cfg.lookup("trajectory_generation.solver_exponent_decay");
+    return solver;
+}
+
+void getDynamicLimits(LIMITS_MODE limits_mode, DynamicLimits* translationalLimits, DynamicLimits* rotationalLimits)
+{
     if(limits_mode == LIMITS_MODE::VISION)
     {
         PLOGI << "Setting trajectory limits mode to LIMITS_MODE::VISION";
-        translationalLimits = { cfg.lookup("motion.translation.max_vel.vision"), 
-                                cfg.lookup("motion.translation.max_acc.vision"), 
-                                cfg.lookup("motion.translation.max_jerk.vision")};
-        rotationalLimits = {    cfg.lookup("motion.rotation.max_vel.vision"), 
-                                cfg.lookup("motion.rotation.max_acc.vision"), 
-                                cfg.lookup("motion.rotation.max_jerk.vision")};
+        *translationalLimits = { cfg.lookup("motion.translation.max_vel.vision"), 
+                                 cfg.lookup("motion.translation.max_acc.vision"), 
+                                 cfg.lookup("motion.translation.max_jerk.vision")};
+        *rotationalLimits = {    cfg.lookup("motion.rotation.max_vel.vision"), 
+                                 cfg.lookup("motion.rotation.max_acc.vision"), 
+                                 cfg.lookup("motion.rotation.max_jerk.vision")};
     }
     else if(limits_mode == LIMITS_MODE::FINE || limits_mode == LIMITS_MODE::SLOW)
     {
         PLOGI << "Setting trajectory limits mode to LIMITS_MODE::FINE/SLOW";
-        translationalLimits = { cfg.lookup("motion.translation.max_vel.fine"), 
-                                cfg.lookup("motion.translation.max_acc.fine"), 
-                                cfg.lookup("motion.translation.max_jerk.fine")};
-        rotationalLimits = {    cfg.lookup("motion.rotation.max_vel.fine"), 
-                                cfg.lookup("motion.rotation.max_acc.fine"), 
-                                cfg.lookup("motion.rotation.max_jerk.fine")};
+        *translationalLimits = { cfg.lookup("motion.translation.max_vel.fine"), 
+                                 cfg.lookup("motion.translation.max_acc.fine"), 
+                                 cfg.lookup("motion.translation.max_jerk.fine")};
+        *rotationalLimits = {    cfg.lookup("motion.rotation.max_vel.fine"), 
+                                 cfg.lookup("motion.rotation.max_acc.fine"), 
+                                 cfg.lookup("motion.rotation.max_jerk.fine")};
     }
     else
     {
         PLOGI << "Setting trajectory limits mode to LIMITS_MODE::COARSE";
-        translationalLimits = { cfg.lookup("motion.translation.max_vel.coarse"), 
-                                cfg.lookup("motion.translation.max_acc.coarse"), 
-                                cfg.lookup("motion.translation.max_jerk.coarse")};
-        rotationalLimits = {    cfg.lookup("motion.rotation.max_vel.coarse"), 
-                                cfg.lookup("motion.rotation.max_acc.coarse"), 
-                                cfg.lookup("motion.rotation.max_jerk.coarse")};
+        *translationalLimits = { cfg.lookup("motion.translation.max_vel.coarse"), 
+                                 cfg.lookup("motion.translation.max_acc.coarse"), 
+                                 cfg.lookup("motion.translation.max_jerk.coarse")};
+        *rotationalLimits = {    cfg.lookup("motion.rotation.max_vel.coarse"), 
+                                 cfg.lookup("motion.rotation.max_acc.coarse"), 
+                                 cfg.lookup("motion.rotation.max_jerk.coarse")};
     }
-
-    // This scaling makes sure to give some headroom for the controller to go a bit faster than the planned limits 
-    // without actually violating any hard constraints
-    mpp.translationalLimits = translationalLimits * cfg.lookup("motion.limit_max_fraction");
-    mpp.rotationalLimits = rotationalLimits * cfg.lookup("motion.limit_max_fraction");
-    mpp.solver_params = solver;
-
-    return std::move(mpp);     
 }
 
 bool sCurveWithinLimits(const SCurveParameters& params, const DynamicLimits& limits)
@@ -172,6 +200,17 @@ bool sCurveWithinLimits(const SCurveParameters& params, const DynamicLimits& lim
     return params.v_lim <= limits.max_vel && params.a_lim <= limits.max_acc && params.j_lim <= limits.max_jerk;
 }
 
+// Uses the rest to rest solver unless the axis is already moving along the direction of travel
+bool generateAxisSCurve(float dist, float v0, float a0, DynamicLimits limits, const SolverParameters& solver, SCurveParameters* params)
+{
+    float min_dist = cfg.lookup("trajectory_generation.min_dist_limit");
+    if(fabs(dist) < min_dist || (fabs(v0) < min_initial_state && fabs(a0) < min_initial_state))
+    {
+        return generateSCurve(dist, limits, solver, params);
+    }
+    return generateSCurveFromState(dist, v0, a0, limits, params);
+}
+
 Trajectory generateTrajectory(MotionPlanningProblem problem)
 {   
     // Figure out delta that the trajectory needs to cover
@@ -185,10 +224,17 @@ Trajectory generateTrajectory(MotionPlanningProblem problem)
     traj.trans_direction = deltaPosition.head(2).normalized();
     traj.rot_direction = sgn(deltaPosition(2));
     
+    // A trajectory replanned while moving starts with the velocity and acceleration it already has along each 
+    // axis. Anything sideways to the new direction of travel is left for the controller to take out.
+    float trans_v0 = problem.initialVelocity.head(2).dot(traj.trans_direction);
+    float trans_a0 = problem.initialAcceleration.head(2).dot(traj.trans_direction);
+    float rot_v0 = problem.initialVelocity(2) * traj.rot_direction;
+    float rot_a0 = problem.initialAcceleration(2) * traj.rot_direction;
+
     // Solve translational component
     float dist = deltaPosition.head(2).norm();
     SCurveParameters trans_params;
-    bool ok = generateSCurve(dist, problem.translationalLimits, problem.solver_params, &trans_params);
+    bool ok = generateAxisSCurve(dist, trans_v0, trans_a0, problem.translationalLimits, problem.solver_params, &trans_params);
     if(!ok)
     {
         PLOGW << "Failed to generate translational trajectory";
@@ -198,7 +244,7 @@ Trajectory generateTrajectory(MotionPlanningProblem problem)
     // Solve rotational component
     SCurveParameters rot_params;
     dist = fabs(deltaPosition(2));
-    ok = generateSCurve(dist, problem.rotationalLimits, problem.solver_params, &rot_params);
+    ok = generateAxisSCurve(dist, rot_v0, rot_a0, problem.rotationalLimits, problem.solver_params, &rot_params);
     if(!ok)
     {
         PLOGW << "Failed to generate rotational trajectory";
@@ -206,11 +252,27 @@ Trajectory generateTrajectory(MotionPlanningProblem problem)
     }
 
     // Syncronize trajectories so they both start and end at the same time
-    ok = synchronizeParameters(&trans_params, &rot_params);
-    if (!ok)
+    SyncResult sync = synchronizeParameters(&trans_params, &rot_params);
+    if(sync.lengthened)
     {
-        PLOGW << "Failed to synchronize trajectory parameters";
-        return traj; 
+        PLOGI.printf("Stretched %s profile by %.2fx to end with %s", sync.rotation_limited ? "translation" : "rotation", 
+            sync.time_scale, sync.rotation_limited ? "rotation" : "translation");
+    }
+
+    // Each axis is within its own limits, but both together can still ask more of the wheels than they can give.
+    // A profile that starts moving can't be stretched without changing its starting velocity, so a replanned 
+    // trajectory relies on the one it replaces having already been held to the wheel limits.
+    if(trans_params.nonzero_start || rot_params.nonzero_start)
+    {
+        PLOGI << "Trajectory starts moving, skipping wheel limits";
+    }
+    else
+    {
+        float wheel_scale = applyWheelLimits(&trans_params, &rot_params, problem.wheelLimits);
+        if(wheel_scale > 1)
+        {
+            PLOGI.printf("Slowed combined motion by %.2fx to stay within wheel limits", wheel_scale);
+        }
     }
 
     if(!sCurveWithinLimits(trans_params, problem.translationalLimits))
@@ -228,6 +290,43 @@ Trajectory generateTrajectory(MotionPlanningProblem problem)
     traj.rot_params = rot_params;
     traj.complete = true;
 
+    // The problem limits only go up to limit_max_fraction of the configured ones. Playing the trajectory back faster 
+    // can use the rest, but never more than the configured limits.
+    float fraction = problem.limitMaxFraction;
+    WheelLimits full_wheel_limits = {problem.wheelLimits.dist_from_center, problem.wheelLimits.max_vel / fraction, 
+                                     problem.wheelLimits.max_acc / fraction};
+    traj.max_time_scale = std::min({maxTimeScale(trans_params, problem.translationalLimits * (1 / fraction)),
+                                    maxTimeScale(rot_params, problem.rotationalLimits * (1 / fraction)),
+                                    maxTimeScale(trans_params, rot_params, full_wheel_limits)});
+    traj.max_trans_acc = problem.translationalLimits.max_acc / fraction;
+    traj.max_rot_acc = problem.rotationalLimits.max_acc / fraction;
+    traj.max_wheel_acc = full_wheel_limits.max_acc;
+    traj.wheel_dist_from_center = full_wheel_limits.dist_from_center;
+
+    return traj;
+}
+
+Trajectory generateStopTrajectory(MotionPlanningProblem problem)
+{
+    Trajectory traj;
+    traj.initialPoint = {problem.initialPoint(0), problem.initialPoint(1), problem.initialPoint(2)};
+
+    // Translation stops along the direction it is moving in, or accelerating in if it isn't moving yet. Anything 
+    // sideways to that is left for the controller to take out.
+    Eigen::Vector2f trans_vel = problem.initialVelocity.head(2);
+    Eigen::Vector2f trans_acc = problem.initialAcceleration.head(2);
+    if(trans_vel.norm() > min_initial_state) traj.trans_direction = trans_vel.normalized();
+    else if(trans_acc.norm() > min_initial_state) traj.trans_direction = trans_acc.normalized();
+    else traj.trans_direction = {1, 0};
+    float rot_vel = problem.initialVelocity(2);
+    float rot_acc = problem.initialAcceleration(2);
+    traj.rot_direction = fabs(rot_vel) > min_initial_state ? sgn(rot_vel) : sgn(rot_acc);
+
+    generateStopSCurve(trans_vel.dot(traj.trans_direction), trans_acc.dot(traj.trans_direction), 
+        problem.translationalLimits, &traj.trans_params);
+    generateStopSCurve(rot_vel * traj.rot_direction, rot_acc * traj.rot_direction, problem.rotationalLimits, &traj.rot_params);
+    traj.complete = true;
+
     return traj;
 }
 
@@ -304,8 +403,109 @@ bool generateSCurve(float dist, DynamicLimits limits, const SolverParameters& so
     return solution_found;
 }
 
+// Fills switch point i by holding constant jerk from switch point i-1 until acceleration reaches a_end
+void integrateSwitchPoint(SCurveParameters* params, int i, float dt, float a_end)
+{
+    const SwitchPoint& prev = params->switch_points[i-1];
+    float j = dt > 0 ? (a_end - prev.a) / dt : 0;
+    SwitchPoint& sp = params->switch_points[i];
+    sp.t = prev.t + dt;
+    sp.a = dt > 0 ? a_end : prev.a;
+    sp.v = prev.v + prev.a * dt + 0.5 * j * std::pow(dt, 2);
+    sp.p = prev.p + prev.v * dt + 0.5 * prev.a * std::pow(dt, 2) + d6 * j * std::pow(dt, 3);
+}
+
+// Fills the switch points of a profile that goes from (v0, a0) to cruising at vc, cruises for dt_v and then stops
+void populateSwitchPointsFromState(SCurveParameters* params, float v0, float a0, float vc, float a_max, float dt_v)
+{
+    float j = params->j_lim;
+    params->switch_points[0] = {0, 0, v0, a0};
+
+    // Regions 1-3 ramp to the cruise velocity. Flipping the direction of the velocity change to be positive 
+    // lets the same math cover speeding up and slowing down.
+    float s = vc >= v0 + a0 * fabs(a0) / (2 * j) ? 1 : -1;
+    float dv = s * (vc - v0);
+    float b0 = s * a0;
+    float a_peak = std::min(a_max, sqrtf(std::max(0.0f, (2 * j * dv + b0 * b0) / 2)));
+    float dt1 = fabs(a_peak - b0) / j;
+    float dv1 = (a_peak * a_peak - b0 * b0) / (2 * j) * (a_peak >= b0 ? 1 : -1);
+    float dt3 = a_peak / j;
+    float dv3 = a_peak * a_peak / (2 * j);
+    float dt2 = a_peak > 0 ? std::max(0.0f, (dv - dv1 - dv3) / a_peak) : 0;
+    integrateSwitchPoint(params, 1, dt1, s * a_peak);
+    integrateSwitchPoint(params, 2, dt2, s * a_peak);
+    integrateSwitchPoint(params, 3, dt3, 0);
+
+    // Region 4 cruises and regions 5-7 are a normal stop from the cruise velocity
+    float a_stop = std::min(a_max, sqrtf(vc * j));
+    float dt_j = a_stop / j;
+    float dt_a = a_stop > 0 ? std::max(0.0f, (vc - a_stop * a_stop / j) / a_stop) : 0;
+    integrateSwitchPoint(params, 4, dt_v, 0);
+    integrateSwitchPoint(params, 5, dt_j, -a_stop);
+    integrateSwitchPoint(params, 6, dt_a, -a_stop);
+    integrateSwitchPoint(params, 7, dt_j, 0);
+    params->switch_points[7].v = 0;
+
+    params->v_lim = vc;
+    params->a_lim = a_stop;
+}
+
+bool generateSCurveFromState(float dist, float v0, float a0, DynamicLimits limits, SCurveParameters* params)
+{
+    params->j_lim = limits.max_jerk;
+    params->nonzero_start = true;
+
+    // Distance covered getting to cruise velocity vc and then straight back down to rest
+    auto dist_without_cruise = [&](float vc)
+    {
+        populateSwitchPointsFromState(params, v0, a0, vc, limits.max_acc, 0);
+        return params->switch_points[7].p;
+    };
+
+    // Use the fastest cruise velocity that still leaves room to stop. The distance grows with the 
+    // cruise velocity, so if the velocity limit doesn't fit it can be bisected for.
+    float v_lim = limits.max_vel;
+    if(dist_without_cruise(v_lim) > dist)
+    {
+        float v_low = 0;
+        float v_high = v_lim;
+        for (int i = 0; i < num_cruise_vel_bisections; i++)
+        {
+            float v_mid = 0.5 * (v_low + v_high);
+            if(dist_without_cruise(v_mid) > dist)
+            {
+                v_high = v_mid;
+            }
+            else
+            {
+                v_low = v_mid;
+            }
+        }
+        v_lim = v_low;
+    }
+    if(v_lim <= 0)
+    {
+        PLOGW.printf("Can't stop within %.3f starting from v: %.3f, a: %.3f", dist, v0, a0);
+        return false;
+    }
+
+    float dt_v = std::max(0.0f, (dist - dist_without_cruise(v_lim)) / v_lim);
+    populateSwitchPointsFromState(params, v0, a0, v_lim, limits.max_acc, dt_v);
+    PLOGI << "Trajectory solution found from moving start";
+    return true;
+}
+
+void generateStopSCurve(float v0, float a0, DynamicLimits limits, SCurveParameters* params)
+{
+    // A stop is just the ramp to a cruise velocity of 0, with nothing left to cruise or stop from
+    params->j_lim = limits.max_jerk;
+    params->nonzero_start = true;
+    populateSwitchPointsFromState(params, v0, a0, 0, limits.max_acc, 0);
+}
+
 void populateSwitchTimeParameters(SCurveParameters* params, float dt_j, float dt_a, float dt_v)
 {
+
     // Fill first point with all zeros
     params->switch_points[0].t = 0;
     params->switch_points[0].p = 0;
@@ -340,74 +540,141 @@ void populateSwitchTimeParameters(SCurveParameters* params, float dt_j, float dt
     }
 }
 
-bool synchronizeParameters(SCurveParameters* params1, SCurveParameters* params2)
+SyncResult synchronizeParameters(SCurveParameters* trans_params, SCurveParameters* rot_params)
 {
     // Figure out which parameter set is the faster one
-    float end_time_1 = params1->switch_points[7].t;
-    float end_time_2 = params2->switch_points[7].t;
+    float trans_end_time = trans_params->switch_points[7].t;
+    float rot_end_time = rot_params->switch_points[7].t;
 
-    // Slow down which ever one is faster to syncronize them
-    bool ok = false;
-    if(end_time_1 > end_time_2)
+    // Stretch which ever one is faster so they end together. The slower one keeps its minimum time profile.
+    SyncResult result;
+    result.rotation_limited = rot_end_time > trans_end_time;
+    if(result.rotation_limited)
     {
-        ok = slowDownParamsToMatchTime(params2, end_time_1);
+        result.time_scale = scaleParamsToMatchTime(trans_params, rot_end_time);
     }
     else 
     {
-        ok = slowDownParamsToMatchTime(params1, end_time_2);
+        result.time_scale = scaleParamsToMatchTime(rot_params, trans_end_time);
     }
+    result.lengthened = result.time_scale > 1;
 
-    return ok;
+    return result;
 }
 
-bool slowDownParamsToMatchTime(SCurveParameters* params, float time_to_match)
+float scaleParamsToMatchTime(SCurveParameters* params, float time_to_match)
 {
-    // Compute time delta needed to adjust by 
+    // A profile that doesn't move has nothing to stretch, it just holds position
+    // and one that starts moving would have its starting velocity changed
     float end_time = params->switch_points[7].t;
-    float dt = time_to_match - end_time;
+    if(end_time <= 0 || time_to_match <= end_time || params->nonzero_start)
+    {
+        return 1;
+    }
 
-    // Do a simple adjustment by adding an equal amount of time to each region
-    float dt_per_region = dt / 7.0;
+    // Playing the same profile k times slower covers the same distance with every region k times longer,
+    // and scales velocity by 1/k, acceleration by 1/k^2 and jerk by 1/k^3. Since k > 1 the new limits
+    // are always lower than the ones the profile was solved with, so the result is always feasible.
+    float k = time_to_match / end_time;
+    params->v_lim /= k;
+    params->a_lim /= k * k;
+    params->j_lim /= k * k * k;
     for (int i = 1; i < 8; i++)
     {
-        params->switch_points[i].t += + i*dt_per_region;
+        params->switch_points[i].t *= k;
+        params->switch_points[i].v /= k;
+        params->switch_points[i].a /= k * k;
     }
+    params->switch_points[7].t = time_to_match;
 
-    // Then recompute limits based on updated times
-    return solveInverse(params);
+    return k;
 }
 
-bool solveInverse(SCurveParameters* params)
+WheelDemand computeWheelDemand(const SCurveParameters& trans_params, const SCurveParameters& rot_params, float dist_from_center)
 {
-    // Gather parameters needed
-    const float dt_j = params->switch_points[1].t - params->switch_points[0].t;
-    const float dt_a = params->switch_points[2].t - params->switch_points[1].t;
-    const float dt_v = params->switch_points[4].t - params->switch_points[3].t;
-    const float deltaPosition = params->switch_points[7].p;
+    // Check every switch point plus an even spread in between, since the peak of the combined motion
+    // can fall inside a region when translation and rotation don't change regions together
+    float end_time = std::max(trans_params.switch_points[7].t, rot_params.switch_points[7].t);
+    std::vector<float> times;
+    times.reserve(16 + num_wheel_demand_samples + 1);
+    for (int i = 0; i < 8; i++)
+    {
+        times.push_back(trans_params.switch_points[i].t);
+        times.push_back(rot_params.switch_points[i].t);
+    }
+    for (int i = 0; i <= num_wheel_demand_samples; i++)
+    {
+        times.push_back(end_time * i / num_wheel_demand_samples);
+    }
 
-    // Build linear system
-    Eigen::Matrix3f A;
-    Eigen::Vector3f b;
-    A << dt_j,                                     -1,                                     0    ,
-         std::pow(dt_j, 2),                        dt_a                    ,              -1    ,
-         std::pow(dt_j, 2) * (dt_a - dt_j),  std::pow(dt_j, 2) + std::pow(dt_a, 2),  dt_v + 2* dt_j;
-    b << 0, 0, deltaPosition;
+    // The drive direction of each wheel is a unit vector that turns with the robot, so for any heading the rim
+    // speed is at most |v_t| + d*|v_r|. Rotating the wheels under the translation adds |v_t|*|v_r| to the acceleration.
+    WheelDemand demand = {0, 0};
+    for (float t : times)
+    {
+        std::vector<float> trans = lookup_1D(t, trans_params);
+        std::vector<float> rot = lookup_1D(t, rot_params);
+        float vel = fabs(trans[1]) + dist_from_center * fabs(rot[1]);
+        float acc = fabs(trans[2]) + dist_from_center * fabs(rot[2]) + fabs(trans[1] * rot[1]);
+        demand.max_vel = std::max(demand.max_vel, vel);
+        demand.max_acc = std::max(demand.max_acc, acc);
+    }
+    return demand;
+}
 
-    // Solve system and check results
-    // Eigen::Vector3f lims = A.fullPivHouseholderQr().solve(b);
-    Eigen::Vector3f lims = A.bdcSvd(Eigen::ComputeFullU | Eigen::ComputeFullV).solve(b);
-    float relative_error = (A*lims - b).norm() / b.norm();
-    if (relative_error > 1e-5)
+float applyWheelLimits(SCurveParameters* trans_params, SCurveParameters* rot_params, const WheelLimits& limits)
+{
+    // Stretching both profiles by k keeps them synchronized and divides wheel speed by k and wheel
+    // acceleration by k^2 (all three acceleration terms scale the same way), so k can be solved directly
+    WheelDemand demand = computeWheelDemand(*trans_params, *rot_params, limits.dist_from_center);
+    float k = std::max({1.0f, demand.max_vel / limits.max_vel, sqrtf(demand.max_acc / limits.max_acc)});
+    if(k <= 1)
     {
-        PLOGW << "Could not find feasible inverse parameter mapping";
-        return false;
+        return 1;
     }
 
-    params->j_lim = lims(0);
-    params->a_lim = lims(1);
-    params->v_lim = lims(2);
-    populateSwitchTimeParameters(params, dt_j, dt_a, dt_v);   
-    return true;
+    float end_time = std::max(trans_params->switch_points[7].t, rot_params->switch_points[7].t);
+    scaleParamsToMatchTime(trans_params, k * end_time);
+    scaleParamsToMatchTime(rot_params, k * end_time);
+    return k;
+}
+
+float maxTimeScale(const SCurveParameters& params, const DynamicLimits& limits)
+{
+    // Playing a profile back k times faster multiplies velocity by k, acceleration by k^2 and jerk by k^3
+    float max_vel = 0;
+    float max_acc = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        max_vel = std::max(max_vel, fabsf(params.switch_points[i].v));
+        max_acc = std::max(max_acc, fabsf(params.switch_points[i].a));
+    }
+    float k = std::numeric_limits<float>::max();
+    if(max_vel > 0) k = std::min(k, limits.max_vel / max_vel);
+    if(max_acc > 0) 
+    {
+        k = std::min(k, sqrtf(limits.max_acc / max_acc));
+        k = std::min(k, cbrtf(limits.max_jerk / params.j_lim));
+    }
+    return k;
+}
+
+float maxTimeScale(const SCurveParameters& trans_params, const SCurveParameters& rot_params, const WheelLimits& limits)
+{
+    WheelDemand demand = computeWheelDemand(trans_params, rot_params, limits.dist_from_center);
+    float k = std::numeric_limits<float>::max();
+    if(demand.max_vel > 0) k = std::min(k, limits.max_vel / demand.max_vel);
+    if(demand.max_acc > 0) k = std::min(k, sqrtf(limits.max_acc / demand.max_acc));
+    return k;
+}
+
+Eigen::Vector3f localVelToWheelSpeeds(const Velocity& local_vel, float dist_from_center)
+{
+    // Same kinematics as doIK in robot_motor_driver.ino, but left as speed at the wheel rim
+    const float sq3 = sqrt(3.0);
+    return { -sq3 / 2 * local_vel.vx + 0.5f * local_vel.vy + dist_from_center * local_vel.va,
+              sq3 / 2 * local_vel.vx + 0.5f * local_vel.vy + dist_from_center * local_vel.va,
+                                          -local_vel.vy + dist_from_center * local_vel.va };
 }
 
 std::vector<float> computeKinematicsBasedOnRegion(const SCurveParameters& params, int region, float dt)
@@ -416,8 +683,21 @@ std::vector<float> computeKinematicsBasedOnRegion(const SCurveParameters& params
     bool need_a = true;
     bool need_v = true;
 
+    // A profile starting from a moving state ramps to its cruise velocity with whatever jerk gets it from one
+    // switch point to the next
+    if (params.nonzero_start && (region == 1 || region == 3))
+    {
+        float region_dt = params.switch_points[region].t - params.switch_points[region-1].t;
+        j = region_dt > 0 ? (params.switch_points[region].a - params.switch_points[region-1].a) / region_dt : 0;
+    }
+    else if (params.nonzero_start && region == 2)
+    {
+        j = 0;
+        a = params.switch_points[1].a;
+        need_a = false;
+    }
     // Positive jerk
-    if (region == 1 || region == 7) 
+    else if (region == 1 || region == 7) 
     { 
         j = params.j_lim; 
     }
@@ -475,4 +755,94 @@ std::vector<float> computeKinematicsBasedOnRegion(const SCurveParameters& params
         d6 * j * std::pow(dt, 3);
 
     return {a,v,p};
-}
\ No newline at end of file
+}
+
+TrajectoryTimeScaler::TrajectoryTimeScaler()
+: override_(1),
+  max_rate_(1),
+  time_(0),
+  rate_(1),
+  rate_change_(0),
+  max_rate_change_(cfg.lookup("motion.speed_override.max_rate_change")),
+  max_rate_change_acc_(cfg.lookup("motion.speed_override.max_rate_change_acc"))
+{
+}
+
+void TrajectoryTimeScaler::restart(float max_rate, bool at_rest)
+{
+    max_rate_ = max_rate;
+    time_ = 0;
+    if(at_rest)
+    {
+        rate_ = std::min(override_, max_rate_);
+        rate_change_ = 0;
+    }
+}
+
+float TrajectoryTimeScaler::update(float dt)
+{
+    return advance(dt, std::numeric_limits<float>::max());
+}
+
+float TrajectoryTimeScaler::update(float dt, const Trajectory& traj, const PVTPoint& target)
+{
+    // Evaluated at the fastest rate this step can end at, so the acceleration at the new rate fits as well
+    return advance(dt, maxRateChange(traj, target, rate_ + max_rate_change_ * dt));
+}
+
+float TrajectoryTimeScaler::advance(float dt, float max_rate_change)
+{
+    // Take the rate change towards the fastest one that can still come back to zero by the time the rate gets to
+    // the goal, without the rate change itself changing faster than allowed
+    float goal = std::min(override_, max_rate_);
+    float err = goal - rate_;
+    if(err != 0 || rate_change_ != 0)
+    {
+        float goal_rate_change = sgn(err) * std::min(max_rate_change_, sqrtf(2 * max_rate_change_acc_ * fabsf(err)));
+        float max_step = max_rate_change_acc_ * dt;
+        rate_change_ += std::max(-max_step, std::min(max_step, goal_rate_change - rate_change_));
+        rate_change_ = std::max(-max_rate_change, std::min(max_rate_change, rate_change_));
+        rate_ += rate_change_ * dt;
+        if((goal - rate_) * err <= 0)
+        {
+            rate_ = goal;
+            rate_change_ = 0;
+        }
+    }
+
+    time_ += rate_ * dt;
+    return time_;
+}
+
+float TrajectoryTimeScaler::maxRateChange(const Trajectory& traj, const PVTPoint& target, float rate) const
+{
+    // Playing back at a changing rate gives rate^2 * acc + rate_change * vel. max_time_scale only covers the first 
+    // part, so the rate change can only use what that leaves over. The wheel terms match computeWheelDemand.
+    float k = rate * rate;
+    float d = traj.wheel_dist_from_center;
+    float trans_vel = sqrtf(target.velocity.vx * target.velocity.vx + target.velocity.vy * target.velocity.vy);
+    float trans_acc = sqrtf(target.acceleration.vx * target.acceleration.vx + target.acceleration.vy * target.acceleration.vy);
+    float rot_vel = fabsf(target.velocity.va);
+    float rot_acc = fabsf(target.acceleration.va);
+
+    float max_rate_change = std::numeric_limits<float>::max();
+    auto limit = [&max_rate_change](float headroom, float vel)
+    {
+        if(vel > 0) max_rate_change = std::min(max_rate_change, std::max(0.0f, headroom) / vel);
+    };
+    limit(traj.max_trans_acc - k * trans_acc, trans_vel);
+    limit(traj.max_rot_acc - k * rot_acc, rot_vel);
+    limit(traj.max_wheel_acc - k * (trans_acc + d * rot_acc + trans_vel * rot_vel), trans_vel + d * rot_vel);
+    return max_rate_change;
+}
+
+Velocity TrajectoryTimeScaler::scaleVelocity(Velocity vel) const
+{
+    return {rate_ * vel.vx, rate_ * vel.vy, rate_ * vel.va};
+}
+
+Velocity TrajectoryTimeScaler::scaleAcceleration(Velocity acc, Velocity vel) const
+{
+    float k = rate_ * rate_;
+    return {k * acc.vx + rate_change_ * vel.vx, k * acc.vy + rate_change_ * vel.vy, k * acc.va + rate_change_ * vel.va};
+}
@@ -11,12 +11,14 @@ struct PVTPoint
 {
     Point position;
     Velocity velocity;
+    Velocity acceleration;
     float time;
 
     std::string toString() const
     {
-      char s[200];
-      sprintf(s, "[Position: %s, Velocity: %s, T: %.3f]", position.toString().c_str(), velocity.toString().c_str(), time);
+      char s[300];
+      sprintf(s, "[Position: %s, Velocity: %s, Acceleration: %s, T: %.3f]", position.toString().c_str(), 
+        velocity.toString().c_str(), acceleration.toString().c_str(), time);
       return static_cast<std::string>(s);
     }
 
@@ -56,6 +58,9 @@ struct SCurveParameters
     float a_lim;
     float j_lim;
     SwitchPoint switch_points[8];
+    // Set when the profile starts moving (switch_points[0] has non-zero velocity or acceleration). Regions 1-3 then
+    // take whatever jerk and acceleration get from the starting state to v_lim, and a_lim only applies to the stop.
+    bool nonzero_start = false;
 
     std::string toString() const
     {
@@ -75,6 +80,13 @@ struct Trajectory
     SCurveParameters trans_params;
     SCurveParameters rot_params;
     bool complete;
+    float max_time_scale = 1;   // Fastest the trajectory can be played back relative to how it was planned and stay within the configured limits
+    // Configured acceleration limits, without the limit_max_fraction headroom taken off. Changing the playback rate
+    // adds acceleration on top of the planned one, see TrajectoryTimeScaler::update.
+    float max_trans_acc = 0;
+    float max_rot_acc = 0;
+    float max_wheel_acc = 0;
+    float wheel_dist_from_center = 0;
 
     std::string toString() const
     {
@@ -101,24 +113,60 @@ enum class LIMITS_MODE
     SLOW,
 };
 
+// Outcome of synchronizing the translational and rotational profiles
+struct SyncResult
+{
+    bool lengthened;        // True if the faster axis was stretched to end with the slower one
+    bool rotation_limited;  // True if rotation is the slower axis that sets the move time
+    float time_scale;       // Factor the faster axis duration was multiplied by, 1 if not lengthened
+};
+
+// Speed and acceleration capacity of the omni wheels, measured at the wheel rim
+struct WheelLimits
+{
+    float dist_from_center;  // m, distance from the center of rotation to each wheel
+    float max_vel;           // m/s
+    float max_acc;           // m/s^2
+};
+
+// Worst case load a trajectory puts on the wheels
+struct WheelDemand
+{
+    float max_vel;           // m/s
+    float max_acc;           // m/s^2
+};
+
 // All the pieces needed to define the motion planning problem
 struct MotionPlanningProblem
 {
     Eigen::Vector3f initialPoint;
+    Eigen::Vector3f initialVelocity;
+    Eigen::Vector3f initialAcceleration;
     Eigen::Vector3f targetPoint;
     DynamicLimits translationalLimits;
     DynamicLimits rotationalLimits;  
+    WheelLimits wheelLimits;
+    float limitMaxFraction;          // Fraction of the configured limits the limits above were scaled down to
     SolverParameters solver_params;
 };
 
 // Helper methods - making public for easier testing
 MotionPlanningProblem buildMotionPlanningProblem(Point initialPoint, Point targetPoint, LIMITS_MODE limits_mode, const SolverParameters& solver);
+void getDynamicLimits(LIMITS_MODE limits_mode, DynamicLimits* translationalLimits, DynamicLimits* rotationalLimits);
+SolverParameters getSolverParameters();
 Trajectory generateTrajectory(MotionPlanningProblem problem);
+Trajectory generateStopTrajectory(MotionPlanningProblem problem);
 bool generateSCurve(float dist, DynamicLimits limits, const SolverParameters& solver, SCurveParameters* params);
+bool generateSCurveFromState(float dist, float v0, float a0, DynamicLimits limits, SCurveParameters* params);
+void generateStopSCurve(float v0, float a0, DynamicLimits limits, SCurveParameters* params);
 void populateSwitchTimeParameters(SCurveParameters* params, float dt_j, float dt_a, float dt_v);
-bool synchronizeParameters(SCurveParameters* params1, SCurveParameters* params2);
-bool slowDownParamsToMatchTime(SCurveParameters* params, float time_to_match);
-bool solveInverse(SCurveParameters* params);
+SyncResult synchronizeParameters(SCurveParameters* trans_params, SCurveParameters* rot_params);
+float scaleParamsToMatchTime(SCurveParameters* params, float time_to_match);
+WheelDemand computeWheelDemand(const SCurveParameters& trans_params, const SCurveParameters& rot_params, float dist_from_center);
+float applyWheelLimits(SCurveParameters* trans_params, SCurveParameters* rot_params, const WheelLimits& limits);
+float maxTimeScale(const SCurveParameters& params, const DynamicLimits& limits);
+float maxTimeScale(const SCurveParameters& trans_params, const SCurveParameters& rot_params, const WheelLimits& limits);
+Eigen::Vector3f localVelToWheelSpeeds(const Velocity& local_vel, float dist_from_center);
 std::vector<float> lookup_1D(float time, const SCurveParameters& params);
 std::vector<float> computeKinematicsBasedOnRegion(const SCurveParameters& params, int region, float dt);
 
@@ -134,13 +182,24 @@ class SmoothTrajectoryGenerator
     // successful
     bool generatePointToPointTrajectory(Point initialPoint, Point targetPoint, LIMITS_MODE limits_mode);
 
-    // Generates a trajectory that attempts to maintain the target velocity for a specified time. Note that the current implimentation
-    // of this does not give a guarantee on the accuracy of the velocity if the specified velocity and move time would violate the dynamic 
-    // limits of the fine or coarse movement mode. Returns a bool indicating if trajectory generation was successful
-    bool generateConstVelTrajectory(Point initialPoint, Velocity velocity, float moveTime, LIMITS_MODE limits_mode);
+    // Same as above, but starting with the given global velocity and acceleration instead of at rest, so a running
+    // trajectory can be replanned without a jump in the commanded velocity
+    bool generatePointToPointTrajectory(Point initialPoint, Velocity initialVelocity, Velocity initialAcceleration, 
+                                        Point targetPoint, LIMITS_MODE limits_mode);
+
+    // Generates the quickest jerk limited trajectory that brings the robot to rest from the given global velocity and
+    // acceleration. The end of the trajectory is where the robot will stop.
+    bool generateStopTrajectory(Point initialPoint, Velocity initialVelocity, Velocity initialAcceleration, LIMITS_MODE limits_mode);
 
     // Looks up a point in the current trajectory based on the time, in seconds, from the start of the trajectory
-    PVTPoint lookup(float time);
+    PVTPoint lookup(float time) const;
+
+    // Position the current trajectory ends at
+    Point getEndPoint() const;
+
+    // Access to the current trajectory so one solved elsewhere (i.e. planned ahead) can be swapped in
+    const Trajectory& getTrajectory() const { return currentTrajectory_; };
+    void setTrajectory(const Trajectory& trajectory) { currentTrajectory_ = trajectory; };
 
   private:
 
@@ -154,4 +213,50 @@ class SmoothTrajectoryGenerator
     SolverParameters solver_params_;
 };
 
+// Plays a trajectory back faster or slower than it was planned, without replanning it. The rate is trajectory
+// seconds per real second. It follows the requested speed override with a limited rate of change and a limited
+// change in that rate, so a new override doesn't kick the robot, and is capped by the trajectory's max_time_scale.
+class TrajectoryTimeScaler
+{
+  public:
+    TrajectoryTimeScaler();
+
+    // Requested playback rate, kept until it is set again
+    void setOverride(float rate) { override_ = rate; };
+
+    // Starts again from the beginning of a new trajectory. A trajectory starting at rest starts straight at the 
+    // override since scaling its time doesn't change its starting state, otherwise the rate carries on from where it was.
+    void restart(float max_rate, bool at_rest);
+
+    // Advances the trajectory time by dt seconds of real time and returns the new trajectory time
+    float update(float dt);
+
+    // Same as above, but first holds the rate change to the acceleration left over at target, the point of traj
+    // at the current trajectory time. Playing it back at a changing rate then stays within traj's configured limits.
+    float update(float dt, const Trajectory& traj, const PVTPoint& target);
+
+    float getTime() const { return time_; };
+    float getRate() const { return rate_; };
+    float getRateChange() const { return rate_change_; };
+
+    // Velocity and acceleration of the robot at the current rate, given the ones the trajectory was planned with
+    Velocity scaleVelocity(Velocity vel) const;
+    Velocity scaleAcceleration(Velocity acc, Velocity vel) const;
+
+  private:
+    // Moves the rate towards the override with the rate change held to +/- max_rate_change
+    float advance(float dt, float max_rate_change);
+
+    // Largest rate change the acceleration headroom at target allows when playing back at rate
+    float maxRateChange(const Trajectory& traj, const PVTPoint& target, float rate) const;
+
+    float override_;
+    float max_rate_;
+    float time_;
+    float rate_;
+    float rate_change_;
+    float max_rate_change_;
+    float max_rate_change_acc_;
+};
+
 #endif
\ No newline at end of file
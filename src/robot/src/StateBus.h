@@ -0,0 +1,182 @@
+#ifndef StateBus_h
+#define StateBus_h
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+
+#include "utils.h"
+#include "camera_tracker/CameraTrackerBase.h"
+
+// Latest value of one piece of robot state and a sequence number counting how many times it has
+// been published. The value is kept under a seqlock made of relaxed atomic words, so publishing
+// never waits on readers and readers on any thread just retry if they overlap a publish. Only one
+// thread may publish to a given topic.
+template <typename T>
+class StateTopic
+{
+    static_assert(std::is_trivially_copyable<T>::value, "State topics must be trivially copyable");
+
+  public:
+
+    StateTopic()
+    : seq_(0),
+      words_(),
+      wait_mutex_(),
+      wait_cv_(),
+      num_waiters_(0)
+    {
+        storeWords(T());
+    }
+
+    void publish(const T& value)
+    {
+        uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        storeWords(value);
+        seq_.store(seq + 2, std::memory_order_release);
+
+        if(num_waiters_.load(std::memory_order_acquire) > 0)
+        {
+            wait_cv_.notify_all();
+        }
+    }
+
+    // Only publishes (and bumps the sequence) if the value differs from the current one
+    void publishIfChanged(const T& value)
+    {
+        if(!(get() == value))
+        {
+            publish(value);
+        }
+    }
+
+    // Copies the latest value into out and returns its sequence number
+    uint64_t read(T& out) const
+    {
+        std::array<uint64_t, num_words> buf;
+        while(true)
+        {
+            uint64_t seq_before = seq_.load(std::memory_order_acquire);
+            if(seq_before & 1)
+            {
+                continue;
+            }
+            for(int i = 0; i < num_words; i++)
+            {
+                buf[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(seq_.load(std::memory_order_relaxed) == seq_before)
+            {
+                memcpy(static_cast<void*>(&out), buf.data(), sizeof(T));
+                return seq_before / 2;
+            }
+        }
+    }
+
+    T get() const
+    {
+        T value;
+        read(value);
+        return value;
+    }
+
+    // Number of times the topic has been published, 0 if never
+    uint64_t getSequence() const
+    {
+        return seq_.load(std::memory_order_acquire) / 2;
+    }
+
+    // Blocks the calling thread until something newer than seq is published or timeout_s passes.
+    // On success out and seq are updated to the new value. The timeout is in real time, so this
+    // should not be used from code running on the mock clock.
+    bool waitForUpdate(uint64_t& seq, T& out, float timeout_s)
+    {
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(timeout_s));
+        num_waiters_.fetch_add(1, std::memory_order_acq_rel);
+        bool updated = false;
+        {
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            while(!(updated = getSequence() > seq))
+            {
+                auto now = std::chrono::steady_clock::now();
+                if(now >= deadline)
+                {
+                    break;
+                }
+                // The publisher notifies without taking the mutex so it can never block, which means a
+                // notify can slip in between the check and the wait. Waiting in short slices bounds that.
+                wait_cv_.wait_for(lock, std::min<std::chrono::steady_clock::duration>(deadline - now, max_wait_slice));
+            }
+        }
+        num_waiters_.fetch_sub(1, std::memory_order_acq_rel);
+
+        if(updated)
+        {
+            seq = read(out);
+        }
+        return updated;
+    }
+
+    // Not copyable since readers hold references to topics
+    StateTopic(StateTopic const&) = delete;
+    StateTopic& operator= (StateTopic const&) = delete;
+
+  private:
+
+    static constexpr int num_words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    static constexpr std::chrono::milliseconds max_wait_slice{1};
+
+    void storeWords(const T& value)
+    {
+        std::array<uint64_t, num_words> buf = {};
+        memcpy(buf.data(), &value, sizeof(T));
+        for(int i = 0; i < num_words; i++)
+        {
+            words_[i].store(buf[i], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint64_t> seq_;     // Odd while a publish is in progress
+    std::array<std::atomic<uint64_t>, num_words> words_;
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+    std::atomic<int> num_waiters_;
+};
+
+template <typename T>
+constexpr std::chrono::milliseconds StateTopic<T>::max_wait_slice;
+
+struct ErrorState
+{
+    bool error_status = false;
+    bool motor_driver_connected = false;
+    bool lifter_driver_connected = false;
+
+    bool operator== (const ErrorState& other) const
+    {
+        return error_status == other.error_status &&
+               motor_driver_connected == other.motor_driver_connected &&
+               lifter_driver_connected == other.lifter_driver_connected;
+    }
+};
+
+// State shared between subsystems. Any thread may read or wait on a topic, each topic has a single publisher.
+struct StateBus
+{
+    StateTopic<Point> pose;                             // Controller pose estimate, published by RobotController
+    StateTopic<Velocity> velocity;                      // Controller velocity estimate, published by RobotController
+    StateTopic<CameraTrackerOutput> camera;             // Latest camera tracker output, published by Robot when it changes
+    StateTopic<LocalizationMetrics> localization;       // Published by RobotController
+    StateTopic<TrayState> tray;                         // Published by Robot when the tray state changes
+    StateTopic<ErrorState> errors;                      // Published by whoever sets or clears the error on the main loop
+};
+
+#endif //StateBus_h
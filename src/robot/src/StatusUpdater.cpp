@@ -2,58 +2,131 @@
 #include "constants.h"
 
 StatusUpdater::StatusUpdater() :
-  currentStatus_()
+  currentStatus_(),
+  bus_()
 {
 }
 
+StatusUpdater::Status StatusUpdater::getStatus() const
+{
+    Status status = currentStatus_;
+
+    Point pose = bus_.pose.get();
+    status.pos_x = pose.x;
+    status.pos_y = pose.y;
+    status.pos_a = pose.a;
+
+    Velocity vel = bus_.velocity.get();
+    status.vel_x = vel.vx;
+    status.vel_y = vel.vy;
+    status.vel_a = vel.va;
+
+    ErrorState errors = bus_.errors.get();
+    status.error_status = errors.error_status;
+    status.motor_driver_connected = errors.motor_driver_connected;
+    status.lifter_driver_connected = errors.lifter_driver_connected;
+
+    status.localization_metrics = bus_.localization.get();
+    return status;
+}
+
 std::string StatusUpdater::getStatusJsonString() 
 {
     // Return the status string
-    return currentStatus_.toJsonString();
+    Status status = getStatus();
+    std::string msg = status.toJsonString();
+    currentStatus_.counter = status.counter;
+    return msg;
 }
 
 void StatusUpdater::updatePosition(float x, float y, float a)
 {
-    currentStatus_.pos_x = x;
-    currentStatus_.pos_y = y;
-    currentStatus_.pos_a = a;
+    bus_.pose.publish({x, y, a});
 }
 
 void StatusUpdater::updateVelocity(float vx, float vy, float va)
 {
-    currentStatus_.vel_x = vx;
-    currentStatus_.vel_y = vy;
-    currentStatus_.vel_a = va;
+    bus_.velocity.publish({vx, vy, va});
+}
+
+void StatusUpdater::setErrorStatus()
+{
+    ErrorState errors = bus_.errors.get();
+    errors.error_status = true;
+    bus_.errors.publishIfChanged(errors);
+}
+
+void StatusUpdater::clearErrorStatus()
+{
+    ErrorState errors = bus_.errors.get();
+    errors.error_status = false;
+    bus_.errors.publishIfChanged(errors);
+}
+
+void StatusUpdater::updateLaneCommand(LANE lane, COMMAND cmd)
+{
+  bool in_progress = cmd != COMMAND::NONE;
+  if(lane == LANE::BASE)
+  {
+    currentStatus_.base_in_progress = in_progress;
+    currentStatus_.base_cmd = static_cast<int>(cmd);
+  }
+  else if(lane == LANE::TRAY)
+  {
+    currentStatus_.tray_in_progress = in_progress;
+    currentStatus_.tray_cmd = static_cast<int>(cmd);
+  }
+  currentStatus_.in_progress = currentStatus_.base_in_progress || currentStatus_.tray_in_progress || currentStatus_.sequence_running;
 }
 
-void StatusUpdater::updateInProgress(bool in_progress)
+bool StatusUpdater::getInProgress(LANE lane) const
 {
-  currentStatus_.in_progress = in_progress;
+  if(lane == LANE::BASE) return currentStatus_.base_in_progress;
+  if(lane == LANE::TRAY) return currentStatus_.tray_in_progress;
+  return false;
 }
 
-void StatusUpdater::updateControlLoopTime(int controller_loop_ms)
+void StatusUpdater::updateSequenceProgress(bool running, int step, int num_steps)
+{
+  currentStatus_.sequence_running = running;
+  currentStatus_.sequence_step = step;
+  currentStatus_.sequence_length = num_steps;
+  currentStatus_.in_progress = currentStatus_.base_in_progress || currentStatus_.tray_in_progress || currentStatus_.sequence_running;
+}
+
+void StatusUpdater::updateControlLoopTime(float controller_loop_ms)
 {
     currentStatus_.controller_loop_ms = controller_loop_ms;
 }
 
-void StatusUpdater::updatePositionLoopTime(int position_loop_ms)
+void StatusUpdater::updateControlLoopJitter(float controller_loop_p99_ms, float controller_loop_max_ms)
+{
+    currentStatus_.controller_loop_p99_ms = controller_loop_p99_ms;
+    currentStatus_.controller_loop_max_ms = controller_loop_max_ms;
+}
+
+void StatusUpdater::updatePositionLoopTime(float position_loop_ms)
 {
     currentStatus_.position_loop_ms = position_loop_ms;
 }
 
 void StatusUpdater::updateLocalizationMetrics(LocalizationMetrics localization_metrics)
 {
-    currentStatus_.localization_metrics = localization_metrics;
+    bus_.localization.publish(localization_metrics);
 }
 
 void StatusUpdater::update_motor_driver_connected(bool connected)
 {
-  currentStatus_.motor_driver_connected = connected;
+  ErrorState errors = bus_.errors.get();
+  errors.motor_driver_connected = connected;
+  bus_.errors.publishIfChanged(errors);
 }
 
 void StatusUpdater::update_lifter_driver_connected(bool connected)
 {
-  currentStatus_.lifter_driver_connected = connected;
+  ErrorState errors = bus_.errors.get();
+  errors.lifter_driver_connected = connected;
+  bus_.errors.publishIfChanged(errors);
 }
 
 void StatusUpdater::updateVisionControllerPose(Point pose)
@@ -3,7 +3,9 @@
 #define StatusUpdater_h
 
 #include <ArduinoJson/ArduinoJson.h>
+#include "constants.h"
 #include "utils.h"
+#include "StateBus.h"
 
 class StatusUpdater
 {
@@ -16,23 +18,33 @@ class StatusUpdater
 
     void updateVelocity(float vx, float vy, float va);
 
-    void updateControlLoopTime(int controller_loop_ms);
+    void updateControlLoopTime(float controller_loop_ms);
 
-    void updatePositionLoopTime(int position_loop_ms);
+    // Worst case controller loop times over the same window as updateControlLoopTime
+    void updateControlLoopJitter(float controller_loop_p99_ms, float controller_loop_max_ms);
 
-    void updateInProgress(bool in_progress);
+    void updatePositionLoopTime(float position_loop_ms);
 
+    // Command running in the lane, COMMAND::NONE once it is done
+    void updateLaneCommand(LANE lane, COMMAND cmd);
+
+    // True if a command is running in any lane
     bool getInProgress() const { return currentStatus_.in_progress; };
+
+    bool getInProgress(LANE lane) const;
+
+    // A running sequence counts as in progress until its last step has finished
+    void updateSequenceProgress(bool running, int step, int num_steps);
     
-    void setErrorStatus() { currentStatus_.error_status = true;}
+    void setErrorStatus();
 
-    void clearErrorStatus() {currentStatus_.error_status = false;};
+    void clearErrorStatus();
 
-    bool getErrorStatus() const {return currentStatus_.error_status;}
+    bool getErrorStatus() const {return bus_.errors.get().error_status;}
 
     void updateLocalizationMetrics(LocalizationMetrics localization_metrics);
 
-    float getLocalizationConfidence() const {return currentStatus_.localization_metrics.total_confidence;};
+    float getLocalizationConfidence() const {return bus_.localization.get().total_confidence;};
 
     void update_motor_driver_connected(bool connected);
 
@@ -44,6 +56,10 @@ class StatusUpdater
     
     void updateLastMarvelmindPose(Point pose, bool pose_used);
 
+    // Pose, velocity, localization and errors live on the bus so they can be read from other threads
+    StateBus& getStateBus() { return bus_; };
+    const StateBus& getStateBus() const { return bus_; };
+
     struct Status
     {
       // Current position and velocity
@@ -66,10 +82,19 @@ class StatusUpdater
       bool last_mm_used;
 
       // Loop times
-      int controller_loop_ms;
-      int position_loop_ms;
+      float controller_loop_ms;
+      float controller_loop_p99_ms;
+      float controller_loop_max_ms;
+      float position_loop_ms;
 
       bool in_progress;
+      bool base_in_progress;
+      bool tray_in_progress;
+      int base_cmd;
+      int tray_cmd;
+      bool sequence_running;
+      int sequence_step;
+      int sequence_length;
       bool error_status;
       uint8_t counter; // Just to show that the status is updating. Okay to roll over
 
@@ -96,8 +121,17 @@ class StatusUpdater
       last_mm_a(0.0),
       last_mm_used(false),
       controller_loop_ms(999),
+      controller_loop_p99_ms(999),
+      controller_loop_max_ms(999),
       position_loop_ms(999),
       in_progress(false),
+      base_in_progress(false),
+      tray_in_progress(false),
+      base_cmd(static_cast<int>(COMMAND::NONE)),
+      tray_cmd(static_cast<int>(COMMAND::NONE)),
+      sequence_running(false),
+      sequence_step(0),
+      sequence_length(0),
       error_status(false),
       counter(0),
       motor_driver_connected(false),
@@ -110,7 +144,7 @@ class StatusUpdater
       std::string toJsonString()
       {
         // Size the object correctly
-        const size_t capacity = JSON_OBJECT_SIZE(50); // Update when adding new fields
+        const size_t capacity = JSON_OBJECT_SIZE(60); // Update when adding new fields
         DynamicJsonDocument root(capacity);
 
         // Format to match messages sent by server
@@ -125,8 +159,17 @@ class StatusUpdater
         doc["vel_y"] = vel_y;
         doc["vel_a"] = vel_a;
         doc["controller_loop_ms"] = controller_loop_ms;
+        doc["controller_loop_p99_ms"] = controller_loop_p99_ms;
+        doc["controller_loop_max_ms"] = controller_loop_max_ms;
         doc["position_loop_ms"] = position_loop_ms;
         doc["in_progress"] = in_progress;
+        doc["base_in_progress"] = base_in_progress;
+        doc["tray_in_progress"] = tray_in_progress;
+        doc["base_cmd"] = base_cmd;
+        doc["tray_cmd"] = tray_cmd;
+        doc["sequence_running"] = sequence_running;
+        doc["sequence_step"] = sequence_step;
+        doc["sequence_length"] = sequence_length;
         doc["error_status"] = error_status;
         doc["counter"] = counter++;
         doc["motor_driver_connected"] = motor_driver_connected;
@@ -151,6 +194,11 @@ class StatusUpdater
         doc["cam_pose_y"] = camera_debug.pose_y;
         doc["cam_pose_a"] = camera_debug.pose_a;
         doc["cam_loop_ms"] = camera_debug.loop_ms;
+        doc["cam_side_latency_ms"] = camera_debug.side_latency_ms;
+        doc["cam_rear_latency_ms"] = camera_debug.rear_latency_ms;
+        doc["cam_side_dropped_frames"] = camera_debug.side_dropped_frames;
+        doc["cam_rear_dropped_frames"] = camera_debug.rear_dropped_frames;
+        doc["cam_pose_residual"] = camera_debug.pose_residual;
         doc["vision_x"] = vision_x;
         doc["vision_y"] = vision_y;
         doc["vision_a"] = vision_a;
@@ -166,10 +214,11 @@ class StatusUpdater
       }
     };
 
-    Status getStatus() { return currentStatus_;};
+    Status getStatus() const;
 
   private:
     Status currentStatus_;
+    StateBus bus_;
 
 };
 
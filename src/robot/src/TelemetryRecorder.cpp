@@ -0,0 +1,125 @@
+#include "TelemetryRecorder.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <plog/Log.h>
+
+#include "constants.h"
+
+constexpr uint32_t telemetry_version = 1;
+constexpr const char* telemetry_magic = "DRTELEM";
+constexpr const char* telemetry_schema =
+    "timestamp_us:u64,motion_id:u32,limits_mode:u16,traj_running:u16,traj_time:f32,"
+    "pos_x:f32,pos_y:f32,pos_a:f32,vel_x:f32,vel_y:f32,vel_a:f32,"
+    "target_pos_x:f32,target_pos_y:f32,target_pos_a:f32,target_vel_x:f32,target_vel_y:f32,target_vel_a:f32,"
+    "control_vel_x:f32,control_vel_y:f32,control_vel_a:f32,loop_dt:f32,cov_x:f32,cov_y:f32,cov_a:f32";
+
+static_assert(sizeof(TelemetryRecord) == 96, "Update telemetry_schema and telemetry_version when changing TelemetryRecord");
+
+// Keeps the previous runs by shifting them along, same naming as the rolled logs: telemetry.bin -> telemetry.1.bin ->
+// telemetry.2.bin ... up to max_files in total
+static void rollFiles(const std::string& file_path, int max_files)
+{
+    if(max_files < 2 || access(file_path.c_str(), F_OK) != 0)
+    {
+        return;
+    }
+    size_t dot = file_path.find_last_of('.');
+    std::string base = dot == std::string::npos ? file_path : file_path.substr(0, dot);
+    std::string ext = dot == std::string::npos ? "" : file_path.substr(dot);
+
+    std::string last = base + "." + std::to_string(max_files - 1) + ext;
+    remove(last.c_str());
+    for(int i = max_files - 2; i >= 1; i--)
+    {
+        std::string from = base + "." + std::to_string(i) + ext;
+        std::string to = base + "." + std::to_string(i + 1) + ext;
+        rename(from.c_str(), to.c_str());
+    }
+    std::string first = base + ".1" + ext;
+    rename(file_path.c_str(), first.c_str());
+}
+
+TelemetryRecorder::TelemetryRecorder()
+: TelemetryRecorder(static_cast<const char*>(cfg.lookup("telemetry.path")),
+                    static_cast<bool>(cfg.lookup("telemetry.enabled")) ? static_cast<int>(cfg.lookup("telemetry.capacity")) : 0,
+                    cfg.lookup("telemetry.max_files"))
+{}
+
+TelemetryRecorder::TelemetryRecorder(const std::string& file_path, int capacity, int max_files)
+: header_(nullptr),
+  records_(nullptr),
+  mapped_size_(0),
+  next_slot_(0)
+{
+    if(capacity > 0)
+    {
+        rollFiles(file_path, max_files);
+        open(file_path, capacity);
+    }
+}
+
+TelemetryRecorder::~TelemetryRecorder()
+{
+    if(header_)
+    {
+        msync(header_, mapped_size_, MS_ASYNC);
+        munmap(header_, mapped_size_);
+    }
+}
+
+void TelemetryRecorder::open(const std::string& file_path, int capacity)
+{
+    int fd = ::open(file_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        PLOGE << "Unable to open telemetry file " << file_path;
+        return;
+    }
+
+    // Preallocate the whole ring up front so recording never has to grow the file
+    size_t size = sizeof(TelemetryFileHeader) + static_cast<size_t>(capacity) * sizeof(TelemetryRecord);
+    void* mapping = MAP_FAILED;
+    if(ftruncate(fd, size) == 0)
+    {
+        mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        PLOGE << "Unable to map telemetry file " << file_path;
+        return;
+    }
+
+    mapped_size_ = size;
+    header_ = static_cast<TelemetryFileHeader*>(mapping);
+    records_ = reinterpret_cast<TelemetryRecord*>(static_cast<char*>(mapping) + sizeof(TelemetryFileHeader));
+
+    memset(header_, 0, sizeof(TelemetryFileHeader));
+    strncpy(header_->magic, telemetry_magic, sizeof(header_->magic));
+    strncpy(header_->schema, telemetry_schema, sizeof(header_->schema) - 1);
+    header_->version = telemetry_version;
+    header_->header_size = sizeof(TelemetryFileHeader);
+    header_->record_size = sizeof(TelemetryRecord);
+    header_->capacity = capacity;
+    header_->record_count = 0;
+    PLOGI << "Recording telemetry to " << file_path;
+}
+
+void TelemetryRecorder::record(const TelemetryRecord& record)
+{
+    if(!header_)
+    {
+        return;
+    }
+    memcpy(&records_[next_slot_], &record, sizeof(TelemetryRecord));
+    header_->record_count++;
+    next_slot_++;
+    if(next_slot_ == header_->capacity)
+    {
+        next_slot_ = 0;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef TelemetryRecorder_h
+#define TelemetryRecorder_h
+
+#include <stdint.h>
+#include <string>
+
+// One fixed size record per controller tick. Field order and types must match
+// telemetry_schema in TelemetryRecorder.cpp, which is written into the file header
+// so src/master/telemetry_convert.py can decode the file without knowing this struct.
+struct TelemetryRecord
+{
+    uint64_t timestamp_us;       // Steady clock time
+    uint32_t motion_id;          // Increments each time a new move starts
+    uint16_t limits_mode;        // LIMITS_MODE of the move
+    uint16_t traj_running;       // 1 if a trajectory was active this tick
+    float traj_time;             // Time of the trajectory target (s)
+    float pos[3];                // Estimated global pose x, y, a
+    float vel[3];                // Estimated global velocity x, y, a
+    float target_pos[3];         // Trajectory target pose, in the frame the controller mode tracks in
+    float target_vel[3];         // Trajectory target velocity
+    float control_vel[3];        // Commanded global velocity
+    float loop_dt;               // Time since previous controller tick (s)
+    float cov[3];                // Localization covariance diagonal x, y, a
+};
+
+// Fixed size header at the start of the telemetry file
+struct TelemetryFileHeader
+{
+    char magic[8];               // "DRTELEM"
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t capacity;           // Number of record slots in the ring
+    uint64_t record_count;       // Total records written, the next slot is record_count % capacity
+    char schema[512];            // Comma separated name:type for each record field, in order
+};
+
+// Records telemetry into a preallocated, memory mapped ring file. Recording a tick is a
+// single memcpy into the mapping, the OS handles writing it out to disk.
+class TelemetryRecorder
+{
+  public:
+    // Uses telemetry.* settings from the config
+    TelemetryRecorder();
+
+    // A capacity of 0 disables recording. An existing file is kept as file_path's .1 file (with older ones shifted
+    // along) when max_files is more than 1, otherwise it is overwritten.
+    TelemetryRecorder(const std::string& file_path, int capacity, int max_files = 1);
+
+    ~TelemetryRecorder();
+
+    // Copies the record into the next slot, overwriting the oldest record once the ring is full
+    void record(const TelemetryRecord& record);
+
+    bool isOpen() const { return header_ != nullptr; };
+
+    uint64_t getRecordCount() const { return header_ ? header_->record_count : 0; };
+
+    // Delete copy and assignment constructors
+    TelemetryRecorder(TelemetryRecorder const&) = delete;
+    TelemetryRecorder& operator= (TelemetryRecorder const&) = delete;
+
+  private:
+
+    void open(const std::string& file_path, int capacity);
+
+    TelemetryFileHeader* header_;
+    TelemetryRecord* records_;
+    size_t mapped_size_;
+    uint32_t next_slot_;
+};
+
+#endif //TelemetryRecorder_h
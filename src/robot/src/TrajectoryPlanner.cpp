@@ -0,0 +1,114 @@
+#include "TrajectoryPlanner.h"
+
+#include <plog/Log.h>
+
+#include "constants.h"
+
+TrajectoryPlanner::TrajectoryPlanner()
+: traj_gen_(),
+  max_trans_error_(cfg.lookup("trajectory_generation.plan_ahead_max_trans_error")),
+  max_ang_error_(cfg.lookup("trajectory_generation.plan_ahead_max_ang_error")),
+  mutex_(),
+  cv_(),
+  request_(),
+  has_request_(false),
+  request_pending_(false),
+  has_plan_(false),
+  plan_ok_(false),
+  plan_(),
+  stop_(false),
+  thread_()
+{
+    // Start the worker last so it only ever sees fully constructed members
+    thread_ = std::thread(&TrajectoryPlanner::run, this);
+}
+
+TrajectoryPlanner::~TrajectoryPlanner()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+void TrajectoryPlanner::requestPlan(Point start, Point target, LIMITS_MODE limits_mode)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        request_ = {start, target, limits_mode};
+        has_request_ = true;
+        request_pending_ = true;
+        has_plan_ = false;
+    }
+    cv_.notify_all();
+}
+
+bool TrajectoryPlanner::takePlan(Point start, Point target, LIMITS_MODE limits_mode, Trajectory* trajectory, Point* planned_target)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(!has_request_ || request_.limits_mode != limits_mode || !closeEnough(request_.start, start) || !closeEnough(request_.target, target))
+    {
+        return false;
+    }
+
+    // Solving it here would take just as long, so wait for the worker instead
+    cv_.wait(lock, [this]{ return has_plan_ || !has_request_; });
+    if(!has_request_)
+    {
+        return false;
+    }
+
+    *trajectory = plan_;
+    *planned_target = request_.target;
+    has_request_ = false;
+    has_plan_ = false;
+    return plan_ok_;
+}
+
+void TrajectoryPlanner::clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        has_request_ = false;
+        request_pending_ = false;
+        has_plan_ = false;
+    }
+    cv_.notify_all();
+}
+
+void TrajectoryPlanner::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true)
+    {
+        cv_.wait(lock, [this]{ return request_pending_ || stop_; });
+        if(stop_)
+        {
+            return;
+        }
+
+        Request request = request_;
+        request_pending_ = false;
+        lock.unlock();
+
+        bool ok = traj_gen_.generatePointToPointTrajectory(request.start, request.target, request.limits_mode);
+
+        lock.lock();
+        // Drop the result if the request was replaced or cleared while solving
+        if(has_request_ && !request_pending_)
+        {
+            plan_ = traj_gen_.getTrajectory();
+            plan_ok_ = ok;
+            has_plan_ = true;
+            cv_.notify_all();
+        }
+    }
+}
+
+bool TrajectoryPlanner::closeEnough(Point a, Point b) const
+{
+    Eigen::Vector2f dp = {a.x - b.x, a.y - b.y};
+    return dp.norm() <= max_trans_error_ && fabs(angle_diff(a.a, b.a)) <= max_ang_error_;
+}
@@ -0,0 +1,63 @@
+#ifndef TrajectoryPlanner_h
+#define TrajectoryPlanner_h
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "SmoothTrajectoryGenerator.h"
+#include "utils.h"
+
+// Solves point to point trajectories on a worker thread, so the next move can be planned while the current
+// one is still running and start right away once it is commanded. Only the latest request is kept.
+class TrajectoryPlanner
+{
+  public:
+
+    TrajectoryPlanner();
+    ~TrajectoryPlanner();
+
+    // Queues a plan from start to target, replacing any request or plan that hasn't been taken yet
+    void requestPlan(Point start, Point target, LIMITS_MODE limits_mode);
+
+    // Hands back the plan for the latest request if it uses the same limits mode and its start and target are within
+    // tolerance of the given ones, waiting for it if it is still being solved. planned_target is the target the
+    // trajectory actually ends at. Returns false if there is no matching plan or solving it failed.
+    bool takePlan(Point start, Point target, LIMITS_MODE limits_mode, Trajectory* trajectory, Point* planned_target);
+
+    // Drops anything requested or planned
+    void clear();
+
+    // Not copyable since it owns a thread
+    TrajectoryPlanner(TrajectoryPlanner const&) = delete;
+    TrajectoryPlanner& operator= (TrajectoryPlanner const&) = delete;
+
+  private:
+
+    struct Request
+    {
+        Point start;
+        Point target;
+        LIMITS_MODE limits_mode;
+    };
+
+    void run();
+    bool closeEnough(Point a, Point b) const;
+
+    SmoothTrajectoryGenerator traj_gen_;   // Only used from the worker thread
+    float max_trans_error_;
+    float max_ang_error_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    Request request_;
+    bool has_request_;                     // request_ hasn't been taken or cleared
+    bool request_pending_;                 // request_ is waiting for the worker
+    bool has_plan_;                        // plan_ holds the result for request_
+    bool plan_ok_;
+    Trajectory plan_;
+    bool stop_;
+    std::thread thread_;
+};
+
+#endif //TrajectoryPlanner_h
@@ -38,15 +38,27 @@ TrayController::TrayController()
   fake_tray_motion_(cfg.lookup("tray.fake_tray_motions")),
   cur_action_(ACTION::NONE),
   controller_rate_(cfg.lookup("tray.controller_frequency")),
-  is_initialized_(false)
+  is_initialized_(false),
+  fault_(false),
+  step_id_(0),
+  latch_timeout_ms_(cfg.lookup("tray.latch_timeout_ms")),
+  move_timeout_ms_(cfg.lookup("tray.move_timeout_ms")),
+  home_timeout_ms_(cfg.lookup("tray.home_timeout_ms"))
 {
     if(fake_tray_motion_) PLOGW << "Fake tray motion enabled";
 }
 
-void TrayController::initialize()
+void TrayController::startAction(ACTION action)
 {
-    cur_action_ = ACTION::INITIALIZE;
+    cur_action_ = action;
     action_step_ = 0;
+    action_step_running_ = false;
+    fault_ = false;
+}
+
+void TrayController::initialize()
+{
+    startAction(ACTION::INITIALIZE);
     PLOGI << "Starting tray action INITIALIZE";
 }
 
@@ -58,8 +70,7 @@ bool TrayController::place()
         return false;
     }
     
-    cur_action_ = ACTION::PLACE;
-    action_step_ = 0;
+    startAction(ACTION::PLACE);
     PLOGI << "Starting tray action PLACE";
     return true;
 }
@@ -72,12 +83,23 @@ bool TrayController::load()
         return false;
     }
     
-    cur_action_ = ACTION::LOAD;
-    action_step_ = 0;
+    startAction(ACTION::LOAD);
     PLOGI << "Starting tray action LOAD";
     return true;
 }
 
+TrayState TrayController::getTrayState() const
+{
+    TrayState state;
+    state.initialized = is_initialized_;
+    state.action_running = cur_action_ != ACTION::NONE;
+    state.load_complete = load_complete_;
+    state.action = static_cast<int>(cur_action_);
+    state.action_step = action_step_;
+    state.fault = fault_;
+    return state;
+}
+
 void TrayController::estop()
 {
     cur_action_ = ACTION::NONE;
@@ -126,13 +148,14 @@ void TrayController::update()
     }
 }
 
-void TrayController::runStepAndWaitForCompletion(std::string data, std::string debug_print)
+void TrayController::runStepAndWaitForCompletion(std::string data, std::string debug_print, int timeout_ms)
 {
     if(!action_step_running_)
     {
+        step_id_++;
         if (serial_to_lifter_driver_->isConnected())
         {
-            serial_to_lifter_driver_->send(data);
+            serial_to_lifter_driver_->send(data + "@" + std::to_string(step_id_));
         }
         action_step_running_ = true;
         PLOGI << debug_print;
@@ -140,21 +163,56 @@ void TrayController::runStepAndWaitForCompletion(std::string data, std::string d
     }
     else
     {
-        // Request status and wait for command to complete
-        std::string msg = "";
-        if (serial_to_lifter_driver_->isConnected())
+        // The lifter driver tells us when the step is done, faking it just takes a fixed time
+        bool step_done = fake_tray_motion_ ? action_timer_.dt_ms() > 1000 : checkForStepDone();
+        if(step_done) 
         {
-            serial_to_lifter_driver_->send("lift:status_req");
-            msg = serial_to_lifter_driver_->rcv_lift();
-        }
-        // Initial delay for action
-        if(action_timer_.dt_ms() > 1000 && (msg == "none" || fake_tray_motion_)) {
+            PLOGI.printf("Tray step %i done in %i ms", action_step_, action_timer_.dt_ms());
             action_step_running_ = false;
             action_step_++;
         }
+        else if(cur_action_ != ACTION::NONE && action_timer_.dt_ms() > timeout_ms)
+        {
+            abortAction("Timed out after " + std::to_string(timeout_ms) + " ms waiting on tray step " + std::to_string(action_step_));
+        }
     }
 }
 
+bool TrayController::checkForStepDone()
+{
+    if (!serial_to_lifter_driver_->isConnected())
+    {
+        return false;
+    }
+
+    // Status replies and events from older steps can be in the queue too, only look for this step
+    const std::string done_msg = "done:" + std::to_string(step_id_);
+    const std::string rejected_msg = "rejected:" + std::to_string(step_id_);
+    bool done = false;
+    std::string msg = serial_to_lifter_driver_->rcv_lift();
+    while(!msg.empty())
+    {
+        if(msg == done_msg)
+        {
+            done = true;
+        }
+        else if(msg == rejected_msg)
+        {
+            abortAction("Lifter driver rejected tray step " + std::to_string(action_step_));
+            return false;
+        }
+        msg = serial_to_lifter_driver_->rcv_lift();
+    }
+    return done;
+}
+
+void TrayController::abortAction(std::string reason)
+{
+    PLOGE << reason;
+    estop();
+    fault_ = true;
+}
+
 void TrayController::updateInitialize()
 {
     /*
@@ -169,14 +227,14 @@ void TrayController::updateInitialize()
     {
         std::string data = "lift:close";
         std::string debug = "Closing latch";
-        runStepAndWaitForCompletion(data, debug);
+        runStepAndWaitForCompletion(data, debug, latch_timeout_ms_);
     }
     // 1 - Do tray init
     if(action_step_ == 1)
     {
         std::string data = "lift:home";
         std::string debug = "Homing tray";
-        runStepAndWaitForCompletion(data, debug);
+        runStepAndWaitForCompletion(data, debug, home_timeout_ms_);
     }
     // 2 - Move to default location
     if(action_step_ == 2)
@@ -184,7 +242,7 @@ void TrayController::updateInitialize()
         int pos = getPos(LifterPosType::DEFAULT);
         std::string data = "lift:pos:" + std::to_string(pos);
         std::string debug = "Moving tray to default position";
-        runStepAndWaitForCompletion(data, debug);
+        runStepAndWaitForCompletion(data, debug, move_timeout_ms_);
     }
     // 3 - Done with actinon
     if(action_step_ == 3)
@@ -211,14 +269,14 @@ void TrayController::updatePlace()
         int pos = getPos(LifterPosType::PLACE);
         std::string data = "lift:pos:" + std::to_string(pos);
         std::string debug = "Moving tray to placement position";
-        runStepAndWaitForCompletion(data, debug);
+        runStepAndWaitForCompletion(data, debug, move_timeout_ms_);
     }
     // 1 - Open latch
     if(action_step_ == 1)
     {
         std::string data = "lift:open";
         std::string debug = "Opening latch";
-        runStepAndWaitForCompletion(data, debug);
+        runStepAndWaitForCompletion(data, debug, latch_timeout_ms_);
     }
     // 2 - Move tray to default
     if(action_step_ == 2)
@@ -226,14 +284,14 @@ void TrayController::updatePlace()
         int pos = getPos(LifterPosType::DEFAULT);
         std::string data = "lift:pos:" + std::to_string(pos);
         std::string debug = "Moving tray to default position";
-        runStepAndWaitForCompletion(data, debug);
+        runStepAndWaitForCompletion(data, debug, move_timeout_ms_);
     }
     // 3 - Close latch
     if(action_step_ == 3)
     {
         std::string data = "lift:close";
         std::string debug = "Closing latch";
-        runStepAndWaitForCompletion(data, debug);
+        runStepAndWaitForCompletion(data, debug, latch_timeout_ms_);
     }
     // 4 - Done with actinon
     if(action_step_ == 4)
@@ -258,7 +316,7 @@ void TrayController::updateLoad()
         int pos = getPos(LifterPosType::LOAD);
         std::string data = "lift:pos:" + std::to_string(pos);
         std::string debug = "Moving tray to load position";
-        runStepAndWaitForCompletion(data, debug);
+        runStepAndWaitForCompletion(data, debug, move_timeout_ms_);
     }
     // 1 - Wait for load complete signal
     if(action_step_ == 1)
@@ -285,7 +343,7 @@ void TrayController::updateLoad()
         int pos = getPos(LifterPosType::DEFAULT);
         std::string data = "lift:pos:" + std::to_string(pos);
         std::string debug = "Moving tray to default position";
-        runStepAndWaitForCompletion(data, debug);
+        runStepAndWaitForCompletion(data, debug, move_timeout_ms_);
     }
     // 3 - Done with actinon
     if(action_step_ == 3)
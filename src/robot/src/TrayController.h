@@ -20,6 +20,11 @@ class TrayController
 
     bool isActionRunning() {return cur_action_ != ACTION::NONE;}
 
+    // True if the last action was aborted because a step failed or timed out. Cleared when the next action starts.
+    bool hasFault() const {return fault_;}
+
+    TrayState getTrayState() const;
+
     void update();
 
     void estop();
@@ -48,8 +53,19 @@ class TrayController
     RateController controller_rate_;       // Rate limit controller loop
     Timer action_timer_;
     bool is_initialized_;
+    bool fault_;
+    int step_id_;                          // Sent along with each step so the lifter driver can report when it is done
+    int latch_timeout_ms_;
+    int move_timeout_ms_;
+    int home_timeout_ms_;
+
+    void startAction(ACTION action);
+    void runStepAndWaitForCompletion(std::string data, std::string debug_print, int timeout_ms);
+
+    // Reads everything the lifter driver sent and returns true if it reported the current step done
+    bool checkForStepDone();
 
-    void runStepAndWaitForCompletion(std::string data, std::string debug_print);
+    void abortAction(std::string reason);
     void updateInitialize();
     void updateLoad();
     void updatePlace();
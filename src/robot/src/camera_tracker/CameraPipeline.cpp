@@ -3,9 +3,15 @@
 #include <plog/Log.h>
 #include "constants.h"
 #include <mutex>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
 
 std::mutex data_mutex;
 
+// How long the processing thread waits for a new frame before giving up on this loop
+constexpr int frame_wait_timeout_ms = 100;
+
 cv::Point2f getBestKeypoint(std::vector<cv::KeyPoint> keypoints)
 {
     if(keypoints.empty())
@@ -30,9 +36,23 @@ cv::Point2f getBestKeypoint(std::vector<cv::KeyPoint> keypoints)
 
 CameraPipeline::CameraPipeline(CAMERA_ID id, bool start_thread)
 : use_debug_image_(cfg.lookup("vision_tracker.debug.use_debug_image")),
+  use_replay_(cfg.lookup("vision_tracker.debug.use_replay")),
+  replay_finished_(false),
   output_debug_images_(cfg.lookup("vision_tracker.debug.save_camera_debug")),
   thread_running_(false),
-  current_output_()
+  current_output_(),
+  latest_frame_(),
+  latest_frame_time_(ClockFactory::getFactoryInstance()->get_clock()->now()),
+  new_frame_ready_(false),
+  dropped_frames_(0),
+  use_staged_pipeline_(cfg.lookup("vision_tracker.staged.enabled")),
+  stage_threads_(),
+  preprocess_queue_(cfg.lookup("vision_tracker.staged.queue_size")),
+  detect_queue_(cfg.lookup("vision_tracker.staged.queue_size")),
+  capture_core_(-1),
+  preprocess_core_(-1),
+  detect_core_(-1),
+  frame_count_(0)
 {
     initCamera(id);
 
@@ -68,12 +88,19 @@ void CameraPipeline::initCamera(CAMERA_ID id)
     std::string camera_path_config_name = "vision_tracker." + name + ".camera_path";
     std::string debug_output_path_config_name = "vision_tracker." + name + ".debug_output_path";
     std::string debug_image_config_name = "vision_tracker." + name + ".debug_image";
+    std::string replay_path_config_name = "vision_tracker." + name + ".replay_path";
     std::string x_offset_config_name = "vision_tracker.physical." + name + ".x_offset";
     std::string y_offset_config_name = "vision_tracker.physical." + name + ".y_offset";
     std::string z_offset_config_name = "vision_tracker.physical." + name + ".z_offset";
     std::string x_res_scale_config_name = "vision_tracker." + name + ".resolution_scale_x";
     std::string y_res_scale_config_name = "vision_tracker." + name + ".resolution_scale_y";
+    std::string staged_cores_config_name = "vision_tracker.staged." + name + "_cores";
     
+    // Cores for the staged pipeline threads
+    capture_core_ = cfg.lookup(staged_cores_config_name)[0];
+    preprocess_core_ = cfg.lookup(staged_cores_config_name)[1];
+    detect_core_ = cfg.lookup(staged_cores_config_name)[2];
+
     // Initialize intrinsic calibration data
     camera_data_.id = id;
     std::string calibration_path = cfg.lookup(calibration_path_config_name);
@@ -82,7 +109,7 @@ void CameraPipeline::initCamera(CAMERA_ID id)
     if(fs["K"].isNone() || fs["D"].isNone()) 
     {
         PLOGE.printf("Missing %s calibration data", name.c_str());
-        throw;
+        throw std::runtime_error("Missing " + name + " calibration data in " + calibration_path);
     }
     fs["K"] >> camera_data_.K;
     fs["D"] >> camera_data_.D;
@@ -118,49 +145,82 @@ void CameraPipeline::initCamera(CAMERA_ID id)
     // PLOGI << name << " R: " << camera_data_.R;
     // PLOGI << name << " t: " << camera_data_.t.transpose();
 
-    // Precompute some inverse values for later re-use
-    camera_data_.R_inv = camera_data_.R.inverse();
-    Eigen::Matrix3f tmp;
+    Eigen::Matrix3f K_eigen;
     // Hack to get around problems with enabling eigen support in opencv
-    tmp << camera_data_.K.at<double>(0,0), camera_data_.K.at<double>(0,1), camera_data_.K.at<double>(0,2),
-           camera_data_.K.at<double>(1,0), camera_data_.K.at<double>(1,1), camera_data_.K.at<double>(1,2),
-           camera_data_.K.at<double>(2,0), camera_data_.K.at<double>(2,1), camera_data_.K.at<double>(2,2);
-    camera_data_.K_inv = tmp.inverse();
+    K_eigen << camera_data_.K.at<double>(0,0), camera_data_.K.at<double>(0,1), camera_data_.K.at<double>(0,2),
+               camera_data_.K.at<double>(1,0), camera_data_.K.at<double>(1,1), camera_data_.K.at<double>(1,2),
+               camera_data_.K.at<double>(2,0), camera_data_.K.at<double>(2,1), camera_data_.K.at<double>(2,2);
+
+    // Since the targets are always on the Z=0 plane, the projection K*[R|t]*[x,y,0,1] reduces
+    // to the ground homography K*[r1,r2,t]*[x,y,1]. Precompute it and its inverse once here.
+    Eigen::Matrix3f r1_r2_t;
+    r1_r2_t << camera_data_.R.col(0), camera_data_.R.col(1), camera_data_.t;
+    camera_data_.H = K_eigen * r1_r2_t;
+    camera_data_.H_inv = camera_data_.H.inverse();
 
     // PLOGI << name << " K: " << camera_data_.K;
-    // PLOGI << name << " Ktmp: " << tmp;
-    // PLOGI << name << " Kinv: " << camera_data_.K_inv;
+    // PLOGI << name << " H: " << camera_data_.H;
+    // PLOGI << name << " H_inv: " << camera_data_.H_inv;
     
     // Initialize camera calibration capture or debug data
-    if(!use_debug_image_)
+    if(use_debug_image_)
+    {
+        std::string image_path = cfg.lookup(debug_image_config_name);
+        camera_data_.debug_frame = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
+        if(camera_data_.debug_frame.empty())
+        {
+            PLOGE.printf("Could not read %s debug image from %s", name.c_str(), image_path.c_str());
+            throw std::runtime_error("Could not read " + name + " debug image from " + image_path);
+        }
+        PLOGW.printf("Loading %s debug image from %s", name.c_str(), image_path.c_str());
+    }
+    else if(use_replay_)
+    {
+        // Replay either a directory of recorded frames (filtered by camera name) or a video file
+        std::string replay_path = cfg.lookup(replay_path_config_name);
+        camera_data_.replay_idx = 0;
+        if(std::filesystem::is_directory(replay_path))
+        {
+            cv::glob(replay_path + "/*" + name + "*.jpg", camera_data_.replay_files, false);
+            std::sort(camera_data_.replay_files.begin(), camera_data_.replay_files.end());
+            if(camera_data_.replay_files.empty())
+            {
+                PLOGE.printf("No %s replay frames found in %s", name.c_str(), replay_path.c_str());
+                throw std::runtime_error("No " + name + " replay frames found in " + replay_path);
+            }
+            PLOGW.printf("Replaying %i %s frames from %s", static_cast<int>(camera_data_.replay_files.size()), name.c_str(), replay_path.c_str());
+        }
+        else
+        {
+            camera_data_.capture = cv::VideoCapture(replay_path);
+            if (!camera_data_.capture.isOpened()) 
+            {
+                PLOGE.printf("Could not open %s replay video at %s", name.c_str(), replay_path.c_str());
+                throw std::runtime_error("Could not open " + name + " replay video at " + replay_path);
+            }
+            PLOGW.printf("Replaying %s video from %s", name.c_str(), replay_path.c_str());
+        }
+    }
+    else
     {
         std::string camera_path = cfg.lookup(camera_path_config_name);
         camera_data_.capture = cv::VideoCapture(camera_path);
         if (!camera_data_.capture.isOpened()) 
         {
             PLOGE.printf("Could not open %s camera at %s", name.c_str(), camera_path.c_str());
-            throw;
+            throw std::runtime_error("Could not open " + name + " camera at " + camera_path);
         }
         PLOGI.printf("Opened %s camera at %s", name.c_str(), camera_path.c_str());
         camera_data_.capture.set(cv::CAP_PROP_FRAME_WIDTH, 320);
         camera_data_.capture.set(cv::CAP_PROP_FRAME_HEIGHT, 240);
         camera_data_.capture.set(cv::CAP_PROP_FPS, 30);
+        // Keep the driver queue short so a grabbed frame is never more than one frame old
+        camera_data_.capture.set(cv::CAP_PROP_BUFFERSIZE, 1);
 
         int width = camera_data_.capture.get(cv::CAP_PROP_FRAME_WIDTH);
         int height = camera_data_.capture.get(cv::CAP_PROP_FRAME_HEIGHT);
         int fps = camera_data_.capture.get(cv::CAP_PROP_FPS);
         PLOGI.printf("Properties %s: resolution: %ix%i, fps: %i", name.c_str(), width, height, fps);
-    } 
-    else 
-    {
-        std::string image_path = cfg.lookup(debug_image_config_name);
-        camera_data_.debug_frame = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
-        if(camera_data_.debug_frame.empty())
-        {
-            PLOGE.printf("Could not read %s debug image from %s", name.c_str(), image_path.c_str());
-            throw;
-        }
-        PLOGW.printf("Loading %s debug image from %s", name.c_str(), image_path.c_str());
     }
 
     // Initialze debug output path
@@ -178,97 +238,138 @@ std::string CameraPipeline::cameraIdToString(CAMERA_ID id)
     return "unk";
 }
 
-std::vector<cv::KeyPoint> CameraPipeline::allKeypointsInImage(cv::Mat img_raw, bool output_debug)
+void CameraPipeline::preprocessFrame(FrameData& frame)
 {   
-    // Timer t;
+    Timer t;
 
     // Undistort and crop
-    cv::Mat img_undistorted;
     cv::Rect validPixROI;
     // PLOGI << "init memory time: " << t.dt_ms();
     // t.reset();
-    cv::Mat newcameramtx = cv::getOptimalNewCameraMatrix(camera_data_.K, camera_data_.D, img_raw.size(), /*alpha=*/1, img_raw.size(), &validPixROI);
+    cv::Mat newcameramtx = cv::getOptimalNewCameraMatrix(camera_data_.K, camera_data_.D, frame.raw.size(), /*alpha=*/1, frame.raw.size(), &validPixROI);
     // PLOGI << "new camera time: " << t.dt_ms();
     // t.reset();
-    cv::undistort(img_raw, img_undistorted, camera_data_.K, camera_data_.D);
+    cv::undistort(frame.raw, frame.undistorted, camera_data_.K, camera_data_.D);
 
-    // PLOGI << "undistort time: " << t.dt_ms();
-    // t.reset();
+    frame.timings.undistort_us = t.dt_us();
+    t.reset();
 
     // Threshold
-    cv::Mat img_thresh;
-    cv::threshold(img_undistorted, img_thresh, threshold_, 255, cv::THRESH_BINARY_INV);
+    cv::threshold(frame.undistorted, frame.thresh, threshold_, 255, cv::THRESH_BINARY_INV);
     // PLOGI <<" Threshold";
 
-    // PLOGI << "threshold time: " << t.dt_ms();
-    // t.reset();
+    frame.timings.threshold_us = t.dt_us();
+}
+
+void CameraPipeline::detectKeypoints(FrameData& frame)
+{
+    Timer t;
 
     // Blob detection
-    std::vector<cv::KeyPoint> keypoints;
-    keypoints.reserve(10);
-    // PLOGI << "blob memory time: " << t.dt_ms();
-    // t.reset();
-    blob_detector_->detect(img_thresh, keypoints);
-    // PLOGI <<"Num blobs " << keypoints.size();
+    frame.keypoints.clear();
+    frame.keypoints.reserve(10);
+    blob_detector_->detect(frame.thresh, frame.keypoints);
+    // PLOGI <<"Num blobs " << frame.keypoints.size();
 
-    // PLOGI << "blob detect time: " << t.dt_ms();
-    // t.reset();
+    frame.timings.detect_us = t.dt_us();
 
-    if(output_debug)
+    if(output_debug_images_)
     {
-        std::string debug_path = camera_data_.id == CAMERA_ID::SIDE ? 
-            cfg.lookup("vision_tracker.side.debug_output_path") :
-            cfg.lookup("vision_tracker.rear.debug_output_path");
-        cv::imwrite(debug_path + "img_raw.jpg", img_raw);
-        cv::imwrite(debug_path + "img_undistorted.jpg", img_undistorted);
-        cv::imwrite(debug_path + "img_thresh.jpg", img_thresh);
-
-        cv::Mat img_with_keypoints;
-        cv::drawKeypoints(img_thresh, keypoints, img_with_keypoints, cv::Scalar(0,0,255), cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
-        cv::imwrite(debug_path + "img_keypoints.jpg", img_with_keypoints);
-
-        cv::Mat img_with_best_keypoint = img_undistorted;
-        cv::Point2f best_keypoint = getBestKeypoint(keypoints);
-        cv::circle(img_with_best_keypoint, best_keypoint, 1, cv::Scalar(0,0,255), -1);
-        cv::circle(img_with_best_keypoint, best_keypoint, 10, cv::Scalar(0,0,255), 5);
-        Eigen::Vector2f best_point_m = cameraToRobot(best_keypoint);
-        std::string label_text = "Best:" + std::to_string(best_point_m[0]) +"m,"+ std::to_string(best_point_m[1]) + "m";
-        cv::putText(img_with_best_keypoint, //target image
-                    label_text, //text
-                    cv::Point(10, 20), //top-left position
-                    cv::FONT_HERSHEY_DUPLEX,
-                    0.5,
-                    CV_RGB(255,0,0), //font color
-                    1);
-        Eigen::Vector2f target_point_world;
-        if(camera_data_.id == CAMERA_ID::SIDE)
-        {
-            target_point_world << float(cfg.lookup("vision_tracker.physical.side.target_x")), float(cfg.lookup("vision_tracker.physical.side.target_y"));
-        }
-        else 
-        {
-            target_point_world << float(cfg.lookup("vision_tracker.physical.rear.target_x")), float(cfg.lookup("vision_tracker.physical.rear.target_y"));
-        }
-        Eigen::Vector2f target_point_camera = robotToCamera(target_point_world);
-        cv::Point2f pt{target_point_camera[0], target_point_camera[1]};
-        cv::circle(img_with_best_keypoint, pt, 5, cv::Scalar(255,0,0), -1);
-        std::string label_text2 = "Target:" + std::to_string(target_point_camera[0]) +"px, "+ std::to_string(target_point_camera[1]) + "px";
-        cv::putText(img_with_best_keypoint, //target image
-                    label_text2, //text
-                    cv::Point(10, 40), //top-left position
-                    cv::FONT_HERSHEY_DUPLEX,
-                    0.5,
-                    CV_RGB(0,0,255), //font color
-                    1);
-
-        cv::imwrite(debug_path + "img_best_keypoint.jpg", img_with_best_keypoint);
-        PLOGI.printf("Writing debug images %s",cameraIdToString(camera_data_.id).c_str());
+        writeDebugImages(frame);
     }
+}
 
-    // PLOGI << "debug time: " << t.dt_ms();
-    // t.reset();
+void CameraPipeline::writeDebugImages(const FrameData& frame)
+{
+    std::string debug_path = camera_data_.id == CAMERA_ID::SIDE ? 
+        cfg.lookup("vision_tracker.side.debug_output_path") :
+        cfg.lookup("vision_tracker.rear.debug_output_path");
+    cv::imwrite(debug_path + "img_raw.jpg", frame.raw);
+    cv::imwrite(debug_path + "img_undistorted.jpg", frame.undistorted);
+    cv::imwrite(debug_path + "img_thresh.jpg", frame.thresh);
+
+    cv::Mat img_with_keypoints;
+    cv::drawKeypoints(frame.thresh, frame.keypoints, img_with_keypoints, cv::Scalar(0,0,255), cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
+    // Label all keypoints with their ground position, converted in a single batch
+    Eigen::Matrix2Xf keypoints_px(2, frame.keypoints.size());
+    for(size_t i = 0; i < frame.keypoints.size(); i++)
+    {
+        keypoints_px.col(i) << frame.keypoints[i].pt.x, frame.keypoints[i].pt.y;
+    }
+    Eigen::Matrix2Xf keypoints_m = cameraToRobotBatch(keypoints_px);
+    for(size_t i = 0; i < frame.keypoints.size(); i++)
+    {
+        std::string keypoint_text = std::to_string(keypoints_m(0,i)) + "," + std::to_string(keypoints_m(1,i));
+        cv::putText(img_with_keypoints, keypoint_text, cv::Point(frame.keypoints[i].pt.x, frame.keypoints[i].pt.y), cv::FONT_HERSHEY_DUPLEX, 0.3, CV_RGB(255,0,0), 1);
+    }
+    cv::imwrite(debug_path + "img_keypoints.jpg", img_with_keypoints);
+
+    cv::Mat img_with_best_keypoint = frame.undistorted.clone();
+    cv::Point2f best_keypoint = getBestKeypoint(frame.keypoints);
+    cv::circle(img_with_best_keypoint, best_keypoint, 1, cv::Scalar(0,0,255), -1);
+    cv::circle(img_with_best_keypoint, best_keypoint, 10, cv::Scalar(0,0,255), 5);
+    Eigen::Vector2f best_point_m = cameraToRobot(best_keypoint);
+    std::string label_text = "Best:" + std::to_string(best_point_m[0]) +"m,"+ std::to_string(best_point_m[1]) + "m";
+    cv::putText(img_with_best_keypoint, //target image
+                label_text, //text
+                cv::Point(10, 20), //top-left position
+                cv::FONT_HERSHEY_DUPLEX,
+                0.5,
+                CV_RGB(255,0,0), //font color
+                1);
+    Eigen::Vector2f target_point_world;
+    if(camera_data_.id == CAMERA_ID::SIDE)
+    {
+        target_point_world << float(cfg.lookup("vision_tracker.physical.side.target_x")), float(cfg.lookup("vision_tracker.physical.side.target_y"));
+    }
+    else 
+    {
+        target_point_world << float(cfg.lookup("vision_tracker.physical.rear.target_x")), float(cfg.lookup("vision_tracker.physical.rear.target_y"));
+    }
+    Eigen::Vector2f target_point_camera = robotToCamera(target_point_world);
+    cv::Point2f pt{target_point_camera[0], target_point_camera[1]};
+    cv::circle(img_with_best_keypoint, pt, 5, cv::Scalar(255,0,0), -1);
+    std::string label_text2 = "Target:" + std::to_string(target_point_camera[0]) +"px, "+ std::to_string(target_point_camera[1]) + "px";
+    cv::putText(img_with_best_keypoint, //target image
+                label_text2, //text
+                cv::Point(10, 40), //top-left position
+                cv::FONT_HERSHEY_DUPLEX,
+                0.5,
+                CV_RGB(0,0,255), //font color
+                1);
+
+    cv::imwrite(debug_path + "img_best_keypoint.jpg", img_with_best_keypoint);
+    PLOGI.printf("Writing debug images %s",cameraIdToString(camera_data_.id).c_str());
+}
+
+void CameraPipeline::publishOutput(FrameData& frame)
+{
+    Eigen::Vector2f best_point_m = {0,0};
+    cv::Point2f best_point_px = {0,0};
+
+    // Do post-processing if the detection was successful
+    bool detected = !frame.keypoints.empty();
+    Timer t;
+    if(detected) 
+    {
+        best_point_px = getBestKeypoint(frame.keypoints);
+        best_point_m = cameraToRobot(best_point_px);
+    }
+    frame.timings.transform_us = t.dt_us();
 
-    return keypoints;
+    // Update output values in thread-safe manner
+    {
+        std::lock_guard<std::mutex> read_lock(data_mutex);
+        current_output_.ok = detected;
+        current_output_.timestamp = ClockFactory::getFactoryInstance()->get_clock()->now();
+        current_output_.point = best_point_m;
+        current_output_.uv = {best_point_px.x, best_point_px.y};
+        current_output_.latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>
+            (current_output_.timestamp - frame.capture_time).count();
+        current_output_.dropped_frames = dropped_frames_;
+        current_output_.frame_count = ++frame_count_;
+        current_output_.timings = frame.timings;
+    }
 }
 
 void CameraPipeline::start()
@@ -277,6 +378,17 @@ void CameraPipeline::start()
     {
         PLOGI.printf("Starting %s camera thread",cameraIdToString(camera_data_.id).c_str());
         thread_running_ = true;
+        if(use_staged_pipeline_)
+        {
+            stage_threads_.emplace_back(&CameraPipeline::captureStageLoop, this);
+            stage_threads_.emplace_back(&CameraPipeline::preprocessStageLoop, this);
+            stage_threads_.emplace_back(&CameraPipeline::detectStageLoop, this);
+            return;
+        }
+        if(!use_debug_image_ && !use_replay_)
+        {
+            capture_thread_ = std::thread(&CameraPipeline::captureThreadLoop, this);
+        }
         thread_ = std::thread(&CameraPipeline::threadLoop, this);
         // thread_.detach();
     }
@@ -288,7 +400,22 @@ void CameraPipeline::stop()
     {
         PLOGI.printf("Stopping %s camera thread",cameraIdToString(camera_data_.id).c_str());
         thread_running_ = false;
-        thread_.join();
+        frame_cv_.notify_all();
+        preprocess_queue_.wakeAll();
+        detect_queue_.wakeAll();
+        if(thread_.joinable())
+        {
+            thread_.join();
+        }
+        if(capture_thread_.joinable())
+        {
+            capture_thread_.join();
+        }
+        for(auto& t : stage_threads_)
+        {
+            t.join();
+        }
+        stage_threads_.clear();
     }
 }
 
@@ -300,48 +427,180 @@ void CameraPipeline::threadLoop()
     }
 }
 
-void CameraPipeline::oneLoop()
+void CameraPipeline::captureThreadLoop()
 {
-    Eigen::Vector2f best_point_m = {0,0};
-    cv::Point2f best_point_px = {0,0};
-    bool detected = false;
-    try
+    while(thread_running_)
     {
-
-        // Get latest frame
+        // Read continuously so the driver queue never backs up with stale frames
         cv::Mat frame;
-        if (use_debug_image_) frame = camera_data_.debug_frame;
-        else camera_data_.capture >> frame;
+        bool ok = false;
+        try
+        {
+            ok = camera_data_.capture.read(frame) && !frame.empty();
+        }
+        catch (cv::Exception& e)
+        {
+            PLOGW << "Caught cv::Exception during capture: " << e.what();
+        }
+        if(!ok)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        ClockTimePoint capture_time = ClockFactory::getFactoryInstance()->get_clock()->now();
 
-        // Perform keypoint detection
-        std::vector<cv::KeyPoint> keypoints = allKeypointsInImage(frame, output_debug_images_);
+        // Overwrite the slot with the newest frame, counting the old one as dropped if it was never used
+        {
+            std::lock_guard<std::mutex> lock(frame_mutex_);
+            if(new_frame_ready_) dropped_frames_++;
+            latest_frame_ = frame;
+            latest_frame_time_ = capture_time;
+            new_frame_ready_ = true;
+        }
+        frame_cv_.notify_one();
+    }
+}
 
-        // Do post-processing if the detection was successful
-        detected = !keypoints.empty();
-        if(detected) 
+void CameraPipeline::captureStageLoop()
+{
+    setCurrentThreadAffinity(capture_core_);
+    while(thread_running_)
+    {
+        FrameData frame;
+        bool ok = false;
+        try
+        {
+            ok = getLatestFrame(frame.raw, frame.capture_time);
+        }
+        catch (cv::Exception& e)
         {
-            best_point_px = getBestKeypoint(keypoints);
-            best_point_m = cameraToRobot(best_point_px);
+            PLOGW << "Caught cv::Exception during capture: " << e.what();
+        }
+        if(!ok)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
 
+        pushToStage(preprocess_queue_, std::move(frame));
+    }
+}
+
+void CameraPipeline::preprocessStageLoop()
+{
+    setCurrentThreadAffinity(preprocess_core_);
+    while(thread_running_)
+    {
+        FrameData frame;
+        if(!preprocess_queue_.waitPop(frame, thread_running_)) continue;
+        try
+        {
+            preprocessFrame(frame);
+        }
+        catch (cv::Exception& e)
+        {
+            PLOGW << "Caught cv::Exception: " << e.what();
+            publishOutput(frame);
+            continue;
         }
+        pushToStage(detect_queue_, std::move(frame));
     }
-    catch (cv::Exception& e)
+}
+
+void CameraPipeline::detectStageLoop()
+{
+    setCurrentThreadAffinity(detect_core_);
+    while(thread_running_)
     {
-        PLOGW << "Caught cv::Exception: " << e.what();
-        detected = false;
-        best_point_m = {0,0};
-        best_point_px = {0,0};
+        FrameData frame;
+        if(!detect_queue_.waitPop(frame, thread_running_)) continue;
+        try
+        {
+            detectKeypoints(frame);
+        }
+        catch (cv::Exception& e)
+        {
+            PLOGW << "Caught cv::Exception: " << e.what();
+            frame.keypoints.clear();
+        }
+        publishOutput(frame);
     }
-    
+}
 
-    // Update output values in thread-safe manner
+void CameraPipeline::pushToStage(SpscQueue<FrameData>& queue, FrameData&& frame)
+{
+    // Replays are processed frame by frame as fast as possible, so wait for the next stage. Otherwise drop the frame
+    // rather than block if the next stage is behind so latency stays bounded.
+    bool pushed = use_replay_ ? queue.waitPush(std::move(frame), thread_running_) : queue.push(std::move(frame));
+    if(!pushed && thread_running_) dropped_frames_++;
+}
+
+bool CameraPipeline::getLatestFrame(cv::Mat& frame, ClockTimePoint& capture_time)
+{
+    if(use_debug_image_)
     {
-        std::lock_guard<std::mutex> read_lock(data_mutex);
-        current_output_.ok = detected;
-        current_output_.timestamp = ClockFactory::getFactoryInstance()->get_clock()->now();
-        current_output_.point = best_point_m;
-        current_output_.uv = {best_point_px.x, best_point_px.y};
+        frame = camera_data_.debug_frame;
+        capture_time = ClockFactory::getFactoryInstance()->get_clock()->now();
+        return true;
+    }
+
+    // Replay frames are consumed in order as fast as they can be processed
+    if(use_replay_)
+    {
+        if(camera_data_.replay_files.empty()) 
+        {
+            camera_data_.capture >> frame;
+        }
+        else if(camera_data_.replay_idx < camera_data_.replay_files.size())
+        {
+            frame = cv::imread(camera_data_.replay_files[camera_data_.replay_idx++], cv::IMREAD_GRAYSCALE);
+        }
+        capture_time = ClockFactory::getFactoryInstance()->get_clock()->now();
+        replay_finished_ = frame.empty();
+        return !replay_finished_;
     }
+
+    // Without a capture thread (i.e. oneLoop called directly) just read synchronously
+    if(!capture_thread_.joinable())
+    {
+        camera_data_.capture >> frame;
+        capture_time = ClockFactory::getFactoryInstance()->get_clock()->now();
+        return !frame.empty();
+    }
+
+    std::unique_lock<std::mutex> lock(frame_mutex_);
+    frame_cv_.wait_for(lock, std::chrono::milliseconds(frame_wait_timeout_ms), 
+        [this]{ return new_frame_ready_ || !thread_running_; });
+    if(!new_frame_ready_)
+    {
+        return false;
+    }
+    frame = latest_frame_;
+    capture_time = latest_frame_time_;
+    new_frame_ready_ = false;
+    return true;
+}
+
+void CameraPipeline::oneLoop()
+{
+    FrameData frame;
+    frame.capture_time = ClockFactory::getFactoryInstance()->get_clock()->now();
+    try
+    {
+        // Get latest frame
+        if(!getLatestFrame(frame.raw, frame.capture_time)) return;
+
+        // Perform keypoint detection
+        preprocessFrame(frame);
+        detectKeypoints(frame);
+    }
+    catch (cv::Exception& e)
+    {
+        PLOGW << "Caught cv::Exception: " << e.what();
+        frame.keypoints.clear();
+    }
+
+    publishOutput(frame);
 }
 
 CameraPipelineOutput CameraPipeline::getData()
@@ -354,43 +613,22 @@ CameraPipelineOutput CameraPipeline::getData()
 
 Eigen::Vector2f CameraPipeline::cameraToRobot(cv::Point2f cameraPt)
 {
-    Eigen::Vector3f uv_point = {cameraPt.x, cameraPt.y, 1};
-
-    // Compute scaling factor for Z=0
-    Eigen::Vector3f tmp1 = camera_data_.R_inv * camera_data_.K_inv * uv_point;
-    Eigen::Vector3f tmp2 = camera_data_.R_inv * camera_data_.t;
-    float s = tmp2(2,0) / tmp1(2,0);
-
-    // Debug
-    Eigen::Vector3f scaled_cam_frame = s * camera_data_.K_inv * uv_point;
-    Eigen::Vector3f cam_frame_offset = scaled_cam_frame  - camera_data_.t;
-
-    // Convert to world coordinate
-    Eigen::Vector3f world_point = camera_data_.R_inv * cam_frame_offset;
-    // PLOGI << cameraIdToString(id);
-    // PLOGI << "uv_point: " << uv_point.transpose();
-    // PLOGI << "scaled_cam_frame: " << scaled_cam_frame.transpose();
-    // PLOGI << "cam_frame_offset: " << cam_frame_offset.transpose();
-    // PLOGI << "world_point: " << world_point.transpose();
-
-
-    if(fabs(world_point(2)) > 1e-3) PLOGE.printf("Z value %f is not near zero", world_point(2));
-
-    return {world_point(0),world_point(1)};
+    Eigen::Vector3f world_point = camera_data_.H_inv * Eigen::Vector3f(cameraPt.x, cameraPt.y, 1);
+    return world_point.hnormalized();
 }
 
 Eigen::Vector2f CameraPipeline::robotToCamera(Eigen::Vector2f robotPt)
 {
-    Eigen::Vector4f robot_point_3d = {robotPt[0], robotPt[1], 0, 1};
-    Eigen::MatrixXf r_t(3,4);
-    r_t << camera_data_.R, camera_data_.t;
+    Eigen::Vector3f camera_pt_scaled = camera_data_.H * robotPt.homogeneous();
+    return camera_pt_scaled.hnormalized();
+}
 
-    Eigen::Matrix3f K_tmp;
-    // Hack to get around problems with enabling eigen support in opencv
-    K_tmp << camera_data_.K.at<double>(0,0), camera_data_.K.at<double>(0,1), camera_data_.K.at<double>(0,2),
-           camera_data_.K.at<double>(1,0), camera_data_.K.at<double>(1,1), camera_data_.K.at<double>(1,2),
-           camera_data_.K.at<double>(2,0), camera_data_.K.at<double>(2,1), camera_data_.K.at<double>(2,2);
+Eigen::Matrix2Xf CameraPipeline::cameraToRobotBatch(const Eigen::Matrix2Xf& cameraPts)
+{
+    return (camera_data_.H_inv * cameraPts.colwise().homogeneous()).colwise().hnormalized();
+}
 
-    Eigen::Vector3f camera_pt_scaled = K_tmp * r_t * robot_point_3d;
-    return {camera_pt_scaled[0]/camera_pt_scaled[2], camera_pt_scaled[1]/camera_pt_scaled[2]};
+Eigen::Matrix2Xf CameraPipeline::robotToCameraBatch(const Eigen::Matrix2Xf& robotPts)
+{
+    return (camera_data_.H * robotPts.colwise().homogeneous()).colwise().hnormalized();
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include <Eigen/Dense>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 enum class CAMERA_ID
 {
@@ -13,12 +15,25 @@ enum class CAMERA_ID
     SIDE
 };
 
+// Time spent in each processing stage for the most recent frame
+struct CameraPipelineTimings
+{
+  int undistort_us = 0;
+  int threshold_us = 0;
+  int detect_us = 0;
+  int transform_us = 0;
+};
+
 struct CameraPipelineOutput
 {
   bool ok = false;
   ClockTimePoint timestamp = ClockFactory::getFactoryInstance()->get_clock()->now();
   Eigen::Vector2f point = {0,0};
   Eigen::Vector2f uv = {0,0};
+  int latency_ms = 0;
+  int dropped_frames = 0;
+  int frame_count = 0;      // Frames processed since the pipeline was created
+  CameraPipelineTimings timings;
 };
 
 class CameraPipeline 
@@ -39,9 +54,17 @@ class CameraPipeline
 
     void toggleDebugImageOutput() {output_debug_images_ = !output_debug_images_;};
 
+    // True once all frames from the replay source have been processed
+    bool replayFinished() {return replay_finished_;};
+
     Eigen::Vector2f cameraToRobot(cv::Point2f cameraPt);
 
     Eigen::Vector2f robotToCamera(Eigen::Vector2f robotPt);
+
+    // Batched versions of the above, one point per column
+    Eigen::Matrix2Xf cameraToRobotBatch(const Eigen::Matrix2Xf& cameraPts);
+
+    Eigen::Matrix2Xf robotToCameraBatch(const Eigen::Matrix2Xf& robotPts);
   
   private:
 
@@ -50,30 +73,88 @@ class CameraPipeline
       CAMERA_ID id;
       cv::VideoCapture capture;
       cv::Mat K;
-      Eigen::Matrix3f K_inv;
       cv::Mat D;
       Eigen::Matrix3f R;
-      Eigen::Matrix3f R_inv;
       Eigen::Vector3f t;
+      Eigen::Matrix3f H;      // Ground plane (Z=0) to image homography
+      Eigen::Matrix3f H_inv;  // Image to ground plane homography
       cv::Mat debug_frame;
       std::string debug_output_path;
+      std::vector<std::string> replay_files;
+      size_t replay_idx;
+    };
+
+    // Intermediate results for one frame as it moves through the processing stages
+    struct FrameData
+    {
+      cv::Mat raw;
+      cv::Mat undistorted;
+      cv::Mat thresh;
+      std::vector<cv::KeyPoint> keypoints;
+      ClockTimePoint capture_time;
+      CameraPipelineTimings timings;
     };
 
     void threadLoop();
 
+    void captureThreadLoop();
+
+    // Staged pipeline threads: capture -> preprocess -> detect and transform
+    void captureStageLoop();
+
+    void preprocessStageLoop();
+
+    void detectStageLoop();
+
+    // Hands a frame to the next stage of the staged pipeline
+    void pushToStage(SpscQueue<FrameData>& queue, FrameData&& frame);
+
+    bool getLatestFrame(cv::Mat& frame, ClockTimePoint& capture_time);
+
     std::string cameraIdToString(CAMERA_ID id);
     
     void initCamera(CAMERA_ID id);
 
-    std::vector<cv::KeyPoint> allKeypointsInImage(cv::Mat img_raw, bool output_debug);
+    // Undistort and threshold
+    void preprocessFrame(FrameData& frame);
+
+    // Blob detection on the thresholded image
+    void detectKeypoints(FrameData& frame);
+
+    // Pick the best keypoint, transform it to robot coordinates and make it available via getData
+    void publishOutput(FrameData& frame);
+
+    void writeDebugImages(const FrameData& frame);
 
     CameraData camera_data_;
     bool use_debug_image_;
+    bool use_replay_;
+    std::atomic<bool> replay_finished_;
     std::atomic<bool> output_debug_images_;
     std::atomic<bool> thread_running_;
     std::thread thread_;
     CameraPipelineOutput current_output_;
 
+    // Latest frame slot filled by the capture thread. Frames that are overwritten
+    // before the processing thread picks them up are counted as dropped.
+    std::thread capture_thread_;
+    std::mutex frame_mutex_;
+    std::condition_variable frame_cv_;
+    cv::Mat latest_frame_;
+    ClockTimePoint latest_frame_time_;
+    bool new_frame_ready_;
+    std::atomic<int> dropped_frames_;
+
+    // Optional staged pipeline with a thread per stage connected by bounded queues
+    bool use_staged_pipeline_;
+    std::vector<std::thread> stage_threads_;
+    SpscQueue<FrameData> preprocess_queue_;
+    SpscQueue<FrameData> detect_queue_;
+    int capture_core_;
+    int preprocess_core_;
+    int detect_core_;
+    int frame_count_;
+
     // Params read from config
     cv::SimpleBlobDetector::Params blob_params_;
     cv::Ptr<cv::SimpleBlobDetector> blob_detector_;
@@ -22,6 +22,11 @@ CameraTracker::CameraTracker(bool start_thread)
                             cfg.lookup("vision_tracker.physical.side.target_y")};
     robot_P_rear_target_ = {cfg.lookup("vision_tracker.physical.rear.target_x"), 
                             cfg.lookup("vision_tracker.physical.rear.target_y")};
+
+    // Pose fit params
+    side_target_weight_ = cfg.lookup("vision_tracker.pose_fit.side_weight");
+    rear_target_weight_ = cfg.lookup("vision_tracker.pose_fit.rear_weight");
+    max_pose_residual_ = cfg.lookup("vision_tracker.pose_fit.max_residual");
 }
 
 CameraTracker::~CameraTracker() {}
@@ -33,6 +38,8 @@ void CameraTracker::update()
     output_.raw_detection = side_output.ok && rear_output.ok;
     debug_.side_ok = side_cam_ok_filter_.update(side_output.ok);
     debug_.rear_ok = rear_cam_ok_filter_.update(rear_output.ok);
+    debug_.side_dropped_frames = side_output.dropped_frames;
+    debug_.rear_dropped_frames = rear_output.dropped_frames;
     bool new_output_pose_ready = false;
 
     if(rear_output.ok)
@@ -44,7 +51,20 @@ void CameraTracker::update()
         last_side_cam_output_ = side_output;
     }
 
-    if(last_side_cam_output_.ok && last_rear_cam_output_.ok) new_output_pose_ready = true;
+    RigidPoseFit fit;
+    if(last_side_cam_output_.ok && last_rear_cam_output_.ok)
+    {
+        // Reject geometrically inconsistent detections before they reach the vision filter
+        fit = fitRobotPoseFromImagePoints(last_side_cam_output_.point, last_rear_cam_output_.point);
+        debug_.pose_residual = fit.residual;
+        new_output_pose_ready = fit.ok && fit.residual <= max_pose_residual_;
+        if(!new_output_pose_ready)
+        {
+            PLOGW.printf("Rejecting camera pose fit with residual %.4f m", fit.residual);
+            last_rear_cam_output_.ok = false;
+            last_side_cam_output_.ok = false;
+        }
+    }
 
     // int time_delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>
     //     (last_side_cam_output_.timestamp - last_rear_cam_output_.timestamp).count();
@@ -59,7 +79,7 @@ void CameraTracker::update()
     if(!new_output_pose_ready) return;
 
     // Populate output
-    output_.pose = computeRobotPoseFromImagePoints(last_side_cam_output_.point, last_rear_cam_output_.point);
+    output_.pose = fit.pose;
     output_.timestamp = ClockFactory::getFactoryInstance()->get_clock()->now();
     camera_loop_time_averager_.mark_point();
 
@@ -76,6 +96,8 @@ void CameraTracker::update()
     debug_.pose_y = output_.pose.y;
     debug_.pose_a = output_.pose.a;
     debug_.loop_ms = camera_loop_time_averager_.get_ms();
+    debug_.side_latency_ms = last_side_cam_output_.latency_ms;
+    debug_.rear_latency_ms = last_rear_cam_output_.latency_ms;
 
     // Mark camera output values as not okay to make sure they are only used once
     last_rear_cam_output_.ok = false;
@@ -115,23 +137,13 @@ void CameraTracker::toggleDebugImageOutput()
 
 Point CameraTracker::computeRobotPoseFromImagePoints(Eigen::Vector2f p_side, Eigen::Vector2f p_rear)
 {  
-    // Solve linear equations to get pose values
-    Eigen::Matrix4f A;
-    Eigen::Vector4f b;
-    A << 1, 0, -p_rear[1], p_rear[0],
-         0, 1,  p_rear[0], p_rear[1],
-         1, 0, -p_side[1], p_side[0],
-         0, 1,  p_side[0], p_side[1];
-    b << robot_P_rear_target_[0],
-         robot_P_rear_target_[1],
-         robot_P_side_target_[0],
-         robot_P_side_target_[1];
-    Eigen::Vector4f x = A.colPivHouseholderQr().solve(b);
-    
-    // Populate pose with angle averaging
-    float pose_x = x[0];
-    float pose_y = x[1];
-    float pose_a = atan2(x[2], x[3]);
-    return {pose_x, pose_y, pose_a};
+    return fitRobotPoseFromImagePoints(p_side, p_rear).pose;
+}
+
+RigidPoseFit CameraTracker::fitRobotPoseFromImagePoints(Eigen::Vector2f p_side, Eigen::Vector2f p_rear)
+{
+    return fitRigidPose2D({p_side, p_rear}, 
+                          {robot_P_side_target_, robot_P_rear_target_},
+                          {side_target_weight_, rear_target_weight_});
 }
 
@@ -5,6 +5,7 @@
 #include "utils.h"
 #include <Eigen/Dense>
 #include "CameraPipeline.h"
+#include "PoseSolver.h"
 
 class CameraTracker : public CameraTrackerBase
 {
@@ -31,6 +32,8 @@ class CameraTracker : public CameraTrackerBase
 
     Point computeRobotPoseFromImagePoints(Eigen::Vector2f p_side, Eigen::Vector2f p_rear);
 
+    RigidPoseFit fitRobotPoseFromImagePoints(Eigen::Vector2f p_side, Eigen::Vector2f p_rear);
+
     void oneLoop();
 
   private:
@@ -42,6 +45,9 @@ class CameraTracker : public CameraTrackerBase
     CameraTrackerOutput output_;
     Eigen::Vector2f robot_P_side_target_;
     Eigen::Vector2f robot_P_rear_target_;
+    float side_target_weight_;
+    float rear_target_weight_;
+    float max_pose_residual_;
     CameraPipelineOutput last_rear_cam_output_;
     CameraPipelineOutput last_side_cam_output_;
     LatchedBool side_cam_ok_filter_;
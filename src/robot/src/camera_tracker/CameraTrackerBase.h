@@ -9,6 +9,12 @@ struct CameraTrackerOutput
   bool ok;
   ClockTimePoint timestamp;
   bool raw_detection;
+
+  bool operator== (const CameraTrackerOutput& other) const
+  {
+    return pose.x == other.pose.x && pose.y == other.pose.y && pose.a == other.pose.a &&
+           ok == other.ok && timestamp == other.timestamp && raw_detection == other.raw_detection;
+  }
 };
 
 class CameraTrackerBase
@@ -1,6 +1,7 @@
 #include "CameraTrackerFactory.h"
 #include "CameraTracker.h"
 #include "CameraTrackerMock.h"
+#include "CameraTrackerSim.h"
 
 #include <plog/Log.h> 
 
@@ -18,6 +19,11 @@ CameraTrackerFactory* CameraTrackerFactory::getFactoryInstance()
 
 void CameraTrackerFactory::set_mode(CAMERA_TRACKER_FACTORY_MODE mode)
 {
+    // Anything already built was built for the old mode
+    if(mode != mode_)
+    {
+        camera_tracker_.reset();
+    }
     mode_ = mode;
 }
 
@@ -44,6 +50,11 @@ void CameraTrackerFactory::build_camera_tracker()
         camera_tracker_ = std::make_unique<CameraTrackerMock>();
         PLOGI << "Built CameraTrackerMock";
     }
+    else if (mode_ == CAMERA_TRACKER_FACTORY_MODE::SIM)
+    {
+        camera_tracker_ = std::make_unique<CameraTrackerSim>();
+        PLOGI << "Built CameraTrackerSim";
+    }
 }
 
 
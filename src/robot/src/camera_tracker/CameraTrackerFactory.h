@@ -10,6 +10,7 @@ enum class CAMERA_TRACKER_FACTORY_MODE
 {
   STANDARD,
   MOCK,
+  SIM,
 };
 
 class CameraTrackerFactory
@@ -19,6 +20,7 @@ class CameraTrackerFactory
 
     static CameraTrackerFactory* getFactoryInstance();
 
+    // Switching modes drops anything built in the old mode, so it gets built again in the new one
     void set_mode(CAMERA_TRACKER_FACTORY_MODE mode);
 
     CameraTrackerBase* get_camera_tracker();
@@ -0,0 +1,38 @@
+#ifndef CameraTrackerSim_h
+#define CameraTrackerSim_h
+
+#include "utils.h"
+#include "CameraTrackerBase.h"
+#include "sim/SimRobotPlant.h"
+
+// Camera tracker for simulation mode, reports the simulated robot pose relative to the vision target
+class CameraTrackerSim : public CameraTrackerBase
+{
+  public:
+
+    virtual void start() override { running_ = true; };
+
+    virtual void stop() override { running_ = false; };
+
+    virtual void update() override {};
+
+    virtual bool running() override { return running_; };
+
+    virtual void toggleDebugImageOutput() override {};
+
+    virtual CameraTrackerOutput getPoseFromCamera() override 
+    { 
+        CameraTrackerOutput output = SimRobotPlant::getInstance()->getCameraReading();
+        output.ok = output.ok && running_;
+        return output;
+    };
+
+    virtual CameraDebug getCameraDebug() override { return CameraDebug(); }; 
+
+  private:
+
+    bool running_ = false;
+};
+
+
+#endif //CameraTrackerSim_h
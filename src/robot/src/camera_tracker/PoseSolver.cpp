@@ -0,0 +1,63 @@
+#include "PoseSolver.h"
+
+RigidPoseFit fitRigidPose2D(const std::vector<Eigen::Vector2f>& points, 
+                            const std::vector<Eigen::Vector2f>& targets,
+                            const std::vector<float>& weights)
+{
+    RigidPoseFit fit;
+    const size_t n = points.size();
+    if(n < 2 || targets.size() != n || weights.size() != n)
+    {
+        return fit;
+    }
+
+    // Weighted centroids
+    float weight_sum = 0;
+    Eigen::Vector2f points_mean = {0,0};
+    Eigen::Vector2f targets_mean = {0,0};
+    for(size_t i = 0; i < n; i++)
+    {
+        weight_sum += weights[i];
+        points_mean += weights[i] * points[i];
+        targets_mean += weights[i] * targets[i];
+    }
+    if(weight_sum <= 0)
+    {
+        return fit;
+    }
+    points_mean /= weight_sum;
+    targets_mean /= weight_sum;
+
+    // The optimal rotation angle comes straight from the weighted dot and cross products
+    // of the centered point sets (2D Procrustes), so no matrix decomposition is needed.
+    float sum_dot = 0;
+    float sum_cross = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        Eigen::Vector2f p = points[i] - points_mean;
+        Eigen::Vector2f q = targets[i] - targets_mean;
+        sum_dot += weights[i] * (p[0] * q[0] + p[1] * q[1]);
+        sum_cross += weights[i] * (p[0] * q[1] - p[1] * q[0]);
+    }
+    if(fabs(sum_dot) < 1e-9 && fabs(sum_cross) < 1e-9)
+    {
+        return fit;
+    }
+    float a = atan2(sum_cross, sum_dot);
+    Eigen::Matrix2f R;
+    R << cos(a), -sin(a),
+         sin(a),  cos(a);
+    Eigen::Vector2f t = targets_mean - R * points_mean;
+
+    // Weighted RMS residual
+    float err_sum = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        err_sum += weights[i] * (R * points[i] + t - targets[i]).squaredNorm();
+    }
+
+    fit.pose = {t[0], t[1], a};
+    fit.residual = sqrt(err_sum / weight_sum);
+    fit.ok = true;
+    return fit;
+}
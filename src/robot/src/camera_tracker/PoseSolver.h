@@ -0,0 +1,21 @@
+#ifndef PoseSolver_h
+#define PoseSolver_h
+
+#include "utils.h"
+#include <Eigen/Dense>
+#include <vector>
+
+struct RigidPoseFit
+{
+    Point pose;           // Transform that maps the measured points onto the target points
+    float residual = 0;   // Weighted RMS distance (meters) between the transformed points and targets
+    bool ok = false;      // False if the inputs were invalid or degenerate
+};
+
+// Closed-form weighted least squares fit of a 2D rigid transform (x, y, a) such that
+// target_i ~= [x,y] + R(a) * point_i. Works for any N >= 2 correspondences.
+RigidPoseFit fitRigidPose2D(const std::vector<Eigen::Vector2f>& points, 
+                            const std::vector<Eigen::Vector2f>& targets,
+                            const std::vector<float>& weights);
+
+#endif //PoseSolver_h
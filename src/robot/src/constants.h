@@ -20,7 +20,6 @@ extern libconfig::Config cfg;
 // Log file ID for motion specific stuff
 #define MOTION_LOG_ID 2
 #define LOCALIZATION_LOG_ID 3
-#define MOTION_CSV_LOG_ID 4
 
 // Commands use to communicate about behavior specified from master
 enum class COMMAND
@@ -45,6 +44,27 @@ enum class COMMAND
     STOP_CAMERAS,
     MOVE_REL_SLOW,
     MOVE_FINE_STOP_VISION,
+    SEQUENCE,
+    ABORT_SEQUENCE,
+    SET_SPEED_OVERRIDE,
+    JOG,
+};
+
+// Commands in different lanes drive independent axes, so they can run at the same time.
+// A new command is only held off by the command running in its own lane.
+enum class LANE
+{
+    NONE,   // Handled right away without occupying a lane
+    BASE,
+    TRAY,
+};
+
+// Extra condition a sequence step waits for before it starts
+enum class SEQUENCE_CONDITION
+{
+    NONE,
+    LOCALIZED,  // Localization confidence above localization.confidence_for_wait
+    VISION_OK,  // Camera tracker has a good pose
 };
 
 #endif
@@ -2,15 +2,17 @@
 #include <plog/Init.h>
 #include <plog/Formatters/TxtFormatter.h>
 #include <plog/Formatters/MessageOnlyFormatter.h>
-#include <plog/Appenders/ColorConsoleAppender.h>
-#include <plog/Appenders/RollingFileAppender.h>
 #include <chrono>
+#include <csignal>
 #include <iostream>
 
 #include "robot.h"
+#include "AsyncLogAppender.h"
+#include "LoopProfiler.h"
 #include "constants.h"
 #include "sockets/SocketMultiThreadWrapperFactory.h"
 #include "camera_tracker/CameraTrackerFactory.h"
+#include "serial/SerialCommsFactory.h"
 
 libconfig::Config cfg = libconfig::Config();
 
@@ -26,19 +28,20 @@ void configure_logger()
     std::string motion_log_file_name = std::string("log/motion_log_") + std::string(datetime_str) + std::string(".txt");
     std::string localization_log_file_name = std::string("log/localization_log_") + std::string(datetime_str) + std::string(".txt");
 
-    // Initialize robot logs to to go file and console
+    // Initialize robot logs to to go file and console. All appenders hand their records
+    // to a background writer thread so the control loop never waits on I/O.
     std::string log_level = cfg.lookup("log_level");
     plog::Severity severity = plog::severityFromString(log_level.c_str());
-    static plog::RollingFileAppender<plog::TxtFormatter> fileAppender(robot_log_file_name.c_str(), 1000000, 5);
-    static plog::ColorConsoleAppender<plog::TxtFormatter> consoleAppender;
+    static AsyncAppender<plog::TxtFormatter> fileAppender(robot_log_file_name.c_str(), 1000000, 5);
+    static AsyncAppender<plog::TxtFormatter> consoleAppender("");
     plog::init(severity, &fileAppender).addAppender(&consoleAppender); 
 
     // Initialize motion logs to go to file
-    static plog::RollingFileAppender<plog::TxtFormatter> motionFileAppender(motion_log_file_name.c_str(), 1000000, 5);
+    static AsyncAppender<plog::TxtFormatter> motionFileAppender(motion_log_file_name.c_str(), 1000000, 5);
     plog::init<MOTION_LOG_ID>(plog::debug, &motionFileAppender);
 
     // Initialize localization logs to go to file
-    static plog::RollingFileAppender<plog::TxtFormatter> localizationFileAppender(localization_log_file_name.c_str(), 1000000, 5);
+    static AsyncAppender<plog::TxtFormatter> localizationFileAppender(localization_log_file_name.c_str(), 1000000, 5);
     plog::init<LOCALIZATION_LOG_ID>(plog::debug, &localizationFileAppender);
 
     PLOGI << "Logger ready";
@@ -59,6 +62,47 @@ void setup_mock_socket()
     }
 }
 
+// Replaces the clearcore, marvelmind and cameras with simulated models. Runs on the mock clock,
+// which is advanced a fixed step every robot loop so the simulation runs as fast as the loop can.
+void run_simulation()
+{
+    PLOGW << "Running in simulation mode";
+    ClockFactory::getFactoryInstance()->set_mode(CLOCK_FACTORY_MODE::MOCK);
+    SerialCommsFactory::getFactoryInstance()->set_mode(SERIAL_FACTORY_MODE::SIM);
+    CameraTrackerFactory::getFactoryInstance()->set_mode(CAMERA_TRACKER_FACTORY_MODE::SIM);
+    MockClockWrapper* mock_clock = dynamic_cast<MockClockWrapper*>(ClockFactory::getFactoryInstance()->get_clock());
+    mock_clock->set_now();
+    int step_us = cfg.lookup("simulation.step_us");
+
+    Robot r;
+    while(!Robot::stopRequested())
+    {
+        r.runOnce();
+        mock_clock->advance_us(step_us);
+    }
+}
+
+void handle_stop_signal(int)
+{
+    Robot::requestStop();
+}
+
+// Writes the loop stage timing out once the robot loop has stopped. Goes to stdout as well since
+// the log writer thread may not get to flush before exit.
+void dump_loop_timing()
+{
+    if(!cfg.lookup("perf.enabled") || !cfg.lookup("perf.dump_on_exit"))
+    {
+        return;
+    }
+    std::string path = cfg.lookup("perf.dump_path");
+    if(LoopProfiler::getInstance()->dump(path))
+    {
+        std::cout << "Loop timing written to " << path << std::endl;
+    }
+    std::cout << LoopProfiler::getInstance()->getJsonString() << std::endl;
+}
+
 void capture_images()
 {
     // Modify config values to ensure they are set to log debug images
@@ -95,9 +139,19 @@ int main(int argc, char** argv)
         else 
         {
             setup_mock_socket();
-
-            Robot r;
-            r.run(); //Should loop forver until stopped
+            std::signal(SIGINT, handle_stop_signal);
+            std::signal(SIGTERM, handle_stop_signal);
+
+            if(cfg.lookup("simulation.enabled"))
+            {
+                run_simulation();
+            }
+            else
+            {
+                Robot r;
+                r.run(); //Loops until stopped with ctrl-c
+            }
+            dump_loop_timing();
         }
 
     }
@@ -1,12 +1,13 @@
 #include "robot.h"
 
 #include <plog/Log.h> 
+#include "LoopProfiler.h"
 #include "utils.h"
 #include "camera_tracker/CameraTrackerFactory.h"
 
 
-WaitForLocalizeHelper::WaitForLocalizeHelper(const StatusUpdater& statusUpdater, float max_timeout, float confidence_threshold) 
-: statusUpdater_(statusUpdater),
+WaitForLocalizeHelper::WaitForLocalizeHelper(const StateBus& bus, float max_timeout, float confidence_threshold) 
+: localization_(bus.localization),
     timer_(),
     max_timeout_(max_timeout),
     confidence_threshold_(confidence_threshold)
@@ -19,7 +20,7 @@ bool WaitForLocalizeHelper::isDone()
         PLOGW.printf("Exiting wait for localize due to time");
         return true;
     }
-    float confidence = statusUpdater_.getLocalizationConfidence();
+    float confidence = localization_.get().total_confidence;
     if(confidence > confidence_threshold_)
     {
         PLOGI.printf("Exiting wait for localize with confidence: %4.2f", confidence);
@@ -43,21 +44,32 @@ Robot::Robot()
   mm_wrapper_(),
   position_time_averager_(10),
   robot_loop_time_averager_(20),
-  wait_for_localize_helper_(statusUpdater_, cfg.lookup("localization.max_wait_time"), cfg.lookup("localization.confidence_for_wait")),
+  wait_for_localize_helper_(statusUpdater_.getStateBus(), cfg.lookup("localization.max_wait_time"), cfg.lookup("localization.confidence_for_wait")),
+  sequencer_(statusUpdater_.getStateBus(), cfg.lookup("localization.confidence_for_wait")),
+  planned_step_(-1),
   vision_print_rate_(10),
   camera_tracker_(CameraTrackerFactory::getFactoryInstance()->get_camera_tracker()),
   camera_motion_start_time_(ClockTimePoint::min()),
-  camera_trigger_time_1_(ClockTimePoint::min()),
-  camera_trigger_time_2_(ClockTimePoint::min()),
   camera_stop_triggered_(false),
-  curCmd_(COMMAND::NONE)
+  fine_move_target_(),
+  camera_stop_check_timer_(),
+  camera_stop_dir_(0,0),
+  camera_stop_result_(),
+  camera_stop_result_pending_(false),
+  camera_stop_rest_time_(ClockTimePoint::min()),
+  base_cmd_(COMMAND::NONE),
+  tray_cmd_(COMMAND::NONE)
 {
     PLOGI.printf("Robot starting");
 }
 
+std::atomic<bool> Robot::stop_requested_(false);
+
 void Robot::run()
 {
-    while(true)
+    // Keep the control loop on its own core, away from the camera pipeline threads
+    setCurrentThreadAffinity(cfg.lookup("control_thread_core"));
+    while(!stopRequested())
     {
         runOnce();
     }
@@ -66,46 +78,81 @@ void Robot::run()
 
 void Robot::runOnce() 
 {
+    ScopedStageTimer loop_timer(LOOP_STAGE::LOOP);
+
     // Check for new command and try to start it
-    COMMAND newCmd = server_.oneLoop();
-    bool status = tryStartNewCmd(newCmd);
+    COMMAND newCmd;
+    {
+        ScopedStageTimer t(LOOP_STAGE::SOCKET);
+        newCmd = server_.oneLoop();
+    }
+    bool status;
+    {
+        ScopedStageTimer t(LOOP_STAGE::COMMAND);
+        status = tryStartNewCmd(newCmd);
+    }
 
-    // Update our current command if we successfully started a new command
+    // Update the current command of its lane if we successfully started a new command
     if(status)
     {
-        curCmd_ = newCmd;
-        statusUpdater_.updateInProgress(true);
+        setLaneCommand(laneForCommand(newCmd), newCmd);
     }
 
     // Service marvelmind
-    std::vector<float> positions = mm_wrapper_.getPositions();
-    if (positions.size() == 3)
     {
-        position_time_averager_.mark_point();
-        float angle_rad = wrap_angle(positions[2] * M_PI / 180.0);
-        controller_.inputPosition(positions[0], positions[1], angle_rad);
+        ScopedStageTimer t(LOOP_STAGE::MARVELMIND);
+        std::vector<float> positions = mm_wrapper_.getPositions();
+        if (positions.size() == 3)
+        {
+            position_time_averager_.mark_point();
+            float angle_rad = wrap_angle(positions[2] * M_PI / 180.0);
+            controller_.inputPosition(positions[0], positions[1], angle_rad);
+        }
     }
 
     // Service various modules
-    controller_.update();
-    tray_controller_.update();
-    camera_tracker_->update();
-
-    // Verify if MOVE_FINE_STOP_VISION needs to trigger stop
-    if(checkForCameraStopTrigger())
     {
-        controller_.stopFast();
-        camera_stop_triggered_ = true;
+        ScopedStageTimer t(LOOP_STAGE::CONTROLLER);
+        controller_.update();
+    }
+    {
+        ScopedStageTimer t(LOOP_STAGE::TRAY);
+        tray_controller_.update();
+        TrayState tray_state = tray_controller_.getTrayState();
+        if(tray_state.fault && !statusUpdater_.getStateBus().tray.get().fault)
+        {
+            statusUpdater_.setErrorStatus();
+        }
+        statusUpdater_.getStateBus().tray.publishIfChanged(tray_state);
     }
+    {
+        ScopedStageTimer t(LOOP_STAGE::CAMERA);
+        camera_tracker_->update();
+        statusUpdater_.getStateBus().camera.publishIfChanged(camera_tracker_->getPoseFromCamera());
 
-    // Check if the current command has finished
-    bool done = checkForCmdComplete(curCmd_);
-    if(done)
+        // Verify if MOVE_FINE_STOP_VISION needs to trigger stop
+        if(checkForCameraStopTrigger())
+        {
+            controller_.stopFast();
+            camera_stop_triggered_ = true;
+        }
+        checkCameraStopResult();
+    }
+
+    // Check if the current command in each lane has finished
+    if(base_cmd_ != COMMAND::NONE && checkForCmdComplete(base_cmd_))
+    {
+        if(base_cmd_ == COMMAND::MOVE_FINE_STOP_VISION) logCameraStopResult();
+        setLaneCommand(LANE::BASE, COMMAND::NONE);
+    }
+    if(tray_cmd_ != COMMAND::NONE && checkForCmdComplete(tray_cmd_))
     {
-        curCmd_ = COMMAND::NONE;
-        statusUpdater_.updateInProgress(false);
+        setLaneCommand(LANE::TRAY, COMMAND::NONE);
     }
 
+    // Start the next sequence steps on the same loop the lanes free up
+    updateSequence();
+
     // Update loop time and status updater
     statusUpdater_.updatePositionLoopTime(position_time_averager_.get_ms());
     CameraDebug camera_debug = camera_tracker_->getCameraDebug();
@@ -139,23 +186,31 @@ bool Robot::tryStartNewCmd(COMMAND cmd)
         camera_tracker_->toggleDebugImageOutput();
         return false;
     }
-    if (cmd == COMMAND::START_CAMERAS)
+    if (cmd == COMMAND::START_CAMERAS || cmd == COMMAND::STOP_CAMERAS)
     {
-        camera_tracker_->start();
-        return false;
-    }
-    if (cmd == COMMAND::STOP_CAMERAS)
-    {
-        camera_tracker_->stop();
+        startCommand(cmd, {}, {});
         return false;
     }
     // Same with ESTOP
     if (cmd == COMMAND::ESTOP)
     {
+        sequencer_.abort();
         controller_.estop();
         tray_controller_.estop();
         return false;
     }
+    // Aborting a sequence drops the steps that haven't started, anything running is left to finish
+    if (cmd == COMMAND::ABORT_SEQUENCE)
+    {
+        sequencer_.abort();
+        return false;
+    }
+    // A speed override applies to the running move and the ones after it, so it never waits for a lane
+    if (cmd == COMMAND::SET_SPEED_OVERRIDE)
+    {
+        controller_.setSpeedOverride(server_.getSpeedOverrideData());
+        return false;
+    }
     // Same with LOAD_COMPLETE
     if (cmd == COMMAND::LOAD_COMPLETE)
     {
@@ -166,37 +221,71 @@ bool Robot::tryStartNewCmd(COMMAND cmd)
     // Just do nothing for NONE
     if (cmd == COMMAND::NONE) { return false;}
     
-    // For all other commands, we need to make sure we aren't doing anything else at the moment
-    if(statusUpdater_.getInProgress())
+    // A sequence owns both lanes until it is done
+    if(sequencer_.isRunning())
+    {
+        PLOGW << "Sequence running, rejecting new command: " << static_cast<int>(cmd);
+        return false;
+    }
+
+    // A sequence needs everything idle to start. Its steps are started from updateSequence, so it doesn't take a lane itself.
+    if (cmd == COMMAND::SEQUENCE)
+    {
+        if(statusUpdater_.getInProgress())
+        {
+            PLOGW << "Command already running, rejecting new sequence";
+        }
+        else if(!statusUpdater_.getErrorStatus())
+        {
+            sequencer_.start(server_.getSequenceData());
+            planned_step_ = -1;
+        }
+        return false;
+    }
+
+    // Velocity setpoints can be streamed in while a velocity move runs, they change the running move instead of
+    // being rejected as a new one
+    bool velocity_cmd = cmd == COMMAND::MOVE_CONST_VEL || cmd == COMMAND::JOG;
+    bool velocity_move_running = base_cmd_ == COMMAND::MOVE_CONST_VEL || base_cmd_ == COMMAND::JOG;
+    if(velocity_cmd && velocity_move_running && !statusUpdater_.getErrorStatus())
+    {
+        startCommand(cmd, server_.getMoveData(), server_.getVelocityData());
+        return false;
+    }
+
+    // For all other commands, we need to make sure nothing else is running in the same lane. The base
+    // and tray are independent axes, so a tray action can run during a move and the other way around.
+    LANE lane = laneForCommand(cmd);
+    if(statusUpdater_.getInProgress(lane))
     {
-        PLOGW << "Command " << static_cast<int>(curCmd_) << " already running, rejecting new command: " << static_cast<int>(cmd);
+        PLOGW << "Command " << static_cast<int>(getCurrentCommand(lane)) << " already running, rejecting new command: " << static_cast<int>(cmd);
         return false;
     }
     else if (statusUpdater_.getErrorStatus())
     {
         return false;
     }
-    
-    // Start new command
+
+    return startCommand(cmd, server_.getMoveData(), server_.getVelocityData());
+}
+
+bool Robot::startCommand(COMMAND cmd, const RobotServer::PositionData& move_data, const RobotServer::VelocityData& velocity_data)
+{
     if(cmd == COMMAND::MOVE)
     {
-        RobotServer::PositionData data = server_.getMoveData();
-        controller_.moveToPosition(data.x, data.y, data.a);
+        controller_.moveToPosition(move_data.x, move_data.y, move_data.a);
     }
     else if(cmd == COMMAND::MOVE_REL)
     {
-        RobotServer::PositionData data = server_.getMoveData();
-        controller_.moveToPositionRelative(data.x, data.y, data.a);
+        controller_.moveToPositionRelative(move_data.x, move_data.y, move_data.a);
     }
     else if(cmd == COMMAND::MOVE_REL_SLOW)
     {
-        RobotServer::PositionData data = server_.getMoveData();
-        controller_.moveToPositionRelativeSlow(data.x, data.y, data.a);
+        controller_.moveToPositionRelativeSlow(move_data.x, move_data.y, move_data.a);
     }
     else if(cmd == COMMAND::MOVE_FINE)
     {
-        RobotServer::PositionData data = server_.getMoveData();
-        controller_.moveToPositionFine(data.x, data.y, data.a);
+        controller_.moveToPositionFine(move_data.x, move_data.y, move_data.a);
     }
     else if(cmd == COMMAND::MOVE_FINE_STOP_VISION)
     {
@@ -205,22 +294,23 @@ bool Robot::tryStartNewCmd(COMMAND cmd)
             PLOGW << "Cannot start MOVE_FINE_STOP_VISION if camera tracker isn't running";
             return false;
         }
-        RobotServer::PositionData data = server_.getMoveData();
-        controller_.moveToPositionFine(data.x, data.y, data.a);
+        controller_.moveToPositionFine(move_data.x, move_data.y, move_data.a);
         resetCameraStopTriggers();
         camera_motion_start_time_ = ClockFactory::getFactoryInstance()->get_clock()->now();
-        fine_move_target_ = {data.x, data.y, data.a};
+        fine_move_target_ = {move_data.x, move_data.y, move_data.a};
     
     }
     else if(cmd == COMMAND::MOVE_CONST_VEL)
     {
-        RobotServer::VelocityData data = server_.getVelocityData();
-        controller_.moveConstVel(data.vx, data.vy, data.va, data.t);
+        controller_.moveConstVel(velocity_data.vx, velocity_data.vy, velocity_data.va, velocity_data.t);
+    }
+    else if(cmd == COMMAND::JOG)
+    {
+        controller_.jog(velocity_data.vx, velocity_data.vy, velocity_data.va);
     }
     else if (cmd == COMMAND::MOVE_WITH_VISION)
     {
-        RobotServer::PositionData data = server_.getMoveData();
-        controller_.moveWithVision(data.x, data.y, data.a);
+        controller_.moveWithVision(move_data.x, move_data.y, move_data.a);
     }
     else if(cmd == COMMAND::PLACE_TRAY)
     {
@@ -242,6 +332,14 @@ bool Robot::tryStartNewCmd(COMMAND cmd)
     {
         wait_for_localize_helper_.start();
     }
+    else if (cmd == COMMAND::START_CAMERAS)
+    {
+        camera_tracker_->start();
+    }
+    else if (cmd == COMMAND::STOP_CAMERAS)
+    {
+        camera_tracker_->stop();
+    }
     else
     {
         PLOGW.printf("Unknown command!");
@@ -261,6 +359,7 @@ bool Robot::checkForCmdComplete(COMMAND cmd)
             cmd == COMMAND::MOVE_REL ||
             cmd == COMMAND::MOVE_FINE ||
             cmd == COMMAND::MOVE_CONST_VEL ||
+            cmd == COMMAND::JOG ||
             cmd == COMMAND::MOVE_WITH_VISION || 
             cmd == COMMAND::MOVE_REL_SLOW || 
             cmd == COMMAND::MOVE_FINE_STOP_VISION)
@@ -285,48 +384,169 @@ bool Robot::checkForCmdComplete(COMMAND cmd)
         
 }
 
-bool Robot::checkForCameraStopTrigger()
+void Robot::updateSequence()
 {
-    if(curCmd_ != COMMAND::MOVE_FINE_STOP_VISION) return false;
-    if(camera_stop_triggered_) return false;
-
-    CameraTrackerOutput camera_output = camera_tracker_->getPoseFromCamera();
-    if(camera_output.ok)
+    if(sequencer_.isRunning() && statusUpdater_.getErrorStatus())
     {
-        bool camera_trigger_1_ = camera_trigger_time_1_ > camera_motion_start_time_;
-        bool camera_trigger_2 = camera_trigger_time_2_ > camera_motion_start_time_;
-        bool timestamp_after_1 = camera_output.timestamp > camera_trigger_time_1_;
-        bool timestamp_after_2 = camera_output.timestamp > camera_trigger_time_2_;
-        bool timestamp_difference = std::chrono::duration_cast<FpSeconds>(camera_output.timestamp - camera_trigger_time_1_).count() > 0;
-        Point current_pos = controller_.getCurrentPosition();
-        Eigen::Vector2f dp = {fine_move_target_.x - current_pos.x, fine_move_target_.y - current_pos.y};
-        bool pos_in_tolerance = dp.norm() < 0.5;
+        sequencer_.abort();
+    }
 
-        if(camera_trigger_1_ && camera_trigger_2 && timestamp_after_1 && timestamp_after_2 && pos_in_tolerance)
-        {
-            return true;
-        }
-        else if(camera_trigger_1_ && timestamp_after_1 && timestamp_difference)
+    std::vector<RobotServer::SequenceStep> steps_to_start;
+    bool ok = sequencer_.update(base_cmd_ != COMMAND::NONE, tray_cmd_ != COMMAND::NONE, &steps_to_start);
+    for(const RobotServer::SequenceStep& step : steps_to_start)
+    {
+        if(!ok) break;
+        PLOGI << "Starting sequence step: " << static_cast<int>(step.cmd);
+        if(startCommand(step.cmd, step.move_data, step.velocity_data))
         {
-            camera_trigger_time_2_ = camera_output.timestamp;
-            return true;
+            setLaneCommand(laneForCommand(step.cmd), step.cmd);
         }
         else
         {
-            camera_trigger_time_1_ = camera_output.timestamp;
-            return false;
+            PLOGE << "Sequence step failed to start: " << static_cast<int>(step.cmd);
+            sequencer_.abort();
+            ok = false;
         }
     }
+
+    // Stop everything the sequence started so the robot doesn't carry on with half of a placement
+    if(!ok)
+    {
+        controller_.estop();
+        tray_controller_.estop();
+        statusUpdater_.setErrorStatus();
+    }
     else
     {
-        resetCameraStopTriggers();
+        planNextSequenceMove();
     }
-    return false;
+    statusUpdater_.updateSequenceProgress(sequencer_.isRunning(), sequencer_.getCurrentStep(), sequencer_.getNumSteps());
+}
+
+void Robot::planNextSequenceMove()
+{
+    // Solve the next move of the sequence off the main loop, from where the running move will end
+    int idx = sequencer_.findNextStep(LANE::BASE);
+    if(idx < 0 || idx == planned_step_)
+    {
+        return;
+    }
+    planned_step_ = idx;
+
+    const RobotServer::SequenceStep& step = sequencer_.getStep(idx);
+    const RobotServer::PositionData& data = step.move_data;
+    if(step.cmd == COMMAND::MOVE)
+    {
+        controller_.planNextMove(data.x, data.y, data.a, LIMITS_MODE::COARSE);
+    }
+    else if(step.cmd == COMMAND::MOVE_FINE || step.cmd == COMMAND::MOVE_FINE_STOP_VISION)
+    {
+        controller_.planNextMove(data.x, data.y, data.a, LIMITS_MODE::FINE);
+    }
+    else if(step.cmd == COMMAND::MOVE_REL)
+    {
+        controller_.planNextMoveRelative(data.x, data.y, data.a, LIMITS_MODE::COARSE);
+    }
+    else if(step.cmd == COMMAND::MOVE_REL_SLOW)
+    {
+        controller_.planNextMoveRelative(data.x, data.y, data.a, LIMITS_MODE::SLOW);
+    }
+}
+
+void Robot::setLaneCommand(LANE lane, COMMAND cmd)
+{
+    if(lane == LANE::BASE)
+    {
+        base_cmd_ = cmd;
+    }
+    else if(lane == LANE::TRAY)
+    {
+        tray_cmd_ = cmd;
+    }
+    statusUpdater_.updateLaneCommand(lane, cmd);
+}
+
+bool Robot::checkForCameraStopTrigger()
+{
+    if(base_cmd_ != COMMAND::MOVE_FINE_STOP_VISION) return false;
+    if(camera_stop_triggered_) return false;
+
+    float check_dt = camera_stop_check_timer_.dt_s();
+    camera_stop_check_timer_.reset();
+
+    // Only trust detections made during this move, near where the move expects the target to be
+    CameraTrackerOutput camera_output = statusUpdater_.getStateBus().camera.get();
+    if(!camera_output.ok || camera_output.timestamp <= camera_motion_start_time_) return false;
+    Point current_pos = controller_.getCurrentPosition();
+    Eigen::Vector2f dp = {fine_move_target_.x - current_pos.x, fine_move_target_.y - current_pos.y};
+    if(dp.norm() > 0.5) return false;
+
+    // The camera pose is the robot relative to the vision target, so rotating the robot velocity by the difference
+    // between the camera and global headings puts it in the target frame
+    Velocity vel = statusUpdater_.getStateBus().velocity.get();
+    float speed = sqrt(vel.vx * vel.vx + vel.vy * vel.vy);
+    if(speed < 1e-3) return false;
+    Eigen::Vector2f dir = Eigen::Rotation2Df(camera_output.pose.a - current_pos.a) * Eigen::Vector2f(vel.vx, vel.vy) / speed;
+
+    // Distance left along the direction of travel until the robot is level with the target. The detection is
+    // as old as the camera latency, so take off what the robot covered since.
+    ClockTimePoint now = ClockFactory::getFactoryInstance()->get_clock()->now();
+    float latency = std::chrono::duration_cast<FpSeconds>(now - camera_output.timestamp).count();
+    float dist_to_target = -Eigen::Vector2f(camera_output.pose.x, camera_output.pose.y).dot(dir) - speed * latency;
+
+    // Start stopping on whichever check lands closest to the point where the stop would end on the target. The
+    // controller plans this from stop limits it cached, so checking every loop doesn't log or read the config.
+    float stopping_dist = controller_.getStoppingDistance();
+    if(dist_to_target - stopping_dist > 0.5 * speed * check_dt) return false;
+
+    camera_stop_dir_ = dir;
+    camera_stop_result_.triggered = true;
+    camera_stop_result_.predicted_error = dist_to_target - stopping_dist;
+    PLOGI.printf("Camera stop triggered %.3f m from target at %.3f m/s, stopping distance %.3f m, camera latency %.0f ms",
+        dist_to_target, speed, stopping_dist, 1000 * latency);
+    return true;
 }
 
 void Robot::resetCameraStopTriggers()
 {
+    // Starting another stop before the last one was checked leaves its achieved error unknown
+    checkCameraStopResult(/*give_up=*/ true);
     camera_stop_triggered_ = false;
-    camera_trigger_time_1_ = ClockTimePoint::min();
-    camera_trigger_time_2_ = ClockTimePoint::min();
+    camera_stop_check_timer_.reset();
+    camera_stop_result_ = CameraStopResult();
+    camera_stop_result_pending_ = false;
+}
+
+void Robot::logCameraStopResult()
+{
+    if(!camera_stop_triggered_)
+    {
+        PLOGW << "MOVE_FINE_STOP_VISION finished without seeing the vision target";
+        return;
+    }
+    // The camera pose on the bus can be from before the robot stopped, so the achieved error waits for a newer one
+    camera_stop_rest_time_ = ClockFactory::getFactoryInstance()->get_clock()->now();
+    camera_stop_result_pending_ = true;
+}
+
+void Robot::checkCameraStopResult(bool give_up)
+{
+    if(!camera_stop_result_pending_) return;
+
+    CameraTrackerOutput camera_output = statusUpdater_.getStateBus().camera.get();
+    bool at_rest_pose = camera_output.ok && camera_output.timestamp > camera_stop_rest_time_;
+    // Keep waiting as long as the robot stays where it stopped and the camera could still see it
+    if(!at_rest_pose && !give_up && base_cmd_ == COMMAND::NONE && camera_tracker_->running()) return;
+    camera_stop_result_pending_ = false;
+
+    if(!at_rest_pose)
+    {
+        PLOGW.printf("Camera stop predicted to end %.4f m short of target, achieved error unknown since no camera pose was seen after the robot came to rest",
+            camera_stop_result_.predicted_error);
+        return;
+    }
+    camera_stop_result_.achieved_known = true;
+    camera_stop_result_.achieved_error = -Eigen::Vector2f(camera_output.pose.x, camera_output.pose.y).dot(camera_stop_dir_);
+    PLOGI.printf("Camera stop error along travel: predicted %.4f m, achieved %.4f m (positive is short of target), camera pose %s",
+        camera_stop_result_.predicted_error, camera_stop_result_.achieved_error, camera_output.pose.toString().c_str());
 }
@@ -1,6 +1,9 @@
 #ifndef Robot_h
 #define Robot_h
 
+#include <atomic>
+
+#include "CommandSequencer.h"
 #include "MarvelmindWrapper.h"
 #include "RobotController.h"
 #include "RobotServer.h"
@@ -12,18 +15,27 @@
 class WaitForLocalizeHelper 
 {
   public:
-    WaitForLocalizeHelper(const StatusUpdater& statusUpdater, float max_timeout, float confidence_threshold);
+    WaitForLocalizeHelper(const StateBus& bus, float max_timeout, float confidence_threshold);
     bool isDone();
     void start();
 
   private:
-    const StatusUpdater& statusUpdater_;
+    const StateTopic<LocalizationMetrics>& localization_;
     Timer timer_;
     float max_timeout_;
     float confidence_threshold_;
 };
 
 
+// Outcome of the last MOVE_FINE_STOP_VISION along the direction of travel, positive errors are short of the target
+struct CameraStopResult
+{
+    bool triggered = false;         // The camera saw the target and the stop was started
+    float predicted_error = 0;      // Where the stop was planned to end
+    bool achieved_known = false;    // A camera pose taken after the robot came to rest has been seen
+    float achieved_error = 0;
+};
+
 class Robot
 {
 
@@ -31,19 +43,31 @@ class Robot
 
     Robot();
 
+    // Runs the loop until requestStop is called
     void run();
     void runOnce();
 
+    // Safe to call from a signal handler
+    static void requestStop() { stop_requested_ = true; };
+    static bool stopRequested() { return stop_requested_; };
+
     // Used for tests only
-    COMMAND getCurrentCommand() { return curCmd_; };
+    COMMAND getCurrentCommand(LANE lane = LANE::BASE) { return lane == LANE::TRAY ? tray_cmd_ : base_cmd_; };
     StatusUpdater::Status getStatus() { return statusUpdater_.getStatus(); };
+    CameraStopResult getCameraStopResult() const { return camera_stop_result_; };
 
   private:
 
     bool checkForCmdComplete(COMMAND cmd);
     bool tryStartNewCmd(COMMAND cmd);
+    bool startCommand(COMMAND cmd, const RobotServer::PositionData& move_data, const RobotServer::VelocityData& velocity_data);
+    void setLaneCommand(LANE lane, COMMAND cmd);
+    void updateSequence();
+    void planNextSequenceMove();
     bool checkForCameraStopTrigger();
     void resetCameraStopTriggers();
+    void logCameraStopResult();
+    void checkCameraStopResult(bool give_up = false);
 
     StatusUpdater statusUpdater_;
     RobotServer server_;
@@ -54,15 +78,23 @@ class Robot
     TimeRunningAverage position_time_averager_;    // Handles keeping average of the position update timing
     TimeRunningAverage robot_loop_time_averager_; 
     WaitForLocalizeHelper wait_for_localize_helper_;
+    CommandSequencer sequencer_;
+    int planned_step_;                  // Sequence step the next move was last planned ahead for
     RateController vision_print_rate_;
     CameraTrackerBase* camera_tracker_;
     ClockTimePoint camera_motion_start_time_;
-    ClockTimePoint camera_trigger_time_1_;
-    ClockTimePoint camera_trigger_time_2_;
     bool camera_stop_triggered_;
     Point fine_move_target_;
+    Timer camera_stop_check_timer_;     // Time between stop trigger checks, to know how far the robot goes until the next one
+    Eigen::Vector2f camera_stop_dir_;   // Direction of travel in the vision target frame when the stop was triggered
+    CameraStopResult camera_stop_result_;
+    bool camera_stop_result_pending_;   // Waiting for a camera pose from after the robot came to rest
+    ClockTimePoint camera_stop_rest_time_;
+
+    COMMAND base_cmd_;                  // Command running in the base lane
+    COMMAND tray_cmd_;                  // Command running in the tray lane
 
-    COMMAND curCmd_;
+    static std::atomic<bool> stop_requested_;
 };
 
 
@@ -2,14 +2,34 @@
 
 RobotControllerModeBase::RobotControllerModeBase(bool fake_perfect_motion)
 : move_start_timer_(),
+  loop_timer_(),
+  time_scaler_(),
+  last_move_time_(0),
+  current_target_(),
   move_running_(false),
   fake_perfect_motion_(fake_perfect_motion)
 {
 }
 
-void RobotControllerModeBase::startMove()
+void RobotControllerModeBase::startMove(float max_time_scale)
 {
     move_running_ = true;
-    move_start_timer_.reset();
     loop_timer_.reset();
+    restartTrajectoryTime(max_time_scale, true);
+}
+
+void RobotControllerModeBase::restartTrajectoryTime(float max_time_scale, bool at_rest)
+{
+    move_start_timer_.reset();
+    last_move_time_ = 0;
+    time_scaler_.restart(max_time_scale, at_rest);
+}
+
+float RobotControllerModeBase::advanceTrajectoryTime(const SmoothTrajectoryGenerator& traj_gen)
+{
+    float move_time = move_start_timer_.dt_s();
+    PVTPoint target = traj_gen.lookup(time_scaler_.getTime());
+    float traj_time = time_scaler_.update(move_time - last_move_time_, traj_gen.getTrajectory(), target);
+    last_move_time_ = move_time;
+    return traj_time;
 }
\ No newline at end of file
@@ -11,10 +11,22 @@ class RobotControllerModeBase
 
     RobotControllerModeBase(bool fake_perfect_motion);
 
+    virtual ~RobotControllerModeBase() = default;
+
     virtual Velocity computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle) = 0;
 
     virtual bool checkForMoveComplete(Point current_position, Velocity current_velocity) = 0;
 
+    // Trajectory target from the last call to computeTargetVelocity, in the frame the mode tracks in
+    PVTPoint getCurrentTarget() const { return current_target_; };
+
+    // Global acceleration of the trajectory at the current target, zero for modes that don't follow a global trajectory
+    virtual Velocity getCurrentTargetAcceleration() const { return {0,0,0}; };
+
+    // Speed to play the trajectory back at relative to how it was planned. Modes that don't use the trajectory time
+    // from advanceTrajectoryTime ignore it.
+    void setSpeedOverride(float speed_override) { time_scaler_.setOverride(speed_override); };
+
   protected:
 
     struct TrajectoryTolerances
@@ -25,10 +37,20 @@ class RobotControllerModeBase
         float ang_vel_err;
     };
 
-    void startMove();
+    void startMove(float max_time_scale = 1);
+
+    // Starts the trajectory time over for a new trajectory, see TrajectoryTimeScaler::restart
+    void restartTrajectoryTime(float max_time_scale, bool at_rest);
+
+    // Advances the trajectory time of traj_gen's trajectory by the time since the last call at the current playback
+    // rate and returns it
+    float advanceTrajectoryTime(const SmoothTrajectoryGenerator& traj_gen);
 
     Timer move_start_timer_;
     Timer loop_timer_;
+    TrajectoryTimeScaler time_scaler_;
+    float last_move_time_;
+    PVTPoint current_target_;
     bool move_running_; 
     bool fake_perfect_motion_;
 
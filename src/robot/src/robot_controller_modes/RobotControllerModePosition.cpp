@@ -6,8 +6,7 @@ RobotControllerModePosition::RobotControllerModePosition(bool fake_perfect_motio
 : RobotControllerModeBase(fake_perfect_motion),
   traj_gen_(),
   limits_mode_(LIMITS_MODE::FINE),
-  goal_pos_(0,0,0),
-  current_target_()
+  goal_pos_(0,0,0)
 {
     coarse_tolerances_.trans_pos_err = cfg.lookup("motion.translation.position_threshold.coarse");
     coarse_tolerances_.ang_pos_err = cfg.lookup("motion.rotation.position_threshold.coarse");
@@ -38,19 +37,34 @@ bool RobotControllerModePosition::startMove(Point current_position, Point target
     limits_mode_ = limits_mode;
     goal_pos_ = target_position;
     bool ok = traj_gen_.generatePointToPointTrajectory(current_position, target_position, limits_mode);
-    if(ok) RobotControllerModeBase::startMove();
+    if(ok) RobotControllerModeBase::startMove(traj_gen_.getTrajectory().max_time_scale);
     return ok;
 }
 
-Velocity RobotControllerModePosition::computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle)
+bool RobotControllerModePosition::startPlannedMove(const Trajectory& trajectory, Point target_position, LIMITS_MODE limits_mode)
 {
-    float dt_from_traj_start = move_start_timer_.dt_s();
-    current_target_ = traj_gen_.lookup(dt_from_traj_start);
+    limits_mode_ = limits_mode;
+    goal_pos_ = target_position;
+    traj_gen_.setTrajectory(trajectory);
+    if(trajectory.complete) RobotControllerModeBase::startMove(trajectory.max_time_scale);
+    return trajectory.complete;
+}
+
+void RobotControllerModePosition::updateTarget(Point current_position, Velocity current_velocity, bool log_this_cycle)
+{
+    current_target_ = traj_gen_.lookup(advanceTrajectoryTime(traj_gen_));
+    current_target_.acceleration = time_scaler_.scaleAcceleration(current_target_.acceleration, current_target_.velocity);
+    current_target_.velocity = time_scaler_.scaleVelocity(current_target_.velocity);
 
     // Print motion estimates to log
     PLOGD_IF_(MOTION_LOG_ID, log_this_cycle) << "Target: " << current_target_.toString();
     PLOGD_IF_(MOTION_LOG_ID, log_this_cycle) << "Est Vel: " << current_velocity.toString();
     PLOGD_IF_(MOTION_LOG_ID, log_this_cycle) << "Est Pos: " << current_position.toString();
+}
+
+Velocity RobotControllerModePosition::computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle)
+{
+    updateTarget(current_position, current_velocity, log_this_cycle);
     
     Velocity output;
     if(fake_perfect_motion_)
@@ -66,16 +80,14 @@ Velocity RobotControllerModePosition::computeTargetVelocity(Point current_positi
         output.va = a_controller_.compute(current_target_.position.a, current_position.a, current_target_.velocity.va, current_velocity.va, dt_since_last_loop);
     }
 
-    PLOGI_(MOTION_CSV_LOG_ID).printf("time,%.4f",dt_from_traj_start);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("pos,%.4f,%.4f,%.4f",current_position.x,current_position.y,current_position.a);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("target_pos,%.4f,%.4f,%.4f",current_target_.position.x,current_target_.position.y,current_target_.position.a);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("vel,%.4f,%.4f,%.4f",current_velocity.vx,current_velocity.vy,current_velocity.va);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("target_vel,%.4f,%.4f,%.4f",current_target_.velocity.vx,current_target_.velocity.vy,current_target_.velocity.va);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("control_vel,%.4f,%.4f,%.4f",output.vx,output.vy,output.va);
-
     return output;
 }
 
+Velocity RobotControllerModePosition::getCurrentTargetAcceleration() const
+{
+    return current_target_.acceleration;
+}
+
 bool RobotControllerModePosition::checkForMoveComplete(Point current_position, Velocity current_velocity)
 {
     // Get the right threshold values
@@ -14,16 +14,23 @@ class RobotControllerModePosition : public RobotControllerModeBase
 
     bool startMove(Point current_position, Point target_position, LIMITS_MODE limits_mode);
 
+    // Same as startMove but follows a trajectory that was already solved
+    bool startPlannedMove(const Trajectory& trajectory, Point target_position, LIMITS_MODE limits_mode);
+
     virtual Velocity computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle) override;
 
     virtual bool checkForMoveComplete(Point current_position, Velocity current_velocity) override;
 
+    virtual Velocity getCurrentTargetAcceleration() const override;
+
   protected:
 
+    // Looks up the trajectory target for this cycle at the current playback rate and logs it
+    void updateTarget(Point current_position, Velocity current_velocity, bool log_this_cycle);
+
     SmoothTrajectoryGenerator traj_gen_; 
     LIMITS_MODE limits_mode_;
     Point goal_pos_;
-    PVTPoint current_target_;
 
     TrajectoryTolerances coarse_tolerances_;
     TrajectoryTolerances fine_tolerances_;
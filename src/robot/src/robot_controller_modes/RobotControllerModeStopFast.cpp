@@ -4,17 +4,13 @@
 
 RobotControllerModeStopFast::RobotControllerModeStopFast(bool fake_perfect_motion)
 : RobotControllerModeBase(fake_perfect_motion),
-  current_target_()
+  traj_gen_()
 {
     fine_tolerances_.trans_pos_err = cfg.lookup("motion.translation.position_threshold.fine");
     fine_tolerances_.ang_pos_err = cfg.lookup("motion.rotation.position_threshold.fine");
     fine_tolerances_.trans_vel_err = cfg.lookup("motion.translation.velocity_threshold.fine");
     fine_tolerances_.ang_vel_err = cfg.lookup("motion.rotation.velocity_threshold.fine");
 
-    max_decel_ = {cfg.lookup("motion.translation.max_acc.coarse"),
-                  cfg.lookup("motion.translation.max_acc.coarse"),
-                  cfg.lookup("motion.rotation.max_acc.coarse")};
-                          
     PositionController::Gains position_gains;
     position_gains.kp = cfg.lookup("motion.translation.gains.kp");
     position_gains.ki = cfg.lookup("motion.translation.gains.ki");
@@ -29,44 +25,26 @@ RobotControllerModeStopFast::RobotControllerModeStopFast(bool fake_perfect_motio
     a_controller_ = PositionController(angle_gains);
 }
 
-void RobotControllerModeStopFast::startMove(Point current_position, Velocity current_velocity)
+bool RobotControllerModeStopFast::startMove(Point current_position, Velocity current_velocity, Velocity current_acceleration)
 {
-    (void) current_position;
-    initial_vel_sign_ = {
-        sgn(current_velocity.vx),
-        sgn(current_velocity.vy),
-        sgn(current_velocity.va),
-    };
-    current_decel_ = {
-        -initial_vel_sign_[0] * max_decel_[0],
-        -initial_vel_sign_[1] * max_decel_[1],
-        -initial_vel_sign_[2] * max_decel_[2],
-    };
-    PLOGW.printf("Starting STOP_FAST from velocity %s at decel: %f,%f,%f",current_velocity.toString().c_str(),
-        current_decel_[0],current_decel_[1], current_decel_[2]);
+    // Stop as hard as the coarse limits allow
+    bool ok = traj_gen_.generateStopTrajectory(current_position, current_velocity, current_acceleration, LIMITS_MODE::COARSE);
+    if(!ok)
+    {
+        PLOGE << "Failed to plan STOP_FAST";
+        return false;
+    }
+    PLOGW.printf("Starting STOP_FAST from velocity %s, acceleration %s, stopping at %s", current_velocity.toString().c_str(),
+        current_acceleration.toString().c_str(), getStopPoint().toString().c_str());
+    PLOGD_(MOTION_LOG_ID) << traj_gen_.getTrajectory().toString();
     RobotControllerModeBase::startMove();
+    return true;
 }
 
 Velocity RobotControllerModeStopFast::computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle)
 {
     float dt_from_traj_start = move_start_timer_.dt_s();
-    float dt = loop_timer_.dt_s();
-    Point target_pos = {
-        current_position.x + current_velocity.vx * dt + 0.5f * current_decel_[0] * dt * dt,
-        current_position.y + current_velocity.vy * dt + 0.5f * current_decel_[1] * dt * dt,
-        current_position.a + current_velocity.va * dt + 0.5f * current_decel_[2] * dt * dt,
-    };
-    Velocity target_vel = {
-        current_velocity.vx + current_decel_[0]*dt,
-        current_velocity.vy + current_decel_[1]*dt,
-        current_velocity.va + current_decel_[2]*dt,
-    };
-
-    if(current_velocity.vx != 0 && sgn(current_velocity.vx) != initial_vel_sign_[0]) target_vel.vx = 0;
-    if(current_velocity.vy != 0 && sgn(current_velocity.vy) != initial_vel_sign_[1]) target_vel.vy = 0;
-    if(current_velocity.va != 0 && sgn(current_velocity.va) != initial_vel_sign_[2]) target_vel.va = 0;
-
-    current_target_ = {target_pos, target_vel, dt_from_traj_start};
+    current_target_ = traj_gen_.lookup(dt_from_traj_start);
 
     // Print motion estimates to log
     PLOGD_IF_(MOTION_LOG_ID, log_this_cycle) << "Target: " << current_target_.toString();
@@ -82,18 +60,11 @@ Velocity RobotControllerModeStopFast::computeTargetVelocity(Point current_positi
     {
         float dt_since_last_loop = loop_timer_.dt_s();
         loop_timer_.reset();
-        output.vx = x_controller_.compute(0, 0, current_target_.velocity.vx, current_velocity.vx, dt_since_last_loop);
-        output.vy = y_controller_.compute(0, 0, current_target_.velocity.vy, current_velocity.vy, dt_since_last_loop);
-        output.va = a_controller_.compute(0, 0, current_target_.velocity.va, current_velocity.va, dt_since_last_loop);
+        output.vx = x_controller_.compute(current_target_.position.x, current_position.x, current_target_.velocity.vx, current_velocity.vx, dt_since_last_loop);
+        output.vy = y_controller_.compute(current_target_.position.y, current_position.y, current_target_.velocity.vy, current_velocity.vy, dt_since_last_loop);
+        output.va = a_controller_.compute(current_target_.position.a, current_position.a, current_target_.velocity.va, current_velocity.va, dt_since_last_loop);
     }
 
-    PLOGI_(MOTION_CSV_LOG_ID).printf("time,%.4f",dt_from_traj_start);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("pos,%.4f,%.4f,%.4f",current_position.x,current_position.y,current_position.a);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("target_pos,%.4f,%.4f,%.4f",current_target_.position.x,current_target_.position.y,current_target_.position.a);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("vel,%.4f,%.4f,%.4f",current_velocity.vx,current_velocity.vy,current_velocity.va);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("target_vel,%.4f,%.4f,%.4f",current_target_.velocity.vx,current_target_.velocity.vy,current_target_.velocity.va);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("control_vel,%.4f,%.4f,%.4f",output.vx,output.vy,output.va);
-
     return output;
 }
 
@@ -117,4 +88,9 @@ bool RobotControllerModeStopFast::checkForMoveComplete(Point current_position, V
     }
 
     return traj_complete;  
+}
+
+Velocity RobotControllerModeStopFast::getCurrentTargetAcceleration() const
+{
+    return current_target_.acceleration;
 }
\ No newline at end of file
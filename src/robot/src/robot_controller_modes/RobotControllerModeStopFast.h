@@ -12,19 +12,22 @@ class RobotControllerModeStopFast : public RobotControllerModeBase
 
     RobotControllerModeStopFast(bool fake_perfect_motion);
 
-    void startMove(Point current_position, Velocity current_velocity);
+    // Plans a jerk limited stop from the current velocity and acceleration
+    bool startMove(Point current_position, Velocity current_velocity, Velocity current_acceleration);
 
     virtual Velocity computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle) override;
 
     virtual bool checkForMoveComplete(Point current_position, Velocity current_velocity) override;
 
+    virtual Velocity getCurrentTargetAcceleration() const override;
+
+    // Where the robot will come to rest
+    Point getStopPoint() const { return traj_gen_.getEndPoint(); };
+
   protected:
 
-    PVTPoint current_target_;
+    SmoothTrajectoryGenerator traj_gen_;
     TrajectoryTolerances fine_tolerances_;
-    std::vector<float> max_decel_; 
-    std::vector<float> current_decel_;
-    std::vector<int> initial_vel_sign_;  
 
     PositionController x_controller_;
     PositionController y_controller_;
@@ -0,0 +1,84 @@
+#include "RobotControllerModeTracking.h"
+#include "constants.h"
+#include <algorithm>
+#include <string>
+#include <plog/Log.h>
+
+TrackingController::Gains readTrackingGains(const std::string& gains_path, float acc_feedforward)
+{
+    TrackingController::Gains gains;
+    gains.kp = cfg.lookup(gains_path + ".kp");
+    gains.ki = cfg.lookup(gains_path + ".ki");
+    gains.kd = cfg.lookup(gains_path + ".kd");
+    gains.ka = acc_feedforward;
+    return gains;
+}
+
+RobotControllerModeTracking::RobotControllerModeTracking(bool fake_perfect_motion)
+: RobotControllerModePosition(fake_perfect_motion)
+{
+    float trans_acc_feedforward = cfg.lookup("motion.translation.acc_feedforward");
+    trans_schedule_.coarse = readTrackingGains("motion.translation.gains", trans_acc_feedforward);
+    trans_schedule_.fine = readTrackingGains("motion.translation.gains_fine", trans_acc_feedforward);
+    trans_schedule_.coarse_max_vel = cfg.lookup("motion.translation.max_vel.coarse");
+    trans_schedule_.fine_max_vel = cfg.lookup("motion.translation.max_vel.fine");
+    trans_schedule_.at_speed = cfg.lookup("motion.translation.gains_at_speed");
+    float trans_max_correction = cfg.lookup("motion.translation.max_correction");
+    x_tracker_ = TrackingController(trans_schedule_.coarse, trans_max_correction);
+    y_tracker_ = TrackingController(trans_schedule_.coarse, trans_max_correction);
+
+    float rot_acc_feedforward = cfg.lookup("motion.rotation.acc_feedforward");
+    rot_schedule_.coarse = readTrackingGains("motion.rotation.gains", rot_acc_feedforward);
+    rot_schedule_.fine = readTrackingGains("motion.rotation.gains_fine", rot_acc_feedforward);
+    rot_schedule_.coarse_max_vel = cfg.lookup("motion.rotation.max_vel.coarse");
+    rot_schedule_.fine_max_vel = cfg.lookup("motion.rotation.max_vel.fine");
+    rot_schedule_.at_speed = cfg.lookup("motion.rotation.gains_at_speed");
+    a_tracker_ = TrackingController(rot_schedule_.coarse, cfg.lookup("motion.rotation.max_correction"));
+}
+
+TrackingController::Gains RobotControllerModeTracking::scheduleGains(const GainSchedule& schedule, float speed) const
+{
+    bool coarse = limits_mode_ == LIMITS_MODE::COARSE;
+    TrackingController::Gains gains = coarse ? schedule.coarse : schedule.fine;
+    float max_vel = coarse ? schedule.coarse_max_vel : schedule.fine_max_vel;
+    float scale = 1 + (schedule.at_speed - 1) * std::min(1.0f, speed / max_vel);
+    gains.kp *= scale;
+    gains.ki *= scale;
+    gains.kd *= scale;
+    return gains;
+}
+
+Velocity RobotControllerModeTracking::computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle)
+{
+    updateTarget(current_position, current_velocity, log_this_cycle);
+    
+    Velocity output;
+    if(fake_perfect_motion_)
+    {
+        output = current_target_.velocity;
+    }
+    else 
+    {
+        float dt_since_last_loop = loop_timer_.dt_s();
+        loop_timer_.reset();
+
+        const Velocity& vel = current_target_.velocity;
+        const Velocity& acc = current_target_.acceleration;
+        TrackingController::Gains trans_gains = scheduleGains(trans_schedule_, sqrtf(vel.vx * vel.vx + vel.vy * vel.vy));
+        x_tracker_.setGains(trans_gains);
+        y_tracker_.setGains(trans_gains);
+        TrackingController::Gains rot_gains = scheduleGains(rot_schedule_, fabs(vel.va));
+        a_tracker_.setGains(rot_gains);
+
+        // Put the actual angle on the same side of +/-pi as the target so the error doesn't jump across the wrap
+        float target_a = current_target_.position.a;
+        float current_a = target_a - angle_diff(target_a, current_position.a);
+
+        output.vx = x_tracker_.compute(current_target_.position.x, current_position.x, vel.vx, current_velocity.vx, acc.vx, dt_since_last_loop);
+        output.vy = y_tracker_.compute(current_target_.position.y, current_position.y, vel.vy, current_velocity.vy, acc.vy, dt_since_last_loop);
+        output.va = a_tracker_.compute(target_a, current_a, vel.va, current_velocity.va, acc.va, dt_since_last_loop);
+        PLOGD_IF_(MOTION_LOG_ID, log_this_cycle).printf("Scheduled kp: [trans: %.3f, rot: %.3f]", trans_gains.kp, rot_gains.kp);
+    }
+
+    return output;
+}
@@ -0,0 +1,44 @@
+#ifndef RobotControllerModeTracking_h
+#define RobotControllerModeTracking_h
+
+#include "RobotControllerModePosition.h"
+#include "SmoothTrajectoryGenerator.h"
+#include "utils.h"
+
+// Follows the same point to point trajectories as RobotControllerModePosition, but feeds the trajectory acceleration
+// forward and schedules the feedback gains on the limits mode and the target speed, so the robot stays closer to
+// the trajectory through the jerk and acceleration segments.
+class RobotControllerModeTracking : public RobotControllerModePosition
+{
+
+  public:
+
+    RobotControllerModeTracking(bool fake_perfect_motion);
+
+    virtual Velocity computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle) override;
+
+  protected:
+
+    // Feedback gains for one kind of axis. Coarse moves use the coarse gains and everything else the fine ones,
+    // scaled linearly from the gains at rest down to at_speed times them at the max velocity of the limits mode.
+    struct GainSchedule
+    {
+        TrackingController::Gains coarse;
+        TrackingController::Gains fine;
+        float coarse_max_vel;
+        float fine_max_vel;
+        float at_speed;
+    };
+
+    TrackingController::Gains scheduleGains(const GainSchedule& schedule, float speed) const;
+
+    GainSchedule trans_schedule_;
+    GainSchedule rot_schedule_;
+
+    TrackingController x_tracker_;
+    TrackingController y_tracker_;
+    TrackingController a_tracker_;
+
+};
+
+#endif //RobotControllerModeTracking_h
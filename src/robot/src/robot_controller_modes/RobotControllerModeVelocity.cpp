@@ -0,0 +1,158 @@
+#include "RobotControllerModeVelocity.h"
+#include "constants.h"
+#include <algorithm>
+#include <plog/Log.h>
+
+// Acceleration to move vel towards target with, along the difference between them. It heads for the most that can 
+// still be taken back out by the time the velocity gets there, and changes no faster than the jerk limit. Ramping 
+// acceleration a down to zero in steps of max_jerk * dt covers a^2 / (2 * max_jerk) + a * dt / 2 of velocity, which
+// sets that most.
+template <typename V>
+V rampAcceleration(const V& target, const V& vel, const V& acc, const DynamicLimits& limits, float dt)
+{
+    V err = target - vel;
+    float dist = err.norm();
+    V goal_acc = V::Zero();
+    if(dist > 0)
+    {
+        float stoppable_acc = limits.max_jerk * (sqrtf(dt * dt / 4 + 2 * dist / limits.max_jerk) - dt / 2);
+        goal_acc = err / dist * std::min(limits.max_acc, stoppable_acc);
+    }
+
+    V acc_change = goal_acc - acc;
+    float max_acc_change = limits.max_jerk * dt;
+    if(acc_change.norm() > max_acc_change)
+    {
+        acc_change *= max_acc_change / acc_change.norm();
+    }
+    return acc + acc_change;
+}
+
+// Steps vel with acc, landing on the target instead of going back and forth over it
+template <typename V>
+void stepTowards(const V& target, float dt, V* vel, V* acc)
+{
+    V err = target - *vel;
+    *vel += *acc * dt;
+    if((target - *vel).dot(err) <= 0)
+    {
+        *vel = target;
+        *acc = V::Zero();
+    }
+}
+
+RobotControllerModeVelocity::RobotControllerModeVelocity(bool fake_perfect_motion)
+: RobotControllerModeBase(fake_perfect_motion),
+  setpoint_(0,0,0),
+  hold_s_(0),
+  setpoint_timer_(),
+  setpoint_expired_(true),
+  trans_vel_(Eigen::Vector2f::Zero()),
+  trans_acc_(Eigen::Vector2f::Zero()),
+  rot_vel_(Eigen::Matrix<float,1,1>::Zero()),
+  rot_acc_(Eigen::Matrix<float,1,1>::Zero())
+{
+    getDynamicLimits(LIMITS_MODE::COARSE, &trans_limits_, &rot_limits_);
+    float fraction = cfg.lookup("motion.limit_max_fraction");
+    trans_limits_ = trans_limits_ * fraction;
+    rot_limits_ = rot_limits_ * fraction;
+    wheel_limits_ = {cfg.lookup("motion.wheel_limits.dist_from_center"),
+                     static_cast<float>(cfg.lookup("motion.wheel_limits.max_vel")) * fraction,
+                     static_cast<float>(cfg.lookup("motion.wheel_limits.max_acc")) * fraction};
+
+    coarse_tolerances_.trans_pos_err = cfg.lookup("motion.translation.position_threshold.coarse");
+    coarse_tolerances_.ang_pos_err = cfg.lookup("motion.rotation.position_threshold.coarse");
+    coarse_tolerances_.trans_vel_err = cfg.lookup("motion.translation.velocity_threshold.coarse");
+    coarse_tolerances_.ang_vel_err = cfg.lookup("motion.rotation.velocity_threshold.coarse");
+}
+
+void RobotControllerModeVelocity::startMove()
+{
+    RobotControllerModeBase::startMove();
+}
+
+void RobotControllerModeVelocity::setSetpoint(Velocity velocity, float hold_s)
+{
+    // Keep the setpoint within the axis limits and, with both axes together, within what the wheels can do
+    Eigen::Vector2f trans = {velocity.vx, velocity.vy};
+    float scale = 1;
+    if(trans.norm() > 0) scale = std::min(scale, trans_limits_.max_vel / trans.norm());
+    if(velocity.va != 0) scale = std::min(scale, rot_limits_.max_vel / fabsf(velocity.va));
+    float wheel_vel = trans.norm() + wheel_limits_.dist_from_center * fabsf(velocity.va);
+    if(wheel_vel > 0) scale = std::min(scale, wheel_limits_.max_vel / wheel_vel);
+    if(scale < 1)
+    {
+        PLOGW.printf("Velocity setpoint %s is over the limits, scaling by %.2f", velocity.toString().c_str(), scale);
+    }
+
+    setpoint_ = {scale * velocity.vx, scale * velocity.vy, scale * velocity.va};
+    hold_s_ = hold_s;
+    setpoint_timer_.reset();
+    setpoint_expired_ = false;
+}
+
+Velocity RobotControllerModeVelocity::computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle)
+{
+    float dt_since_last_loop = loop_timer_.dt_s();
+    loop_timer_.reset();
+
+    // Stop if the setpoint isn't renewed in time, either because it was only for a set time or because whoever is 
+    // streaming setpoints went quiet
+    if(!setpoint_expired_ && setpoint_timer_.dt_s() > hold_s_)
+    {
+        PLOGI << "Velocity setpoint expired, ramping down to a stop";
+        setpoint_expired_ = true;
+    }
+    Velocity target = setpoint_expired_ ? Velocity(0,0,0) : setpoint_;
+
+    Eigen::Vector2f trans_target = {target.vx, target.vy};
+    Eigen::Matrix<float,1,1> rot_target(target.va);
+    trans_acc_ = rampAcceleration(trans_target, trans_vel_, trans_acc_, trans_limits_, dt_since_last_loop);
+    rot_acc_ = rampAcceleration(rot_target, rot_vel_, rot_acc_, rot_limits_, dt_since_last_loop);
+
+    // Both axes share the wheels, so scale both accelerations down together when their combined rim acceleration 
+    // would be over the wheel limit, like applyWheelLimits does for trajectories
+    float wheel_acc = trans_acc_.norm() + wheel_limits_.dist_from_center * fabsf(rot_acc_(0));
+    if(wheel_acc > wheel_limits_.max_acc)
+    {
+        float scale = wheel_limits_.max_acc / wheel_acc;
+        trans_acc_ *= scale;
+        rot_acc_ *= scale;
+    }
+
+    stepTowards(trans_target, dt_since_last_loop, &trans_vel_, &trans_acc_);
+    stepTowards(rot_target, dt_since_last_loop, &rot_vel_, &rot_acc_);
+
+    current_target_.position = current_position;
+    current_target_.velocity = {trans_vel_(0), trans_vel_(1), rot_vel_(0)};
+    current_target_.time = move_start_timer_.dt_s();
+
+    PLOGD_IF_(MOTION_LOG_ID, log_this_cycle) << "Target: " << current_target_.toString();
+    PLOGD_IF_(MOTION_LOG_ID, log_this_cycle) << "Est Vel: " << current_velocity.toString();
+    PLOGD_IF_(MOTION_LOG_ID, log_this_cycle) << "Est Pos: " << current_position.toString();
+
+    // The motor driver closes the loop on wheel velocity, there's no position to hold on to here
+    return current_target_.velocity;
+}
+
+bool RobotControllerModeVelocity::checkForMoveComplete(Point current_position, Velocity current_velocity)
+{
+    (void) current_position;
+    bool zero_cmd_vel = setpoint_expired_ && current_target_.velocity.nearZero();
+
+    Eigen::Vector2f dv = {current_velocity.vx, current_velocity.vy};
+    bool vel_in_tolerance = dv.norm() < coarse_tolerances_.trans_vel_err && fabs(current_velocity.va) < coarse_tolerances_.ang_vel_err;
+
+    bool move_complete = zero_cmd_vel && vel_in_tolerance;
+    if(move_complete) 
+    {
+        move_running_ = false;
+    }
+
+    return move_complete;
+}
+
+Velocity RobotControllerModeVelocity::getCurrentTargetAcceleration() const
+{
+    return {trans_acc_(0), trans_acc_(1), rot_acc_(0)};
+}
@@ -0,0 +1,49 @@
+#ifndef RobotControllerModeVelocity_h
+#define RobotControllerModeVelocity_h
+
+#include <Eigen/Dense>
+#include "RobotControllerModeBase.h"
+#include "SmoothTrajectoryGenerator.h"
+#include "utils.h"
+
+// Follows a stream of global velocity setpoints instead of a trajectory. The commanded velocity ramps towards each new
+// setpoint within the coarse acceleration and jerk limits and the wheel acceleration limit, and ramps back down to a 
+// stop once a setpoint runs out.
+class RobotControllerModeVelocity : public RobotControllerModeBase
+{
+
+  public:
+
+    RobotControllerModeVelocity(bool fake_perfect_motion);
+
+    void startMove();
+
+    // Ramps towards the velocity and holds it for hold_s seconds from now, unless another setpoint comes in first
+    void setSetpoint(Velocity velocity, float hold_s);
+
+    virtual Velocity computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle) override;
+
+    virtual bool checkForMoveComplete(Point current_position, Velocity current_velocity) override;
+
+    virtual Velocity getCurrentTargetAcceleration() const override;
+
+  protected:
+
+    DynamicLimits trans_limits_;
+    DynamicLimits rot_limits_;
+    WheelLimits wheel_limits_;
+    TrajectoryTolerances coarse_tolerances_;
+
+    Velocity setpoint_;
+    float hold_s_;                  // How long the setpoint holds after it was set
+    Timer setpoint_timer_;          // Time since the setpoint was set
+    bool setpoint_expired_;         // Ramping down to a stop
+
+    Eigen::Vector2f trans_vel_;     // Commanded velocity and acceleration, ramping towards the setpoint
+    Eigen::Vector2f trans_acc_;
+    Eigen::Matrix<float,1,1> rot_vel_;
+    Eigen::Matrix<float,1,1> rot_acc_;
+
+};
+
+#endif //RobotControllerModeVelocity_h
@@ -1,7 +1,7 @@
 #include "RobotControllerModeVision.h"
 #include "constants.h"
+#include <algorithm>
 #include <plog/Log.h>
-#include "camera_tracker/CameraTrackerFactory.h"
 
 RobotControllerModeVision::RobotControllerModeVision(bool fake_perfect_motion, StatusUpdater& status_updater)
 : RobotControllerModeBase(fake_perfect_motion),
@@ -9,11 +9,17 @@ RobotControllerModeVision::RobotControllerModeVision(bool fake_perfect_motion, S
   traj_gen_(),
   goal_point_(0,0,0),
   current_point_(0,0,0),
-  current_target_(),
-  camera_tracker_(CameraTrackerFactory::getFactoryInstance()->get_camera_tracker()),
+  camera_output_(status_updater.getStateBus().camera),
   traj_done_timer_(),
+  last_vision_update_time_(),
+  replan_period_s_(0),
+  replan_timer_(),
+  last_replan_vision_time_(),
   kf_(3,3)
 {
+    float replan_frequency = cfg.lookup("vision_tracker.replan_frequency");
+    replan_period_s_ = replan_frequency > 0 ? 1.0 / replan_frequency : 0;
+
     tolerances_.trans_pos_err = cfg.lookup("motion.translation.position_threshold.vision");
     tolerances_.ang_pos_err = cfg.lookup("motion.rotation.position_threshold.vision");
     tolerances_.trans_vel_err = cfg.lookup("motion.translation.velocity_threshold.vision");
@@ -48,7 +54,7 @@ RobotControllerModeVision::RobotControllerModeVision(bool fake_perfect_motion, S
 
 bool RobotControllerModeVision::startMove(Point target_point)
 {
-    CameraTrackerOutput tracker_output = camera_tracker_->getPoseFromCamera();
+    CameraTrackerOutput tracker_output = camera_output_.get();
     if(!tracker_output.ok) 
     {
         PLOGE << "Cannot start vision move, camera pose not ok";
@@ -57,14 +63,35 @@ bool RobotControllerModeVision::startMove(Point target_point)
     current_point_ = tracker_output.pose;
     goal_point_ = target_point;
     bool ok = traj_gen_.generatePointToPointTrajectory(current_point_, target_point, LIMITS_MODE::VISION);
-    if(ok) RobotControllerModeBase::startMove();
+    if(ok) RobotControllerModeBase::startMove(traj_gen_.getTrajectory().max_time_scale);
+    replan_timer_.reset();
+    last_replan_vision_time_ = tracker_output.timestamp;
     return ok;
 }
 
+void RobotControllerModeVision::replan(float dt_from_traj_start)
+{
+    replan_timer_.reset();
+    last_replan_vision_time_ = last_vision_update_time_;
+
+    // Start from where the current trajectory is commanding right now so the velocity doesn't jump
+    Trajectory previous = traj_gen_.getTrajectory();
+    PVTPoint start = traj_gen_.lookup(dt_from_traj_start);
+    bool ok = traj_gen_.generatePointToPointTrajectory(current_point_, start.velocity, start.acceleration, goal_point_, LIMITS_MODE::VISION);
+    if(!ok)
+    {
+        PLOGW << "Vision replan failed, keeping current trajectory";
+        traj_gen_.setTrajectory(previous);
+        return;
+    }
+    PLOGI_(MOTION_LOG_ID) << "Replanned vision move from " << current_point_.toString();
+    restartTrajectoryTime(traj_gen_.getTrajectory().max_time_scale, false);
+}
+
 Velocity RobotControllerModeVision::computeTargetVelocity(Point current_position, Velocity current_velocity, bool log_this_cycle)
 {   
     // Get current target global position and global velocity according to the trajectory
-    float dt_from_traj_start = move_start_timer_.dt_s();
+    float dt_from_traj_start = advanceTrajectoryTime(traj_gen_);
     current_target_ = traj_gen_.lookup(dt_from_traj_start);
 
     // Get previous loop time
@@ -83,7 +110,7 @@ Velocity RobotControllerModeVision::computeTargetVelocity(Point current_position
     }
 
     // Get latest pose from cameras and do update step if data is available
-    CameraTrackerOutput tracker_output = camera_tracker_->getPoseFromCamera();
+    CameraTrackerOutput tracker_output = camera_output_.get();
     if(tracker_output.ok && tracker_output.timestamp > last_vision_update_time_)
     {
         // Get the current distance measurements from the sensors and update the filter
@@ -97,6 +124,19 @@ Velocity RobotControllerModeVision::computeTargetVelocity(Point current_position
     current_point_ = {state[0], state[1], state[2]};
     status_updater_.updateVisionControllerPose(current_point_);
 
+    // While the move is running, keep replanning from the latest fused camera pose so the approach converges on
+    // the goal as the estimate improves instead of only tracking the pose the move started from
+    const Trajectory& traj = traj_gen_.getTrajectory();
+    float traj_end_time = std::max(traj.trans_params.switch_points[7].t, traj.rot_params.switch_points[7].t);
+    if(replan_period_s_ > 0 && replan_timer_.dt_s() >= replan_period_s_ && dt_from_traj_start < traj_end_time &&
+       last_vision_update_time_ > last_replan_vision_time_)
+    {
+        replan(dt_from_traj_start);
+        dt_from_traj_start = time_scaler_.getTime();
+        current_target_ = traj_gen_.lookup(dt_from_traj_start);
+    }
+    current_target_.velocity = time_scaler_.scaleVelocity(current_target_.velocity);
+
     // Print motion estimates to log
     PLOGD_IF_(MOTION_LOG_ID, log_this_cycle) << "\nTarget: " << current_target_.toString();
     PLOGD_IF_(MOTION_LOG_ID, log_this_cycle) << "Est Vel: " << current_velocity.toString();
@@ -121,13 +161,6 @@ Velocity RobotControllerModeVision::computeTargetVelocity(Point current_position
     output_global.vy = sin(current_position.a) * output_local.vx + cos(current_position.a) * output_local.vy;
     output_global.va = output_local.va;
 
-    PLOGI_(MOTION_CSV_LOG_ID).printf("time,%.4f",dt_from_traj_start);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("pos,%.4f,%.4f,%.4f",current_point_.x,current_point_.y,current_point_.a);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("target_pos,%.4f,%.4f,%.4f",current_target_.position.x,current_target_.position.y,current_target_.position.a);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("vel,%.4f,%.4f,%.4f",local_vel[0],local_vel[1],local_vel[2]);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("target_vel,%.4f,%.4f,%.4f",current_target_.velocity.vx,current_target_.velocity.vy,current_target_.velocity.va);
-    PLOGI_(MOTION_CSV_LOG_ID).printf("control_vel,%.4f,%.4f,%.4f",output_local.vx,output_local.vy,output_local.va);
-
     return output_global;
 }
 
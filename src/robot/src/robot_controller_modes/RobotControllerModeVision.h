@@ -23,14 +23,20 @@ class RobotControllerModeVision : public RobotControllerModeBase
 
   protected:
 
+    // Plans a new trajectory from the fused camera pose to the goal, starting with the velocity and acceleration
+    // the current one has at dt_from_traj_start. Keeps the current trajectory if this fails.
+    void replan(float dt_from_traj_start);
+
     StatusUpdater& status_updater_;
     SmoothTrajectoryGenerator traj_gen_; 
     Point goal_point_;
     Point current_point_;
-    PVTPoint current_target_;
-    CameraTrackerBase* camera_tracker_;
+    const StateTopic<CameraTrackerOutput>& camera_output_;
     Timer traj_done_timer_;
     ClockTimePoint last_vision_update_time_;
+    float replan_period_s_;                     // 0 if the move is only planned at the start
+    Timer replan_timer_;
+    ClockTimePoint last_replan_vision_time_;    // Camera update the current trajectory was planned from
 
     TrajectoryTolerances tolerances_;
 
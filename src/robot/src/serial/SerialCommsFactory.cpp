@@ -1,6 +1,7 @@
 #include "SerialCommsFactory.h"
 #include "SerialComms.h"
 #include "MockSerialComms.h"
+#include "SimSerialComms.h"
 
 #include <plog/Log.h> 
 
@@ -18,6 +19,11 @@ SerialCommsFactory* SerialCommsFactory::getFactoryInstance()
 
 void SerialCommsFactory::set_mode(SERIAL_FACTORY_MODE mode)
 {
+    // Anything already built was built for the old mode
+    if(mode != mode_)
+    {
+        comms_objects_.clear();
+    }
     mode_ = mode;
 }
 
@@ -54,6 +60,11 @@ void SerialCommsFactory::build_serial_comms(std::string portName)
         serial_comms = std::make_unique<MockSerialComms>(portName);
         PLOGI << "Built MockSerialComms for " << portName;
     }
+    else if (mode_ == SERIAL_FACTORY_MODE::SIM)
+    {
+        serial_comms = std::make_unique<SimSerialComms>(portName);
+        PLOGI << "Built SimSerialComms for " << portName;
+    }
 
     comms_objects_[portName] = std::move(serial_comms);
 }
@@ -10,6 +10,7 @@ enum class SERIAL_FACTORY_MODE
 {
   STANDARD,
   MOCK,
+  SIM,
 };
 
 class SerialCommsFactory
@@ -19,6 +20,7 @@ class SerialCommsFactory
 
     static SerialCommsFactory* getFactoryInstance();
 
+    // Switching modes drops anything built in the old mode, so it gets built again in the new one
     void set_mode(SERIAL_FACTORY_MODE mode);
 
     SerialCommsBase* get_serial_comms(std::string portName);
@@ -0,0 +1,201 @@
+#include "SimSerialComms.h"
+
+#include <plog/Log.h> 
+#include "constants.h"
+
+
+SimSerialComms::SimSerialComms(std::string portName)
+: SerialCommsBase(),
+  plant_(SimRobotPlant::getInstance()),
+  rcv_base_data_(),
+  rcv_lift_data_(),
+  base_msg_timer_(),
+  base_msg_timeout_ms_(cfg.lookup("simulation.base.msg_timeout_ms")),
+  lift_mode_(LIFT_MODE::NONE),
+  lift_step_id_(-1),
+  latch_timer_(),
+  latch_time_ms_(cfg.lookup("simulation.lifter.latch_time_ms")),
+  port_(portName)
+{
+    connected_ = true;
+}
+
+SimSerialComms::~SimSerialComms()
+{
+}
+
+void SimSerialComms::send(std::string msg)
+{
+    checkBaseTimeout();
+    if (msg.rfind("base:", 0) == 0)
+    {
+        base_msg_timer_.reset();
+        handleBaseMsg(msg.substr(5, std::string::npos));
+    }
+    else if (msg.rfind("lift:", 0) == 0)
+    {
+        handleLiftMsg(msg.substr(5, std::string::npos));
+    }
+}
+
+std::string SimSerialComms::rcv_base()
+{
+    checkBaseTimeout();
+    if(rcv_base_data_.empty())
+    {
+        return "";
+    }
+    std::string outdata = rcv_base_data_.front();
+    rcv_base_data_.pop();
+    return outdata;
+}
+
+std::string SimSerialComms::rcv_lift()
+{
+    // The firmware pushes step completion on its own, so check for it here too
+    updateLiftMode();
+    if(rcv_lift_data_.empty())
+    {
+        return "";
+    }
+    std::string outdata = rcv_lift_data_.front();
+    rcv_lift_data_.pop();
+    return outdata;
+}
+
+std::string SimSerialComms::rcv_distance()
+{
+    return "";
+}
+
+void SimSerialComms::checkBaseTimeout()
+{
+    if(base_msg_timer_.dt_ms() > base_msg_timeout_ms_ && plant_->isBaseMoving())
+    {
+        PLOGW << "Sim base message timeout, stopping motors";
+        plant_->commandBaseVelocity({0,0,0});
+        plant_->setBasePower(false);
+    }
+}
+
+void SimSerialComms::handleBaseMsg(const std::string& msg)
+{
+    if(msg == "Power:ON")
+    {
+        plant_->setBasePower(true);
+        return;
+    }
+    else if(msg == "Power:OFF")
+    {
+        plant_->setBasePower(false);
+        return;
+    }
+
+    std::vector<float> cmd = parseCommaDelimitedStringToFloat(msg);
+    if(cmd.size() != 3)
+    {
+        PLOGW << "Sim could not decode base message: " << msg;
+        return;
+    }
+    plant_->commandBaseVelocity({cmd[0], cmd[1], cmd[2]});
+
+    // Firmware replies with the velocity the motors are currently commanded to
+    Velocity measured = plant_->getBaseVelocity();
+    char buff[100];
+    sprintf(buff, "%.3f,%.3f,%.3f", measured.vx, measured.vy, measured.va);
+    rcv_base_data_.push(buff);
+}
+
+void SimSerialComms::handleLiftMsg(const std::string& msg_in)
+{
+    updateLiftMode();
+
+    // Same "@<id>" step id suffix as the firmware
+    std::string msg = msg_in;
+    int step_id = -1;
+    size_t id_idx = msg.find('@');
+    if(id_idx != std::string::npos)
+    {
+        step_id = std::stoi(msg.substr(id_idx + 1));
+        msg = msg.substr(0, id_idx);
+    }
+
+    if(msg == "stop")
+    {
+        plant_->stopLifter();
+        lift_mode_ = LIFT_MODE::NONE;
+        lift_step_id_ = -1;
+    }
+    else if(lift_mode_ == LIFT_MODE::NONE)
+    {
+        // Like the firmware, new commands are only accepted once the previous one is done
+        if(msg == "home")
+        {
+            plant_->homeLifter();
+            lift_mode_ = LIFT_MODE::HOMING;
+        }
+        else if(msg == "open")
+        {
+            latch_timer_.reset();
+            lift_mode_ = LIFT_MODE::LATCH_OPEN;
+        }
+        else if(msg == "close")
+        {
+            latch_timer_.reset();
+            lift_mode_ = LIFT_MODE::LATCH_CLOSE;
+        }
+        else if(msg.rfind("pos:", 0) == 0)
+        {
+            plant_->commandLifterPosition(std::stol(msg.substr(4)));
+            lift_mode_ = LIFT_MODE::AUTO_POS;
+        }
+        else if(msg != "status_req")
+        {
+            PLOGW << "Sim could not decode lift message: " << msg;
+            return;
+        }
+        if(msg != "status_req")
+        {
+            lift_step_id_ = step_id;
+        }
+    }
+
+    if(step_id >= 0 && msg != "stop" && lift_step_id_ != step_id)
+    {
+        rcv_lift_data_.push("rejected:" + std::to_string(step_id));
+    }
+
+    std::string status = "none";
+    switch(lift_mode_)
+    {
+        case LIFT_MODE::AUTO_POS: status = "pos"; break;
+        case LIFT_MODE::HOMING: status = "homing"; break;
+        case LIFT_MODE::LATCH_OPEN: status = "open"; break;
+        case LIFT_MODE::LATCH_CLOSE: status = "close"; break;
+        default: break;
+    }
+    rcv_lift_data_.push(status);
+}
+
+void SimSerialComms::updateLiftMode()
+{
+    bool finished = false;
+    if((lift_mode_ == LIFT_MODE::AUTO_POS || lift_mode_ == LIFT_MODE::HOMING) && !plant_->isLifterMoving())
+    {
+        finished = true;
+    }
+    else if((lift_mode_ == LIFT_MODE::LATCH_OPEN || lift_mode_ == LIFT_MODE::LATCH_CLOSE) && latch_timer_.dt_ms() > latch_time_ms_)
+    {
+        finished = true;
+    }
+
+    if(finished)
+    {
+        lift_mode_ = LIFT_MODE::NONE;
+        if(lift_step_id_ >= 0)
+        {
+            rcv_lift_data_.push("done:" + std::to_string(lift_step_id_));
+            lift_step_id_ = -1;
+        }
+    }
+}
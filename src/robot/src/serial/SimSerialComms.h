@@ -0,0 +1,61 @@
+#ifndef SimSerialComms_h
+#define SimSerialComms_h
+
+#include <string>
+#include <queue>
+
+#include "SerialCommsBase.h"
+#include "sim/SimRobotPlant.h"
+
+// Stands in for the ClearCore in simulation mode. Handles base and lifter messages the same
+// way robot_motor_driver.ino does and drives the SimRobotPlant with them.
+class SimSerialComms : public SerialCommsBase
+{
+  public:
+    
+    SimSerialComms(std::string portName);
+
+    virtual ~SimSerialComms();
+
+    void send(std::string msg) override;
+
+    std::string rcv_base() override;
+
+    std::string rcv_lift() override;
+
+    std::string rcv_distance() override;
+
+  private:
+
+    enum class LIFT_MODE
+    {
+        NONE,
+        AUTO_POS,
+        HOMING,
+        LATCH_OPEN,
+        LATCH_CLOSE,
+    };
+
+    void handleBaseMsg(const std::string& msg);
+
+    void handleLiftMsg(const std::string& msg);
+
+    // Firmware stops the motors if commands stop arriving
+    void checkBaseTimeout();
+
+    void updateLiftMode();
+
+    SimRobotPlant* plant_;
+    std::queue<std::string> rcv_base_data_;
+    std::queue<std::string> rcv_lift_data_;
+    Timer base_msg_timer_;
+    int base_msg_timeout_ms_;
+    LIFT_MODE lift_mode_;
+    int lift_step_id_;          // Id of the step the lifter is working on, -1 if none
+    Timer latch_timer_;
+    int latch_time_ms_;
+    std::string port_;
+
+};
+
+#endif
@@ -0,0 +1,315 @@
+#include "SimRobotPlant.h"
+
+#include <plog/Log.h>
+#include "constants.h"
+
+// Largest step used to integrate the base, keeps the pose integration accurate while rotating
+constexpr float max_integration_step_s = 0.001;
+// How much pose history to keep for delayed sensor readings
+constexpr float pose_history_s = 2.0;
+
+SimRobotPlant* SimRobotPlant::instance = NULL;
+
+SimRobotPlant* SimRobotPlant::getInstance()
+{
+    if(!instance)
+    {
+        instance = new SimRobotPlant;
+    }
+    return instance;
+}
+
+SimRobotPlant::SimRobotPlant()
+: wheel_radius_(cfg.lookup("simulation.base.wheel_radius")),
+  wheel_dist_from_center_(cfg.lookup("simulation.base.wheel_dist_from_center")),
+  belt_ratio_(cfg.lookup("simulation.base.belt_ratio")),
+  steps_per_rad_(static_cast<int>(cfg.lookup("simulation.base.steps_per_rev")) / (2 * M_PI)),
+  max_motor_vel_(cfg.lookup("simulation.base.max_vel_steps")),
+  max_motor_acc_(cfg.lookup("simulation.base.max_acc_steps")),
+  ik_(),
+  fk_(),
+  lifter_max_vel_(static_cast<float>(cfg.lookup("simulation.lifter.max_vel_revs")) * static_cast<int>(cfg.lookup("tray.steps_per_rev"))),
+  lifter_homing_vel_(static_cast<float>(cfg.lookup("simulation.lifter.homing_vel_revs")) * static_cast<int>(cfg.lookup("tray.steps_per_rev"))),
+  lifter_acc_(static_cast<float>(cfg.lookup("simulation.lifter.max_acc_revs")) * static_cast<int>(cfg.lookup("tray.steps_per_rev"))),
+  mm_x_offset_(static_cast<float>(cfg.lookup("localization.mm_x_offset")) / 1000.0f),
+  mm_y_offset_(static_cast<float>(cfg.lookup("localization.mm_y_offset")) / 1000.0f),
+  mm_period_s_(1.0f / static_cast<float>(cfg.lookup("simulation.marvelmind.rate_hz"))),
+  mm_latency_s_(static_cast<int>(cfg.lookup("simulation.marvelmind.latency_ms")) / 1000.0f),
+  mm_trans_noise_(cfg.lookup("simulation.marvelmind.trans_noise")),
+  mm_angle_noise_deg_(cfg.lookup("simulation.marvelmind.angle_noise_deg")),
+  cam_period_s_(1.0f / static_cast<float>(cfg.lookup("simulation.camera.rate_hz"))),
+  cam_latency_s_(static_cast<int>(cfg.lookup("simulation.camera.latency_ms")) / 1000.0f),
+  cam_trans_noise_(cfg.lookup("simulation.camera.trans_noise")),
+  cam_angle_noise_(cfg.lookup("simulation.camera.angle_noise")),
+  cam_max_range_(cfg.lookup("simulation.camera.max_range")),
+  cam_target_(cfg.lookup("simulation.camera.target")[0], 
+              cfg.lookup("simulation.camera.target")[1], 
+              cfg.lookup("simulation.camera.target")[2]),
+  rng_(static_cast<int>(cfg.lookup("simulation.seed"))),
+  noise_(0.0, 1.0)
+{
+    // Same kinematics as doIK in robot_motor_driver.ino
+    const float sq3 = sqrt(3.0);
+    const float d = wheel_dist_from_center_;
+    ik_ << -sq3 / 2, 0.5, d,
+            sq3 / 2, 0.5, d,
+            0,      -1,   d;
+    ik_ *= -belt_ratio_ / wheel_radius_;
+    fk_ = ik_.inverse();
+
+    Point start_pose(cfg.lookup("simulation.start_pose")[0], 
+                     cfg.lookup("simulation.start_pose")[1], 
+                     cfg.lookup("simulation.start_pose")[2]);
+    reset(start_pose);
+}
+
+void SimRobotPlant::reset(Point pose)
+{
+    pose_ = pose;
+    base_power_ = false;
+    motor_vel_ = Eigen::Vector3f::Zero();
+    motor_target_vel_ = Eigen::Vector3f::Zero();
+    motor_steps_ = Eigen::Vector3f::Zero();
+    motor_steps_output_ = Eigen::Vector3f::Zero();
+    lifter_pos_ = 0;
+    lifter_vel_ = 0;
+    lifter_target_ = 0;
+    lifter_moving_ = false;
+    lifter_homing_ = false;
+
+    last_update_time_ = ClockFactory::getFactoryInstance()->get_clock()->now();
+    last_mm_sample_time_ = last_update_time_;
+    last_cam_sample_time_ = last_update_time_;
+    last_cam_output_ = {{0,0,0}, false, last_update_time_, false};
+    pose_history_.clear();
+    pose_history_.push_back({last_update_time_, pose_});
+}
+
+void SimRobotPlant::update()
+{
+    ClockTimePoint now = ClockFactory::getFactoryInstance()->get_clock()->now();
+    float dt = std::chrono::duration_cast<FpSeconds>(now - last_update_time_).count();
+    if(dt <= 0)
+    {
+        return;
+    }
+
+    float remaining = dt;
+    while(remaining > 0)
+    {
+        float step = std::min(remaining, max_integration_step_s);
+        stepBase(step);
+        stepLifter(step);
+        remaining -= step;
+    }
+    last_update_time_ = now;
+
+    pose_history_.push_back({now, pose_});
+    while(pose_history_.size() > 2 && 
+          std::chrono::duration_cast<FpSeconds>(now - pose_history_[1].time).count() > pose_history_s)
+    {
+        pose_history_.pop_front();
+    }
+}
+
+float SimRobotPlant::moveTowards(float current, float target, float max_delta)
+{
+    if(fabs(target - current) <= max_delta)
+    {
+        return target;
+    }
+    return current + sgn(target - current) * max_delta;
+}
+
+void SimRobotPlant::stepBase(float dt)
+{
+    // Each motor ramps to its own target at the accel limit, same as the ClearCore step generators
+    Eigen::Vector3f prev_vel = motor_vel_;
+    for(int i = 0; i < 3; i++)
+    {
+        float target = base_power_ ? motor_target_vel_[i] : 0.0f;
+        motor_vel_[i] = moveTowards(motor_vel_[i], target, max_motor_acc_ * dt);
+    }
+    motor_steps_ += 0.5 * (prev_vel + motor_vel_) * dt;
+
+    // Motors only ever move by whole steps
+    Eigen::Vector3f whole_steps = motor_steps_.array().floor();
+    Eigen::Vector3f delta_steps = whole_steps - motor_steps_output_;
+    motor_steps_output_ = whole_steps;
+    if(delta_steps.isZero())
+    {
+        return;
+    }
+
+    Eigen::Vector3f local_delta = fk_ * (delta_steps / steps_per_rad_);
+    float mid_angle = pose_.a + 0.5 * local_delta[2];
+    float cA = cos(mid_angle);
+    float sA = sin(mid_angle);
+    pose_.x += cA * local_delta[0] - sA * local_delta[1];
+    pose_.y += sA * local_delta[0] + cA * local_delta[1];
+    pose_.a = wrap_angle(pose_.a + local_delta[2]);
+}
+
+void SimRobotPlant::stepLifter(float dt)
+{
+    if(!lifter_moving_)
+    {
+        return;
+    }
+
+    if(lifter_homing_)
+    {
+        // Home switch is at position 0
+        lifter_pos_ -= lifter_homing_vel_ * dt;
+        if(lifter_pos_ <= 0)
+        {
+            lifter_pos_ = 0;
+            lifter_moving_ = false;
+            lifter_homing_ = false;
+        }
+        return;
+    }
+
+    // Trapezoidal move to the target
+    float dist = lifter_target_ - lifter_pos_;
+    float stopping_dist = lifter_vel_ * lifter_vel_ / (2 * lifter_acc_);
+    float desired_vel = fabs(dist) <= stopping_dist ? 0.0f : sgn(dist) * lifter_max_vel_;
+    lifter_vel_ = moveTowards(lifter_vel_, desired_vel, lifter_acc_ * dt);
+    lifter_pos_ += lifter_vel_ * dt;
+    if(fabs(lifter_target_ - lifter_pos_) < 1.0 || sgn(lifter_target_ - lifter_pos_) != sgn(dist))
+    {
+        lifter_pos_ = lifter_target_;
+        lifter_vel_ = 0;
+        lifter_moving_ = false;
+    }
+}
+
+void SimRobotPlant::setBasePower(bool on)
+{
+    update();
+    base_power_ = on;
+    if(!on)
+    {
+        motor_target_vel_ = Eigen::Vector3f::Zero();
+    }
+}
+
+void SimRobotPlant::commandBaseVelocity(Velocity local_cmd)
+{
+    update();
+    Eigen::Vector3f cmd = {local_cmd.vx, local_cmd.vy, local_cmd.va};
+    motor_target_vel_ = ik_ * cmd * steps_per_rad_;
+    for(int i = 0; i < 3; i++)
+    {
+        motor_target_vel_[i] = std::max(std::min(motor_target_vel_[i], max_motor_vel_), -max_motor_vel_);
+    }
+}
+
+Velocity SimRobotPlant::getBaseVelocity()
+{
+    update();
+    Eigen::Vector3f local_vel = fk_ * (motor_vel_ / steps_per_rad_);
+    return {local_vel[0], local_vel[1], local_vel[2]};
+}
+
+bool SimRobotPlant::isBaseMoving()
+{
+    update();
+    return !motor_vel_.isZero();
+}
+
+void SimRobotPlant::commandLifterPosition(long steps)
+{
+    update();
+    lifter_target_ = steps;
+    lifter_moving_ = true;
+    lifter_homing_ = false;
+}
+
+void SimRobotPlant::homeLifter()
+{
+    update();
+    lifter_moving_ = true;
+    lifter_homing_ = true;
+    lifter_vel_ = 0;
+}
+
+void SimRobotPlant::stopLifter()
+{
+    update();
+    lifter_moving_ = false;
+    lifter_homing_ = false;
+    lifter_vel_ = 0;
+}
+
+bool SimRobotPlant::isLifterMoving()
+{
+    update();
+    return lifter_moving_;
+}
+
+long SimRobotPlant::getLifterPosition()
+{
+    update();
+    return lround(lifter_pos_);
+}
+
+Point SimRobotPlant::getPastPose(ClockTimePoint time)
+{
+    for(auto it = pose_history_.rbegin(); it != pose_history_.rend(); it++)
+    {
+        if(it->time <= time)
+        {
+            return it->pose;
+        }
+    }
+    return pose_history_.front().pose;
+}
+
+std::vector<float> SimRobotPlant::getMarvelmindReading()
+{
+    update();
+    std::vector<float> output;
+    float dt = std::chrono::duration_cast<FpSeconds>(last_update_time_ - last_mm_sample_time_).count();
+    if(dt < mm_period_s_)
+    {
+        return output;
+    }
+    last_mm_sample_time_ = last_update_time_;
+
+    // The beacons report the pair center, which is offset from the center of rotation
+    ClockTimePoint sample_time = last_update_time_ - std::chrono::duration_cast<ClockTimePoint::duration>(FpSeconds(mm_latency_s_));
+    Point pose = getPastPose(sample_time);
+    float cA = cos(pose.a);
+    float sA = sin(pose.a);
+    output.push_back(pose.x + cA * mm_x_offset_ - sA * mm_y_offset_ + mm_trans_noise_ * noise_(rng_));
+    output.push_back(pose.y + sA * mm_x_offset_ + cA * mm_y_offset_ + mm_trans_noise_ * noise_(rng_));
+    output.push_back(pose.a * 180.0 / M_PI + mm_angle_noise_deg_ * noise_(rng_));
+    return output;
+}
+
+CameraTrackerOutput SimRobotPlant::getCameraReading()
+{
+    update();
+    float dt = std::chrono::duration_cast<FpSeconds>(last_update_time_ - last_cam_sample_time_).count();
+    if(dt < cam_period_s_)
+    {
+        return last_cam_output_;
+    }
+    last_cam_sample_time_ = last_update_time_;
+
+    // Robot pose relative to the vision target, which is what the camera tracker measures
+    ClockTimePoint sample_time = last_update_time_ - std::chrono::duration_cast<ClockTimePoint::duration>(FpSeconds(cam_latency_s_));
+    Point pose = getPastPose(sample_time);
+    float dx = pose.x - cam_target_.x;
+    float dy = pose.y - cam_target_.y;
+    float cA = cos(cam_target_.a);
+    float sA = sin(cam_target_.a);
+    Point relative_pose( cA * dx + sA * dy + cam_trans_noise_ * noise_(rng_),
+                        -sA * dx + cA * dy + cam_trans_noise_ * noise_(rng_),
+                         wrap_angle(pose.a - cam_target_.a) + cam_angle_noise_ * noise_(rng_));
+    bool in_view = sqrt(dx*dx + dy*dy) < cam_max_range_;
+
+    last_cam_output_ = {relative_pose, in_view, sample_time, in_view};
+    return last_cam_output_;
+}
@@ -0,0 +1,142 @@
+#ifndef SimRobotPlant_h
+#define SimRobotPlant_h
+
+#include <deque>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "utils.h"
+#include "camera_tracker/CameraTrackerBase.h"
+
+// Physical model of the robot used in simulation mode. Models the three omni wheel base
+// the same way robot_motor_driver.ino drives it (per-motor velocity/accel limits and whole
+// step output), the tray lifter, and the marvelmind and camera sensors with latency and
+// noise. Time comes from the ClockFactory clock, so it runs as fast as the mock clock is
+// advanced and is repeatable for a given seed.
+class SimRobotPlant
+{
+  public:
+
+    static SimRobotPlant* getInstance();
+
+    // Puts the robot back at pose, stopped with motors disabled and sensor history cleared
+    void reset(Point pose);
+
+    // Advances the model to the current clock time
+    void update();
+
+    // Enable or disable the base motors. Disabled motors ignore velocity commands and stop.
+    void setBasePower(bool on);
+
+    // Sets the target local cartesian velocity, converted to motor speeds the same way as the firmware
+    void commandBaseVelocity(Velocity local_cmd);
+
+    // Local cartesian velocity computed from the current motor speeds, as reported by the firmware
+    Velocity getBaseVelocity();
+
+    bool isBaseMoving();
+
+    // Lifter position in steps from home
+    void commandLifterPosition(long steps);
+
+    void homeLifter();
+
+    void stopLifter();
+
+    bool isLifterMoving();
+
+    long getLifterPosition();
+
+    // True state of the robot
+    Point getTruePose() { return pose_; };
+
+    // Returns x (m), y (m), a (deg) of the marvelmind pair if a new reading is available,
+    // otherwise an empty vector, matching MarvelmindWrapper::getPositions
+    std::vector<float> getMarvelmindReading();
+
+    // Latest camera pose of the robot relative to the vision target
+    CameraTrackerOutput getCameraReading();
+
+    // Moves the vision target, which starts at simulation.camera.target
+    void setCameraTarget(Point target) { cam_target_ = target; };
+
+    Point getCameraTarget() { return cam_target_; };
+
+    // Delete copy and assignment constructors
+    SimRobotPlant(SimRobotPlant const&) = delete;
+    SimRobotPlant& operator= (SimRobotPlant const&) = delete;
+
+  private:
+
+    struct PoseSample
+    {
+        ClockTimePoint time;
+        Point pose;
+    };
+
+    SimRobotPlant();
+
+    void stepBase(float dt);
+
+    void stepLifter(float dt);
+
+    // Pose at the given time, from the recorded history
+    Point getPastPose(ClockTimePoint time);
+
+    float moveTowards(float current, float target, float max_delta);
+
+    static SimRobotPlant* instance;
+
+    // Base parameters
+    float wheel_radius_;
+    float wheel_dist_from_center_;
+    float belt_ratio_;
+    float steps_per_rad_;
+    float max_motor_vel_;                  // steps/s
+    float max_motor_acc_;                  // steps/s^2
+    Eigen::Matrix3f ik_;                   // Local cartesian velocity -> motor speed (rad/s)
+    Eigen::Matrix3f fk_;                   // Motor speed (rad/s) -> local cartesian velocity
+
+    // Base state
+    Point pose_;
+    bool base_power_;
+    Eigen::Vector3f motor_vel_;            // Current motor speeds (steps/s)
+    Eigen::Vector3f motor_target_vel_;     // Commanded motor speeds (steps/s)
+    Eigen::Vector3f motor_steps_;          // Step position including fractional steps not yet output
+    Eigen::Vector3f motor_steps_output_;   // Whole steps output so far
+
+    // Lifter parameters and state
+    float lifter_max_vel_;                 // steps/s
+    float lifter_homing_vel_;              // steps/s
+    float lifter_acc_;                     // steps/s^2
+    float lifter_pos_;
+    float lifter_vel_;
+    float lifter_target_;
+    bool lifter_moving_;
+    bool lifter_homing_;
+
+    // Sensor parameters and state
+    float mm_x_offset_;
+    float mm_y_offset_;
+    float mm_period_s_;
+    float mm_latency_s_;
+    float mm_trans_noise_;
+    float mm_angle_noise_deg_;
+    ClockTimePoint last_mm_sample_time_;
+    float cam_period_s_;
+    float cam_latency_s_;
+    float cam_trans_noise_;
+    float cam_angle_noise_;
+    float cam_max_range_;
+    Point cam_target_;
+    ClockTimePoint last_cam_sample_time_;
+    CameraTrackerOutput last_cam_output_;
+
+    std::deque<PoseSample> pose_history_;
+    ClockTimePoint last_update_time_;
+    std::mt19937 rng_;
+    std::normal_distribution<float> noise_;
+};
+
+#endif //SimRobotPlant_h
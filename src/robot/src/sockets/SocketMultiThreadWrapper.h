@@ -5,6 +5,7 @@
 #include <thread>
 #include "SocketMultiThreadWrapperBase.h"
 
+// Also the largest message the robot can receive, RobotClient.py checks sequences against its copy in ROBOT_BUFFER_SIZE
 #define BUFFER_SIZE 2048
 
 class SocketMultiThreadWrapper : public SocketMultiThreadWrapperBase
@@ -2,15 +2,15 @@
  
 #include "utils.h"
 
+#include <algorithm>
 #include <cmath>
 #include <chrono>
 #include <plog/Log.h>
 #include <iostream>
 #include <stdio.h>
 #include <sstream>
+#include <pthread.h>
 #include <plog/Init.h>
-#include <plog/Formatters/CsvFormatter.h>
-#include <plog/Appenders/RollingFileAppender.h>
 
 float wrap_angle(float a)
 {
@@ -54,42 +54,154 @@ bool RateController::ready()
 }
 
 
-TimeRunningAverage::TimeRunningAverage(int window_size)
-: buf_(),
-  buf_idx_(0),
-  window_size_(window_size),
-  filled_(false),
-  started_(false),
-  timer_()
+WindowedStats::WindowedStats(int window_size)
+: window_size_(std::max(window_size, 1)),
+  buf_(window_size_, 0),
+  num_added_(0),
+  count_(0),
+  sum_(0),
+  sum_sq_(0),
+  min_queue_(),
+  max_queue_(),
+  histogram_(Buckets::num_buckets, 0)
 {
-    buf_.reserve(window_size_);
+    min_queue_.samples.resize(window_size_);
+    max_queue_.samples.resize(window_size_);
 }
 
-int TimeRunningAverage::get_ms()
+void WindowedStats::add(uint32_t value)
 {
-    int sum_end_idx = buf_idx_;
-    if(filled_)
+    int slot = num_added_ % window_size_;
+
+    // Drop the value leaving the window
+    if(count_ == window_size_)
+    {
+        uint32_t old = buf_[slot];
+        sum_ -= old;
+        sum_sq_ -= static_cast<uint64_t>(old) * old;
+        histogram_[Buckets::index(old)]--;
+        uint64_t old_sample = num_added_ - window_size_;
+        for(MonotonicQueue* q : {&min_queue_, &max_queue_})
+        {
+            if(q->size > 0 && q->samples[q->head] == old_sample)
+            {
+                q->head = (q->head + 1) % window_size_;
+                q->size--;
+            }
+        }
+    }
+    else
     {
-        sum_end_idx = window_size_;
+        count_++;
     }
 
-    if (sum_end_idx == 0)
+    buf_[slot] = value;
+    sum_ += value;
+    sum_sq_ += static_cast<uint64_t>(value) * value;
+    histogram_[Buckets::index(value)]++;
+    pushMonotonic(min_queue_, num_added_, true);
+    pushMonotonic(max_queue_, num_added_, false);
+    num_added_++;
+}
+
+void WindowedStats::pushMonotonic(MonotonicQueue& q, uint64_t sample, bool keep_min)
+{
+    // Anything at the back that can no longer be the min (or max) of the window is dropped
+    uint32_t value = buf_[sample % window_size_];
+    while(q.size > 0)
     {
-        return 0;
+        int back = (q.head + q.size - 1) % window_size_;
+        uint32_t back_value = buf_[q.samples[back] % window_size_];
+        if(keep_min ? back_value < value : back_value > value)
+        {
+            break;
+        }
+        q.size--;
     }
+    q.samples[(q.head + q.size) % window_size_] = sample;
+    q.size++;
+}
 
-    int sum = 0;
-    for(int i = 0; i < sum_end_idx; i++)
+void WindowedStats::reset()
+{
+    num_added_ = 0;
+    count_ = 0;
+    sum_ = 0;
+    sum_sq_ = 0;
+    min_queue_.head = 0;
+    min_queue_.size = 0;
+    max_queue_.head = 0;
+    max_queue_.size = 0;
+    std::fill(histogram_.begin(), histogram_.end(), 0);
+}
+
+float WindowedStats::get_mean() const
+{
+    if(count_ == 0) return 0;
+    return static_cast<double>(sum_) / count_;
+}
+
+float WindowedStats::get_stddev() const
+{
+    if(count_ == 0) return 0;
+    double mean = static_cast<double>(sum_) / count_;
+    double var = static_cast<double>(sum_sq_) / count_ - mean * mean;
+    return var > 0 ? std::sqrt(var) : 0;
+}
+
+uint32_t WindowedStats::get_min() const
+{
+    if(count_ == 0) return 0;
+    return buf_[min_queue_.samples[min_queue_.head] % window_size_];
+}
+
+uint32_t WindowedStats::get_max() const
+{
+    if(count_ == 0) return 0;
+    return buf_[max_queue_.samples[max_queue_.head] % window_size_];
+}
+
+uint32_t WindowedStats::get_percentile(float p) const
+{
+    if(count_ == 0) return 0;
+    int target = std::max(1, static_cast<int>(std::ceil(p * count_)));
+    int seen = 0;
+    for(int i = 0; i < Buckets::num_buckets; i++)
     {
-        sum += buf_[i];
+        seen += histogram_[i];
+        if(seen >= target)
+        {
+            return std::max(std::min(Buckets::upperBound(i), get_max()), get_min());
+        }
     }
-    return sum / sum_end_idx;
+    return get_max();
 }
 
-float TimeRunningAverage::get_sec()
+TimeRunningAverage::TimeRunningAverage(int window_size)
+: stats_(window_size),
+  started_(false),
+  timer_()
 {
-    float ms = static_cast<float>(get_ms());
-    return ms / 1000.0;
+}
+
+float TimeRunningAverage::get_ms() const
+{
+    return stats_.get_mean() / 1000.0;
+}
+
+float TimeRunningAverage::get_sec() const
+{
+    return stats_.get_mean() / 1000000.0;
+}
+
+float TimeRunningAverage::get_p99_ms() const
+{
+    return stats_.get_percentile(0.99) / 1000.0;
+}
+
+float TimeRunningAverage::get_max_ms() const
+{
+    return stats_.get_max() / 1000.0;
 }
 
 void TimeRunningAverage::mark_point()
@@ -101,15 +213,8 @@ void TimeRunningAverage::mark_point()
         return;
     }
 
-    buf_[buf_idx_] = timer_.dt_ms();
+    stats_.add(timer_.dt_us());
     timer_.reset();
-
-    buf_idx_++;
-    if (buf_idx_ >= window_size_)
-    {
-        filled_ = true;
-        buf_idx_ = 0;
-    }
 }
 
 
@@ -252,6 +357,55 @@ float PositionController::compute(float target_position, float actual_position,
 }
 
 
+TrackingController::TrackingController(Gains gains, float max_correction) 
+: gains_(gains),
+  max_correction_(max_correction),
+  error_sum_(0.0)
+{ }
+
+void TrackingController::reset()
+{
+    error_sum_ = 0.0;
+}
+
+float TrackingController::compute(float target_position, float actual_position, float target_velocity, float actual_velocity, 
+                                  float target_acceleration, float dt)
+{
+    float pos_err = target_position - actual_position;
+    float vel_err = target_velocity - actual_velocity;
+    float feedback = gains_.kp * pos_err + gains_.kd * vel_err;
+
+    // Conditional integration: keep the new error only if the correction has room for it or it unwinds the sum
+    float error_sum = error_sum_ + pos_err * dt;
+    if(fabs(feedback + gains_.ki * error_sum) < max_correction_ || fabs(error_sum) < fabs(error_sum_))
+    {
+        error_sum_ = error_sum;
+    }
+    float correction = std::max(-max_correction_, std::min(max_correction_, feedback + gains_.ki * error_sum_));
+
+    return target_velocity + gains_.ka * target_acceleration + correction;
+}
+
+
+bool setCurrentThreadAffinity(int core)
+{
+    if(core < 0)
+    {
+        return true;
+    }
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if(rc != 0)
+    {
+        PLOGW.printf("Unable to pin thread to core %i, error %i", core, rc);
+        return false;
+    }
+    return true;
+}
+
 float vectorMean(const std::vector<float>& data)
 {
     if(data.empty()) return 0;
@@ -310,20 +464,3 @@ std::vector<float> parseCommaDelimitedStringToFloat(const std::string& str_in)
     }
     return result;
 }
-
-
-
-void reset_last_motion_logger()
-{
-    // Delete the loggers
-    g_logger.reset();
-    g_appender.reset();
-
-    // Delete the file
-    remove("log/last_motion_log.csv");
-
-    // Re-initialize the logger
-    g_appender.reset(new plog::RollingFileAppender<plog::CsvFormatter>("log/last_motion_log.csv"));
-    g_logger.reset(new plog::Logger<MOTION_CSV_LOG_ID>(plog::debug));
-    g_logger->addAppender(g_appender.get());
-}
\ No newline at end of file
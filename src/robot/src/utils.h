@@ -1,9 +1,13 @@
 #ifndef utils_h
 #define utils_h
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <math.h>
 #include <plog/Log.h> 
 #include <plog/Logger.h> 
@@ -105,24 +109,112 @@ class Timer
 };
 
 
-// Keeps an average of how long the time delta is between events
+// HDR style log-linear buckets for histograms of 32 bit values. Values under 2 * sub_bucket_count get their own
+// bucket, above that each power of two is split into sub_bucket_count linear buckets, so the top of a value's
+// bucket is within 1 / sub_bucket_count of it over the whole range.
+template<int SubBucketBits>
+class LogLinearBuckets
+{
+  public:
+    static constexpr int sub_bucket_bits = SubBucketBits;
+    static constexpr int sub_bucket_count = 1 << sub_bucket_bits;
+    static constexpr int num_buckets = (33 - sub_bucket_bits) * sub_bucket_count;
+
+    static int index(uint32_t value)
+    {
+        if(value < 2 * sub_bucket_count)
+        {
+            return value;
+        }
+        // Shift so the value lands in [sub_bucket_count, 2*sub_bucket_count), one block of buckets per shift
+        int shift = (31 - __builtin_clz(value)) - sub_bucket_bits;
+        return shift * sub_bucket_count + (value >> shift);
+    }
+
+    // Largest value that lands in bucket idx
+    static uint32_t upperBound(int idx)
+    {
+        if(idx < 2 * sub_bucket_count)
+        {
+            return idx;
+        }
+        int shift = idx / sub_bucket_count - 1;
+        uint64_t sub = idx - shift * sub_bucket_count;
+        return static_cast<uint32_t>(std::min<uint64_t>(((sub + 1) << shift) - 1, UINT32_MAX));
+    }
+};
+
+// Statistics over the last window_size values added. Every query is O(1): the sum and sum of
+// squares are kept running, min/max use monotonic queues and percentiles come from a fixed
+// log-linear histogram (8 buckets per power of two, so they are within about 12% of the real value).
+class WindowedStats
+{
+  public:
+    WindowedStats(int window_size);
+
+    void add(uint32_t value);
+
+    void reset();
+
+    int get_count() const { return count_; };
+
+    float get_mean() const;
+
+    float get_stddev() const;
+
+    uint32_t get_min() const;
+
+    uint32_t get_max() const;
+
+    // Approximate value that fraction p (0 to 1) of the window is at or below
+    uint32_t get_percentile(float p) const;
+
+    using Buckets = LogLinearBuckets<3>;
+
+  private:
+
+    // Ring of sample numbers whose values are monotonic, front is the min (or max) of the window
+    struct MonotonicQueue
+    {
+        std::vector<uint64_t> samples;
+        int head = 0;
+        int size = 0;
+    };
+
+    void pushMonotonic(MonotonicQueue& q, uint64_t sample, bool keep_min);
+
+    int window_size_;
+    std::vector<uint32_t> buf_;
+    uint64_t num_added_;
+    int count_;
+    uint64_t sum_;
+    uint64_t sum_sq_;
+    MonotonicQueue min_queue_;
+    MonotonicQueue max_queue_;
+    std::vector<uint32_t> histogram_;
+};
+
+// Keeps statistics of how long the time delta is between events, in microseconds
 class TimeRunningAverage
 {
   public:
     TimeRunningAverage(int window_size);
 
-    int get_ms();
+    float get_ms() const;
+
+    float get_sec() const;
+
+    float get_p99_ms() const;
+
+    float get_max_ms() const;
 
-    float get_sec();
+    const WindowedStats& get_stats() const { return stats_; };
 
     void mark_point();
 
   private:
 
-    std::vector<int> buf_;
-    int buf_idx_;
-    int window_size_;
-    bool filled_;
+    WindowedStats stats_;
     bool started_;
     Timer timer_;
 
@@ -306,6 +398,123 @@ class CircularBuffer
 
 };
 
+// Bounded lock-free queue for exactly one producer thread and one consumer thread. push and pop never block,
+// waitPush and waitPop block on a condition variable that is only touched while one of them is waiting.
+template<class T>
+class SpscQueue
+{
+  public:
+    SpscQueue(int capacity)
+    : data_(capacity + 1),
+      head_(0),
+      tail_(0),
+      wait_mutex_(),
+      wait_cv_(),
+      waiters_(0)
+    {}
+
+    // Returns false without blocking if the queue is full
+    bool push(T&& val)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t next = increment(tail);
+        if(next == head_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        data_[tail] = std::move(val);
+        tail_.store(next, std::memory_order_release);
+        notifyWaiters();
+        return true;
+    }
+
+    // Returns false without blocking if the queue is empty
+    bool pop(T& val)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if(head == tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        val = std::move(data_[head]);
+        head_.store(increment(head), std::memory_order_release);
+        notifyWaiters();
+        return true;
+    }
+
+    // Waits for room instead of failing when the queue is full. Returns false without pushing if running goes false.
+    bool waitPush(T&& val, const std::atomic<bool>& running)
+    {
+        while(!push(std::move(val)))
+        {
+            if(!running) return false;
+            wait([&]{ return !full() || !running; });
+        }
+        return true;
+    }
+
+    // Waits for something to pop instead of failing when the queue is empty. Returns false if running goes false.
+    bool waitPop(T& val, const std::atomic<bool>& running)
+    {
+        while(!pop(val))
+        {
+            if(!running) return false;
+            wait([&]{ return !empty() || !running; });
+        }
+        return true;
+    }
+
+    // Wakes a blocked waitPush or waitPop so it sees its running flag was cleared
+    void wakeAll()
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        wait_cv_.notify_all();
+    }
+
+    bool empty() const 
+    { 
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+  private:
+    size_t increment(size_t idx) const { return (idx + 1) % data_.size(); }
+
+    bool full() const
+    {
+        return increment(tail_.load(std::memory_order_acquire)) == head_.load(std::memory_order_acquire);
+    }
+
+    template<class Predicate>
+    void wait(Predicate pred)
+    {
+        std::unique_lock<std::mutex> lock(wait_mutex_);
+        waiters_.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wait_cv_.wait(lock, pred);
+        waiters_.fetch_sub(1);
+    }
+
+    // The fence pairs with the one in wait between the waiter counting itself and checking the queue, so either the
+    // waiter sees the change or this sees the waiter. push and pop only take the lock when someone is actually waiting.
+    void notifyWaiters()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(waiters_.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+            wait_cv_.notify_all();
+        }
+    }
+
+    std::vector<T> data_;
+    // Separate cache lines so the producer and consumer don't contend
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+    std::atomic<int> waiters_;
+};
+
 
 class PositionController
 {
@@ -332,6 +541,39 @@ class PositionController
     float error_sum_;
 };
 
+// Like PositionController, but also feeds the target acceleration forward to lead the velocity the motors
+// actually reach, and limits how much the feedback can add so a big error can't wind up the integral
+class TrackingController
+{
+  public:
+
+    struct Gains
+    {
+        float kp;
+        float ki;
+        float kd;
+        float ka;   // s, target acceleration is multiplied by this and added to the target velocity
+    };
+
+    TrackingController(Gains gains = {0,0,0,0}, float max_correction = 0);
+
+    // Gains can change while tracking (i.e. scheduled on speed), the error sum carries over
+    void setGains(Gains gains) { gains_ = gains; };
+
+    void reset();
+
+    // Compute control velocity for target position with velocity and acceleration feedforward. The feedback 
+    // correction is clamped to +/- max_correction and the error sum only grows while it isn't clamped.
+    float compute(float target_position, float actual_position, float target_velocity, float actual_velocity, 
+                  float target_acceleration, float dt);
+
+  private:
+
+    Gains gains_;
+    float max_correction_;
+    float error_sum_;
+};
+
 struct LocalizationMetrics 
 {
     float last_position_uncertainty;
@@ -357,9 +599,39 @@ struct CameraDebug
     float pose_x;
     float pose_y;
     float pose_a;
-    int loop_ms = 0;
+    float loop_ms = 0;
+    int side_latency_ms = 0;
+    int rear_latency_ms = 0;
+    int side_dropped_frames = 0;
+    int rear_dropped_frames = 0;
+    float pose_residual = 0;
 };
 
+struct TrayState
+{
+    bool initialized = false;
+    bool action_running = false;
+    bool load_complete = false;
+    int action = 0;
+    int action_step = 0;
+    bool fault = false;
+
+    bool operator== (const TrayState& other) const
+    {
+        return initialized == other.initialized && action_running == other.action_running &&
+               load_complete == other.load_complete && action == other.action && action_step == other.action_step &&
+               fault == other.fault;
+    }
+};
+
+//*******************************************
+//           Threads
+//*******************************************
+
+// Pin the calling thread to a single cpu core. A negative core leaves the thread unpinned.
+bool setCurrentThreadAffinity(int core);
+
+
 //*******************************************
 //           Misc math
 //*******************************************
@@ -378,13 +650,4 @@ float zScore(float mean, float stddev, float reading);
 std::vector<std::string> parseCommaDelimitedString(const std::string& str_in);
 std::vector<float> parseCommaDelimitedStringToFloat(const std::string& str_in);
 
-
-//*******************************************
-//           Logging
-//*******************************************
-
-static std::unique_ptr<plog::IAppender> g_appender;
-static std::unique_ptr<plog::Logger<MOTION_CSV_LOG_ID>> g_logger;
-void reset_last_motion_logger();
-
 #endif
@@ -0,0 +1,132 @@
+#include <Catch/catch.hpp>
+#include <fstream>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "AsyncLogAppender.h"
+#include "test-utils.h"
+
+static std::vector<std::string> readLines(const std::string& path)
+{
+    std::vector<std::string> lines;
+    std::ifstream file(path);
+    std::string line;
+    while(std::getline(file, line))
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+TEST_CASE("Async log writes records", "[AsyncLog]")
+{
+    const std::string path = temp_test_path("async_test_log.txt");
+    remove(path.c_str());
+    {
+        AsyncLogSink sink(path, "header\n", 0, 0);
+        for(int i = 0; i < 10; i++)
+        {
+            REQUIRE(sink.push("line " + std::to_string(i) + "\n"));
+        }
+        REQUIRE(sink.getDroppedCount() == 0);
+    }
+
+    // Destroying the sink writes out everything still queued
+    std::vector<std::string> lines = readLines(path);
+    REQUIRE(lines.size() == 11);
+    CHECK(lines[0] == "header");
+    CHECK(lines[1] == "line 0");
+    CHECK(lines[10] == "line 9");
+}
+
+TEST_CASE("Async log restart", "[AsyncLog]")
+{
+    const std::string path = temp_test_path("async_test_log.txt");
+    remove(path.c_str());
+    {
+        AsyncLogSink sink(path, "header\n", 0, 0);
+        sink.push("old\n");
+        sink.restart();
+        sink.push("new\n");
+    }
+
+    std::vector<std::string> lines = readLines(path);
+    REQUIRE(lines.size() == 2);
+    CHECK(lines[0] == "header");
+    CHECK(lines[1] == "new");
+}
+
+TEST_CASE("Async log counts dropped records", "[AsyncLog]")
+{
+    const std::string path = temp_test_path("async_test_log.txt");
+    remove(path.c_str());
+    const int num_records = 100000;
+    int num_pushed = 0;
+    int num_dropped = 0;
+    {
+        AsyncLogSink sink(path, "", 0, 0);
+        for(int i = 0; i < num_records; i++)
+        {
+            if(sink.push("x\n")) num_pushed++;
+        }
+        num_dropped = sink.getDroppedCount();
+    }
+
+    // Every record is either written or counted as dropped, and drops are noted in the file
+    REQUIRE(num_pushed + num_dropped == num_records);
+    int num_written = 0;
+    int num_noted_dropped = 0;
+    for(const auto& line : readLines(path))
+    {
+        if(line == "x")
+        {
+            num_written++;
+        }
+        else
+        {
+            num_noted_dropped += std::stoi(line.substr(line.find(']') + 2));
+        }
+    }
+    CHECK(num_written == num_pushed);
+    CHECK(num_noted_dropped == num_dropped);
+}
+
+TEST_CASE("Async log rolls files", "[AsyncLog]")
+{
+    const std::string path = temp_test_path("async_test_roll.txt");
+    const std::string path_1 = temp_test_path("async_test_roll.1.txt");
+    const std::string path_2 = temp_test_path("async_test_roll.2.txt");
+    remove(path.c_str());
+    remove(path_1.c_str());
+    remove(path_2.c_str());
+    {
+        AsyncLogSink sink(path, "", 100, 3);
+        for(int i = 0; i < 30; i++)
+        {
+            // 10 bytes per line, wait so each line lands in its own batch
+            sink.push("123456789\n");
+            usleep(10000);
+        }
+    }
+
+    CHECK(readLines(path_1).size() >= 10);
+    CHECK(readLines(path_2).size() >= 10);
+    CHECK(readLines(path).size() <= 10);
+}
+
+TEST_CASE("Async log creates its directory", "[AsyncLog]")
+{
+    const std::string dir = temp_test_path("async_test_dir");
+    const std::string path = dir + "/nested/async_test_log.txt";
+    std::filesystem::remove_all(dir);
+    {
+        AsyncLogSink sink(path, "header\n", 0, 0);
+        sink.push("line\n");
+    }
+
+    std::vector<std::string> lines = readLines(path);
+    REQUIRE(lines.size() == 2);
+    CHECK(lines[1] == "line");
+    std::filesystem::remove_all(dir);
+}
@@ -35,6 +35,31 @@ TEST_CASE("Robot coords from image coords", "[Camera]")
         CHECK(xy_world[0] < side_offset_x);
         CHECK(xy_world[1] > side_offset_y);
     }
+
+    SECTION("Round trip")
+    {
+        Eigen::Vector2f uv = {100, 50};
+        Eigen::Vector2f uv_round_trip = c.robotToCamera(c.cameraToRobot({uv[0], uv[1]}));
+        CHECK(uv_round_trip[0] == Approx(uv[0]).margin(1e-2));
+        CHECK(uv_round_trip[1] == Approx(uv[1]).margin(1e-2));
+    }
+
+    SECTION("Batched matches single point")
+    {
+        Eigen::Matrix2Xf uv(2,3);
+        uv << 0, 160, 320,
+              0, 120, 240;
+        Eigen::Matrix2Xf xy_world = c.cameraToRobotBatch(uv);
+        Eigen::Matrix2Xf uv_round_trip = c.robotToCameraBatch(xy_world);
+        for(int i = 0; i < uv.cols(); i++)
+        {
+            Eigen::Vector2f xy_single = c.cameraToRobot({uv(0,i), uv(1,i)});
+            CHECK(xy_world(0,i) == Approx(xy_single[0]));
+            CHECK(xy_world(1,i) == Approx(xy_single[1]));
+            CHECK(uv_round_trip(0,i) == Approx(uv(0,i)).margin(1e-2));
+            CHECK(uv_round_trip(1,i) == Approx(uv(1,i)).margin(1e-2));
+        }
+    }
 }
 
 // Verify that camera params between actual and test config are synced if this test is giving trouble
@@ -115,4 +140,72 @@ TEST_CASE("Marker Detection", "[Camera]")
             CHECK(output.uv == item.expected_point_px);
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Replay frames", "[Camera]")
+{
+    SafeConfigModifier<bool> config_modifier_1("vision_tracker.debug.use_debug_image", false);
+    SafeConfigModifier<bool> config_modifier_2("vision_tracker.debug.use_replay", true);
+    SafeConfigModifier<std::string> config_modifier_3("vision_tracker.side.replay_path", "/home/pi/DominoRobot/src/robot/test/testdata/new_images/");
+
+    CameraPipeline c(CAMERA_ID::SIDE, /*start_thread=*/ false);
+
+    int num_frames = 0;
+    int num_detections = 0;
+    while(num_frames < 100)
+    {
+        c.oneLoop();
+        if(c.replayFinished()) break;
+        CameraPipelineOutput output = c.getData();
+        num_frames++;
+        if(output.ok) num_detections++;
+    }
+
+    // Matches the side images and expected detections listed in the Marker Detection test
+    CHECK(c.replayFinished());
+    CHECK(num_frames == 9);
+    CHECK(num_detections == 7);
+}
+
+TEST_CASE("Replay frames staged", "[Camera]")
+{
+    SafeConfigModifier<bool> config_modifier_1("vision_tracker.debug.use_debug_image", false);
+    SafeConfigModifier<bool> config_modifier_2("vision_tracker.debug.use_replay", true);
+    SafeConfigModifier<std::string> config_modifier_3("vision_tracker.side.replay_path", "/home/pi/DominoRobot/src/robot/test/testdata/new_images/");
+    SafeConfigModifier<bool> config_modifier_4("vision_tracker.staged.enabled", true);
+
+    // Same frames as above, now through the capture, preprocess and detect threads
+    CameraPipeline c(CAMERA_ID::SIDE, /*start_thread=*/ true);
+    CameraPipelineOutput output;
+    for(int i = 0; i < 1000; i++)
+    {
+        output = c.getData();
+        if(c.replayFinished() && output.frame_count == 9) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    c.stop();
+
+    CHECK(c.replayFinished());
+    CHECK(output.frame_count == 9);
+    CHECK(output.dropped_frames == 0);
+}
+
+TEST_CASE("Bad replay path", "[Camera]")
+{
+    SafeConfigModifier<bool> config_modifier_1("vision_tracker.debug.use_debug_image", false);
+    SafeConfigModifier<bool> config_modifier_2("vision_tracker.debug.use_replay", true);
+
+    // A directory without any frames for the camera
+    std::string empty_dir = temp_test_path("empty_replay");
+    std::filesystem::create_directories(empty_dir);
+    {
+        SafeConfigModifier<std::string> config_modifier_3("vision_tracker.side.replay_path", empty_dir);
+        REQUIRE_THROWS_AS(CameraPipeline(CAMERA_ID::SIDE, /*start_thread=*/ false), std::runtime_error);
+    }
+
+    // Not a directory, so it is opened as a video
+    {
+        SafeConfigModifier<std::string> config_modifier_3("vision_tracker.side.replay_path", empty_dir + "/missing.avi");
+        REQUIRE_THROWS_AS(CameraPipeline(CAMERA_ID::SIDE, /*start_thread=*/ false), std::runtime_error);
+    }
+}
@@ -0,0 +1,163 @@
+#include <Catch/catch.hpp>
+
+#include "CommandSequencer.h"
+#include "test-utils.h"
+
+RobotServer::SequenceStep makeStep(COMMAND cmd, bool with_previous=false, float timeout_s=0, 
+                                   SEQUENCE_CONDITION condition=SEQUENCE_CONDITION::NONE)
+{
+    RobotServer::SequenceStep step = {};
+    step.cmd = cmd;
+    step.with_previous = with_previous;
+    step.timeout_s = timeout_s;
+    step.condition = condition;
+    return step;
+}
+
+TEST_CASE("Steps run in order", "[CommandSequencer]")
+{
+    get_mock_clock_and_reset();
+    StateBus bus;
+    CommandSequencer s(bus, 0.9);
+    s.start({makeStep(COMMAND::MOVE), makeStep(COMMAND::PLACE_TRAY), makeStep(COMMAND::MOVE_REL)});
+    REQUIRE(s.isRunning());
+    REQUIRE(s.getNumSteps() == 3);
+
+    std::vector<RobotServer::SequenceStep> steps;
+    REQUIRE(s.update(false, false, &steps));
+    REQUIRE(steps.size() == 1);
+    REQUIRE(steps[0].cmd == COMMAND::MOVE);
+    REQUIRE(s.getCurrentStep() == 1);
+
+    // Place waits for the move even though it is in the other lane
+    steps.clear();
+    REQUIRE(s.update(true, false, &steps));
+    REQUIRE(steps.empty());
+
+    // And starts on the same update the move is done
+    REQUIRE(s.update(false, false, &steps));
+    REQUIRE(steps.size() == 1);
+    REQUIRE(steps[0].cmd == COMMAND::PLACE_TRAY);
+
+    steps.clear();
+    REQUIRE(s.update(false, false, &steps));
+    REQUIRE(steps.size() == 1);
+    REQUIRE(steps[0].cmd == COMMAND::MOVE_REL);
+    REQUIRE(s.isRunning());
+
+    steps.clear();
+    REQUIRE(s.update(true, false, &steps));
+    REQUIRE(s.isRunning());
+    REQUIRE(s.update(false, false, &steps));
+    REQUIRE(steps.empty());
+    REQUIRE(s.isRunning() == false);
+    REQUIRE(s.getCurrentStep() == 3);
+}
+
+TEST_CASE("Steps with previous", "[CommandSequencer]")
+{
+    get_mock_clock_and_reset();
+    StateBus bus;
+    CommandSequencer s(bus, 0.9);
+    s.start({makeStep(COMMAND::MOVE), makeStep(COMMAND::INITIALIZE_TRAY, true), makeStep(COMMAND::MOVE_REL, true)});
+
+    // The tray step starts along with the move, the second move has to wait for the first
+    std::vector<RobotServer::SequenceStep> steps;
+    REQUIRE(s.update(false, false, &steps));
+    REQUIRE(steps.size() == 2);
+    REQUIRE(steps[0].cmd == COMMAND::MOVE);
+    REQUIRE(steps[1].cmd == COMMAND::INITIALIZE_TRAY);
+
+    steps.clear();
+    REQUIRE(s.update(false, true, &steps));
+    REQUIRE(steps.size() == 1);
+    REQUIRE(steps[0].cmd == COMMAND::MOVE_REL);
+}
+
+TEST_CASE("Step conditions", "[CommandSequencer]")
+{
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    StateBus bus;
+    CommandSequencer s(bus, 0.9);
+    s.start({makeStep(COMMAND::MOVE_WITH_VISION, false, 1.0, SEQUENCE_CONDITION::VISION_OK),
+             makeStep(COMMAND::MOVE, false, 1.0, SEQUENCE_CONDITION::LOCALIZED)});
+
+    std::vector<RobotServer::SequenceStep> steps;
+    REQUIRE(s.update(false, false, &steps));
+    REQUIRE(steps.empty());
+
+    CameraTrackerOutput camera_output;
+    camera_output.ok = true;
+    bus.camera.publish(camera_output);
+    mock_clock->advance_ms(500);
+    REQUIRE(s.update(false, false, &steps));
+    REQUIRE(steps.size() == 1);
+
+    SECTION("Met")
+    {
+        LocalizationMetrics metrics = {};
+        metrics.total_confidence = 0.95;
+        bus.localization.publish(metrics);
+        steps.clear();
+        REQUIRE(s.update(false, false, &steps));
+        REQUIRE(steps.size() == 1);
+        REQUIRE(steps[0].cmd == COMMAND::MOVE);
+    }
+
+    SECTION("Timeout")
+    {
+        // Time only counts once the vision move is done and the step is waiting on its condition
+        steps.clear();
+        mock_clock->advance_ms(5000);
+        REQUIRE(s.update(false, false, &steps));
+        mock_clock->advance_ms(900);
+        REQUIRE(s.update(false, false, &steps));
+        mock_clock->advance_ms(200);
+        REQUIRE(s.update(false, false, &steps) == false);
+        REQUIRE(steps.empty());
+        REQUIRE(s.isRunning() == false);
+    }
+}
+
+TEST_CASE("Step timeout while running", "[CommandSequencer]")
+{
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    StateBus bus;
+    CommandSequencer s(bus, 0.9);
+    s.start({makeStep(COMMAND::PLACE_TRAY, false, 2.0), makeStep(COMMAND::MOVE)});
+
+    std::vector<RobotServer::SequenceStep> steps;
+    REQUIRE(s.update(false, false, &steps));
+    mock_clock->advance_ms(1900);
+    REQUIRE(s.update(false, true, &steps));
+    mock_clock->advance_ms(200);
+    REQUIRE(s.update(false, true, &steps) == false);
+    REQUIRE(s.isRunning() == false);
+    REQUIRE(steps.size() == 1);
+}
+
+TEST_CASE("Abort running sequence", "[CommandSequencer]")
+{
+    get_mock_clock_and_reset();
+    StateBus bus;
+    CommandSequencer s(bus, 0.9);
+    s.start({makeStep(COMMAND::MOVE), makeStep(COMMAND::MOVE_REL)});
+
+    std::vector<RobotServer::SequenceStep> steps;
+    REQUIRE(s.update(false, false, &steps));
+    s.abort();
+    REQUIRE(s.isRunning() == false);
+
+    steps.clear();
+    REQUIRE(s.update(false, false, &steps));
+    REQUIRE(steps.empty());
+}
+
+TEST_CASE("Command lanes", "[CommandSequencer]")
+{
+    REQUIRE(laneForCommand(COMMAND::MOVE_FINE_STOP_VISION) == LANE::BASE);
+    REQUIRE(laneForCommand(COMMAND::WAIT_FOR_LOCALIZATION) == LANE::BASE);
+    REQUIRE(laneForCommand(COMMAND::LOAD_TRAY) == LANE::TRAY);
+    REQUIRE(laneForCommand(COMMAND::START_CAMERAS) == LANE::NONE);
+    REQUIRE(laneForCommand(COMMAND::SEQUENCE) == LANE::NONE);
+}
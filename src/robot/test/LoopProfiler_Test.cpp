@@ -0,0 +1,81 @@
+#include <Catch/catch.hpp>
+
+#include "LoopProfiler.h"
+#include "RobotServer.h"
+#include "StatusUpdater.h"
+#include "test-utils.h"
+
+TEST_CASE("Histogram buckets", "[LoopProfiler]")
+{
+    // Exact below 32 us
+    for(uint32_t i = 0; i < 32; i++)
+    {
+        REQUIRE(LatencyHistogram::bucketIndex(i) == static_cast<int>(i));
+        REQUIRE(LatencyHistogram::bucketUpperBound(i) == i);
+    }
+
+    // Every value is at or below the top of its bucket and within one sub bucket of it
+    for(uint32_t us : {32u, 33u, 63u, 64u, 100u, 1000u, 12345u, 1000000u, 4000000000u})
+    {
+        int idx = LatencyHistogram::bucketIndex(us);
+        REQUIRE(idx < LatencyHistogram::num_buckets);
+        uint32_t upper = LatencyHistogram::bucketUpperBound(idx);
+        REQUIRE(upper >= us);
+        REQUIRE(upper - us <= us / LatencyHistogram::sub_bucket_count);
+    }
+    REQUIRE(LatencyHistogram::bucketIndex(UINT32_MAX) == LatencyHistogram::num_buckets - 1);
+}
+
+TEST_CASE("Histogram percentiles", "[LoopProfiler]")
+{
+    LatencyHistogram h;
+    REQUIRE(h.getCount() == 0);
+    REQUIRE(h.getPercentile(0.5) == 0);
+
+    for(uint32_t i = 1; i <= 1000; i++)
+    {
+        h.record(i);
+    }
+    REQUIRE(h.getCount() == 1000);
+    REQUIRE(h.getMax() == 1000);
+    REQUIRE(h.getMean() == Approx(500.5));
+    REQUIRE(h.getPercentile(0.5) == Approx(500).epsilon(0.07));
+    REQUIRE(h.getPercentile(0.99) == Approx(990).epsilon(0.07));
+    REQUIRE(h.getPercentile(1.0) == 1000);
+
+    // A single slow loop shows up in the max but not the median
+    h.record(50000);
+    REQUIRE(h.getMax() == 50000);
+    REQUIRE(h.getPercentile(0.5) == Approx(500).epsilon(0.07));
+
+    h.reset();
+    REQUIRE(h.getCount() == 0);
+    REQUIRE(h.getMax() == 0);
+}
+
+TEST_CASE("Perf command", "[LoopProfiler]")
+{
+    LoopProfiler* profiler = LoopProfiler::getInstance();
+    profiler->reset();
+    profiler->record(LOOP_STAGE::CONTROLLER, 120);
+    profiler->record(LOOP_STAGE::LOOP, 250);
+    {
+        ScopedStageTimer t(LOOP_STAGE::SERIAL);
+    }
+    REQUIRE(profiler->getHistogram(LOOP_STAGE::SERIAL).getCount() == 1);
+
+    StatusUpdater s;
+    RobotServer r = RobotServer(s);
+    MockSocketMultiThreadWrapper* mock_socket = build_and_get_mock_socket();
+    mock_socket->sendMockData("<{'type':'perf'}>");
+    REQUIRE(r.oneLoop() == COMMAND::NONE);
+
+    std::string resp = mock_socket->getMockData();
+    REQUIRE(resp.find("\"type\":\"perf\"") != std::string::npos);
+    REQUIRE(resp.find("\"controller\":{\"count\":1,") != std::string::npos);
+    REQUIRE(resp.find("\"loop\":{\"count\":1,") != std::string::npos);
+    REQUIRE(resp.find("\"max\":250") != std::string::npos);
+    REQUIRE(resp.find("\"camera\":{\"count\":0,") != std::string::npos);
+
+    profiler->reset();
+}
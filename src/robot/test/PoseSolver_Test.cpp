@@ -0,0 +1,68 @@
+#include <Catch/catch.hpp>
+
+#include "camera_tracker/PoseSolver.h"
+
+TEST_CASE("Rigid pose fit", "[PoseSolver]")
+{
+    std::vector<Eigen::Vector2f> targets = {{0, 0.93}, {-0.68, 0}, {0.5, -0.4}};
+    std::vector<float> weights = {1, 1, 1};
+
+    Point true_pose = {0.1, -0.2, 0.15};
+    Eigen::Matrix2f R;
+    R << cos(true_pose.a), -sin(true_pose.a),
+         sin(true_pose.a),  cos(true_pose.a);
+    Eigen::Vector2f t = {true_pose.x, true_pose.y};
+
+    // Points such that target = t + R * point
+    std::vector<Eigen::Vector2f> points;
+    for (const auto& target : targets)
+    {
+        points.push_back(R.transpose() * (target - t));
+    }
+
+    SECTION("Two points, exact")
+    {
+        RigidPoseFit fit = fitRigidPose2D({points[0], points[1]}, {targets[0], targets[1]}, {1, 1});
+        REQUIRE(fit.ok);
+        CHECK(fit.pose.x == Approx(true_pose.x).margin(1e-4));
+        CHECK(fit.pose.y == Approx(true_pose.y).margin(1e-4));
+        CHECK(fit.pose.a == Approx(true_pose.a).margin(1e-4));
+        CHECK(fit.residual == Approx(0).margin(1e-4));
+    }
+
+    SECTION("N points, exact")
+    {
+        RigidPoseFit fit = fitRigidPose2D(points, targets, weights);
+        REQUIRE(fit.ok);
+        CHECK(fit.pose.x == Approx(true_pose.x).margin(1e-4));
+        CHECK(fit.pose.y == Approx(true_pose.y).margin(1e-4));
+        CHECK(fit.pose.a == Approx(true_pose.a).margin(1e-4));
+        CHECK(fit.residual == Approx(0).margin(1e-4));
+    }
+
+    SECTION("Bad point gives large residual")
+    {
+        points[2] += Eigen::Vector2f{0.2, 0};
+        RigidPoseFit fit = fitRigidPose2D(points, targets, weights);
+        REQUIRE(fit.ok);
+        CHECK(fit.residual > 0.05);
+    }
+
+    SECTION("Weighting down a bad point")
+    {
+        points[2] += Eigen::Vector2f{0.2, 0};
+        RigidPoseFit even_fit = fitRigidPose2D(points, targets, weights);
+        RigidPoseFit weighted_fit = fitRigidPose2D(points, targets, {1, 1, 0.01});
+        REQUIRE(weighted_fit.ok);
+        CHECK(fabs(weighted_fit.pose.x - true_pose.x) < fabs(even_fit.pose.x - true_pose.x));
+        CHECK(weighted_fit.pose.a == Approx(true_pose.a).margin(0.01));
+    }
+
+    SECTION("Invalid inputs")
+    {
+        CHECK_FALSE(fitRigidPose2D({points[0]}, {targets[0]}, {1}).ok);
+        CHECK_FALSE(fitRigidPose2D(points, targets, {1, 1}).ok);
+        CHECK_FALSE(fitRigidPose2D(points, targets, {0, 0, 0}).ok);
+        CHECK_FALSE(fitRigidPose2D({points[0], points[0]}, {targets[0], targets[0]}, {1, 1}).ok);
+    }
+}
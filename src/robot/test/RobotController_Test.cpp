@@ -111,6 +111,12 @@ TEST_CASE("Simple coarse motion", "[RobotController]")
     }
 }
 
+TEST_CASE("Simple coarse motion with tracking mode", "[RobotController]")
+{
+    SafeConfigModifier<bool> config_modifier("motion.tracking_mode", true);
+    coarsePositionTest(0.5,0.5,0.5);
+}
+
 void fakeMotionHelper(float x, float y, float a, int max_loops, StatusUpdater& s)
 {
     MockClockWrapper* mock_clock = get_mock_clock_and_reset();
@@ -201,4 +207,209 @@ TEST_CASE("Validate fake_perfect_motion option", "[RobotController]")
 //         std::string cmd_vel = mock_serial->mock_rcv_base();
 //         mock_serial->mock_send(cmd_vel);
 //     };
-// }
\ No newline at end of file
+// }
+TEST_CASE("Planned ahead move", "[RobotController]")
+{
+    SafeConfigModifier<bool> config_modifier("motion.fake_perfect_motion", true);
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    StatusUpdater s;
+    RobotController r = RobotController(s);
+
+    // Plan a relative move from where the first move will end while it is still running
+    r.moveToPosition(0.5, 0, 0.5);
+    r.planNextMoveRelative(0.2, 0, 0, LIMITS_MODE::COARSE);
+    for(int i = 0; i < 10000 && r.isTrajectoryRunning(); i++)
+    {
+        r.update();
+        mock_clock->advance_us(1000);
+    }
+
+    r.moveToPositionRelative(0.2, 0, 0);
+    REQUIRE(r.isTrajectoryRunning());
+    for(int i = 0; i < 10000 && r.isTrajectoryRunning(); i++)
+    {
+        r.update();
+        mock_clock->advance_us(1000);
+    }
+    StatusUpdater::Status status = s.getStatus();
+    REQUIRE(status.pos_x == Approx(0.5 + 0.2 * cos(0.5)).margin(0.002));
+    REQUIRE(status.pos_y == Approx(0.2 * sin(0.5)).margin(0.002));
+    REQUIRE(status.pos_a == Approx(0.5).margin(0.002));
+}
+
+TEST_CASE("Stop fast", "[RobotController]")
+{
+    SafeConfigModifier<bool> config_modifier("motion.fake_perfect_motion", true);
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    StatusUpdater s;
+    RobotController r = RobotController(s);
+    REQUIRE(r.getStoppingDistance() == 0);
+
+    // Stop part way through speeding up and expect to end up where the stopping distance said
+    r.moveToPosition(3, 0, 0);
+    for(int i = 0; i < 600; i++)
+    {
+        r.update();
+        mock_clock->advance_us(1000);
+    }
+    StatusUpdater::Status status = s.getStatus();
+    REQUIRE(status.vel_x > 0);
+    float start_x = status.pos_x;
+    float stopping_distance = r.getStoppingDistance();
+    REQUIRE(stopping_distance > 0);
+    {
+        // Checked every loop while moving, so it comes from the limits the controller cached instead of the config
+        SafeConfigModifier<float> acc_modifier("motion.translation.max_acc.coarse", 20.0);
+        REQUIRE(r.getStoppingDistance() == stopping_distance);
+    }
+
+    r.stopFast();
+    float max_vel = status.vel_x;
+    for(int i = 0; i < 10000 && r.isTrajectoryRunning(); i++)
+    {
+        r.update();
+        mock_clock->advance_us(1000);
+        max_vel = std::max(max_vel, s.getStatus().vel_x);
+    }
+    REQUIRE(r.isTrajectoryRunning() == false);
+    status = s.getStatus();
+    REQUIRE(status.pos_x - start_x == Approx(stopping_distance).margin(0.002));
+    REQUIRE(status.pos_y == Approx(0).margin(0.002));
+    // Still accelerating when the stop starts, so it keeps speeding up a little while the acceleration ramps down
+    REQUIRE(max_vel < 1.0);
+}
+
+TEST_CASE("Speed override", "[RobotController]")
+{
+    SafeConfigModifier<bool> config_modifier("motion.fake_perfect_motion", true);
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    StatusUpdater s;
+    RobotController r = RobotController(s);
+
+    auto run_move = [&](float x)
+    {
+        r.moveToPosition(x, 0, 0);
+        int ms = 0;
+        for(; ms < 60000 && r.isTrajectoryRunning(); ms++)
+        {
+            r.update();
+            mock_clock->advance_us(1000);
+        }
+        REQUIRE(r.isTrajectoryRunning() == false);
+        REQUIRE(s.getStatus().pos_x == Approx(x).margin(0.01));
+        return ms;
+    };
+
+    // Same move at half speed takes twice as long
+    int planned_ms = run_move(1);
+    r.setSpeedOverride(0.5);
+    int slow_ms = run_move(0);
+    CHECK(slow_ms == Approx(2 * planned_ms).epsilon(0.05));
+
+    // Changing the override part way through a move takes effect on that move
+    r.moveToPosition(1, 0, 0);
+    for(int i = 0; i < 500; i++)
+    {
+        r.update();
+        mock_clock->advance_us(1000);
+    }
+    r.setSpeedOverride(1);
+    int ms = 500;
+    for(; ms < 60000 && r.isTrajectoryRunning(); ms++)
+    {
+        r.update();
+        mock_clock->advance_us(1000);
+    }
+    CHECK(ms < slow_ms);
+    CHECK(ms > planned_ms);
+    CHECK(s.getStatus().pos_x == Approx(1).margin(0.01));
+
+    // Out of range requests are clamped rather than ignored
+    r.setSpeedOverride(0);
+    CHECK(run_move(0) > slow_ms);
+}
+
+TEST_CASE("Constant velocity", "[RobotController]")
+{
+    SafeConfigModifier<bool> config_modifier("motion.fake_perfect_motion", true);
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    StatusUpdater s;
+    RobotController r = RobotController(s);
+    float max_acc = cfg.lookup("motion.translation.max_acc.coarse");
+    float max_jerk = cfg.lookup("motion.translation.max_jerk.coarse");
+
+    auto run_for = [&](int ms, float* max_acc_seen, float* max_jerk_seen)
+    {
+        float prev_vel = s.getStatus().vel_y;
+        float prev_acc = 0;
+        for(int i = 0; i < ms && r.isTrajectoryRunning(); i++)
+        {
+            r.update();
+            mock_clock->advance_us(1000);
+            float vel = s.getStatus().vel_y;
+            float acc = (vel - prev_vel) / 0.001;
+            *max_acc_seen = std::max(*max_acc_seen, fabsf(acc));
+            *max_jerk_seen = std::max(*max_jerk_seen, fabsf(acc - prev_acc) / 0.001f);
+            prev_vel = vel;
+            prev_acc = acc;
+        }
+    };
+
+    float max_acc_seen = 0;
+    float max_jerk_seen = 0;
+    r.moveConstVel(0, 0.3, 0, 3);
+    REQUIRE(r.isTrajectoryRunning());
+    run_for(2900, &max_acc_seen, &max_jerk_seen);
+    REQUIRE(s.getStatus().vel_y == Approx(0.3).margin(0.001));
+
+    // A new setpoint changes the running move and restarts its time
+    r.moveConstVel(0, -0.1, 0, 1);
+    run_for(1000, &max_acc_seen, &max_jerk_seen);
+    REQUIRE(r.isTrajectoryRunning());
+    REQUIRE(s.getStatus().vel_y == Approx(-0.1).margin(0.001));
+
+    // Then ramps down to a stop when it runs out
+    run_for(10000, &max_acc_seen, &max_jerk_seen);
+    REQUIRE(r.isTrajectoryRunning() == false);
+    REQUIRE(s.getStatus().vel_y == Approx(0).margin(0.001));
+    CHECK(max_acc_seen <= max_acc * 1.01);
+    // Landing on the setpoint can take out the last bit of acceleration in one step
+    CHECK(max_jerk_seen <= max_jerk * 1.2);
+    CHECK(s.getStatus().pos_x == Approx(0).margin(0.001));
+}
+
+TEST_CASE("Jog translation and rotation together", "[RobotController]")
+{
+    SafeConfigModifier<bool> config_modifier("motion.fake_perfect_motion", true);
+    // Lower than the translation and rotation limits together can reach at the rim
+    SafeConfigModifier<float> wheel_acc_modifier("motion.wheel_limits.max_acc", 1.5);
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    StatusUpdater s;
+    RobotController r = RobotController(s);
+    float dist_from_center = cfg.lookup("motion.wheel_limits.dist_from_center");
+
+    float max_wheel_acc_seen = 0;
+    float max_trans_acc_seen = 0;
+    StatusUpdater::Status prev = s.getStatus();
+    for(int i = 0; i < 1000; i++)
+    {
+        // Stream setpoints faster than the deadman timeout
+        if(i % 100 == 0) r.jog(0.5, 0.5, 0.4);
+        r.update();
+        mock_clock->advance_us(1000);
+
+        StatusUpdater::Status status = s.getStatus();
+        float trans_acc = sqrtf(powf(status.vel_x - prev.vel_x, 2) + powf(status.vel_y - prev.vel_y, 2)) / 0.001f;
+        float rot_acc = fabsf(status.vel_a - prev.vel_a) / 0.001f;
+        max_trans_acc_seen = std::max(max_trans_acc_seen, trans_acc);
+        max_wheel_acc_seen = std::max(max_wheel_acc_seen, trans_acc + dist_from_center * rot_acc);
+        prev = status;
+    }
+
+    REQUIRE(r.isTrajectoryRunning());
+    CHECK(s.getStatus().vel_x == Approx(0.5).margin(0.001));
+    CHECK(s.getStatus().vel_y == Approx(0.5).margin(0.001));
+    CHECK(s.getStatus().vel_a == Approx(0.4).margin(0.001));
+    CHECK(max_wheel_acc_seen <= 1.5 * 1.01);
+    CHECK(max_trans_acc_seen > 1.0);
+}
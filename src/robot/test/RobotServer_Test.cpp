@@ -85,6 +85,23 @@ TEST_CASE("Move const vel", "[RobotServer]")
     REQUIRE(data.t == 4);
 }
 
+TEST_CASE("Jog", "[RobotServer]")
+{
+    std::string msg = "<{'type':'jog','data':{'vx':1,'vy':2,'va':3}}>";
+    std::string expected_response = "<{\"type\":\"ack\",\"data\":\"jog\"}>";
+    COMMAND expected_command = COMMAND::JOG;
+
+    StatusUpdater s;
+    RobotServer r = RobotServer(s);
+    testSimpleCommand(r, msg, expected_response, expected_command);
+
+    RobotServer::VelocityData data = r.getVelocityData();
+    REQUIRE(data.vx == 1);
+    REQUIRE(data.vy == 2);
+    REQUIRE(data.va == 3);
+    REQUIRE(data.t == 0);
+}
+
 TEST_CASE("Place", "[RobotServer]")
 {
     std::string msg = "<{'type':'place'}>";
@@ -156,4 +173,86 @@ TEST_CASE("Load complete", "[RobotServer]")
     StatusUpdater s;
     RobotServer r = RobotServer(s);
     testSimpleCommand(r, msg, expected_response, expected_command);
-}
\ No newline at end of file
+}
+TEST_CASE("Sequence", "[RobotServer]")
+{
+    std::string msg = "<{'type':'sequence','data':{'steps':["
+                      "{'type':'move','data':{'x':1,'y':2,'a':3},'timeout':30},"
+                      "{'type':'wait_for_loc'},"
+                      "{'type':'move_const_vel','data':{'vx':1,'vy':2,'va':3,'t':4},'condition':'localized'},"
+                      "{'type':'place','with_previous':true}]}}>";
+    std::string expected_response = "<{\"type\":\"ack\",\"data\":\"sequence\"}>";
+    COMMAND expected_command = COMMAND::SEQUENCE;
+
+    StatusUpdater s;
+    RobotServer r = RobotServer(s);
+    testSimpleCommand(r, msg, expected_response, expected_command);
+
+    std::vector<RobotServer::SequenceStep> steps = r.getSequenceData();
+    REQUIRE(steps.size() == 4);
+    REQUIRE(steps[0].cmd == COMMAND::MOVE);
+    REQUIRE(steps[0].move_data.x == 1);
+    REQUIRE(steps[0].move_data.y == 2);
+    REQUIRE(steps[0].move_data.a == 3);
+    REQUIRE(steps[0].timeout_s == 30);
+    REQUIRE(steps[0].condition == SEQUENCE_CONDITION::NONE);
+    REQUIRE(steps[1].cmd == COMMAND::WAIT_FOR_LOCALIZATION);
+    REQUIRE(steps[1].timeout_s == 0);
+    REQUIRE(steps[2].cmd == COMMAND::MOVE_CONST_VEL);
+    REQUIRE(steps[2].velocity_data.t == 4);
+    REQUIRE(steps[2].condition == SEQUENCE_CONDITION::LOCALIZED);
+    REQUIRE(steps[2].with_previous == false);
+    REQUIRE(steps[3].cmd == COMMAND::PLACE_TRAY);
+    REQUIRE(steps[3].with_previous == true);
+}
+
+TEST_CASE("Bad sequence", "[RobotServer]")
+{
+    std::string expected_response = "<{\"type\":\"ack\",\"data\":\"bad_sequence\"}>";
+    StatusUpdater s;
+    RobotServer r = RobotServer(s);
+    testSimpleCommand(r, "<{'type':'sequence','data':{'steps':[]}}>", expected_response, COMMAND::NONE);
+    testSimpleCommand(r, "<{'type':'sequence','data':{'steps':[{'type':'estop'}]}}>", expected_response, COMMAND::NONE);
+    testSimpleCommand(r, "<{'type':'sequence','data':{'steps':[{'type':'move','condition':'maybe'}]}}>", expected_response, COMMAND::NONE);
+}
+
+TEST_CASE("Only sequences get a bigger document", "[RobotServer]")
+{
+    // Same size either way, only the sequence gets past the fixed document
+    std::string steps = "";
+    for(int i = 0; i < 10; i++)
+    {
+        steps += "{'type':'move_rel','data':{'x':0.1,'y':0.2,'a':0.3}},";
+    }
+    steps += "{'type':'place'}";
+    StatusUpdater s;
+    RobotServer r = RobotServer(s);
+    testSimpleCommand(r, "<{'type':'sequence','data':{'steps':[" + steps + "]}}>",
+        "<{\"type\":\"ack\",\"data\":\"sequence\"}>", COMMAND::SEQUENCE);
+    REQUIRE(r.getSequenceData().size() == 11);
+    testSimpleCommand(r, "<{'type':'move','data':{'x':1,'y':2,'a':3},'extra':[" + steps + "]}>",
+        "<{\"type\":\"ack\",\"data\":\"bad_json\"}>", COMMAND::NONE);
+}
+
+TEST_CASE("Abort sequence", "[RobotServer]")
+{
+    std::string msg = "<{'type':'abort_sequence'}>";
+    std::string expected_response = "<{\"type\":\"ack\",\"data\":\"abort_sequence\"}>";
+    COMMAND expected_command = COMMAND::ABORT_SEQUENCE;
+
+    StatusUpdater s;
+    RobotServer r = RobotServer(s);
+    testSimpleCommand(r, msg, expected_response, expected_command);
+}
+
+TEST_CASE("Set speed override", "[RobotServer]")
+{
+    std::string msg = "<{'type':'speed_override','data':{'speed':0.5}}>";
+    std::string expected_response = "<{\"type\":\"ack\",\"data\":\"speed_override\"}>";
+    COMMAND expected_command = COMMAND::SET_SPEED_OVERRIDE;
+
+    StatusUpdater s;
+    RobotServer r = RobotServer(s);
+    testSimpleCommand(r, msg, expected_response, expected_command);
+    REQUIRE(r.getSpeedOverrideData() == 0.5);
+}
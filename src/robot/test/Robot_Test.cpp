@@ -1,6 +1,9 @@
 #include <Catch/catch.hpp>
 
 #include "robot.h"
+#include "camera_tracker/CameraTrackerFactory.h"
+#include "serial/SerialCommsFactory.h"
+#include "sim/SimRobotPlant.h"
 
 #include "test-utils.h"
 
@@ -32,4 +35,207 @@ TEST_CASE("Robot move", "[Robot]")
     REQUIRE(status.pos_y == Approx(0.4).margin(0.0005));
     REQUIRE(status.pos_a == Approx(0.3).margin(0.0005));
 
-}
\ No newline at end of file
+}
+
+TEST_CASE("Robot lanes", "[Robot]")
+{
+    SafeConfigModifier<bool> motion_modifier("motion.fake_perfect_motion", true);
+    SafeConfigModifier<bool> tray_modifier("tray.fake_tray_motions", true);
+    
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    MockSocketMultiThreadWrapper* mock_socket = build_and_get_mock_socket();
+    Robot r = Robot();
+
+    mock_socket->sendMockData("<{'type':'move','data':{'x':0.5,'y':0.4,'a':0.3}}>");
+    mock_clock->advance_ms(1);
+    r.runOnce();
+    REQUIRE(r.getCurrentCommand(LANE::BASE) == COMMAND::MOVE);
+
+    // Tray action starts while the base is still moving
+    mock_socket->sendMockData("<{'type':'place'}>");
+    mock_clock->advance_ms(1);
+    r.runOnce();
+    REQUIRE(r.getCurrentCommand(LANE::BASE) == COMMAND::MOVE);
+    REQUIRE(r.getCurrentCommand(LANE::TRAY) == COMMAND::PLACE_TRAY);
+    REQUIRE(r.getStatus().base_in_progress == true);
+    REQUIRE(r.getStatus().tray_in_progress == true);
+
+    // But another move has to wait for the first one
+    mock_socket->sendMockData("<{'type':'move_rel','data':{'x':0.1,'y':0.0,'a':0.0}}>");
+    mock_clock->advance_ms(1);
+    r.runOnce();
+    REQUIRE(r.getCurrentCommand(LANE::BASE) == COMMAND::MOVE);
+
+    for (int i = 0; i < 10000; i++) 
+    {
+        r.runOnce();
+        mock_clock->advance_ms(1);
+        if(r.getStatus().in_progress == false) {break;}
+    }
+    REQUIRE(r.getCurrentCommand(LANE::BASE) == COMMAND::NONE);
+    REQUIRE(r.getCurrentCommand(LANE::TRAY) == COMMAND::NONE);
+    REQUIRE(r.getStatus().pos_x == Approx(0.5).margin(0.0005));
+}
+
+TEST_CASE("Robot jog", "[Robot]")
+{
+    SafeConfigModifier<bool> config_modifier("motion.fake_perfect_motion", true);
+    float deadman_timeout = cfg.lookup("motion.jog.deadman_timeout");
+
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    MockSocketMultiThreadWrapper* mock_socket = build_and_get_mock_socket();
+    Robot r = Robot();
+
+    // Setpoints streamed at 20 Hz keep the same move going
+    for (int i = 0; i < 2000; i++) 
+    {
+        if(i % 50 == 0) mock_socket->sendMockData("<{'type':'jog','data':{'vx':0.2,'vy':0.0,'va':0.0}}>");
+        r.runOnce();
+        mock_clock->advance_ms(1);
+        REQUIRE(r.getCurrentCommand(LANE::BASE) == COMMAND::JOG);
+    }
+    REQUIRE(r.getStatus().vel_x == Approx(0.2).margin(0.001));
+
+    // Other moves are still rejected while it runs
+    mock_socket->sendMockData("<{'type':'move_rel','data':{'x':0.1,'y':0.0,'a':0.0}}>");
+    mock_clock->advance_ms(1);
+    r.runOnce();
+    REQUIRE(r.getCurrentCommand(LANE::BASE) == COMMAND::JOG);
+
+    // Once the stream stops, the robot starts stopping after the deadman timeout
+    mock_socket->sendMockData("<{'type':'jog','data':{'vx':0.2,'vy':0.0,'va':0.0}}>");
+    int ms = 0;
+    for (; ms < 10000 && r.getStatus().in_progress; ms++) 
+    {
+        r.runOnce();
+        mock_clock->advance_ms(1);
+        if(ms < 1000 * deadman_timeout - 10) REQUIRE(r.getStatus().vel_x == Approx(0.2).margin(0.001));
+    }
+    REQUIRE(r.getStatus().in_progress == false);
+    REQUIRE(r.getStatus().vel_x == Approx(0).margin(0.001));
+    REQUIRE(ms > 1000 * deadman_timeout);
+}
+
+TEST_CASE("Robot sequence", "[Robot]")
+{
+    SafeConfigModifier<bool> motion_modifier("motion.fake_perfect_motion", true);
+    SafeConfigModifier<bool> tray_modifier("tray.fake_tray_motions", true);
+    
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    MockSocketMultiThreadWrapper* mock_socket = build_and_get_mock_socket();
+    Robot r = Robot();
+
+    mock_socket->sendMockData("<{'type':'sequence','data':{'steps':["
+                              "{'type':'move','data':{'x':0.5,'y':0.4,'a':0.0}},"
+                              "{'type':'place','with_previous':true},"
+                              "{'type':'move_rel','data':{'x':0.1,'y':0.0,'a':0.0}}]}}>");
+    mock_clock->advance_ms(1);
+    r.runOnce();
+
+    // First two steps start on the loop the sequence arrives
+    REQUIRE(r.getCurrentCommand(LANE::BASE) == COMMAND::MOVE);
+    REQUIRE(r.getCurrentCommand(LANE::TRAY) == COMMAND::PLACE_TRAY);
+    REQUIRE(r.getStatus().sequence_running == true);
+    REQUIRE(r.getStatus().sequence_step == 2);
+    REQUIRE(r.getStatus().sequence_length == 3);
+    REQUIRE(r.getStatus().in_progress == true);
+
+    // Other commands are rejected while the sequence runs
+    mock_socket->sendMockData("<{'type':'load'}>");
+    mock_clock->advance_ms(1);
+    r.runOnce();
+    REQUIRE(r.getCurrentCommand(LANE::TRAY) == COMMAND::PLACE_TRAY);
+
+    // The last move starts on the same loop the first two steps are done, without an idle loop in between
+    bool started_same_loop = false;
+    for (int i = 0; i < 20000; i++) 
+    {
+        bool was_busy = r.getCurrentCommand(LANE::BASE) == COMMAND::MOVE || r.getCurrentCommand(LANE::TRAY) == COMMAND::PLACE_TRAY;
+        r.runOnce();
+        mock_clock->advance_ms(1);
+        if(was_busy && r.getCurrentCommand(LANE::BASE) == COMMAND::MOVE_REL)
+        {
+            started_same_loop = true;
+        }
+        if(r.getStatus().in_progress == false) {break;}
+    }
+    REQUIRE(started_same_loop);
+    REQUIRE(r.getStatus().sequence_running == false);
+    REQUIRE(r.getStatus().sequence_step == 3);
+    REQUIRE(r.getStatus().error_status == false);
+    REQUIRE(r.getStatus().pos_x == Approx(0.6).margin(0.0005));
+}
+
+// Swaps the clearcore, marvelmind and cameras for the simulated models for as long as it is in scope
+class SimModeScope
+{
+  public:
+    SimModeScope()
+    : sim_modifier_("simulation.enabled", true)
+    {
+        SerialCommsFactory::getFactoryInstance()->set_mode(SERIAL_FACTORY_MODE::SIM);
+        CameraTrackerFactory::getFactoryInstance()->set_mode(CAMERA_TRACKER_FACTORY_MODE::SIM);
+    }
+    ~SimModeScope()
+    {
+        SerialCommsFactory::getFactoryInstance()->set_mode(SERIAL_FACTORY_MODE::MOCK);
+        CameraTrackerFactory::getFactoryInstance()->set_mode(CAMERA_TRACKER_FACTORY_MODE::MOCK);
+    }
+
+  private:
+    SafeConfigModifier<bool> sim_modifier_;
+};
+
+TEST_CASE("Robot camera stop", "[Robot]")
+{
+    SimModeScope sim_mode;
+    // The stop is planned from the estimated pose, which only stays close enough to the true pose at this speed
+    // when the move is tracked with feedforward
+    SafeConfigModifier<bool> tracking_modifier("motion.tracking_mode", true);
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    MockSocketMultiThreadWrapper* mock_socket = build_and_get_mock_socket();
+    SimRobotPlant* plant = SimRobotPlant::getInstance();
+    plant->reset({0,0,0});
+    // The move aims past the marker, the camera is what decides where the robot stops
+    Point marker = {0.8, 0.05, 0};
+    plant->setCameraTarget(marker);
+    Robot r = Robot();
+
+    mock_socket->sendMockData("<{'type':'start_cameras'}>");
+    for (int i = 0; i < 10; i++) 
+    {
+        r.runOnce();
+        mock_clock->advance_ms(1);
+    }
+
+    mock_socket->sendMockData("<{'type':'move_fine_stop_vision','data':{'x':1.0,'y':0.05,'a':0.0}}>");
+    mock_clock->advance_ms(1);
+    r.runOnce();
+    REQUIRE(r.getCurrentCommand() == COMMAND::MOVE_FINE_STOP_VISION);
+    for (int i = 0; i < 20000 && r.getStatus().in_progress; i++) 
+    {
+        r.runOnce();
+        mock_clock->advance_ms(1);
+    }
+    REQUIRE(r.getStatus().in_progress == false);
+    REQUIRE(r.getStatus().error_status == false);
+
+    // Came to rest level with the marker instead of at the end of the move
+    Point pose = plant->getTruePose();
+    float tolerance = cfg.lookup("motion.translation.position_threshold.fine");
+    CHECK(pose.x == Approx(marker.x).margin(tolerance));
+    Velocity vel = plant->getBaseVelocity();
+    CHECK(sqrtf(vel.vx * vel.vx + vel.vy * vel.vy) < static_cast<float>(cfg.lookup("motion.translation.velocity_threshold.fine")));
+
+    // The achieved error is only reported once the camera has a pose from after the robot stopped
+    CameraStopResult result = r.getCameraStopResult();
+    CHECK(result.triggered);
+    for (int i = 0; i < 2000 && !r.getCameraStopResult().achieved_known; i++) 
+    {
+        r.runOnce();
+        mock_clock->advance_ms(1);
+    }
+    result = r.getCameraStopResult();
+    REQUIRE(result.achieved_known);
+    CHECK(result.achieved_error == Approx(0).margin(tolerance));
+}
@@ -0,0 +1,152 @@
+#include <Catch/catch.hpp>
+
+#include "sim/SimRobotPlant.h"
+#include "serial/SimSerialComms.h"
+#include "camera_tracker/CameraTrackerSim.h"
+#include "test-utils.h"
+
+// Sends a base velocity command every controller period for the given time
+static std::string driveBase(SimSerialComms& serial, MockClockWrapper* clock, Velocity cmd, float seconds)
+{
+    char buff[100];
+    sprintf(buff, "base:%.4f,%.4f,%.4f", cmd.vx, cmd.vy, cmd.va);
+    std::string reply;
+    for(int i = 0; i < seconds * 40; i++)
+    {
+        serial.send(buff);
+        reply = serial.rcv_base();
+        clock->advance_ms(25);
+    }
+    return reply;
+}
+
+TEST_CASE("Sim base motion", "[Sim]")
+{
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    SimRobotPlant* plant = SimRobotPlant::getInstance();
+    plant->reset({0,0,0});
+    SimSerialComms serial("sim");
+
+    SECTION("Disabled motors don't move")
+    {
+        driveBase(serial, mock_clock, {0.1, 0, 0}, 1.0);
+        REQUIRE(plant->getTruePose() == Point(0,0,0));
+    }
+    SECTION("Translate")
+    {
+        serial.send("base:Power:ON");
+        std::vector<float> reply = parseCommaDelimitedStringToFloat(driveBase(serial, mock_clock, {0.1, 0, 0}, 2.0));
+        REQUIRE(reply.size() == 3);
+        CHECK(reply[0] == Approx(0.1));
+        CHECK(reply[1] == Approx(0).margin(0.001));
+        CHECK(reply[2] == Approx(0).margin(0.001));
+
+        // Motors take a short time to ramp up to speed
+        Point pose = plant->getTruePose();
+        CHECK(pose.x == Approx(0.19).margin(0.01));
+        CHECK(pose.x < 0.2);
+        CHECK(pose.y == Approx(0).margin(0.001));
+        CHECK(pose.a == Approx(0).margin(0.001));
+    }
+    SECTION("Rotate then translate in global frame")
+    {
+        serial.send("base:Power:ON");
+        driveBase(serial, mock_clock, {0, 0, M_PI/4}, 2.0);
+        driveBase(serial, mock_clock, {0, 0, 0}, 1.0);
+        CHECK(plant->getTruePose().a == Approx(M_PI/2).margin(0.05));
+        float a = plant->getTruePose().a;
+
+        driveBase(serial, mock_clock, {0.1, 0, 0}, 2.0);
+        driveBase(serial, mock_clock, {0, 0, 0}, 1.0);
+        Point pose = plant->getTruePose();
+        CHECK(pose.x == Approx(0.2 * cos(a)).margin(0.01));
+        CHECK(pose.y == Approx(0.2 * sin(a)).margin(0.01));
+    }
+    SECTION("Message timeout stops motors")
+    {
+        serial.send("base:Power:ON");
+        driveBase(serial, mock_clock, {0.1, 0.1, 0}, 1.0);
+        REQUIRE(plant->isBaseMoving());
+        mock_clock->advance_ms(300);
+        serial.rcv_base();
+        mock_clock->advance_ms(500);
+        REQUIRE_FALSE(plant->isBaseMoving());
+    }
+}
+
+TEST_CASE("Sim lifter", "[Sim]")
+{
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    SimRobotPlant* plant = SimRobotPlant::getInstance();
+    plant->reset({0,0,0});
+    SimSerialComms serial("sim");
+
+    serial.send("lift:pos:8000");
+    REQUIRE(serial.rcv_lift() == "pos");
+
+    // 10 revs at 7 rev/s and 10 rev/s^2 takes about 2.1 seconds
+    int count = 0;
+    std::string status = "pos";
+    while(status != "none" && count++ < 100)
+    {
+        mock_clock->advance_ms(50);
+        serial.send("lift:status_req");
+        status = serial.rcv_lift();
+    }
+    CHECK(count * 0.05 == Approx(2.1).margin(0.1));
+    CHECK(plant->getLifterPosition() == 8000);
+
+    serial.send("lift:open");
+    REQUIRE(serial.rcv_lift() == "open");
+    mock_clock->advance_ms(1100);
+    serial.send("lift:status_req");
+    REQUIRE(serial.rcv_lift() == "none");
+
+    // Steps sent with an id report when they are done without being polled
+    serial.send("lift:close@7");
+    REQUIRE(serial.rcv_lift() == "close");
+    serial.send("lift:open@8");
+    REQUIRE(serial.rcv_lift() == "rejected:8");
+    REQUIRE(serial.rcv_lift() == "close");
+    REQUIRE(serial.rcv_lift() == "");
+    mock_clock->advance_ms(1100);
+    REQUIRE(serial.rcv_lift() == "done:7");
+    REQUIRE(serial.rcv_lift() == "");
+}
+
+TEST_CASE("Sim sensors", "[Sim]")
+{
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    SimRobotPlant* plant = SimRobotPlant::getInstance();
+    plant->reset({1.0, 2.0, M_PI/2});
+    float mm_x_offset = static_cast<float>(cfg.lookup("localization.mm_x_offset")) / 1000.0;
+
+    SECTION("Marvelmind")
+    {
+        mock_clock->advance_ms(200);
+        std::vector<float> reading = plant->getMarvelmindReading();
+        REQUIRE(reading.size() == 3);
+        CHECK(reading[0] == Approx(1.0).margin(0.05));
+        CHECK(reading[1] == Approx(2.0 + mm_x_offset).margin(0.05));
+        CHECK(reading[2] == Approx(90).margin(5));
+
+        // No new reading until the next update period
+        REQUIRE(plant->getMarvelmindReading().empty());
+    }
+    SECTION("Camera")
+    {
+        CameraTrackerSim camera;
+        camera.start();
+        mock_clock->advance_ms(100);
+        REQUIRE_FALSE(camera.getPoseFromCamera().ok);
+
+        plant->reset({0.1, 0.2, 0.1});
+        mock_clock->advance_ms(100);
+        CameraTrackerOutput output = camera.getPoseFromCamera();
+        REQUIRE(output.ok);
+        CHECK(output.pose.x == Approx(0.1).margin(0.01));
+        CHECK(output.pose.y == Approx(0.2).margin(0.01));
+        CHECK(output.pose.a == Approx(0.1).margin(0.01));
+        CHECK(output.timestamp < ClockFactory::getFactoryInstance()->get_clock()->now());
+    }
+}
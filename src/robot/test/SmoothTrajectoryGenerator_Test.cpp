@@ -185,6 +185,26 @@ TEST_CASE("SmoothTrajectoryGenerator class", "[trajectory]")
             REQUIRE(fabs(output.position.a) < 1.01);
         }
     }
+
+    SECTION("Acceleration")
+    {
+        SmoothTrajectoryGenerator stg;
+        bool ok = stg.generatePointToPointTrajectory({0,0,0}, {1,-2,1}, LIMITS_MODE::COARSE);
+        REQUIRE(ok == true);
+
+        // Acceleration matches the change in velocity around each point
+        float dt = 0.001;
+        for (float t = 0.05; t < 5; t+=0.1)
+        {
+            PVTPoint before = stg.lookup(t - dt);
+            PVTPoint after = stg.lookup(t + dt);
+            PVTPoint output = stg.lookup(t);
+            CHECK(output.acceleration.vx == Approx((after.velocity.vx - before.velocity.vx) / (2*dt)).margin(0.01));
+            CHECK(output.acceleration.vy == Approx((after.velocity.vy - before.velocity.vy) / (2*dt)).margin(0.01));
+            CHECK(output.acceleration.va == Approx((after.velocity.va - before.velocity.va) / (2*dt)).margin(0.01));
+        }
+        CHECK(stg.lookup(60).acceleration.nearZero());
+    }
 }
 
 TEST_CASE("BuildMotionPlanningProblem", "[trajectory]")
@@ -216,6 +236,10 @@ TEST_CASE("BuildMotionPlanningProblem", "[trajectory]")
         REQUIRE(mpp.rotationalLimits.max_vel ==static_cast<float>( cfg.lookup("motion.rotation.max_vel.coarse")));
         REQUIRE(mpp.rotationalLimits.max_acc == static_cast<float>(cfg.lookup("motion.rotation.max_acc.coarse")));
         REQUIRE(mpp.rotationalLimits.max_jerk == static_cast<float>(cfg.lookup("motion.rotation.max_jerk.coarse")));
+        REQUIRE(mpp.wheelLimits.dist_from_center == static_cast<float>(cfg.lookup("motion.wheel_limits.dist_from_center")));
+        REQUIRE(mpp.wheelLimits.max_vel == static_cast<float>(cfg.lookup("motion.wheel_limits.max_vel")));
+        REQUIRE(mpp.wheelLimits.max_acc == static_cast<float>(cfg.lookup("motion.wheel_limits.max_acc")));
+        REQUIRE(mpp.limitMaxFraction == 1.0);
         REQUIRE(mpp.solver_params.num_loops == solver.num_loops);
         REQUIRE(mpp.solver_params.alpha_decay == solver.alpha_decay);
         REQUIRE(mpp.solver_params.beta_decay == solver.beta_decay);
@@ -374,6 +398,158 @@ TEST_CASE("generateSCurve", "[trajectory]")
     }
 }
 
+TEST_CASE("generateSCurveFromState", "[trajectory]")
+{
+    DynamicLimits limits = {1, 2, 8};
+    SCurveParameters params;
+
+    // Checks the profile starts in the given state, ends at rest at dist, stays in the limits and
+    // that looking up each switch time lands on that switch point
+    auto check_profile = [&](float dist, float v0, float a0)
+    {
+        CHECK(params.nonzero_start == true);
+        CHECK(params.switch_points[0].t == 0);
+        CHECK(params.switch_points[0].v == v0);
+        CHECK(params.switch_points[0].a == a0);
+        CHECK(params.switch_points[7].p == Approx(dist).margin(1e-4));
+        CHECK(params.switch_points[7].v == 0);
+        CHECK(params.switch_points[7].a == Approx(0).margin(1e-4));
+        CHECK(params.v_lim <= limits.max_vel);
+        CHECK(params.a_lim <= limits.max_acc);
+        for (int i = 1; i < 8; i++)
+        {
+            CHECK(params.switch_points[i].t >= params.switch_points[i-1].t);
+            std::vector<float> values = lookup_1D(params.switch_points[i].t, params);
+            CHECK(values[0] == Approx(params.switch_points[i].p).margin(1e-4));
+            CHECK(values[1] == Approx(params.switch_points[i].v).margin(1e-4));
+            CHECK(values[2] == Approx(params.switch_points[i].a).margin(1e-4));
+        }
+        float end_time = params.switch_points[7].t;
+        for (int i = 0; i <= 100; i++)
+        {
+            std::vector<float> values = lookup_1D(end_time * i / 100, params);
+            CHECK(values[1] <= std::max(v0, limits.max_vel) + 1e-4);
+            CHECK(fabs(values[2]) <= std::max(fabs(a0), limits.max_acc) + 1e-4);
+        }
+    };
+
+    SECTION("Speeding up")
+    {
+        REQUIRE(generateSCurveFromState(10, 0.5, 0.5, limits, &params));
+        CHECK(params.v_lim == 1.0);
+        CHECK(params.a_lim == 2.0);
+        check_profile(10, 0.5, 0.5);
+    }
+    SECTION("Short move")
+    {
+        REQUIRE(generateSCurveFromState(0.2, 0.2, 0, limits, &params));
+        CHECK(params.v_lim < 1.0);
+        check_profile(0.2, 0.2, 0);
+    }
+    SECTION("Faster than the limit")
+    {
+        REQUIRE(generateSCurveFromState(2, 1.2, 0, limits, &params));
+        CHECK(params.v_lim == 1.0);
+        check_profile(2, 1.2, 0);
+    }
+    SECTION("Still accelerating the wrong way")
+    {
+        REQUIRE(generateSCurveFromState(2, 0.8, -1.0, limits, &params));
+        check_profile(2, 0.8, -1.0);
+    }
+    SECTION("Moving away from the target")
+    {
+        REQUIRE(generateSCurveFromState(2, -0.3, 0, limits, &params));
+        check_profile(2, -0.3, 0);
+    }
+    SECTION("Can't stop in time")
+    {
+        REQUIRE(generateSCurveFromState(0.01, 1.0, 0, limits, &params) == false);
+    }
+}
+
+TEST_CASE("Replan a running trajectory", "[trajectory]")
+{
+    SmoothTrajectoryGenerator stg;
+    Point target = {2,1,0.5};
+    REQUIRE(stg.generatePointToPointTrajectory({0,0,0}, target, LIMITS_MODE::COARSE));
+    PVTPoint mid = stg.lookup(0.8);
+    REQUIRE(mid.velocity.nearZero() == false);
+    REQUIRE(mid.acceleration.nearZero() == false);
+
+    // Picks up with the same velocity from a slightly different position and still ends at the target
+    Point start = {mid.position.x + 0.02f, mid.position.y - 0.01f, mid.position.a};
+    REQUIRE(stg.generatePointToPointTrajectory(start, mid.velocity, mid.acceleration, target, LIMITS_MODE::COARSE));
+    PVTPoint replanned = stg.lookup(0);
+    CHECK(replanned.position == start);
+    CHECK(replanned.velocity.vx == Approx(mid.velocity.vx).margin(0.01));
+    CHECK(replanned.velocity.vy == Approx(mid.velocity.vy).margin(0.01));
+    CHECK(replanned.velocity.va == Approx(mid.velocity.va).margin(0.01));
+    CHECK(replanned.acceleration.vx == Approx(mid.acceleration.vx).margin(0.01));
+    CHECK(replanned.acceleration.vy == Approx(mid.acceleration.vy).margin(0.01));
+    CHECK(replanned.acceleration.va == Approx(mid.acceleration.va).margin(0.01));
+
+    PVTPoint end = stg.lookup(100);
+    CHECK(end.position.x == Approx(target.x).margin(1e-3));
+    CHECK(end.position.y == Approx(target.y).margin(1e-3));
+    CHECK(end.position.a == Approx(target.a).margin(1e-3));
+    CHECK(end.velocity.nearZero());
+}
+
+TEST_CASE("Stop trajectory", "[trajectory]")
+{
+    DynamicLimits limits = {1, 2, 8};
+    SCurveParameters params;
+
+    SECTION("Moving")
+    {
+        generateStopSCurve(0.8, 0.5, limits, &params);
+        CHECK(params.switch_points[0].v == 0.8f);
+        CHECK(params.switch_points[0].a == 0.5f);
+        CHECK(params.switch_points[7].v == 0);
+        CHECK(params.switch_points[7].a == Approx(0).margin(1e-4));
+        // Ramps the acceleration down to the limit, holds it and ramps back up right as it reaches 0
+        CHECK(params.switch_points[1].a == Approx(-2));
+        CHECK(params.switch_points[1].t == Approx(2.5 / 8));
+        CHECK(params.switch_points[3].t == params.switch_points[7].t);
+        float end_time = params.switch_points[7].t;
+        for (int i = 0; i <= 100; i++)
+        {
+            std::vector<float> values = lookup_1D(end_time * i / 100, params);
+            CHECK(values[1] >= -1e-4);
+            CHECK(fabs(values[2]) <= 2 + 1e-4);
+        }
+    }
+    SECTION("Not moving")
+    {
+        generateStopSCurve(0, 0, limits, &params);
+        CHECK(params.switch_points[7].t == 0);
+        CHECK(params.switch_points[7].p == 0);
+    }
+    SECTION("Through the generator")
+    {
+        SmoothTrajectoryGenerator stg;
+        Point start = {1, 2, 0.5};
+        Velocity vel = {0.3, -0.4, 0.2};
+        REQUIRE(stg.generateStopTrajectory(start, vel, {0,0,0}, LIMITS_MODE::COARSE));
+        PVTPoint initial = stg.lookup(0);
+        CHECK(initial.position == start);
+        CHECK(initial.velocity.vx == Approx(vel.vx));
+        CHECK(initial.velocity.vy == Approx(vel.vy));
+        CHECK(initial.velocity.va == Approx(vel.va));
+
+        // Stops in a straight line along the velocity
+        PVTPoint end = stg.lookup(100);
+        Point stop = stg.getEndPoint();
+        CHECK(end.velocity.nearZero());
+        CHECK(end.position.x == Approx(stop.x));
+        CHECK(end.position.y == Approx(stop.y));
+        CHECK(end.position.a == Approx(stop.a));
+        CHECK((stop.x - start.x) / (stop.y - start.y) == Approx(vel.vx / vel.vy));
+        CHECK(stop.a > start.a);
+    }
+}
+
 TEST_CASE("populateSwitchTimeParameters", "[trajectory]")
 {
     SCurveParameters params;
@@ -637,39 +813,45 @@ TEST_CASE("synchronizeParameters", "[trajectory]")
     }
     REQUIRE(valid_params.switch_points[7].p == dp);
     
-    SCurveParameters params_to_test = valid_params;
-    params_to_test.v_lim = 0.0;
-    params_to_test.a_lim = 0.0;
-    params_to_test.j_lim = 0.0;
+    // Same profile played twice as fast
+    SCurveParameters params_to_test;
+    params_to_test.v_lim = 2 * valid_params.v_lim;
+    params_to_test.a_lim = 4 * valid_params.a_lim;
+    params_to_test.j_lim = 8 * valid_params.j_lim;
+    populateSwitchTimeParameters(&params_to_test, dt_j / 2, dt_a / 2, dt_v / 2);
+    REQUIRE(params_to_test.switch_points[7].t == Approx(switch_times[7] / 2));
+    REQUIRE(params_to_test.switch_points[7].p == Approx(dp));
 
-    SECTION("solveInverse")
+    SECTION("scaleParamsToMatchTime")
     {
-        bool ok = solveInverse(&params_to_test);
-        CHECK(ok == true);
+        float scale = scaleParamsToMatchTime(&params_to_test, switch_times[7]);
+        CHECK(scale == Approx(2.0));
         CHECK(params_to_test.v_lim == Approx(valid_params.v_lim));
         CHECK(params_to_test.a_lim == Approx(valid_params.a_lim));
         CHECK(params_to_test.j_lim == Approx(valid_params.j_lim));
-    }
-    SECTION("slowDownParamsToMatchTime")
-    {
+        CHECK(params_to_test.switch_points[7].t == switch_times[7]);
         for (int i = 0; i < 8; i++)
         {
-            params_to_test.switch_points[i].t /= 2.0;
+            CHECK(params_to_test.switch_points[i].t == Approx(switch_times[i]));
+            CHECK(params_to_test.switch_points[i].p == Approx(valid_params.switch_points[i].p));
+            CHECK(params_to_test.switch_points[i].v == Approx(valid_params.switch_points[i].v));
+            CHECK(params_to_test.switch_points[i].a == Approx(valid_params.switch_points[i].a));
         }
-        bool ok = slowDownParamsToMatchTime(&params_to_test, switch_times[7]);
-        CHECK(ok == true);
-        CHECK(params_to_test.switch_points[7].t == switch_times[7]);
-        CHECK(params_to_test.switch_points[7].p == Approx(dp));
+    }
+    SECTION("Never speeds up")
+    {
+        SCurveParameters unchanged = params_to_test;
+        CHECK(scaleParamsToMatchTime(&params_to_test, switch_times[7] / 4) == 1);
+        CHECK(params_to_test.v_lim == unchanged.v_lim);
+        CHECK(params_to_test.switch_points[7].t == unchanged.switch_points[7].t);
     }
     SECTION("synchronize")
     {
-        for (int i = 0; i < 8; i++)
-        {
-            params_to_test.switch_points[i].t /= 2.0;
-        }
         SCurveParameters params_to_test2 = valid_params;
-        bool ok = synchronizeParameters(&params_to_test, &params_to_test2);
-        CHECK(ok == true);
+        SyncResult result = synchronizeParameters(&params_to_test, &params_to_test2);
+        CHECK(result.lengthened);
+        CHECK(result.rotation_limited);
+        CHECK(result.time_scale == Approx(2.0));
         CHECK(params_to_test.switch_points[7].t == switch_times[7]);
         CHECK(params_to_test.switch_points[7].p == Approx(dp));
         CHECK(params_to_test2.switch_points[7].t == switch_times[7]);
@@ -679,4 +861,223 @@ TEST_CASE("synchronizeParameters", "[trajectory]")
             CHECK(params_to_test2.switch_points[i].t == switch_times[i]);
         }
     }
+    SECTION("synchronize with no rotation")
+    {
+        SCurveParameters no_motion = valid_params;
+        generateSCurve(0, {1, 1, 1}, {10, 0.8, 0.8, 0.1}, &no_motion);
+        SyncResult result = synchronizeParameters(&params_to_test, &no_motion);
+        CHECK(result.lengthened == false);
+        CHECK(result.rotation_limited == false);
+        CHECK(result.time_scale == 1);
+        CHECK(params_to_test.switch_points[7].t == Approx(switch_times[7] / 2));
+        CHECK(no_motion.switch_points[7].p == 0);
+    }
+}
+
+TEST_CASE("Wheel limits", "[trajectory]")
+{
+    SolverParameters solver = {25, 0.8, 0.8, 0.1};
+    SCurveParameters trans_params;
+    SCurveParameters rot_params;
+    REQUIRE(generateSCurve(3.0, {1, 2, 8}, solver, &trans_params));
+    REQUIRE(generateSCurve(1.0, {0.5, 1, 5}, solver, &rot_params));
+    synchronizeParameters(&trans_params, &rot_params);
+    float end_time = trans_params.switch_points[7].t;
+    REQUIRE(rot_params.switch_points[7].t == Approx(end_time));
+
+    float d = 0.4;
+    WheelDemand demand = computeWheelDemand(trans_params, rot_params, d);
+    CHECK(demand.max_vel >= trans_params.v_lim);
+    CHECK(demand.max_vel <= trans_params.v_lim + d * rot_params.v_lim + 1e-5);
+    CHECK(demand.max_acc >= trans_params.a_lim);
+
+    SECTION("Within limits")
+    {
+        WheelLimits limits = {d, 2 * demand.max_vel, 2 * demand.max_acc};
+        CHECK(applyWheelLimits(&trans_params, &rot_params, limits) == 1);
+        CHECK(trans_params.switch_points[7].t == end_time);
+        CHECK(rot_params.switch_points[7].t == end_time);
+    }
+    SECTION("Velocity limited")
+    {
+        WheelLimits limits = {d, demand.max_vel / 2, 10 * demand.max_acc};
+        CHECK(applyWheelLimits(&trans_params, &rot_params, limits) == Approx(2.0));
+        WheelDemand new_demand = computeWheelDemand(trans_params, rot_params, d);
+        CHECK(new_demand.max_vel == Approx(limits.max_vel).epsilon(0.001));
+        CHECK(trans_params.switch_points[7].t == Approx(2 * end_time));
+        CHECK(rot_params.switch_points[7].t == Approx(2 * end_time));
+        CHECK(trans_params.switch_points[7].p == Approx(3.0));
+        CHECK(rot_params.switch_points[7].p == Approx(1.0));
+    }
+    SECTION("Acceleration limited")
+    {
+        WheelLimits limits = {d, 10 * demand.max_vel, demand.max_acc / 4};
+        CHECK(applyWheelLimits(&trans_params, &rot_params, limits) == Approx(2.0));
+        WheelDemand new_demand = computeWheelDemand(trans_params, rot_params, d);
+        CHECK(new_demand.max_acc == Approx(limits.max_acc).epsilon(0.001));
+        CHECK(trans_params.switch_points[7].t == Approx(2 * end_time));
+        CHECK(rot_params.switch_points[7].t == Approx(2 * end_time));
+    }
+    SECTION("Through generateTrajectory")
+    {
+        MotionPlanningProblem mpp = buildMotionPlanningProblem({0,0,0}, {3,0,1}, LIMITS_MODE::COARSE, solver);
+        mpp.wheelLimits.max_acc = 0.5;
+        Trajectory traj = generateTrajectory(mpp);
+        REQUIRE(traj.complete);
+        WheelDemand new_demand = computeWheelDemand(traj.trans_params, traj.rot_params, mpp.wheelLimits.dist_from_center);
+        CHECK(new_demand.max_acc <= mpp.wheelLimits.max_acc * 1.001);
+        CHECK(traj.trans_params.switch_points[7].t == Approx(traj.rot_params.switch_points[7].t));
+        CHECK(traj.trans_params.switch_points[7].p == Approx(3.0));
+        CHECK(traj.max_wheel_acc == mpp.wheelLimits.max_acc / mpp.limitMaxFraction);
+    }
+}
+
+TEST_CASE("Time scaling", "[trajectory]")
+{
+    SolverParameters solver = {25, 0.8, 0.8, 0.1};
+    SCurveParameters params;
+    REQUIRE(generateSCurve(3.0, {1, 2, 8}, solver, &params));
+
+    SECTION("Headroom")
+    {
+        // The profile reaches every limit, so jerk going up with the cube of the rate is what runs out first
+        CHECK(maxTimeScale(params, {1, 2, 8}) == Approx(1));
+        CHECK(maxTimeScale(params, {2, 4, 16}) == Approx(cbrtf(2)));
+        CHECK(maxTimeScale(params, {1.5, 100, 100}) == Approx(1.5));
+
+        SCurveParameters still;
+        REQUIRE(generateSCurve(0, {1, 2, 8}, solver, &still));
+        CHECK(maxTimeScale(still, {1, 2, 8}) > 100);
+    }
+
+    SECTION("Start at rest")
+    {
+        TrajectoryTimeScaler scaler;
+        CHECK(scaler.update(0.1) == Approx(0.1));
+
+        scaler.setOverride(0.5);
+        scaler.restart(1, true);
+        CHECK(scaler.getRate() == 0.5);
+        CHECK(scaler.update(0.1) == Approx(0.05));
+        CHECK(scaler.scaleVelocity({1, 2, 3}) == Velocity(0.5, 1, 1.5));
+
+        // Capped at what the trajectory allows
+        scaler.setOverride(2);
+        scaler.restart(1.2, true);
+        CHECK(scaler.getRate() == Approx(1.2));
+    }
+
+    SECTION("Change while running")
+    {
+        float max_rate_change = cfg.lookup("motion.speed_override.max_rate_change");
+        float max_rate_change_acc = cfg.lookup("motion.speed_override.max_rate_change_acc");
+        TrajectoryTimeScaler scaler;
+        scaler.setOverride(0.5);
+        scaler.restart(1, false);
+        CHECK(scaler.getRate() == 1);
+
+        const float dt = 0.001;
+        float prev_rate = 1;
+        float prev_rate_change = 0;
+        float prev_time = 0;
+        bool within_limits = true;
+        for(int i = 0; i < 10000; i++)
+        {
+            float time = scaler.update(dt);
+            if(scaler.getRate() > prev_rate + 1e-6) within_limits = false;
+            if(fabs(scaler.getRateChange()) > max_rate_change + 1e-6) within_limits = false;
+            if(fabs(scaler.getRateChange() - prev_rate_change) > max_rate_change_acc * dt + 1e-6 && scaler.getRate() != 0.5) within_limits = false;
+            if(time - prev_time < 0.5 * dt - 1e-6) within_limits = false;
+            prev_rate = scaler.getRate();
+            prev_rate_change = scaler.getRateChange();
+            prev_time = time;
+        }
+        CHECK(within_limits);
+        CHECK(scaler.getRate() == 0.5);
+        CHECK(scaler.getRateChange() == 0);
+
+        // While the rate is changing, the rate change times the velocity adds to the acceleration
+        scaler.setOverride(1);
+        scaler.update(dt);
+        scaler.update(dt);
+        Velocity acc = scaler.scaleAcceleration({1, 0, 0}, {1, 0, 0});
+        float rate = scaler.getRate();
+        CHECK(acc.vx == Approx(rate * rate + scaler.getRateChange()));
+        CHECK(scaler.getRateChange() > 0);
+    }
+
+    SECTION("Rate change held to the acceleration headroom")
+    {
+        Trajectory traj;
+        traj.max_trans_acc = 1;
+        traj.max_rot_acc = 10;
+        traj.max_wheel_acc = 10;
+        traj.wheel_dist_from_center = 0.4;
+        PVTPoint target = {{0, 0, 0}, {1, 0, 0}, {0.6, 0, 0}, 0};
+
+        TrajectoryTimeScaler scaler;
+        scaler.setOverride(1.25);
+        scaler.restart(1.25, false);
+        const float dt = 0.001;
+        float max_acc = 0;
+        bool limited = false;
+        float max_rate_change = cfg.lookup("motion.speed_override.max_rate_change");
+        bool within_headroom = true;
+        for(int i = 0; i < 10000; i++)
+        {
+            // The rate change that moves the rate this tick has to fit in the headroom at the rate it started from
+            float prev_rate = scaler.getRate();
+            float headroom = (traj.max_trans_acc - prev_rate * prev_rate * target.acceleration.vx) / target.velocity.vx;
+            scaler.update(dt, traj, target);
+            float applied_rate_change = (scaler.getRate() - prev_rate) / dt;
+            if(applied_rate_change > headroom + 1e-3) within_headroom = false;
+            if(headroom < max_rate_change && applied_rate_change > 0) limited = true;
+            max_acc = std::max(max_acc, scaler.scaleAcceleration(target.acceleration, target.velocity).vx);
+        }
+        CHECK(limited);
+        CHECK(within_headroom);
+        CHECK(max_acc <= traj.max_trans_acc + 1e-5);
+        CHECK(scaler.getRate() == Approx(1.25));
+    }
+
+    SECTION("No acceleration headroom")
+    {
+        // Already at the acceleration limit, so there is nothing left over to change the rate with
+        Trajectory traj;
+        traj.max_trans_acc = 1;
+        traj.max_rot_acc = 10;
+        traj.max_wheel_acc = 10;
+        traj.wheel_dist_from_center = 0.4;
+        PVTPoint target = {{0, 0, 0}, {1, 0, 0}, {1, 0, 0}, 0};
+
+        TrajectoryTimeScaler scaler;
+        scaler.setOverride(1.25);
+        scaler.restart(1.25, false);
+        REQUIRE(scaler.getRate() == 1);
+        for(int i = 0; i < 1000; i++)
+        {
+            scaler.update(0.001, traj, target);
+        }
+        CHECK(scaler.getRate() == 1);
+        CHECK(scaler.getRateChange() == 0);
+    }
+}
+
+TEST_CASE("localVelToWheelSpeeds", "[trajectory]")
+{
+    float d = 0.4;
+    Eigen::Vector3f rotate_only = localVelToWheelSpeeds({0, 0, 1}, d);
+    CHECK(rotate_only(0) == Approx(d));
+    CHECK(rotate_only(1) == Approx(d));
+    CHECK(rotate_only(2) == Approx(d));
+
+    Eigen::Vector3f sideways = localVelToWheelSpeeds({0, 1, 0}, d);
+    CHECK(sideways(0) == Approx(0.5));
+    CHECK(sideways(1) == Approx(0.5));
+    CHECK(sideways(2) == Approx(-1));
+
+    Eigen::Vector3f forward = localVelToWheelSpeeds({1, 0, 0}, d);
+    CHECK(forward(0) == Approx(-sqrt(3) / 2));
+    CHECK(forward(1) == Approx(sqrt(3) / 2));
+    CHECK(forward(2) == Approx(0).margin(1e-6));
 }
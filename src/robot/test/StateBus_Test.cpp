@@ -0,0 +1,136 @@
+#include <Catch/catch.hpp>
+#include <thread>
+
+#include "StateBus.h"
+#include "StatusUpdater.h"
+
+// Big enough to span several words so a torn read would show up as mismatched fields
+struct TestState
+{
+    int values[12] = {};
+};
+
+TEST_CASE("Publish and read", "[StateBus]")
+{
+    StateTopic<Point> topic;
+    REQUIRE(topic.getSequence() == 0);
+    REQUIRE(topic.get() == Point(0,0,0));
+
+    topic.publish({1,2,3});
+    REQUIRE(topic.getSequence() == 1);
+    Point p;
+    REQUIRE(topic.read(p) == 1);
+    REQUIRE(p == Point(1,2,3));
+
+    topic.publish({4,5,6});
+    REQUIRE(topic.getSequence() == 2);
+    REQUIRE(topic.get() == Point(4,5,6));
+}
+
+TEST_CASE("Publish if changed", "[StateBus]")
+{
+    StateTopic<TrayState> topic;
+    TrayState state;
+    topic.publishIfChanged(state);
+    REQUIRE(topic.getSequence() == 0);
+
+    state.action_running = true;
+    topic.publishIfChanged(state);
+    topic.publishIfChanged(state);
+    REQUIRE(topic.getSequence() == 1);
+    REQUIRE(topic.get().action_running);
+}
+
+TEST_CASE("Wait for update", "[StateBus]")
+{
+    StateTopic<Point> topic;
+    uint64_t seq = topic.getSequence();
+    Point p;
+
+    SECTION("Timeout")
+    {
+        REQUIRE(topic.waitForUpdate(seq, p, 0.01) == false);
+        REQUIRE(seq == 0);
+    }
+
+    SECTION("Already published")
+    {
+        topic.publish({1,0,0});
+        REQUIRE(topic.waitForUpdate(seq, p, 0.01));
+        REQUIRE(seq == 1);
+        REQUIRE(p.x == 1);
+    }
+
+    SECTION("Published from another thread")
+    {
+        std::thread publisher([&topic]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            topic.publish({2,0,0});
+        });
+        REQUIRE(topic.waitForUpdate(seq, p, 1.0));
+        REQUIRE(seq == 1);
+        REQUIRE(p.x == 2);
+        publisher.join();
+    }
+}
+
+TEST_CASE("No torn reads", "[StateBus]")
+{
+    StateTopic<TestState> topic;
+    const int num_publishes = 20000;
+    std::atomic<bool> done(false);
+
+    std::thread publisher([&]() {
+        TestState state;
+        for(int i = 1; i <= num_publishes; i++)
+        {
+            for(int& v : state.values) v = i;
+            topic.publish(state);
+        }
+        done = true;
+    });
+
+    bool consistent = true;
+    uint64_t last_seq = 0;
+    bool in_order = true;
+    while(!done)
+    {
+        TestState state;
+        uint64_t seq = topic.read(state);
+        for(int v : state.values)
+        {
+            if(v != state.values[0]) consistent = false;
+        }
+        if(static_cast<int>(seq) != state.values[0]) consistent = false;
+        if(seq < last_seq) in_order = false;
+        last_seq = seq;
+    }
+    publisher.join();
+
+    REQUIRE(consistent);
+    REQUIRE(in_order);
+    REQUIRE(topic.getSequence() == num_publishes);
+}
+
+TEST_CASE("Status updater publishes to bus", "[StateBus]")
+{
+    StatusUpdater s;
+    StateBus& bus = s.getStateBus();
+
+    s.updatePosition(1,2,3);
+    s.updateVelocity(4,5,6);
+    REQUIRE(bus.pose.get() == Point(1,2,3));
+    REQUIRE(bus.velocity.get() == Velocity(4,5,6));
+
+    s.setErrorStatus();
+    s.setErrorStatus();
+    REQUIRE(bus.errors.getSequence() == 1);
+    REQUIRE(bus.errors.get().error_status);
+    s.clearErrorStatus();
+    REQUIRE(s.getErrorStatus() == false);
+
+    LocalizationMetrics metrics = {0.1, 0.2, 0.3, 0.4, 0.5};
+    s.updateLocalizationMetrics(metrics);
+    REQUIRE(s.getLocalizationConfidence() == Approx(0.5));
+    REQUIRE(s.getStatus().localization_metrics.confidence_y == Approx(0.3));
+}
@@ -47,11 +47,29 @@ TEST_CASE("Progress", "[StatusUpdater]")
     REQUIRE(status.in_progress == false);
     REQUIRE(s.getInProgress() == false);
 
-    s.updateInProgress(true);
+    s.updateLaneCommand(LANE::BASE, COMMAND::MOVE);
 
     status = s.getStatus();
     REQUIRE(status.in_progress == true);
+    REQUIRE(status.base_in_progress == true);
+    REQUIRE(status.tray_in_progress == false);
+    REQUIRE(status.base_cmd == static_cast<int>(COMMAND::MOVE));
     REQUIRE(s.getInProgress() == true);
+    REQUIRE(s.getInProgress(LANE::BASE) == true);
+    REQUIRE(s.getInProgress(LANE::TRAY) == false);
+
+    s.updateLaneCommand(LANE::TRAY, COMMAND::PLACE_TRAY);
+    s.updateLaneCommand(LANE::BASE, COMMAND::NONE);
+
+    status = s.getStatus();
+    REQUIRE(status.in_progress == true);
+    REQUIRE(status.base_in_progress == false);
+    REQUIRE(status.tray_in_progress == true);
+    REQUIRE(status.base_cmd == static_cast<int>(COMMAND::NONE));
+    REQUIRE(status.tray_cmd == static_cast<int>(COMMAND::PLACE_TRAY));
+
+    s.updateLaneCommand(LANE::TRAY, COMMAND::NONE);
+    REQUIRE(s.getInProgress() == false);
 }
 
 TEST_CASE("JSON", "[StatusUpdater]")
@@ -61,7 +79,7 @@ TEST_CASE("JSON", "[StatusUpdater]")
     s.updateVelocity(4,5,6);
     s.updateControlLoopTime(7);
     s.updatePositionLoopTime(8);
-    s.updateInProgress(true);
+    s.updateLaneCommand(LANE::TRAY, COMMAND::LOAD_TRAY);
 
     std::string json_string = s.getStatusJsonString();
 
@@ -73,6 +91,27 @@ TEST_CASE("JSON", "[StatusUpdater]")
     REQUIRE_THAT(json_string, Contains("\"vel_y\":5"));
     REQUIRE_THAT(json_string, Contains("\"vel_a\":6"));
     REQUIRE_THAT(json_string, Contains("\"controller_loop_ms\":7"));
+    REQUIRE_THAT(json_string, Contains("\"in_progress\":true"));
+    REQUIRE_THAT(json_string, Contains("\"base_in_progress\":false"));
+    REQUIRE_THAT(json_string, Contains("\"tray_in_progress\":true"));
     REQUIRE_THAT(json_string, Contains("\"position_loop_ms\":8"));
     REQUIRE_THAT(json_string, EndsWith("}"));
 }
+
+TEST_CASE("Camera debug JSON", "[StatusUpdater]")
+{
+    StatusUpdater s;
+    CameraDebug camera_debug = CameraDebug();
+    camera_debug.side_latency_ms = 12;
+    camera_debug.rear_latency_ms = 34;
+    camera_debug.side_dropped_frames = 5;
+    camera_debug.rear_dropped_frames = 6;
+    s.updateCameraDebug(camera_debug);
+
+    std::string json_string = s.getStatusJsonString();
+
+    REQUIRE_THAT(json_string, Contains("\"cam_side_latency_ms\":12"));
+    REQUIRE_THAT(json_string, Contains("\"cam_rear_latency_ms\":34"));
+    REQUIRE_THAT(json_string, Contains("\"cam_side_dropped_frames\":5"));
+    REQUIRE_THAT(json_string, Contains("\"cam_rear_dropped_frames\":6"));
+}
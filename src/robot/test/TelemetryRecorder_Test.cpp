@@ -0,0 +1,100 @@
+#include <Catch/catch.hpp>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+
+#include "TelemetryRecorder.h"
+#include "test-utils.h"
+
+static TelemetryRecord makeRecord(int i)
+{
+    TelemetryRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp_us = i;
+    record.motion_id = i / 10;
+    record.pos[0] = 0.1 * i;
+    record.cov[2] = 2.0 * i;
+    return record;
+}
+
+TEST_CASE("Telemetry disabled", "[Telemetry]")
+{
+    TelemetryRecorder recorder(temp_test_path("unused_telemetry.bin"), 0);
+    REQUIRE_FALSE(recorder.isOpen());
+    recorder.record(makeRecord(1));
+    REQUIRE(recorder.getRecordCount() == 0);
+}
+
+TEST_CASE("Telemetry keeps previous runs", "[Telemetry]")
+{
+    const std::string path = temp_test_path("telemetry_roll.bin");
+    const std::string previous_path = temp_test_path("telemetry_roll.1.bin");
+    const std::string oldest_path = temp_test_path("telemetry_roll.2.bin");
+    for(const std::string& p : {path, previous_path, oldest_path})
+    {
+        remove(p.c_str());
+    }
+
+    // Each run records as many ticks as its run number
+    for(int run = 1; run <= 4; run++)
+    {
+        TelemetryRecorder recorder(path, 8, 3);
+        REQUIRE(recorder.isOpen());
+        for(int i = 0; i < run; i++)
+        {
+            recorder.record(makeRecord(i));
+        }
+    }
+
+    auto record_count = [](const std::string& p)
+    {
+        std::ifstream file(p, std::ios::binary);
+        TelemetryFileHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        REQUIRE(file.good());
+        return header.record_count;
+    };
+    CHECK(record_count(path) == 4);
+    CHECK(record_count(previous_path) == 3);
+    CHECK(record_count(oldest_path) == 2);
+    CHECK_FALSE(std::ifstream(temp_test_path("telemetry_roll.3.bin")).good());
+}
+
+TEST_CASE("Telemetry ring file", "[Telemetry]")
+{
+    const std::string path = temp_test_path("telemetry_test.bin");
+    const int capacity = 8;
+    const int num_records = 13;
+    {
+        TelemetryRecorder recorder(path, capacity);
+        REQUIRE(recorder.isOpen());
+        for(int i = 0; i < num_records; i++)
+        {
+            recorder.record(makeRecord(i));
+        }
+        REQUIRE(recorder.getRecordCount() == num_records);
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    TelemetryFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    REQUIRE(std::string(header.magic) == "DRTELEM");
+    REQUIRE(header.header_size == sizeof(TelemetryFileHeader));
+    REQUIRE(header.record_size == sizeof(TelemetryRecord));
+    REQUIRE(header.capacity == capacity);
+    REQUIRE(header.record_count == num_records);
+    REQUIRE(std::string(header.schema).find("timestamp_us:u64,") == 0);
+
+    // Oldest records have been overwritten, slot i holds the newest record with index % capacity == i
+    for(int slot = 0; slot < capacity; slot++)
+    {
+        TelemetryRecord record;
+        file.read(reinterpret_cast<char*>(&record), sizeof(record));
+        REQUIRE(file.good());
+        int expected = slot < num_records - capacity ? slot + capacity : slot;
+        CHECK(record.timestamp_us == static_cast<uint64_t>(expected));
+        CHECK(record.motion_id == static_cast<uint32_t>(expected / 10));
+        CHECK(record.pos[0] == Approx(0.1 * expected));
+        CHECK(record.cov[2] == Approx(2.0 * expected));
+    }
+}
@@ -0,0 +1,65 @@
+#include <Catch/catch.hpp>
+
+#include "TrajectoryPlanner.h"
+#include "test-utils.h"
+
+TEST_CASE("Planned trajectory matches direct solve", "[TrajectoryPlanner]")
+{
+    TrajectoryPlanner planner;
+    Point start = {0.1, 0.2, 0.3};
+    Point target = {1.5, -0.5, 1.0};
+    planner.requestPlan(start, target, LIMITS_MODE::COARSE);
+
+    Trajectory planned;
+    Point planned_target;
+    REQUIRE(planner.takePlan(start, target, LIMITS_MODE::COARSE, &planned, &planned_target));
+    REQUIRE(planned_target == target);
+
+    SmoothTrajectoryGenerator gen;
+    REQUIRE(gen.generatePointToPointTrajectory(start, target, LIMITS_MODE::COARSE));
+    const Trajectory& direct = gen.getTrajectory();
+    REQUIRE(planned.complete);
+    for(int i = 0; i < 8; i++)
+    {
+        CHECK(planned.trans_params.switch_points[i].t == Approx(direct.trans_params.switch_points[i].t));
+        CHECK(planned.rot_params.switch_points[i].p == Approx(direct.rot_params.switch_points[i].p));
+    }
+
+    // Each plan can only be taken once
+    REQUIRE(planner.takePlan(start, target, LIMITS_MODE::COARSE, &planned, &planned_target) == false);
+}
+
+TEST_CASE("Plan has to match the move", "[TrajectoryPlanner]")
+{
+    TrajectoryPlanner planner;
+    Point start = {0, 0, 0};
+    Point target = {1, 0, 0};
+    float max_trans_error = cfg.lookup("trajectory_generation.plan_ahead_max_trans_error");
+    planner.requestPlan(start, target, LIMITS_MODE::COARSE);
+
+    Trajectory planned;
+    Point planned_target;
+    REQUIRE(planner.takePlan(start, target, LIMITS_MODE::FINE, &planned, &planned_target) == false);
+    REQUIRE(planner.takePlan({2 * max_trans_error, 0, 0}, target, LIMITS_MODE::COARSE, &planned, &planned_target) == false);
+    REQUIRE(planner.takePlan(start, {1, 0, 0.5}, LIMITS_MODE::COARSE, &planned, &planned_target) == false);
+
+    // Small differences are fine, the trajectory still ends at the planned target
+    REQUIRE(planner.takePlan({0.5f * max_trans_error, 0, 0}, {1, 0.5f * max_trans_error, 0}, LIMITS_MODE::COARSE, &planned, &planned_target));
+    REQUIRE(planned_target == target);
+}
+
+TEST_CASE("Only the latest plan is kept", "[TrajectoryPlanner]")
+{
+    TrajectoryPlanner planner;
+    Trajectory planned;
+    Point planned_target;
+
+    planner.requestPlan({0, 0, 0}, {1, 0, 0}, LIMITS_MODE::COARSE);
+    planner.requestPlan({0, 0, 0}, {0, 1, 0}, LIMITS_MODE::COARSE);
+    REQUIRE(planner.takePlan({0, 0, 0}, {1, 0, 0}, LIMITS_MODE::COARSE, &planned, &planned_target) == false);
+    REQUIRE(planner.takePlan({0, 0, 0}, {0, 1, 0}, LIMITS_MODE::COARSE, &planned, &planned_target));
+
+    planner.requestPlan({0, 0, 0}, {1, 0, 0}, LIMITS_MODE::COARSE);
+    planner.clear();
+    REQUIRE(planner.takePlan({0, 0, 0}, {1, 0, 0}, LIMITS_MODE::COARSE, &planned, &planned_target) == false);
+}
@@ -13,26 +13,27 @@ TEST_CASE("Send and waiting", "[TrayController]")
     REQUIRE(mock_serial->mock_rcv_lift() == "");
     REQUIRE(t.isActionRunning() == true);
 
-    // Expect to receive close command once and then start status requests
+    // Expect to receive close command with its step id once
     mock_clock->advance_ms(1);
     t.update();
-    REQUIRE(mock_serial->mock_rcv_lift() == "close");
-    
-    // Expect to receive status request command while lifter reports closing
+    REQUIRE(mock_serial->mock_rcv_lift() == "close@1");
+
+    // Status replies and events for other steps don't finish the step, and nothing gets polled
     for (int i = 0; i < 5; i ++)
     {
         mock_clock->advance_ms(1);
         mock_serial->mock_send("lift:close");
+        mock_serial->mock_send("lift:done:0");
         t.update();
-        REQUIRE(mock_serial->mock_rcv_lift() == "status_req");
+        REQUIRE(mock_serial->mock_rcv_lift() == "");
     }
 
-    // Expect to receive none response once lifter reports no action
-    mock_clock->advance_ms(1000);
-    mock_serial->mock_send("lift:none");
+    // Expect the next step to start as soon as the lifter reports this one done
+    mock_clock->advance_ms(1);
+    mock_serial->mock_send("lift:done:1");
     t.update();
-    REQUIRE(mock_serial->mock_rcv_lift() == "status_req");
-    REQUIRE(mock_serial->mock_rcv_lift() == "home");
+    REQUIRE(mock_serial->mock_rcv_lift() == "home@2");
+    REQUIRE(t.getTrayState().action_step == 1);
 }
 
 TEST_CASE("Initialize tray", "[TrayController]")
@@ -45,29 +46,28 @@ TEST_CASE("Initialize tray", "[TrayController]")
     REQUIRE(mock_serial->mock_rcv_lift() == "");
     REQUIRE(t.isActionRunning() == true);
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
-    REQUIRE(mock_serial->mock_rcv_lift() == "close");
-    mock_serial->mock_send("lift:none");
+    REQUIRE(mock_serial->mock_rcv_lift() == "close@1");
+    mock_serial->mock_send("lift:done:1");
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
-    REQUIRE(mock_serial->mock_rcv_lift() == "status_req");
-    REQUIRE(mock_serial->mock_rcv_lift() == "home");
-    mock_serial->mock_send("lift:none");
+    REQUIRE(mock_serial->mock_rcv_lift() == "home@2");
+    mock_serial->mock_send("lift:done:2");
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
     float revs = cfg.lookup("tray.default_pos_revs");
     int steps_per_rev = cfg.lookup("tray.steps_per_rev");
     int steps = steps_per_rev * revs;
-    REQUIRE(mock_serial->mock_rcv_lift() == "status_req");
-    REQUIRE(mock_serial->mock_rcv_lift() == "pos:"+std::to_string(steps));
-    mock_serial->mock_send("lift:none");
+    REQUIRE(mock_serial->mock_rcv_lift() == "pos:"+std::to_string(steps)+"@3");
+    mock_serial->mock_send("lift:done:3");
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
     REQUIRE(t.isActionRunning() == false);
+    REQUIRE(t.getTrayState().initialized == true);
 }
 
 TEST_CASE("Place tray", "[TrayController]")
@@ -77,42 +77,40 @@ TEST_CASE("Place tray", "[TrayController]")
     TrayController t;
     t.setTrayInitialized(true);
 
-    bool status = t.place();    
+    bool status = t.place();
     REQUIRE(status == true);
     REQUIRE(mock_serial->mock_rcv_lift() == "");
     REQUIRE(t.isActionRunning() == true);
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
     float revs = cfg.lookup("tray.place_pos_revs");
     int steps_per_rev = cfg.lookup("tray.steps_per_rev");
     int steps = steps_per_rev * revs;
-    REQUIRE(mock_serial->mock_rcv_lift() == "pos:"+std::to_string(steps));
-    mock_serial->mock_send("lift:none");
+    REQUIRE(mock_serial->mock_rcv_lift() == "pos:"+std::to_string(steps)+"@1");
+    mock_serial->mock_send("lift:done:1");
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
-    REQUIRE(mock_serial->mock_rcv_lift() == "status_req");
-    REQUIRE(mock_serial->mock_rcv_lift() == "open");
-    mock_serial->mock_send("lift:none");
+    REQUIRE(mock_serial->mock_rcv_lift() == "open@2");
+    mock_serial->mock_send("lift:done:2");
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
     revs = cfg.lookup("tray.default_pos_revs");
     steps = steps_per_rev * revs;
-    REQUIRE(mock_serial->mock_rcv_lift() == "status_req");
-    REQUIRE(mock_serial->mock_rcv_lift() == "pos:"+std::to_string(steps));
-    mock_serial->mock_send("lift:none");
+    REQUIRE(mock_serial->mock_rcv_lift() == "pos:"+std::to_string(steps)+"@3");
+    mock_serial->mock_send("lift:done:3");
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
-    REQUIRE(mock_serial->mock_rcv_lift() == "status_req");
-    REQUIRE(mock_serial->mock_rcv_lift() == "close");
-    mock_serial->mock_send("lift:none");
+    REQUIRE(mock_serial->mock_rcv_lift() == "close@4");
+    mock_serial->mock_send("lift:done:4");
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
     REQUIRE(t.isActionRunning() == false);
+    REQUIRE(t.hasFault() == false);
 }
 
 TEST_CASE("Load tray", "[TrayController]")
@@ -127,32 +125,87 @@ TEST_CASE("Load tray", "[TrayController]")
     REQUIRE(mock_serial->mock_rcv_lift() == "");
     REQUIRE(t.isActionRunning() == true);
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
     float revs = cfg.lookup("tray.load_pos_revs");
     int steps_per_rev = cfg.lookup("tray.steps_per_rev");
     int steps = steps_per_rev * revs;
-    REQUIRE(mock_serial->mock_rcv_lift() == "pos:"+std::to_string(steps));
-    mock_serial->mock_send("lift:none");
+    REQUIRE(mock_serial->mock_rcv_lift() == "pos:"+std::to_string(steps)+"@1");
+    mock_serial->mock_send("lift:done:1");
 
     mock_clock->advance_ms(1500);
     t.update();
-    REQUIRE(mock_serial->mock_rcv_lift() == "status_req");
     REQUIRE(mock_serial->mock_rcv_lift() == "");
     t.setLoadComplete();
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
     revs = cfg.lookup("tray.default_pos_revs");
     steps = steps_per_rev * revs;
-    REQUIRE(mock_serial->mock_rcv_lift() == "pos:"+std::to_string(steps));
-    mock_serial->mock_send("lift:none");
+    REQUIRE(mock_serial->mock_rcv_lift() == "pos:"+std::to_string(steps)+"@2");
+    mock_serial->mock_send("lift:done:2");
 
-    mock_clock->advance_ms(1500);
+    mock_clock->advance_ms(1);
     t.update();
     REQUIRE(t.isActionRunning() == false);
 }
 
+TEST_CASE("Step watchdog", "[TrayController]")
+{
+    MockSerialComms* mock_serial = build_and_get_mock_serial(CLEARCORE_USB);;
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+    TrayController t;
+    t.setTrayInitialized(true);
+    int latch_timeout_ms = cfg.lookup("tray.latch_timeout_ms");
+    int move_timeout_ms = cfg.lookup("tray.move_timeout_ms");
+
+    REQUIRE(t.place() == true);
+    mock_clock->advance_ms(1);
+    t.update();
+    mock_serial->purge_data();
+
+    SECTION("Timeout")
+    {
+        mock_clock->advance_ms(move_timeout_ms - 10);
+        t.update();
+        REQUIRE(t.isActionRunning() == true);
+
+        mock_clock->advance_ms(20);
+        t.update();
+        REQUIRE(t.isActionRunning() == false);
+        REQUIRE(t.hasFault() == true);
+        REQUIRE(t.getTrayState().fault == true);
+        REQUIRE(mock_serial->mock_rcv_lift() == "stop");
+    }
+
+    SECTION("Per step timeout")
+    {
+        mock_serial->mock_send("lift:done:1");
+        mock_clock->advance_ms(1);
+        t.update();
+        REQUIRE(mock_serial->mock_rcv_lift() == "open@2");
+
+        mock_clock->advance_ms(latch_timeout_ms + 10);
+        t.update();
+        REQUIRE(t.isActionRunning() == false);
+        REQUIRE(t.hasFault() == true);
+    }
+
+    SECTION("Rejected")
+    {
+        mock_serial->mock_send("lift:rejected:1");
+        mock_clock->advance_ms(1);
+        t.update();
+        REQUIRE(t.isActionRunning() == false);
+        REQUIRE(t.hasFault() == true);
+        REQUIRE(mock_serial->mock_rcv_lift() == "stop");
+    }
+
+    // Fault only lasts until the next action
+    REQUIRE(t.load() == true);
+    REQUIRE(t.hasFault() == false);
+}
+
 TEST_CASE("Errors when tray not initialized", "[TrayController]")
 {
     TrayController t;
@@ -160,4 +213,4 @@ TEST_CASE("Errors when tray not initialized", "[TrayController]")
 
     REQUIRE(t.place() == false);
     REQUIRE(t.load() == false);
-}
\ No newline at end of file
+}
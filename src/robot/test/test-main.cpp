@@ -5,6 +5,7 @@
 #include "sockets/SocketMultiThreadWrapperFactory.h"
 #include "camera_tracker/CameraTrackerFactory.h"
 #include "utils.h"
+#include "test-utils.h"
 
 #include <plog/Log.h> 
 #include <plog/Init.h>
@@ -33,6 +34,8 @@ void configure_logger()
 int main( int argc, char* argv[] ) 
 {
     cfg.readFile(TEST_CONSTANTS_FILE);
+    // Robots built by the tests record telemetry, keep it out of the source tree
+    cfg.lookup("telemetry.path") = temp_test_path("test_telemetry.bin");
     configure_logger();
     SerialCommsFactory::getFactoryInstance()->set_mode(SERIAL_FACTORY_MODE::MOCK);
     SocketMultiThreadWrapperFactory::getFactoryInstance()->set_mode(SOCKET_FACTORY_MODE::MOCK);
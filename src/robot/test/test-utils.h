@@ -7,6 +7,7 @@
 #include "sockets/SocketMultiThreadWrapperFactory.h"
 #include "sockets/MockSocketMultiThreadWrapper.h"
 #include "utils.h"
+#include <filesystem>
 #include <variant>
 
 inline MockSocketMultiThreadWrapper* build_and_get_mock_socket() 
@@ -47,6 +48,14 @@ inline void reset_mock_clock()
     mock_clock->set_now();
 }
 
+// Path for a file written by a test, under the system temp directory so test output stays out of the source tree
+inline std::string temp_test_path(const std::string& name)
+{
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "dominorobot_test";
+    std::filesystem::create_directories(dir);
+    return (dir / name).string();
+}
+
 // Helper class to modify a global setting which will revert the setting change when going out of scope
 template <typename T>
 class SafeConfigModifier
@@ -1,5 +1,6 @@
 #include <Catch/catch.hpp>
 #include <unistd.h>
+#include <thread>
 
 #include "utils.h"
 #include "test-utils.h"
@@ -132,6 +133,105 @@ TEST_CASE("TimeRunningAverage - Variable timing", "[utils]")
     }
 }
 
+TEST_CASE("TimeRunningAverage - Sub millisecond timing", "[utils]")
+{
+    TimeRunningAverage T = TimeRunningAverage(20);
+    MockClockWrapper* mock_clock = get_mock_clock_and_reset();
+
+    T.mark_point();
+    for(int i = 0; i < 20; i++)
+    {
+        mock_clock->advance_us(i == 10 ? 40000 : 25300);
+        T.mark_point();
+    }
+
+    REQUIRE(T.get_ms() == Approx((19 * 25.3 + 40.0) / 20));
+    REQUIRE(T.get_max_ms() == Approx(40.0));
+    REQUIRE(T.get_p99_ms() == Approx(40.0));
+    REQUIRE(T.get_stats().get_min() == 25300);
+}
+
+TEST_CASE("WindowedStats", "[utils]")
+{
+    WindowedStats s = WindowedStats(4);
+    REQUIRE(s.get_count() == 0);
+    REQUIRE(s.get_mean() == 0);
+    REQUIRE(s.get_max() == 0);
+    REQUIRE(s.get_percentile(0.99) == 0);
+
+    for(uint32_t v : {5, 1, 9, 3})
+    {
+        s.add(v);
+    }
+    REQUIRE(s.get_count() == 4);
+    REQUIRE(s.get_mean() == Approx(4.5));
+    REQUIRE(s.get_stddev() == Approx(std::sqrt(8.75)));
+    REQUIRE(s.get_min() == 1);
+    REQUIRE(s.get_max() == 9);
+    REQUIRE(s.get_percentile(0.5) == 3);
+    REQUIRE(s.get_percentile(0.99) == 9);
+
+    SECTION("Window slides")
+    {
+        // 5, 1 and 9 leave the window
+        for(uint32_t v : {4, 2, 6})
+        {
+            s.add(v);
+        }
+        REQUIRE(s.get_count() == 4);
+        REQUIRE(s.get_mean() == Approx(3.75));
+        REQUIRE(s.get_min() == 2);
+        REQUIRE(s.get_max() == 6);
+        REQUIRE(s.get_percentile(0.99) == 6);
+    }
+
+    SECTION("Reset")
+    {
+        s.reset();
+        REQUIRE(s.get_count() == 0);
+        s.add(7);
+        REQUIRE(s.get_min() == 7);
+        REQUIRE(s.get_max() == 7);
+        REQUIRE(s.get_mean() == Approx(7));
+    }
+}
+
+TEST_CASE("LogLinearBuckets", "[utils]")
+{
+    using Buckets = LogLinearBuckets<3>;
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        REQUIRE(Buckets::index(i) == static_cast<int>(i));
+        REQUIRE(Buckets::upperBound(i) == i);
+    }
+    for(uint32_t value : {16u, 17u, 31u, 32u, 100u, 12345u, 4000000000u})
+    {
+        int idx = Buckets::index(value);
+        REQUIRE(idx < Buckets::num_buckets);
+        REQUIRE(Buckets::upperBound(idx) >= value);
+        REQUIRE(Buckets::upperBound(idx) - value <= value / Buckets::sub_bucket_count);
+        // The bucket below ends just before this one starts
+        REQUIRE(Buckets::upperBound(idx - 1) < value);
+    }
+    REQUIRE(Buckets::index(UINT32_MAX) == Buckets::num_buckets - 1);
+}
+
+TEST_CASE("WindowedStats - Percentile accuracy", "[utils]")
+{
+    WindowedStats s = WindowedStats(1000);
+    for(uint32_t i = 0; i < 3000; i++)
+    {
+        s.add(20000 + (i * 7919) % 1000 * 10);
+    }
+    // Last 1000 values cover 20000 to 29990 evenly
+    REQUIRE(s.get_min() == 20000);
+    REQUIRE(s.get_max() == 29990);
+    REQUIRE(s.get_mean() == Approx(24995));
+    REQUIRE(s.get_percentile(0.5) == Approx(25000).epsilon(0.13));
+    REQUIRE(s.get_percentile(0.99) == Approx(29900).epsilon(0.13));
+    REQUIRE(s.get_percentile(0.99) <= s.get_max());
+}
+
 TEST_CASE("Rate controller - slow", "[utils]")
 {
     SafeConfigModifier<bool> config_modifier("motion.rate_always_ready", false);
@@ -380,6 +480,58 @@ TEST_CASE("PositionController", "[utils]")
 
 }
 
+TEST_CASE("TrackingController", "[utils]")
+{
+    SECTION("Feedforward")
+    {
+        TrackingController::Gains gains {1,0,0.5,0.1};
+        TrackingController controller(gains, 1.0);
+
+        float cmd_vel = controller.compute(1.0, 0.5, 1.0, 0.0, 2.0, 0.1);
+        REQUIRE(cmd_vel == Approx(2.2));
+    }
+
+    SECTION("Correction limit and anti-windup")
+    {
+        TrackingController::Gains gains {1,1,0,0};
+        TrackingController controller(gains, 0.5);
+
+        // Big error saturates the correction, and the error sum doesn't build up while it is
+        for (int i = 0; i < 100; i++)
+        {
+            REQUIRE(controller.compute(2.0, 0.0, 1.0, 1.0, 0, 0.1) == Approx(1.5));
+        }
+
+        // So the integral doesn't push back past the target once the error is gone
+        float cmd_vel = controller.compute(1.0, 1.0, 1.0, 1.0, 0, 0.1);
+        REQUIRE(cmd_vel == Approx(1.0));
+
+        // Once the correction is clear of the limit, the error sum grows as usual
+        controller.compute(1.0, 0.9, 0.0, 0.0, 0, 0.1);
+        cmd_vel = controller.compute(1.0, 0.9, 0.0, 0.0, 0, 0.1);
+        REQUIRE(cmd_vel == Approx(0.12));
+    }
+
+    SECTION("Step response with gain change")
+    {
+        TrackingController controller({2,1,0.01,0}, 0.5);
+
+        float actual_pos = 0.0;
+        float actual_vel = 0.0;
+        float dt = 0.1;
+        for (int i = 0; i < 200; i++) 
+        {
+            if(i == 20) controller.setGains({1,0.5,0.01,0});
+            actual_vel = controller.compute(1.0, actual_pos, 0.0, actual_vel, 0.0, dt);
+            REQUIRE(fabs(actual_vel) <= 0.5);
+            actual_pos += actual_vel*dt;
+        }
+
+        REQUIRE(actual_vel == Approx(0).margin(0.001));
+        REQUIRE(actual_pos == Approx(1.0).margin(0.001));
+    }
+}
+
 
 TEST_CASE("VectorMath", "[utils]")
 {
@@ -519,4 +671,102 @@ TEST_CASE("LatchedBool", "[utils]")
         mock_clock->advance_sec(0.6);
         CHECK(lb.update(false) == true);
     }
-}
\ No newline at end of file
+}
+TEST_CASE("SpscQueue", "[utils]")
+{
+    SpscQueue<int> q(3);
+    int val = 0;
+
+    SECTION("Empty")
+    {
+        REQUIRE(q.empty());
+        REQUIRE(q.pop(val) == false);
+    }
+
+    SECTION("Push and pop in order")
+    {
+        REQUIRE(q.push(1));
+        REQUIRE(q.push(2));
+        REQUIRE(q.empty() == false);
+        REQUIRE(q.pop(val));
+        REQUIRE(val == 1);
+        REQUIRE(q.pop(val));
+        REQUIRE(val == 2);
+        REQUIRE(q.empty());
+    }
+
+    SECTION("Full")
+    {
+        REQUIRE(q.push(1));
+        REQUIRE(q.push(2));
+        REQUIRE(q.push(3));
+        REQUIRE(q.push(4) == false);
+        REQUIRE(q.pop(val));
+        REQUIRE(val == 1);
+        REQUIRE(q.push(4));
+        for (int i = 2; i <= 4; i++)
+        {
+            REQUIRE(q.pop(val));
+            REQUIRE(val == i);
+        }
+    }
+
+    SECTION("Two threads")
+    {
+        const int num_values = 10000;
+        std::thread producer([&q]() {
+            for (int i = 0; i < num_values; i++)
+            {
+                int v = i;
+                while(!q.push(std::move(v))) {}
+            }
+        });
+        bool in_order = true;
+        for (int i = 0; i < num_values; i++)
+        {
+            while(!q.pop(val)) {}
+            if (val != i) in_order = false;
+        }
+        producer.join();
+        REQUIRE(in_order);
+        REQUIRE(q.empty());
+    }
+
+    SECTION("Two threads blocking")
+    {
+        // Bigger than the queue so the producer has to wait for room as well
+        const int num_values = 1000;
+        std::atomic<bool> running(true);
+        std::thread producer([&q, &running]() {
+            for (int i = 0; i < num_values; i++)
+            {
+                int v = i;
+                q.waitPush(std::move(v), running);
+            }
+        });
+        bool in_order = true;
+        for (int i = 0; i < num_values; i++)
+        {
+            REQUIRE(q.waitPop(val, running));
+            if (val != i) in_order = false;
+        }
+        producer.join();
+        REQUIRE(in_order);
+        REQUIRE(q.empty());
+    }
+
+    SECTION("Wake a blocked consumer")
+    {
+        std::atomic<bool> running(true);
+        bool popped = true;
+        std::thread consumer([&q, &running, &popped]() {
+            int v = 0;
+            popped = q.waitPop(v, running);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        running = false;
+        q.wakeAll();
+        consumer.join();
+        REQUIRE(popped == false);
+    }
+}
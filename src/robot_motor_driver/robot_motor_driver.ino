@@ -88,6 +88,7 @@ struct Command
     bool latch_open;
     bool latch_close;
     bool status_req;
+    int step_id;
 };
 
 struct CartVelocity
@@ -129,6 +130,7 @@ struct MotorVelocity
 // --------------------------------------------------
 
 MODE activeMode = MODE::NONE;
+int activeStepId = -1;
 unsigned long prevLatchMillis = millis();
 unsigned long prevLatchManualTriggerMillis = millis();
 bool prev_latch_state_open = false;
@@ -171,12 +173,21 @@ bool checkForLifterButtonFallingEdge(bool button_state)
 // "home", "stop", or an integer representing position to move to
 // "open" or "close" controls the latch servo
 // "status_req" will request a status of the mode
+// Any command can end in "@<id>", in which case "done:<id>" is sent back once it finishes
+// or "rejected:<id>" if it could not be started
 // Note that this assumes the message has already been validated
 Command decodeLifterMsg(String msg_in)
 {
     // Strip identifier
     String msg = msg_in.substring(5);
-    Command c = {0, false, false, false, false, false, false};
+    Command c = {0, false, false, false, false, false, false, -1};
+
+    int id_idx = msg.indexOf('@');
+    if(id_idx >= 0)
+    {
+        c.step_id = msg.substring(id_idx + 1).toInt();
+        msg = msg.substring(0, id_idx);
+    }
 
 #if PRINT_DEBUG
     comm.send("DEBUG Incoming lifter message: " + msg);
@@ -217,10 +228,21 @@ Command decodeLifterMsg(String msg_in)
     return c;
 }
 
+// Report the end of the commanded step right away so the robot doesn't need to poll for it
+void finishActiveStep()
+{
+    activeMode = MODE::NONE;
+    if(activeStepId >= 0)
+    {
+        comm.send("lift:done:" + String(activeStepId));
+        activeStepId = -1;
+    }
+}
+
 void lifter_update(String msg)
 {
     // Verify if incoming message is for lifter
-    Command inputCommand = {0, false, false, false, false, false};
+    Command inputCommand = {0, false, false, false, false, false, false, -1};
     bool valid_msg = false;
     if(msg.length() > 0 && msg.startsWith("lift:")) 
     { 
@@ -254,6 +276,7 @@ void lifter_update(String msg)
     if (inputCommand.valid && inputCommand.stop)
     {
         activeMode = MODE::NONE;
+        activeStepId = -1;
 //        LIFTER_MOTOR.EnableRequest(false);
     }
     // For any other command, we will only handle it when there are no other active commands
@@ -276,6 +299,7 @@ void lifter_update(String msg)
         else if(inputCommand.valid && inputCommand.home)
         {
             activeMode = MODE::HOMING;
+            activeStepId = inputCommand.step_id;
             LIFTER_MOTOR.EnableRequest(true);
             LIFTER_MOTOR.MoveVelocity(-1*LIFTER_HOMING_VEL*LIFTER_STEPS_PER_REV);
         }
@@ -283,6 +307,7 @@ void lifter_update(String msg)
                  (manaul_servo_toggle && !prev_latch_state_open))
         {
             activeMode = MODE::LATCH_OPEN;
+            activeStepId = inputCommand.step_id;
             analogWrite(LATCH_SERVO_PIN, LATCH_OPEN_DUTY_CYCLE);
             prev_latch_state_open = true;
             prevLatchMillis = millis();
@@ -291,6 +316,7 @@ void lifter_update(String msg)
                  (manaul_servo_toggle && prev_latch_state_open))
         {
             activeMode = MODE::LATCH_CLOSE;
+            activeStepId = inputCommand.step_id;
             analogWrite(LATCH_SERVO_PIN, LATCH_CLOSE_DUTY_CYCLE);
             prev_latch_state_open = false;
             prevLatchMillis = millis();
@@ -306,6 +332,7 @@ void lifter_update(String msg)
             if(inputCommand.abs_pos <= SAFETY_MAX_POS && inputCommand.abs_pos >= SAFETY_MIN_POS)
             {
                 activeMode = MODE::AUTO_POS;
+                activeStepId = inputCommand.step_id;
                 long target = inputCommand.abs_pos;
                 LIFTER_MOTOR.EnableRequest(true);
                 LIFTER_MOTOR.Move(target, StepGenerator::MOVE_TARGET_ABSOLUTE);
@@ -313,6 +340,11 @@ void lifter_update(String msg)
         }
     }    
 
+    // Let the robot know right away if a step it is waiting on was dropped because the lifter was busy
+    if (inputCommand.valid && inputCommand.step_id >= 0 && !inputCommand.stop && activeStepId != inputCommand.step_id)
+    {
+        comm.send("lift:rejected:" + String(inputCommand.step_id));
+    }
 
     // Handle continous updates for each mode
     String status_str = "lift:none";
@@ -329,7 +361,7 @@ void lifter_update(String msg)
         status_str = "lift:pos";
         if(LIFTER_MOTOR.StepsComplete())
         {
-            activeMode = MODE::NONE;
+            finishActiveStep();
         }
     }
     else if(activeMode == MODE::HOMING)
@@ -338,7 +370,7 @@ void lifter_update(String msg)
         {
             LIFTER_MOTOR.MoveStopAbrupt();
             LIFTER_MOTOR.PositionRefSet(0);
-            activeMode = MODE::NONE;
+            finishActiveStep();
         }
         status_str = "lift:homing";
     }
@@ -347,7 +379,7 @@ void lifter_update(String msg)
         status_str = "lift:close";
         if(millis() - prevLatchMillis > LATCH_ACTIVE_MS)
         {
-            activeMode = MODE::NONE;
+            finishActiveStep();
         }
     }
     else if (activeMode == MODE::LATCH_OPEN)
@@ -355,7 +387,7 @@ void lifter_update(String msg)
         status_str = "lift:open";
         if(millis() - prevLatchMillis > LATCH_ACTIVE_MS)
         {
-            activeMode = MODE::NONE;
+            finishActiveStep();
         }
     }
     else if (activeMode == MODE::NONE)